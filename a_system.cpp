@@ -12,6 +12,7 @@
 #include "u_misc.h"
 #include "u_memory.h"
 #include "u_log.h"
+#include "u_profiler.h"
 
 #include "engine.h"
 
@@ -941,6 +942,7 @@ void Audio::mixLane(float *buffer, size_t samples, float *scratch, int lane) {
 }
 
 void Audio::mix(float *buffer, size_t samples) {
+    U_PROFILE("audio");
     float bufferTime = samples / float(m_sampleRate);
     m_streamTime += bufferTime;
 
@@ -15,6 +15,7 @@
 #include "c_config.h"
 
 #include "r_common.h"
+#include "r_buffer.h"
 #include "r_model.h"
 #include "r_world.h"
 
@@ -22,6 +23,8 @@
 #include "u_misc.h"
 #include "u_set.h"
 #include "u_log.h"
+#include "u_jobs.h"
+#include "u_profiler.h"
 
 #include "s_runtime.h"
 #include "s_memory.h"
@@ -181,6 +184,9 @@ VAR(u::string, vid_display, "name of the display to use for video");
 VAR(int, scr_info, "embed engine info in screenshot", 0, 1, 1);
 VAR(int, scr_format, "screenshot file format (0 = BMP, 1 = TGA, 2 = PNG, 3 = JPG)", 0, 3, 3);
 VAR(float, scr_quality, "screenshot quality", 0.0f, 1.0f, 1.0f);
+VAR(int, scr_burst, "consecutive frames captured by a screenshot", 1, 3600, 1);
+
+NVAR(int, prof_trace, "write a trace of the given number of frames", 0, 3600, 0);
 
 /// pimpl context
 struct Context {
@@ -220,6 +226,7 @@ struct Context {
 
 private:
     friend struct Engine;
+    friend struct RenderThread;
     u::map<int, Controller> m_controllers;
     SDL_GLContext m_gl;
     SDL_Window *m_window;
@@ -345,6 +352,221 @@ inline void Context::Controller::close() {
     SDL_GameControllerClose(m_gamePad);
 }
 
+/// asynchronous screenshots
+//
+// The final frame is read into a pixel buffer object at the end of the frame
+// a screenshot was requested in and mapped a frame later, once the read has
+// completed. Flipping, annotating and encoding happen on a writer thread such
+// that bursts of frames can be captured without stalling the game.
+struct ScreenShots {
+    static constexpr size_t kBuffers = 2;
+    static constexpr size_t kMaxQueued = 16; // bursts drop frames beyond this
+
+    ScreenShots();
+
+    void request(const u::string &file, size_t frames);
+    void capture(size_t width, size_t height); // called at the end of every frame
+    void shutdown(); // finish pending screenshots before the context is lost
+
+private:
+    struct Capture {
+        u::string file;
+        size_t width;
+        size_t height;
+        SaveFormat format;
+        float quality;
+        bool info;
+        u::vector<unsigned char> pixels;
+    };
+
+    struct Slot {
+        GLuint buffer;
+        size_t size;
+        bool pending;
+        Capture *capture;
+    };
+
+    static int writerThread(void *data);
+    static void write(Capture *capture, const u::vector<u::string> &info);
+    void read(Slot &slot);
+
+    Slot m_slots[kBuffers];
+    size_t m_slot;
+    u::string m_file;
+    size_t m_frames; // left to capture
+    size_t m_frame; // number of the next frame in a burst
+    bool m_burst;
+    u::vector<u::string> m_info; // system information, gathered on the GL thread
+    u::vector<Capture*> m_queue;
+    SDL_mutex *m_mutex;
+    SDL_sem *m_semaphore;
+    SDL_Thread *m_thread;
+};
+
+ScreenShots::ScreenShots()
+    : m_slot(0)
+    , m_frames(0)
+    , m_frame(0)
+    , m_burst(false)
+    , m_mutex(nullptr)
+    , m_semaphore(nullptr)
+    , m_thread(nullptr)
+{
+    memset(m_slots, 0, sizeof m_slots);
+}
+
+void ScreenShots::request(const u::string &file, size_t frames) {
+    if (!m_thread) {
+        m_mutex = SDL_CreateMutex();
+        m_semaphore = SDL_CreateSemaphore(0);
+        m_thread = SDL_CreateThread(writerThread, "screenshots", this);
+    }
+    m_file = file;
+    m_frames = frames;
+    m_frame = 0;
+    m_burst = frames > 1;
+}
+
+void ScreenShots::read(Slot &slot) {
+    // the read was issued a frame ago and has most likely completed by now
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    Capture *capture = slot.capture;
+    const size_t size = capture->width * capture->height * 3;
+    const auto *pixels = (const unsigned char *)gl::MapBufferRange(GL_PIXEL_PACK_BUFFER,
+        0, size, GL_MAP_READ_BIT);
+    if (pixels) {
+        capture->pixels.resize(size);
+        memcpy(&capture->pixels[0], pixels, size);
+        gl::UnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.pending = false;
+    slot.capture = nullptr;
+
+    SDL_LockMutex(m_mutex);
+    const bool full = m_queue.size() >= kMaxQueued;
+    if (pixels && !full)
+        m_queue.push_back(capture);
+    SDL_UnlockMutex(m_mutex);
+    if (pixels && !full) {
+        SDL_SemPost(m_semaphore);
+        return;
+    }
+    u::Log::err("[screenshot] => dropped %s\n", u::fixPath(capture->file));
+    delete capture;
+}
+
+void ScreenShots::capture(size_t width, size_t height) {
+    if (!m_thread)
+        return;
+
+    // hand the frame read last frame to the writer
+    Slot &previous = m_slots[(m_slot + kBuffers - 1) % kBuffers];
+    if (previous.pending)
+        read(previous);
+
+    if (!m_frames)
+        return;
+
+    // created here as the request may come from a thread without the context
+    if (!m_slots[0].buffer)
+        gl::GenBuffers(kBuffers, &m_slots[0].buffer);
+
+    if (m_info.empty()) {
+        m_info.push_back(gOperatingSystem);
+        m_info.push_back(u::CPUDesc());
+        m_info.push_back(u::RAMDesc());
+        m_info.push_back((const char *)gl::GetString(GL_VENDOR));
+        m_info.push_back((const char *)gl::GetString(GL_RENDERER));
+        m_info.push_back((const char *)gl::GetString(GL_VERSION));
+        m_info.push_back((const char *)gl::GetString(GL_SHADING_LANGUAGE_VERSION));
+        m_info.push_back("Extensions");
+        for (auto &it : gl::extensions())
+            m_info.push_back(u::format(" %s", gl::extensionString(it)));
+    }
+
+    Capture *capture = new Capture;
+    capture->file = m_burst ? u::format("%s-%04zu", m_file, m_frame++) : m_file;
+    capture->width = width;
+    capture->height = height;
+    capture->format = SaveFormat(scr_format.get());
+    capture->quality = scr_quality;
+    capture->info = scr_info;
+    m_frames--;
+
+    // issue the read into a pixel buffer object, it completes asynchronously
+    Slot &slot = m_slots[m_slot];
+    const size_t size = width * height * 3;
+    gl::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.size != size) {
+        gl::BufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.size = size;
+    }
+    gl::PixelStorei(GL_PACK_ALIGNMENT, 1);
+    gl::ReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    gl::PixelStorei(GL_PACK_ALIGNMENT, 8);
+    gl::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.pending = true;
+    slot.capture = capture;
+    m_slot = (m_slot + 1) % kBuffers;
+}
+
+void ScreenShots::shutdown() {
+    if (!m_thread)
+        return;
+
+    for (auto &it : m_slots)
+        if (it.pending)
+            read(it);
+    gl::DeleteBuffers(kBuffers, &m_slots[0].buffer);
+
+    // a null capture stops the writer once everything before it was written
+    SDL_LockMutex(m_mutex);
+    m_queue.push_back(nullptr);
+    SDL_UnlockMutex(m_mutex);
+    SDL_SemPost(m_semaphore);
+    SDL_WaitThread(m_thread, nullptr);
+    SDL_DestroySemaphore(m_semaphore);
+    SDL_DestroyMutex(m_mutex);
+    m_thread = nullptr;
+}
+
+int ScreenShots::writerThread(void *data) {
+    auto &self = *(ScreenShots *)data;
+    for (;;) {
+        SDL_SemWait(self.m_semaphore);
+        SDL_LockMutex(self.m_mutex);
+        Capture *capture = self.m_queue[0];
+        self.m_queue.erase(self.m_queue.begin(), self.m_queue.begin() + 1);
+        SDL_UnlockMutex(self.m_mutex);
+        if (!capture)
+            break;
+        write(capture, self.m_info);
+        delete capture;
+    }
+    return 0;
+}
+
+void ScreenShots::write(Capture *capture, const u::vector<u::string> &info) {
+    Texture screenShot(&capture->pixels[0], capture->pixels.size(),
+        capture->width, capture->height, false, kTexFormatRGB);
+    capture->pixels.destroy();
+    screenShot.flip();
+    if (capture->info) {
+        size_t line = 0;
+        for (const auto &it : info)
+            screenShot.drawString(line, it.c_str());
+    }
+    if (screenShot.save(capture->file, capture->format, capture->quality)) {
+        u::Log::out("[screenshot] => %s.%s\n", u::fixPath(capture->file),
+            kSaveFormatExtensions[capture->format]);
+    }
+}
+
+static ScreenShots gScreenShots;
+
 /// engine
 static Engine gEngine;
 
@@ -354,6 +576,7 @@ inline Engine::Engine()
     , m_screenWidth(0)
     , m_screenHeight(0)
     , m_refreshRate(0)
+    , m_hidden(false)
     , m_context(nullptr)
 {
 }
@@ -362,6 +585,135 @@ inline Engine::~Engine() {
     delete CTX(m_context);
 }
 
+/// render thread
+//
+// The render thread owns the context from the first frame the game submits on.
+// Frames are handed over one at a time, submitting waits until the previous one
+// has been presented such that the game builds the next frame while the render
+// thread submits this one. State the render thread reads outside of the frame
+// is only changed after waiting for it to go idle.
+struct RenderThread {
+    static constexpr int kNoSwapInterval = -2;
+
+    RenderThread();
+
+    void submit(void (*render)(void *), void *frame);
+    void wait(); // until the frame submitted last has been presented
+    void stop(); // the calling thread owns the context again
+    bool running() const;
+
+    // only after wait(), applied before the next frame is rendered
+    void resize();
+    void setSwapInterval(int interval);
+
+private:
+    static int renderThread(void *data);
+
+    void (*m_render)(void *);
+    void *m_frame;
+    bool m_quit;
+    bool m_resized;
+    int m_swapInterval;
+    SDL_sem *m_ready; // a frame was submitted
+    SDL_sem *m_done; // the frame was presented
+    SDL_Thread *m_thread;
+};
+
+constexpr int RenderThread::kNoSwapInterval;
+
+static RenderThread gRenderThread;
+
+RenderThread::RenderThread()
+    : m_render(nullptr)
+    , m_frame(nullptr)
+    , m_quit(false)
+    , m_resized(false)
+    , m_swapInterval(kNoSwapInterval)
+    , m_ready(nullptr)
+    , m_done(nullptr)
+    , m_thread(nullptr)
+{
+}
+
+int RenderThread::renderThread(void *data) {
+    RenderThread *const self = (RenderThread *)data;
+    Context *const context = CTX(gEngine.m_context);
+    SDL_GL_MakeCurrent(context->m_window, context->m_gl);
+    for (;;) {
+        SDL_SemWait(self->m_ready);
+        if (self->m_quit)
+            break;
+        if (self->m_resized) {
+            gl::Viewport(0, 0, neoWidth(), neoHeight());
+            self->m_resized = false;
+        }
+        if (self->m_swapInterval != kNoSwapInterval) {
+            // late swap tearing is not supported everywhere
+            if (SDL_GL_SetSwapInterval(self->m_swapInterval) == -1 && self->m_swapInterval == kSyncTear)
+                SDL_GL_SetSwapInterval(0);
+            self->m_swapInterval = kNoSwapInterval;
+        }
+        {
+            U_PROFILE("render");
+            self->m_render(self->m_frame);
+        }
+        gEngine.present();
+        SDL_SemPost(self->m_done);
+    }
+    SDL_GL_MakeCurrent(context->m_window, nullptr);
+    return 0;
+}
+
+void RenderThread::submit(void (*render)(void *), void *frame) {
+    if (!m_thread) {
+        m_ready = SDL_CreateSemaphore(0);
+        m_done = SDL_CreateSemaphore(1);
+        // the context can only be current on one thread at a time
+        SDL_GL_MakeCurrent(CTX(gEngine.m_context)->m_window, nullptr);
+        m_thread = SDL_CreateThread(renderThread, "render", this);
+    }
+    SDL_SemWait(m_done);
+    m_render = render;
+    m_frame = frame;
+    SDL_SemPost(m_ready);
+}
+
+void RenderThread::wait() {
+    if (!m_thread)
+        return;
+    SDL_SemWait(m_done);
+    SDL_SemPost(m_done);
+}
+
+void RenderThread::stop() {
+    if (!m_thread)
+        return;
+    SDL_SemWait(m_done);
+    m_quit = true;
+    SDL_SemPost(m_ready);
+    SDL_WaitThread(m_thread, nullptr);
+    SDL_DestroySemaphore(m_ready);
+    SDL_DestroySemaphore(m_done);
+    m_ready = nullptr;
+    m_done = nullptr;
+    m_thread = nullptr;
+    m_quit = false;
+    Context *const context = CTX(gEngine.m_context);
+    SDL_GL_MakeCurrent(context->m_window, context->m_gl);
+}
+
+bool RenderThread::running() const {
+    return m_thread;
+}
+
+void RenderThread::resize() {
+    m_resized = true;
+}
+
+void RenderThread::setSwapInterval(int interval) {
+    m_swapInterval = interval;
+}
+
 bool Engine::init(int &argc, char **argv) {
     // Establish local timers for the engine
     if (!initTimers())
@@ -373,8 +725,14 @@ bool Engine::init(int &argc, char **argv) {
     if (!initContext())
         return false;
 
-    setVSyncOption(vid_vsync);
-    m_frameTimer.cap(vid_maxfps);
+    if (m_hidden) {
+        // measure frames as fast as they can be rendered
+        setVSyncOption(kSyncNone);
+        m_frameTimer.cap(0);
+    } else {
+        setVSyncOption(vid_vsync);
+        m_frameTimer.cap(vid_maxfps);
+    }
 
     return true;
 }
@@ -472,7 +830,9 @@ bool Engine::initContext() {
     u::unique_ptr<Context> ctx(new Context);
 
     uint32_t flags = SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE;
-    if (vid_fullscreen)
+    if (m_hidden)
+        flags |= SDL_WINDOW_HIDDEN;
+    else if (vid_fullscreen)
         flags |= SDL_WINDOW_FULLSCREEN;
 
 #if defined(_MSC_VER)
@@ -583,11 +943,17 @@ bool Engine::initData(int &argc, char **argv) {
         }
     }
 
+    // The timedemo and the replay render into a hidden window, the argument
+    // is left for the game to handle
+    for (int i = 1; i < argc; i++)
+        if (argv[i] && (!strcmp(argv[i], "-timedemo") || !strcmp(argv[i], "-replay")))
+            m_hidden = true;
+
     // Check if the game directory even exists. But fix it to the platforms
     // path separator rules before verifying.
     // Engine paths
     static const char *kPaths[] = {
-        "screenshots", "cache", "tmp"
+        "screenshots", "cache", "tmp", "demos", "traces", "captures"
     };
     u::string fixedDirectory;
     if (directory) {
@@ -653,10 +1019,35 @@ void Engine::bindSet(const u::string &what, void (*handler)()) {
     m_binds[what] = handler;
 }
 
+void Engine::present() {
+    r::streamBuffers::instance().end();
+    gScreenShots.capture(m_screenWidth, m_screenHeight);
+    gl::captureFrame();
+    {
+        U_PROFILE("swap");
+        SDL_GL_SwapWindow(CTX(m_context)->m_window);
+    }
+    r::streamBuffers::instance().begin();
+}
+
 void Engine::swap() {
-    SDL_GL_SwapWindow(CTX(m_context)->m_window);
+    // the render thread presents the frames submitted to it
+    if (!gRenderThread.running())
+        present();
     m_frameTimer.update();
 
+    // The profiled scopes of the frame which just finished
+    u::gProfiler.frame();
+    if (prof_trace) {
+        const time_t t = time(nullptr);
+        const struct tm tm = *localtime(&t);
+        const u::string file = u::format("%straces/%d-%d-%d-%d%d%d.json",
+            neoUserPath(), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+            tm.tm_hour, tm.tm_min, tm.tm_sec);
+        u::gProfiler.trace(file, prof_trace);
+        prof_trace.set(0);
+    }
+
     auto callBind = [this](const char *what) {
         if (m_binds.find(what) != m_binds.end())
             m_binds[what]();
@@ -828,28 +1219,42 @@ void Engine::setWindowTitle(const char *title) {
 }
 
 void Engine::resize(size_t width, size_t height) {
+    // the render thread reads the size while it renders a frame
+    gRenderThread.wait();
     SDL_SetWindowSize(CTX(m_context)->m_window, width, height);
     m_screenWidth = width;
     m_screenHeight = height;
-    gl::Viewport(0, 0, width, height);
+    if (gRenderThread.running())
+        gRenderThread.resize();
+    else
+        gl::Viewport(0, 0, width, height);
     vid_width.set(width);
     vid_height.set(height);
 }
 
 void Engine::setVSyncOption(int option) {
+    // the render thread owns the context, it changes the interval before the
+    // next frame and falls back to no synchronization when tearing fails
+    gRenderThread.wait();
+    const auto setSwapInterval = [](int interval) {
+        if (!gRenderThread.running())
+            return SDL_GL_SetSwapInterval(interval);
+        gRenderThread.setSwapInterval(interval);
+        return 0;
+    };
     switch (option) {
     case kSyncTear:
-        if (SDL_GL_SetSwapInterval(-1) == -1)
+        if (setSwapInterval(-1) == -1)
             setVSyncOption(kSyncRefresh);
         break;
     case kSyncNone:
-        SDL_GL_SetSwapInterval(0);
+        setSwapInterval(0);
         break;
     case kSyncEnabled:
-        SDL_GL_SetSwapInterval(1);
+        setSwapInterval(1);
         break;
     case kSyncRefresh:
-        SDL_GL_SetSwapInterval(0);
+        setSwapInterval(0);
         m_frameTimer.unlock();
         m_frameTimer.cap(m_refreshRate);
         m_frameTimer.lock();
@@ -866,49 +1271,9 @@ void Engine::screenShot() {
         neoUserPath(), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
         tm.tm_hour, tm.tm_min, tm.tm_sec);
 
-    // Get metrics for reading the final composite from GL
-    const int screenWidth = int(neoWidth());
-    const int screenHeight = int(neoHeight());
-    const int screenSize = screenWidth * screenHeight;
-    auto pixels = u::unique_ptr<unsigned char>(new unsigned char[screenSize * 3]);
-
-    // make sure we're reading from the final framebuffer when obtaining the pixels
-    // for the screenshot.
-    gl::BindFramebuffer(GL_READ_FRAMEBUFFER, 0);
-    gl::PixelStorei(GL_PACK_ALIGNMENT, 1);
-    gl::ReadPixels(0, 0, screenWidth, screenHeight, GL_RGB, GL_UNSIGNED_BYTE,
-        (GLvoid *)pixels.get());
-    gl::PixelStorei(GL_PACK_ALIGNMENT, 8);
-
-    // Construct a texture object from the pixel data
-    Texture screenShot(&pixels[0], screenSize*3, screenWidth, screenHeight, false, kTexFormatRGB);
-    screenShot.flip();
-    if (scr_info) {
-        size_t line = 0;
-        auto vendor = (const char *)gl::GetString(GL_VENDOR);
-        auto renderer = (const char *)gl::GetString(GL_RENDERER);
-        auto version = (const char *)gl::GetString(GL_VERSION);
-        auto shader = (const char *)gl::GetString(GL_SHADING_LANGUAGE_VERSION);
-        screenShot.drawString(line, gOperatingSystem);
-        screenShot.drawString(line, u::CPUDesc());
-        screenShot.drawString(line, u::RAMDesc());
-        screenShot.drawString(line, vendor);
-        screenShot.drawString(line, renderer);
-        screenShot.drawString(line, version);
-        screenShot.drawString(line, shader);
-        screenShot.drawString(line, "Extensions");
-        for (auto &it : gl::extensions()) {
-            char buffer[2048];
-            snprintf(buffer, sizeof buffer, " %s", gl::extensionString(it));
-            screenShot.drawString(line, buffer);
-        }
-    }
-
-    auto fixedPath = u::fixPath(file);
-    auto format = SaveFormat(scr_format.get());
-
-    if (screenShot.save(file, format, scr_quality))
-        u::Log::out("[screenshot] => %s.%s\n", fixedPath, kSaveFormatExtensions[scr_format]);
+    // The frame is captured when it's complete, at the end of the frame
+    gRenderThread.wait();
+    gScreenShots.request(file, scr_burst);
 }
 
 const u::string &Engine::userPath() const {
@@ -1120,12 +1485,29 @@ static int entryPoint(int argc, char **argv) {
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK | SDL_INIT_GAMECONTROLLER) != 0)
         neoFatal("Failed to initialize SDL2");
 
+    if (!u::gProfiler.init())
+        neoFatal("Failed to initialize profiler");
+
+    if (!u::gJobs.init())
+        neoFatal("Failed to initialize job system");
+
     if (!gEngine.init(argc, argv))
         neoFatal("Failed to initialize engine");
 
     // Setup OpenGL
     gl::init();
 
+    // -capture <name> records every call into captures/<name>.capture, the
+    // capture must start before anything is created
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "-capture"))
+            continue;
+        const u::string file = u::fixPath(u::format("%scaptures/%s.capture", neoUserPath(), argv[i + 1]));
+        if (!gl::startCapture(file.c_str()))
+            neoFatal("Failed to capture into `%s'", file);
+        u::Log::out("[video] => capturing into %s\n", file);
+    }
+
     gl::FrontFace(GL_CW);
     gl::CullFace(GL_BACK);
     gl::Enable(GL_CULL_FACE);
@@ -1173,12 +1555,21 @@ static int entryPoint(int argc, char **argv) {
     const int status = neoMain(gEngine.m_frameTimer, *audio, *world, argc, argv, (bool &)gShutdown);
     c::Config::write(gEngine.userPath());
 
+    // The context is needed on this thread for the releases
+    gRenderThread.stop();
+
     // Instance must be released before OpenGL context is lost
     r::geomMethods::instance().release();
+    r::streamBuffers::instance().release();
+    gScreenShots.shutdown();
+    gl::stopCapture();
 
     delete world;
     delete audio;
 
+    // no more jobs after this
+    u::gJobs.shutdown();
+
     // shut down the console (frees the console variables)
     c::Console::shutdown();
     return status;
@@ -1256,6 +1647,14 @@ void neoSwap() {
     gEngine.swap();
 }
 
+void neoRender(void (*render)(void *), void *frame) {
+    gRenderThread.submit(render, frame);
+}
+
+void neoRenderStop() {
+    gRenderThread.stop();
+}
+
 size_t neoWidth() {
     return gEngine.width();
 }
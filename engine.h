@@ -118,6 +118,9 @@ protected:
 
     void deleteConfigRecursive(const u::string &pathName);
 
+    friend struct RenderThread;
+    void present(); ///< Finish the frame on the thread owning the context
+
 private:
     u::map<u::string, int> m_keyMap;
     u::map<u::string, bindFunction> m_binds;
@@ -131,6 +134,7 @@ private:
     size_t m_screenWidth;
     size_t m_screenHeight;
     size_t m_refreshRate;
+    bool m_hidden; ///< window is hidden for the timedemo and the replay
     void *m_context; ///< pimpl for context
 };
 
@@ -149,6 +153,14 @@ MouseState neoMouseState();
 TextState neoTextState(u::string &what);
 void neoMouseDelta(int *deltaX, int *deltaY);
 void neoSwap();
+/// Render `frame' with `render' on the render thread, which owns the context
+/// from the first call on. The call waits until the previous frame has been
+/// presented such that the game can build the next frame while this one is
+/// rendered; `frame' must stay untouched until the next call.
+void neoRender(void (*render)(void *frame), void *frame);
+/// Wait until the frame submitted last has been presented and take the context
+/// back onto the calling thread, the next neoRender starts over
+void neoRenderStop();
 size_t neoWidth();
 size_t neoHeight();
 void neoRelativeMouse(bool state);
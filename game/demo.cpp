@@ -0,0 +1,180 @@
+#include <stdio.h>
+
+#include "engine.h"
+#include "demo.h"
+
+#include "r_world.h"
+
+#include "u_algorithm.h"
+#include "u_log.h"
+
+#include "m_trig.h"
+
+constexpr size_t demo::kWarmupFrames;
+
+demo::demo()
+    : m_view(0)
+    , m_time(0.0f)
+{
+}
+
+static u::string demoPath(const u::string &name, const char *extension) {
+    return u::fixPath(neoUserPath() + "demos/" + name + extension);
+}
+
+bool demo::record(const u::string &name) {
+    const u::string path = demoPath(name, ".demo");
+    m_file = u::fopen(path, "w");
+    if (!m_file)
+        return false;
+    m_name = name;
+    u::Log::out("[demo] => recording %s\n", path);
+    return true;
+}
+
+bool demo::play(const u::string &name) {
+    const u::string path = demoPath(name, ".demo");
+    u::file file = u::fopen(path, "r");
+    if (!file)
+        return false;
+    m_views.destroy();
+    for (u::string line; u::getline(file, line); ) {
+        view v;
+        if (sscanf(line.c_str(), "%f %f %f %f %f %f %f %f", &v.delta,
+            &v.position.x, &v.position.y, &v.position.z,
+            &v.rotation.x, &v.rotation.y, &v.rotation.z, &v.rotation.w) == 8)
+        {
+            m_views.push_back(v);
+        }
+    }
+    if (m_views.size() <= kWarmupFrames) {
+        u::Log::err("[demo] => %s is too short\n", path);
+        m_views.destroy();
+        return false;
+    }
+    m_name = name;
+    // queried now as the context belongs to the render thread once it starts
+    m_renderer = (const char *)gl::GetString(GL_RENDERER);
+    m_view = 0;
+    m_time = 0.0f;
+    m_frames.destroy();
+    m_frames.reserve(m_views.size() - kWarmupFrames);
+    u::Log::out("[demo] => playing %s (%zu frames)\n", path, m_views.size());
+    return true;
+}
+
+void demo::add(float delta, const m::vec3 &position, const m::quat &rotation) {
+    fprintf(m_file, "%f %f %f %f %f %f %f %f\n", delta,
+        position.x, position.y, position.z,
+        rotation.x, rotation.y, rotation.z, rotation.w);
+}
+
+void demo::next(float &delta, uint32_t &ticks, m::vec3 &position, m::quat &rotation) {
+    const auto &v = m_views[m_view++];
+    m_time += v.delta;
+    delta = v.delta;
+    ticks = uint32_t(m_time * 1000.0f);
+    position = v.position;
+    rotation = v.rotation;
+}
+
+void demo::measure(float milliseconds, size_t draws, const u::vector<r::World::PassTiming> &timings) {
+    // the first frames are dominated by uploads and shader compilation
+    if (m_view <= kWarmupFrames)
+        return;
+    frame f;
+    f.milliseconds = milliseconds;
+    f.draws = draws;
+    f.passes.resize(timings.size());
+    for (size_t i = 0; i < timings.size(); i++)
+        f.passes[i] = timings[i].milliseconds;
+    if (m_passes.empty())
+        for (const auto &it : timings)
+            m_passes.push_back(it.name);
+    m_frames.push_back(f);
+}
+
+// nearest rank percentile of sorted samples
+static float percentile(const u::vector<float> &samples, float p) {
+    const size_t rank = size_t(m::ceil(p * samples.size()));
+    return samples[u::min(rank ? rank - 1 : 0, samples.size() - 1)];
+}
+
+static void writeSummary(FILE *fp, u::vector<float> &samples) {
+    float total = 0.0f;
+    for (const auto it : samples)
+        total += it;
+    u::sort(samples.begin(), samples.end(), [](float lhs, float rhs) { return lhs < rhs; });
+    fprintf(fp, "{ \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+        total / samples.size(), percentile(samples, 0.50f), percentile(samples, 0.95f),
+        percentile(samples, 0.99f), samples.back());
+}
+
+// a JSON string: quotes, backslashes and control characters are escaped
+static void writeString(FILE *fp, const u::string &string) {
+    fputc('"', fp);
+    for (const char *it = string.c_str(); *it; it++) {
+        const unsigned char ch = *it;
+        if (ch == '"' || ch == '\\')
+            fprintf(fp, "\\%c", ch);
+        else if (ch < 0x20)
+            fprintf(fp, "\\u%04x", ch);
+        else
+            fputc(ch, fp);
+    }
+    fputc('"', fp);
+}
+
+bool demo::finish() {
+    if (m_frames.empty())
+        return false;
+
+    const u::string path = demoPath(m_name, ".json");
+    u::file file = u::fopen(path, "w");
+    if (!file) {
+        u::Log::err("[demo] => failed to write %s\n", path);
+        return false;
+    }
+
+    u::vector<float> samples(m_frames.size());
+    fprintf(file, "{\n");
+    fprintf(file, "  \"demo\": ");
+    writeString(file, m_name);
+    fprintf(file, ",\n  \"renderer\": ");
+    writeString(file, m_renderer);
+    fprintf(file, ",\n");
+    fprintf(file, "  \"width\": %zu,\n", neoWidth());
+    fprintf(file, "  \"height\": %zu,\n", neoHeight());
+    fprintf(file, "  \"frames\": %zu,\n", m_frames.size());
+
+    for (size_t i = 0; i < m_frames.size(); i++)
+        samples[i] = m_frames[i].milliseconds;
+    fprintf(file, "  \"frameTime\": ");
+    writeSummary(file, samples);
+    const float p50 = percentile(samples, 0.50f);
+    const float p99 = percentile(samples, 0.99f);
+
+    fprintf(file, ",\n  \"passes\": {\n");
+    for (size_t i = 0; i < m_passes.size(); i++) {
+        for (size_t j = 0; j < m_frames.size(); j++)
+            samples[j] = m_frames[j].passes[i];
+        fprintf(file, "    \"%s\": ", m_passes[i]);
+        writeSummary(file, samples);
+        fprintf(file, i + 1 < m_passes.size() ? ",\n" : "\n");
+    }
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"perFrame\": [\n");
+    for (size_t i = 0; i < m_frames.size(); i++) {
+        const auto &f = m_frames[i];
+        fprintf(file, "    { \"time\": %.4f, \"draws\": %zu", f.milliseconds, f.draws);
+        for (size_t j = 0; j < m_passes.size(); j++)
+            fprintf(file, ", \"%s\": %.4f", m_passes[j], f.passes[j]);
+        fprintf(file, i + 1 < m_frames.size() ? " },\n" : " }\n");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    u::Log::out("[demo] => %zu frames: %.2f ms p50, %.2f ms p99 (%s)\n",
+        m_frames.size(), p50, p99, path);
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef DEMO_HDR
+#define DEMO_HDR
+#include "u_file.h"
+#include "u_string.h"
+#include "u_vector.h"
+
+#include "m_vec.h"
+#include "m_quat.h"
+
+#include "r_world.h"
+
+// A demo is a recorded camera path. Recording stores the view of every frame
+// along with its delta, playing the demo back replays the views with their
+// original deltas such that every run renders the same frames. Playback is
+// used for the timedemo: every frame is measured and the measurements are
+// written to a JSON file in the demos directory once the demo is over.
+struct demo {
+    static constexpr size_t kWarmupFrames = 16; // not measured
+
+    demo();
+
+    bool record(const u::string &name);
+    bool play(const u::string &name);
+
+    bool recording() const;
+    bool playing() const;
+
+    // store the view of a frame being recorded
+    void add(float delta, const m::vec3 &position, const m::quat &rotation);
+    // fetch the view of the next frame to play back
+    void next(float &delta, uint32_t &ticks, m::vec3 &position, m::quat &rotation);
+    // measure the frame which was just played back, the draws and the pass
+    // timings are those of the last frame the render thread completed
+    void measure(float milliseconds, size_t draws, const u::vector<r::World::PassTiming> &timings);
+    // write the measurements of the playback
+    bool finish();
+
+private:
+    struct view {
+        float delta;
+        m::vec3 position;
+        m::quat rotation;
+    };
+
+    struct frame {
+        float milliseconds;
+        size_t draws;
+        u::vector<float> passes;
+    };
+
+    u::string m_name;
+    u::string m_renderer;
+    u::file m_file;
+    u::vector<view> m_views;
+    size_t m_view;
+    float m_time;
+    u::vector<frame> m_frames;
+    u::vector<const char *> m_passes;
+};
+
+inline bool demo::recording() const {
+    return m_file.get();
+}
+
+inline bool demo::playing() const {
+    return m_view < m_views.size();
+}
+
+#endif
@@ -1,7 +1,12 @@
+#include <string.h>
+
+#include <SDL_timer.h>
+
 #include "engine.h"
 #include "gui.h"
 #include "world.h"
 #include "client.h"
+#include "demo.h"
 #include "menu.h"
 #include "edit.h"
 
@@ -24,6 +29,7 @@ bool gRunning = true;
 bool gPlaying = false;
 world::descriptor *gSelected = nullptr; // Selected world entity
 client gClient;
+demo gDemo;
 world *gWorld = nullptr;
 r::pipeline gPipeline;
 m::perspective gPerspective;
@@ -109,7 +115,43 @@ NVAR(float, u_z, "", -180.0f, 360.0f, 0.0f);
 
 a::Audio *gAudio;
 
-int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **, bool &shutdown) {
+// A frame handed to the render thread. The game fills one while the render
+// thread renders the other.
+struct framePacket {
+    r::pipeline pipeline;
+    m::perspective perspective;
+    bool playing;
+    r::scene scene;
+    gui::Queue *commands;
+    r::gui *gui;
+    r::World *renderer;
+    // filled in by the render thread
+    size_t draws;
+    u::vector<r::World::PassTiming> passes;
+};
+
+static void renderFrame(void *data) {
+    framePacket &frame = *(framePacket *)data;
+    const size_t draws = gl::drawCalls();
+
+    // overlays of the renderer go into the commands of this frame
+    gui::target(frame.commands);
+    if (frame.playing) {
+        gWorld->upload(frame.perspective);
+        gl::ClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        gWorld->render(frame.pipeline, frame.scene);
+        frame.passes = frame.renderer->passTimings();
+    } else {
+        gl::ClearColor(40/255.0f, 30/255.0f, 50/255.0f, 0.1f);
+        gl::Clear(GL_COLOR_BUFFER_BIT);
+    }
+    frame.gui->render(frame.pipeline, *frame.commands);
+    gui::target(nullptr);
+
+    frame.draws = gl::drawCalls() - draws;
+}
+
+int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int argc, char **argv, bool &shutdown) {
     gWorld = new world;
     gWorld->setRenderer(world_);
     gAudio = &audio;
@@ -200,14 +242,13 @@ int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **,
     light.position = { 0, 110, 0 };
     gWorld->insert(light);
 
-    // World only has one directional light
-    r::directionalLight *dlight = gWorld->getDirectionalLight();
-    if (dlight) {
-        dlight->color = { 0.2, 0.2, 0.2 };
-        dlight->ambient = 0.10f;
-        dlight->diffuse = 0.50f;
-        dlight->direction = { -1.0f, 0.0f, 0.0f };
-    }
+    // World only has one directional light, it's submitted with every frame
+    c::Console::value<int>("map_dlight_color").get() = 0x333333;
+    c::Console::value<float>("map_dlight_ambient").get() = 0.10f;
+    c::Console::value<float>("map_dlight_diffuse").get() = 0.50f;
+    c::Console::value<float>("map_dlight_directionx").get() = -1.0f;
+    c::Console::value<float>("map_dlight_directiony").get() = 0.0f;
+    c::Console::value<float>("map_dlight_directionz").get() = 0.0f;
 
     // and some map models
     mapModel m;
@@ -230,8 +271,44 @@ int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **,
         neoFatal("failed to load world");
 #endif
 
+    // -record <name> records the camera path into demos/<name>.demo
+    // -timedemo <name> plays it back and writes timings to demos/<name>.json
+    for (int i = 1; i < argc - 1; i++) {
+        if (!strcmp(argv[i], "-record") && !gDemo.record(argv[i + 1]))
+            neoFatal("failed to record demo `%s'", argv[i + 1]);
+        if (!strcmp(argv[i], "-timedemo")) {
+            if (!gDemo.play(argv[i + 1]))
+                neoFatal("failed to play demo `%s'", argv[i + 1]);
+            gPlaying = true;
+            gMenuState = 0;
+        }
+    }
+
+    framePacket frames[2];
+    size_t frame = 0;
+    for (auto &it : frames) {
+        it.gui = &gGui;
+        it.renderer = &world_;
+        it.draws = 0;
+    }
+
     while (gRunning && !shutdown) {
-        gClient.update(*gWorld, timer.delta());
+        const bool timedemo = gDemo.playing();
+        const uint64_t frameStart = SDL_GetPerformanceCounter();
+
+        float delta = timer.delta();
+        uint32_t ticks = timer.ticks();
+        m::vec3 position;
+        m::quat rotation;
+        if (timedemo) {
+            gDemo.next(delta, ticks, position, rotation);
+        } else {
+            gClient.update(*gWorld, delta);
+            position = gClient.getPosition();
+            rotation = gClient.getRotation();
+            if (gDemo.recording())
+                gDemo.add(delta, position, rotation);
+        }
 
         gPerspective.fov = cl_fov;
         gPerspective.nearp = cl_nearp;
@@ -240,10 +317,10 @@ int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **,
         gPerspective.height = neoHeight();
 
         gPipeline.setPerspective(gPerspective);
-        gPipeline.setRotation(gClient.getRotation());
-        gPipeline.setPosition(gClient.getPosition());
-        gPipeline.setTime(timer.ticks());
-        gPipeline.setDelta(timer.delta());
+        gPipeline.setRotation(rotation);
+        gPipeline.setPosition(position);
+        gPipeline.setTime(ticks);
+        gPipeline.setDelta(delta);
 
         auto mouse = neoMouseState();
 
@@ -251,20 +328,33 @@ int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **,
         if (mouse.button & MouseState::kMouseButtonLeft && gSelected && !(gMenuState & kMenuEdit))
             edit::move();
 
-        if (gPlaying && gWorld->isLoaded()) {
-            gWorld->upload(gPerspective);
-            gl::ClearColor(0.0f, 0.0f, 0.0f, 0.0f);
-            gWorld->render(gPipeline);
-            gGui.render(gPipeline);
-            gui::begin(mouse);
-        } else {
-            gl::ClearColor(40/255.0f, 30/255.0f, 50/255.0f, 0.1f);
-            gl::Clear(GL_COLOR_BUFFER_BIT);
-            gGui.render(gPipeline);
-            gui::begin(mouse);
-        }
+        // hand this frame to the render thread along with the commands of
+        // the gui built last frame, the render thread is done with the other
+        // packet and queue once this returns
+        framePacket &packet = frames[frame];
+        packet.pipeline = gPipeline;
+        packet.perspective = gPerspective;
+        packet.playing = gPlaying && gWorld->isLoaded();
+        if (packet.playing)
+            gWorld->submit(packet.scene);
+        packet.commands = &gui::commands();
+        neoRender(renderFrame, &packet);
+        frame = (frame + 1) % 2;
+
+        gui::begin(mouse);
         neoSwap();
 
+        if (timedemo) {
+            const float milliseconds = 1000.0f * (SDL_GetPerformanceCounter() - frameStart)
+                                     / SDL_GetPerformanceFrequency();
+            const framePacket &rendered = frames[frame];
+            gDemo.measure(milliseconds, rendered.draws, rendered.passes);
+            if (!gDemo.playing()) {
+                gDemo.finish();
+                gRunning = false;
+            }
+        }
+
         if (!gPlaying) {
             const size_t w = neoWidth();
             const size_t h = (neoHeight() / 2);
@@ -400,6 +490,9 @@ int neoMain(FrameTimer &timer, a::Audio &audio, r::World &world_, int, char **,
         //audio.setPan(handle, direction.x);
     }
 
+    // the gui is released with the context on this thread
+    neoRenderStop();
+
     //delete gWorld; // MEH MEH LEAK BECAUSE OWNERSHIP IS HARD
     return 0;
 }
@@ -206,9 +206,9 @@ static void menuColorGrading() {
     const size_t x = neoWidth() / 2 - w / 2;
     const size_t y = neoHeight() / 2 - h / 2;
 
-    auto *colorGrad = gWorld->getColorGrader();
-    if (!colorGrad) return;
-    auto &colorGrading = *colorGrad;
+    // the game owns the settings, they're handed to the render thread with
+    // the next scene
+    auto &colorGrading = *gWorld->getColorGrader();
 
     auto cmySliders = [&](int what) {
         float cr = colorGrading.CR(what);
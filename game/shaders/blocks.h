@@ -0,0 +1,26 @@
+#ifndef BLOCKS_HDR
+#define BLOCKS_HDR
+
+#ifdef USE_UNIFORM_BLOCKS
+// Updated once per frame
+layout(std140, row_major) uniform neoFrame {
+    mat4 gInverse;
+    vec3 gEyeWorldPosition;
+    vec2 gScreenSize; // { width, height }
+    vec2 gScreenFrustum; // { near, far }
+    // { { r, g, b }, { range.x, range.y, density } }
+    vec3 gFog[2];
+    // { 0 = Linear, 1 = Exp, 2 = Exp2 }
+    int gFogEquation;
+};
+
+// Updated once per light
+layout(std140, row_major) uniform neoLight {
+    mat4 gWVP;
+    mat4 gLightWVP;
+    // the light, the layout depends on the type
+    vec4 gLight[3];
+};
+#endif
+
+#endif
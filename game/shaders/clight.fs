@@ -0,0 +1,59 @@
+#include <shaders/screen.h>
+#include <shaders/depth.h>
+#include <shaders/light.h>
+#include <shaders/utils.h>
+
+uniform neoSampler2D gColorMap;
+uniform neoSampler2D gNormalMap;
+
+// { offset, count } into the light index map for every cluster
+uniform usampler2D gClusterMap;
+// the light indices of all clusters
+uniform usampler2D gLightIndexMap;
+// three texels for every light laid out like spotLight
+uniform sampler2D gLightMap;
+
+// { tiles x, tiles y, slice scale, slice bias }
+uniform vec4 gClusterGrid;
+
+out vec4 fragColor;
+
+// Matches lightClusters::kTilesY, kSlices and kIndexWidth
+const int kTilesY = 8;
+const int kSlices = 24;
+const int kIndexWidth = 1024;
+
+void main() {
+    vec2 texCoord = calcTexCoord();
+    vec4 colorMap = neoTexture2D(gColorMap, texCoord);
+    vec4 normalDecode = neoTexture2D(gNormalMap, texCoord);
+    vec3 normalMap = normalize(normalDecode.rgb * 2.0f - 1.0f);
+    vec3 worldPosition = calcPosition(texCoord);
+    vec2 specMap = vec2(colorMap.a * 2.0f, exp2(normalDecode.a * 8.0f));
+
+    // view space depth
+    float depth = calcDepth(texCoord) * 2.0f - 1.0f;
+    float z = (2.0f * gScreenFrustum.x * gScreenFrustum.y)
+        / (gScreenFrustum.y + gScreenFrustum.x -
+            depth * (gScreenFrustum.y - gScreenFrustum.x));
+
+    ivec2 tile = clamp(ivec2(gl_FragCoord.xy / gScreenSize * gClusterGrid.xy),
+                       ivec2(0), ivec2(gClusterGrid.xy) - 1);
+    int slice = clamp(int(log2(z) * gClusterGrid.z + gClusterGrid.w), 0, kSlices - 1);
+    uvec2 cluster = texelFetch(gClusterMap, ivec2(tile.x, tile.y + slice * kTilesY), 0).xy;
+
+    vec4 color = vec4(0.0f);
+    for (uint i = 0u; i < cluster.y; i++) {
+        int offset = int(cluster.x + i);
+        int index = int(texelFetch(gLightIndexMap, ivec2(offset % kIndexWidth, offset / kIndexWidth), 0).x);
+        spotLight light = spotLight(texelFetch(gLightMap, ivec2(0, index), 0),
+                                    texelFetch(gLightMap, ivec2(1, index), 0),
+                                    texelFetch(gLightMap, ivec2(2, index), 0));
+        if (SL_CUTOFF(light) > 1.0f)
+            color += calcPointLight(pointLight(light[0], light[1]), worldPosition, normalMap, specMap);
+        else
+            color += calcSpotLight(light, worldPosition, normalMap, specMap);
+    }
+
+    fragColor = MASK_ALPHA(colorMap * color);
+}
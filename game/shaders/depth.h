@@ -3,10 +3,12 @@
 
 uniform neoSampler2D gDepthMap;
 
+#ifndef USE_UNIFORM_BLOCKS
 uniform mat4 gInverse;
 
 uniform vec2 gScreenSize; // { width, height }
 uniform vec2 gScreenFrustum; // { near, far }
+#endif
 
 vec2 calcDepthCoord(vec2 texCoord) {
 #ifdef HAS_TEXTURE_RECTANGLE
@@ -8,7 +8,11 @@ uniform neoSampler2D gColorMap;
 uniform neoSampler2D gNormalMap;
 uniform neoSampler2D gOcclusionMap;
 
+#ifdef USE_UNIFORM_BLOCKS
+#define gDirectionalLight directionalLight(gLight[0], gLight[1])
+#else
 uniform directionalLight gDirectionalLight;
+#endif
 
 out vec4 fragColor;
 
@@ -1,6 +1,10 @@
+#include <shaders/blocks.h>
+
 in vec3 position;
 
+#ifndef USE_UNIFORM_BLOCKS
 uniform mat4 gWVP;
+#endif
 
 void main() {
     gl_Position = gWVP * vec4(position, 1.0f);
@@ -5,10 +5,12 @@
 #define FOG_RANGE   gFog[1].xy
 #define FOG_DENSITY gFog[1].z
 
+#ifndef USE_UNIFORM_BLOCKS
 // { { r, g, b }, { range.x, range.y, density } }
 uniform vec3[2] gFog;
 // { 0 = Linear, 1 = Exp, 2 = Exp2 }
 uniform int gFogEquation;
+#endif
 
 float calcFogFactor(float fogCoord) {
     vec2 range = FOG_RANGE;
@@ -11,22 +11,52 @@ in float eyeDotDirection0;
 out vec4 diffuseOut;
 out vec4 normalOut;
 
+#ifdef USE_TEXTURE_ARRAY
+// the textures are layers of arrays shared with other materials, which layer
+// and the constants of the material are sourced per draw
+flat in vec4 materialLayers0;
+flat in vec4 materialParams0;
+#define sampler2DMap sampler2DArray
+#define colorMap(X) texture(gColorMap, vec3((X), materialLayers0.x))
+#define normalMap(X) texture(gNormalMap, vec3((X), materialLayers0.y))
+#define specMap(X) texture(gSpecMap, vec3((X), materialLayers0.z))
+#define dispMap(X) texture(gDispMap, vec3((X), materialLayers0.w))
+#else
+#define sampler2DMap sampler2D
+#define colorMap(X) texture(gColorMap, (X))
+#define normalMap(X) texture(gNormalMap, (X))
+#define specMap(X) texture(gSpecMap, (X))
+#define dispMap(X) texture(gDispMap, (X))
+#endif
+
 #ifdef USE_DIFFUSE
-uniform sampler2D gColorMap;
+uniform sampler2DMap gColorMap;
 #endif
 
 #ifdef USE_NORMALMAP
-uniform sampler2D gNormalMap;
+uniform sampler2DMap gNormalMap;
 #endif
 
 #ifdef USE_SPECMAP
-uniform sampler2D gSpecMap;
+uniform sampler2DMap gSpecMap;
 #endif
 
 #ifdef USE_PARALLAX
-uniform sampler2D gDispMap;
+uniform sampler2DMap gDispMap;
 #endif
 
+#if defined(USE_TEXTURE_ARRAY)
+#define gParallax materialParams0.xy // { scale, bias }
+#define gSpecPower materialParams0.z
+#define gSpecIntensity materialParams0.w
+#elif defined(USE_UNIFORM_BLOCKS)
+// Updated once per material
+layout(std140) uniform neoMaterial {
+    vec2 gParallax; // { scale, bias }
+    float gSpecPower;
+    float gSpecIntensity;
+};
+#else
 #ifdef USE_SPECPARAMS
 uniform float gSpecPower;
 uniform float gSpecIntensity;
@@ -35,6 +65,7 @@ uniform float gSpecIntensity;
 #ifdef USE_PARALLAX
 uniform vec2 gParallax; // { scale, bias }
 #endif
+#endif
 
 #ifdef USE_ANIMATION
 uniform ivec2 gAnimOffset;
@@ -45,7 +76,7 @@ uniform vec2 gAnimScale;
 #ifdef USE_NORMALMAP
 vec3 calcBump(vec2 texCoord) {
     vec3 normal;
-    normal.xy = texture(gNormalMap, texCoord).rg * 2.0f - vec2(1.0f, 1.0f);
+    normal.xy = normalMap(texCoord).rg * 2.0f - vec2(1.0f, 1.0f);
     normal.z = sqrt(1.0f - dot(normal.xy, normal.xy));
     mat3 tbn = mat3(tangent0, bitangent0, normal0);
     return normalize(tbn * normal);
@@ -65,17 +96,17 @@ vec2 parallax(vec2 texCoord) {
     vec3 position = vec3(texCoord - shift.xy * numLayers * gParallax.y, 1.0f);
 
     // steep parallax part (forward stepping until the ray is below the heightmap)
-    float height = texture(gDispMap, position.xy).r;
+    float height = dispMap(position.xy).r;
     for (int i = 0; i < numLayers; ++i) {
         position -= shift * step(height, position.z);
-        height = texture(gDispMap, position.xy).r;
+        height = dispMap(position.xy).r;
     }
 
     // Relief mapping part (binary search for the intersection)
-    height = texture(gDispMap, position.xy).r;
+    height = dispMap(position.xy).r;
     for (int i = 0; i < maxReliefSearches; i++) {
         position -= shift * (step(height, position.z) - 0.5f) * exp2(-i);
-        height = texture(gDispMap, position.xy).r;
+        height = dispMap(position.xy).r;
     }
 
     return position.xy;
@@ -96,7 +127,7 @@ void main() {
 #endif
 
 #ifdef USE_DIFFUSE
-    diffuseOut.rgb = texture(gColorMap, texCoord).rgb;
+    diffuseOut.rgb = colorMap(texCoord).rgb;
 #endif
 
 #ifdef USE_NORMALMAP
@@ -108,7 +139,7 @@ void main() {
 #ifdef USE_SPECMAP
     // R contains intensity, B contains power. We pack intensity in alpha of
     // diffuse while power in alpha of normal
-    vec2 spec = texture(gSpecMap, texCoord).rg;
+    vec2 spec = specMap(texCoord).rg;
     diffuseOut.a = spec.r;
     normalOut.a = spec.g;
     // red channel contains intensity while green contains power
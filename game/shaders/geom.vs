@@ -8,13 +8,32 @@ in vec4 weights;
 in vec4 bones;
 #endif
 
+#ifdef USE_INSTANCING
+// the rows of the world matrix of the instance are sourced as the columns
+// of this matrix: transform with row vectors
+in mat4 instanceWorld;
+uniform mat4 gVP;
+#define toWorld(X) ((X) * instanceWorld)
+#define toClip(X) (gVP * toWorld(X))
+#else
 uniform mat4 gWVP;
 uniform mat4 gWorld;
+#define toWorld(X) (gWorld * (X))
+#define toClip(X) (gWVP * (X))
+#endif
 
 #ifdef USE_PARALLAX
 uniform vec3 gEyeWorldPosition;
 #endif
 
+#ifdef USE_TEXTURE_ARRAY
+// the layers and constants of the material of this draw
+in vec4 materialLayers;
+in vec4 materialParams;
+flat out vec4 materialLayers0;
+flat out vec4 materialParams0;
+#endif
+
 #ifdef USE_SKELETAL
 uniform mat3x4 gBoneMats[80];
 #endif
@@ -30,30 +49,35 @@ out float eyeDotDirection0;
 #endif
 
 void main() {
+#ifdef USE_TEXTURE_ARRAY
+    materialLayers0 = materialLayers;
+    materialParams0 = materialParams;
+#endif
+
 #ifdef USE_SKELETAL
     mat3x4 m = gBoneMats[int(bones.x)] * weights.x;
     m += gBoneMats[int(bones.y)] * weights.y;
     m += gBoneMats[int(bones.z)] * weights.z;
     m += gBoneMats[int(bones.w)] * weights.w;
     vec4 pos = vec4(vec4(position, 1.0f) * m, 1.0f);
-    gl_Position = gWVP * pos;
+    gl_Position = toClip(pos);
     texCoord0 = texCoord;
     mat3 trans = mat3(cross(m[1].xyz, m[2].xyz),
                       cross(m[2].xyz, m[0].xyz),
                       cross(m[0].xyz, m[1].xyz));
-    normal0 = (gWorld * vec4(normal * trans, 0.0f)).xyz;
-    tangent0 = (gWorld * vec4(tangent.xyz * trans, 0.0f)).xyz;
+    normal0 = toWorld(vec4(normal * trans, 0.0f)).xyz;
+    tangent0 = toWorld(vec4(tangent.xyz * trans, 0.0f)).xyz;
     bitangent0 = tangent.w * cross(normal0, tangent0);
 #else
-    gl_Position = gWVP * vec4(position, 1.0f);
+    gl_Position = toClip(vec4(position, 1.0f));
     texCoord0 = texCoord;
-    normal0 = (gWorld * vec4(normal, 0.0f)).xyz;
-    tangent0 = (gWorld * vec4(tangent.xyz, 0.0f)).xyz;
+    normal0 = toWorld(vec4(normal, 0.0f)).xyz;
+    tangent0 = toWorld(vec4(tangent.xyz, 0.0f)).xyz;
     bitangent0 = tangent.w * cross(normal0, tangent0);
 #endif
 
 #ifdef USE_PARALLAX
-    vec3 eyePosition = (gWorld * vec4(position, 1.0f)).xyz;
+    vec3 eyePosition = toWorld(vec4(position, 1.0f)).xyz;
     vec3 eyeDirection = gEyeWorldPosition - position;
     mat3 eyeTBN = mat3(tangent0, bitangent0, normal0);
     eyePosition0 = eyeDirection * eyeTBN;
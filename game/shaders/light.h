@@ -1,7 +1,9 @@
 #ifndef LIGHT_HDR
 #define LIGHT_HDR
 
+#ifndef USE_UNIFORM_BLOCKS
 uniform vec3 gEyeWorldPosition;
+#endif
 
 #ifdef USE_SHADOWMAP
 uniform sampler2DShadow gShadowMap;
@@ -34,8 +36,15 @@ uniform sampler2DShadow gShadowMap;
 #define DL_DIRECTION(DL) (DL)[1].xyz
 #define DL_DIFFUSE(DL)   (DL)[1].w
 
-#ifdef USE_SHADOWMAP
+#if defined(USE_SHADOWMAP) && !defined(USE_UNIFORM_BLOCKS)
 uniform mat4 gLightWVP;
+// size of a point light shadow map face in the shadow atlas
+uniform vec2 gShadowFace;
+#elif defined(USE_SHADOWMAP)
+#define gShadowFace gLight[2].xy
+#endif
+
+#ifdef USE_SHADOWMAP
 
 float calcShadowFactor(vec3 shadowCoord) {
     vec2 scale = 1.0f / textureSize(gShadowMap, 0);
@@ -109,11 +118,12 @@ vec4 calcPointLight(pointLight light,
             vec4 project =
                 max(absDir.x, absDir.y) > absDir.z ?
                     (absDir.x > absDir.y ?
-                        vec4(lightDirection.zyx, 0.0f / 3.0f) :
-                        vec4(lightDirection.xzy, 1.0f / 3.0f)) :
-                    vec4(lightDirection, 2.0f / 3.0f);
+                        vec4(lightDirection.zyx, 0.0f) :
+                        vec4(lightDirection.xzy, 1.0f)) :
+                    vec4(lightDirection, 2.0f);
             vec4 shadowCoord = gLightWVP * vec4(project.xy, abs(project.z), 1.0f);
-            attenuation *= calcShadowFactor(shadowCoord.xyz / shadowCoord.w + vec3(project.w, 0.5f * step(0.0f, project.z), 0.0f));
+            vec2 face = vec2(project.w, step(0.0f, project.z)) * gShadowFace;
+            attenuation *= calcShadowFactor(shadowCoord.xyz / shadowCoord.w + vec3(face, 0.0f));
 #endif
             attenuation *= calcLightFactor(facing * invDistance,
                                            lightDirection * invDistance,
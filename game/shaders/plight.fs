@@ -6,7 +6,11 @@
 uniform neoSampler2D gColorMap;
 uniform neoSampler2D gNormalMap;
 
+#ifdef USE_UNIFORM_BLOCKS
+#define gPointLight pointLight(gLight[0], gLight[1])
+#else
 uniform pointLight gPointLight;
+#endif
 
 out vec4 fragColor;
 
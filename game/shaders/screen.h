@@ -1,5 +1,6 @@
 #ifndef SCREEN_HDR
 #define SCREEN_HDR
+#include <shaders/blocks.h>
 
 #ifdef HAS_TEXTURE_RECTANGLE
 #  extension GL_ARB_texture_rectangle : enable
@@ -10,7 +11,9 @@
 #  define neoTexture2D texture
 #endif
 
+#ifndef USE_UNIFORM_BLOCKS
 uniform vec2 gScreenSize; // { width, height }
+#endif
 
 // If it's not a screen quad-aligned effect but is a screen-space effect
 // then utilize this to calculate coordinates.
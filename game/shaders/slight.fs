@@ -6,7 +6,11 @@
 uniform neoSampler2D gColorMap;
 uniform neoSampler2D gNormalMap;
 
+#ifdef USE_UNIFORM_BLOCKS
+#define gSpotLight spotLight(gLight[0], gLight[1], gLight[2])
+#else
 uniform spotLight gSpotLight;
+#endif
 
 out vec4 fragColor;
 
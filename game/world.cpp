@@ -91,20 +91,19 @@ bool world::upload(const m::perspective &p) {
     return m_renderer->upload(p);
 }
 
-void world::render(const r::pipeline &pl) {
-    if (!m_renderer) return;
-    // a new frame reset world state!
-    m_renderer->reset();
+void world::submit(r::scene &scene) {
+    // a new frame starts from an empty scene
+    scene.clear();
 
     float R = ((map_dlight_color >> 16) & 0xFF) / 255.0f;
     float G = ((map_dlight_color >> 8) & 0xFF) / 255.0f;
     float B = (map_dlight_color & 0xFF) / 255.0f;
 
-    r::directionalLight *directionalLight = m_renderer->getDirectionalLight();
-    directionalLight->ambient = map_dlight_ambient;
-    directionalLight->diffuse = map_dlight_diffuse;
-    directionalLight->color = { R, G, B };
-    directionalLight->direction = {
+    r::directionalLight &directionalLight = scene.directionalLight_;
+    directionalLight.ambient = map_dlight_ambient;
+    directionalLight.diffuse = map_dlight_diffuse;
+    directionalLight.color = { R, G, B };
+    directionalLight.direction = {
         map_dlight_directionx,
         map_dlight_directiony,
         map_dlight_directionz
@@ -114,45 +113,58 @@ void world::render(const r::pipeline &pl) {
     G = ((map_fog_color >> 8) & 0xFF) / 255.0f;
     B = (map_fog_color & 0xFF) / 255.0f;
 
-    r::fog &fog = m_renderer->getFog();
+    r::fog &fog = scene.fog_;
     fog.color = { R, G, B };
     fog.density = map_fog_density;
     fog.start = map_fog_range_start;
     fog.end = map_fog_range_end;
     fog.equation = map_fog_equation;
 
-    // add all light positions into the billboard
-    for (auto *it : m_spotLights)
-        m_billboards[0]->add(it->position + m::vec3(0.0f, 5.0f, 0.0f));
-    for (auto *it : m_pointLights)
-        m_billboards[0]->add(it->position + m::vec3(0.0f, 5.0f, 0.0f));
+    // the color grading is only handed over when it changed
+    if (m_colorGrader.updated()) {
+        scene.colorGrader_ = m_colorGrader;
+        scene.colorGraded = true;
+        m_colorGrader.update();
+    }
 
-    // add all lights to the renderer (will ignore adding ones which already exist)
+    // copies of all lights as the editor may change them while the render
+    // thread draws this scene
     for (auto *it : m_pointLights)
-        m_renderer->addPointLight(it);
+        scene.pointLights.push_back({ it, *it });
     for (auto *it : m_spotLights)
-        m_renderer->addSpotLight(it);
+        scene.spotLights.push_back({ it, *it });
 
     // add all billboards
-    for (auto *it : m_billboards)
-        m_renderer->addBillboard(it);
+    scene.billboards.resize(m_billboards.size());
+    for (size_t i = 0; i < m_billboards.size(); i++)
+        scene.billboards[i].billboard_ = m_billboards[i];
+
+    // add all light positions into the billboard
+    for (auto *it : m_spotLights)
+        scene.billboards[0].positions.push_back(it->position + m::vec3(0.0f, 5.0f, 0.0f));
+    for (auto *it : m_pointLights)
+        scene.billboards[0].positions.push_back(it->position + m::vec3(0.0f, 5.0f, 0.0f));
 
     // walk the map models and load new ones on demand (renderer will upload them)
     for (const auto &it : m_mapModels) {
         auto find = m_models.find(it->name);
+        r::model *model = nullptr;
         if (find == m_models.end()) {
             // a new model
-            r::model *model = new r::model;
+            model = new r::model;
             if (!model->load(m_textures, it->name))
                 neoFatal("Failed to load model %s", it->name);
             m_models.insert({ it->name, model });
-            m_renderer->addModel(model, it->highlight, it->position, it->scale, it->rotate);
         } else {
-            m_renderer->addModel(find->second, it->highlight, it->position, it->scale, it->rotate);
+            model = find->second;
         }
+        scene.models.push_back({ it, model, it->highlight, it->position, it->scale, it->rotate });
     }
+}
 
-    m_renderer->render(pl);
+void world::render(const r::pipeline &pl, const r::scene &scene) {
+    if (!m_renderer) return;
+    m_renderer->render(pl, scene);
 }
 
 bool world::trace(const world::trace::query &q, world::trace::hit *h, float maxDistance, bool entities, descriptor *ignore) {
@@ -346,10 +358,6 @@ void world::erase(size_t where) {
     }
 }
 
-r::directionalLight *world::getDirectionalLight() {
-    return m_renderer ? m_renderer->getDirectionalLight() : nullptr;
-}
-
 r::spotLight &world::getSpotLight(size_t index) {
     return *m_spotLights[index];
 }
@@ -379,5 +387,5 @@ const u::vector<mapModel*> &world::getMapModels() const {
 }
 
 ColorGrader *world::getColorGrader() {
-    return m_renderer ? m_renderer->getColorGrader() : nullptr;
+    return &m_colorGrader;
 }
@@ -56,7 +56,10 @@ struct world {
 
     bool load(const u::string &map);
     bool upload(const m::perspective &p);
-    void render(const r::pipeline &pl);
+    // fill the scene of the next frame, called by the game
+    void submit(r::scene &scene);
+    // render a scene filled by submit, called by the render thread
+    void render(const r::pipeline &pl, const r::scene &scene);
 
     bool setRenderer(r::World &renderer) {
         m_renderer = &renderer;
@@ -100,7 +103,6 @@ struct world {
 
     void erase(size_t where); // Erase an entity
 
-    r::directionalLight *getDirectionalLight();
     r::spotLight &getSpotLight(size_t index);
     r::pointLight &getPointLight(size_t index);
     mapModel &getMapModel(size_t index);
@@ -122,6 +124,8 @@ protected:
 private:
     kdMap m_map; // The map for this world
     r::World *m_renderer;
+    // copied into the scene when changed, the render thread grades it
+    ColorGrader m_colorGrader;
 
     u::vector<descriptor> m_entities;
 
@@ -2,8 +2,11 @@
 #include "gui.h"
 #include "c_variable.h"
 
+#include <string.h>
+
+#include <SDL_thread.h>
+
 #include "u_misc.h"
-#include "u_lru.h"
 #include "u_set.h"
 
 #include "m_const.h"
@@ -12,13 +15,37 @@ VAR(int, ui_scroll_speed, "mouse scroll speed", 1, 10, 5);
 
 namespace gui {
 
-static struct stringPool : u::lru<u::string> {
-    const char *operator()(const char *what);
-} gStringPool;
+constexpr size_t Queue::kCommandQueueSize;
+constexpr size_t Queue::kTextBlockSize;
 
-inline const char *stringPool::operator()(const char *what) {
-    const auto f = find(what);
-    return f ? f->c_str() : insert(what).c_str();
+Queue::Queue()
+    : m_textBlock(0)
+    , m_textUsed(0)
+{
+}
+
+Queue::~Queue() {
+    for (auto &it : m_text)
+        delete[] it.data;
+}
+
+const char *Queue::copy(const char *text) {
+    const size_t size = strlen(text) + 1;
+    for (; m_textBlock < m_text.size(); m_textBlock++, m_textUsed = 0) {
+        auto &block = m_text[m_textBlock];
+        if (m_textUsed + size > block.size)
+            continue;
+        char *const data = block.data + m_textUsed;
+        memcpy(data, text, size);
+        m_textUsed += size;
+        return data;
+    }
+    // blocks are kept around after a reset
+    const size_t blockSize = u::max(size, kTextBlockSize);
+    m_text.push_back({ new char[blockSize], blockSize });
+    memcpy(m_text.back().data, text, size);
+    m_textUsed = size;
+    return m_text.back().data;
 }
 
 void Queue::addScissor(int x, int y, int w, int h) {
@@ -93,7 +120,7 @@ void Queue::addText(int x, int y, int align, const char *contents, uint32_t colo
     cmd.asText.x = x;
     cmd.asText.y = y;
     cmd.asText.align = align;
-    cmd.asText.contents = gStringPool(contents);
+    cmd.asText.contents = copy(contents);
 }
 
 void Queue::addImage(int x, int y, int w, int h, const char *path) {
@@ -105,7 +132,7 @@ void Queue::addImage(int x, int y, int w, int h, const char *path) {
     cmd.asImage.y = y;
     cmd.asImage.w = w;
     cmd.asImage.h = h;
-    cmd.asImage.path = gStringPool(path);
+    cmd.asImage.path = copy(path);
 }
 
 void Queue::addModel(int x, int y, int w, int h, const char *path, const r::pipeline &p, int su, int sv) {
@@ -117,7 +144,7 @@ void Queue::addModel(int x, int y, int w, int h, const char *path, const r::pipe
     cmd.asModel.y = y;
     cmd.asModel.w = w;
     cmd.asModel.h = h;
-    cmd.asModel.path = gStringPool(path);
+    cmd.asModel.path = copy(path);
     cmd.asModel.pipeline = p;
     cmd.asModel.su = su;
     cmd.asModel.sv = sv;
@@ -234,7 +261,8 @@ struct State {
     bool m_leftReleased; // left released
 
     Widget m_widget;
-    Queue m_queue;
+    Queue m_queues[2]; // one is built while the other may still be rendered
+    size_t m_queue; // the one being built
     ScrollArea m_scroll;
 };
 
@@ -251,6 +279,7 @@ inline State::State()
     , m_left(false)
     , m_leftPressed(false)
     , m_leftReleased(false)
+    , m_queue(0)
 {
     m_mouse.x = -1;
     m_mouse.y = -1;
@@ -337,8 +366,16 @@ inline void State::update(MouseState &mouse) {
 /// The Singleton
 static State gState;
 
+// the queue a thread draws into
+static const SDL_TLSID gTarget = SDL_TLSCreate();
+
+static inline Queue &queue() {
+    Queue *const target = (Queue *)SDL_TLSGet(gTarget);
+    return target ? *target : gState.m_queues[gState.m_queue];
+}
+
 #define G (gState)
-#define Q (G.m_queue)  // [Q]ueue
+#define Q (queue())  // [Q]ueue
 #define W (G.m_widget) // [W]idget
 #define A (G.m_area)   // [A]rea
 #define S (G.m_scroll) // [S]croll
@@ -813,8 +850,12 @@ void drawTexture(int x, int y, int w, int h, const u::vector<unsigned char> &dat
     Q.addTexture(x, y, w, h, &data[0], data.size());
 }
 
-const Queue &commands() {
-    return Q;
+Queue &commands() {
+    return G.m_queues[G.m_queue];
+}
+
+void target(Queue *queue) {
+    SDL_TLSSet(gTarget, queue, nullptr);
 }
 
 void begin(MouseState &mouse) {
@@ -830,7 +871,8 @@ void begin(MouseState &mouse) {
     G.m_isHot = false;
 
     G.m_widget.reset();
-    G.m_queue.reset();
+    G.m_queue = (G.m_queue + 1) % 2;
+    G.m_queues[G.m_queue].reset();
 
     G.m_area = 1;
 }
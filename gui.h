@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #include "u_stack.h"
+#include "u_vector.h"
 
 #include "r_pipeline.h"
 
@@ -102,8 +103,14 @@ inline Command::Command()
 {
 }
 
+// The commands of a frame. The text they reference is copied into the queue
+// and lives until the queue is reset such that a queue can be rendered by a
+// thread other than the one which built it
 struct Queue {
     static constexpr size_t kCommandQueueSize = 5000;
+    static constexpr size_t kTextBlockSize = 16384;
+    Queue();
+    ~Queue();
     const u::stack<Command, kCommandQueueSize> &operator()() const;
     void reset();
     void addScissor(int x, int y, int w, int h);
@@ -116,11 +123,23 @@ struct Queue {
     void addImage(int x, int y, int w, int h, const char *path);
     void addModel(int x, int y, int w, int h, const char *path, const r::pipeline &p, int su = 0, int sv = 0);
 private:
+    const char *copy(const char *text);
+
+    struct TextBlock {
+        char *data;
+        size_t size;
+    };
+
     u::stack<Command, kCommandQueueSize> m_commands;
+    u::vector<TextBlock> m_text;
+    size_t m_textBlock; // block being written into
+    size_t m_textUsed; // bytes used in that block
 };
 
 inline void Queue::reset() {
     m_commands.reset();
+    m_textBlock = 0;
+    m_textUsed = 0;
 }
 
 inline const u::stack<Command, Queue::kCommandQueueSize> &Queue::operator()() const {
@@ -181,7 +200,14 @@ void drawImage(int x, int y, int w, int h, const char *path);
 void drawModel(int x, int y, int w, int h, const char *path, const r::pipeline &p, int su = 0, int sv = 0);
 void drawTexture(int x, int y, int w, int h, const u::vector<unsigned char> &rgba);
 
-const Queue &commands();
+// The queue being built for the next frame. It stays intact until the next
+// call to begin which starts building the other one of two queues
+Queue &commands();
+
+// Commands drawn by the calling thread go into queue rather than the one being
+// built (nullptr to restore.) The render thread draws its overlays into the
+// queue of the frame it renders
+void target(Queue *queue);
 
 void begin(MouseState &mouse);
 void finish();
@@ -1,10 +1,17 @@
 GAME_SOURCES = \
 	game/menu.cpp \
 	game/client.cpp \
+	game/demo.cpp \
 	game/main.cpp \
 	game/edit.cpp \
 	game/world.cpp
 
+REPLAY_SOURCES = \
+	replay/main.cpp
+
+TEST_SOURCES = \
+	test/occlusion.cpp
+
 MATH_SOURCES = \
 	m_half.cpp \
 	m_mat.cpp \
@@ -16,12 +23,16 @@ MATH_SOURCES = \
 RENDERER_SOURCES = \
 	r_aa.cpp \
 	r_billboard.cpp \
+	r_buffer.cpp \
+	r_cluster.cpp \
 	r_common.cpp \
 	r_composite.cpp \
 	r_gbuffer.cpp \
 	r_model.cpp \
+	r_occlusion.cpp \
 	r_method.cpp \
 	r_pipeline.cpp \
+	r_queue.cpp \
 	r_geom.cpp \
 	r_grader.cpp \
 	r_shadow.cpp \
@@ -48,6 +59,8 @@ UTIL_SOURCES = \
 	u_misc.cpp \
 	u_new.cpp \
 	u_hash.cpp \
+	u_jobs.cpp \
+	u_profiler.cpp \
 	u_log.cpp \
 	u_string.cpp \
 	u_zip.cpp \
@@ -91,4 +104,26 @@ GAME_OBJECTS = \
 	$(GAME_SOURCES:.cpp=.o) \
 	$(ENGINE_SOURCES:.cpp=.o)
 
+REPLAY_OBJECTS = \
+	$(REPLAY_SOURCES:.cpp=.o) \
+	$(ENGINE_SOURCES:.cpp=.o)
+
+# the tests only link what they exercise, they run without a window
+TEST_OBJECTS = \
+	$(TEST_SOURCES:.cpp=.o) \
+	r_occlusion.o \
+	c_complete.o \
+	c_console.o \
+	c_variable.o \
+	u_assert.o \
+	u_file.o \
+	u_hash.o \
+	u_log.o \
+	u_misc.o \
+	u_new.o \
+	u_string.o \
+	$(MATH_SOURCES:.cpp=.o)
+
 GAME_DIR = game
+REPLAY_DIR = replay
+TEST_DIR = test
@@ -23,6 +23,7 @@ void kdMap::unload() {
     triangles.destroy();
     vertices.destroy();
     entities.destroy();
+    visibility.destroy();
 }
 
 template <typename T>
@@ -48,8 +49,9 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
 
     if (header.magic != kdBinHeader::kMagic)
         return false;
-    if (header.version != kdBinHeader::kVersion)
+    if (header.version != kdBinHeader::kVersion && header.version != kdBinHeader::kVersionWithoutVisibility)
         return false;
+    const bool hasVisibility = header.version != kdBinHeader::kVersionWithoutVisibility;
 
     // read entries
     kdBinEntry planeEntry;
@@ -59,6 +61,7 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
     kdBinEntry vertexEntry;
     kdBinEntry entEntry;
     kdBinEntry leafEntry;
+    kdBinEntry visibilityEntry = { 0, 0 };
 
     seek = mapUnserialize(&planeEntry, data, seek);
     seek = mapUnserialize(&textureEntry, data, seek);
@@ -67,8 +70,10 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
     seek = mapUnserialize(&vertexEntry, data, seek);
     seek = mapUnserialize(&entEntry, data, seek);
     seek = mapUnserialize(&leafEntry, data, seek);
+    if (hasVisibility)
+        seek = mapUnserialize(&visibilityEntry, data, seek);
 
-    if (seek != sizeof header + 7*sizeof(kdBinEntry))
+    if (seek != sizeof header + (hasVisibility ? 8 : 7)*sizeof(kdBinEntry))
         return false;
 
     planeEntry.endianSwap();
@@ -78,6 +83,7 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
     vertexEntry.endianSwap();
     entEntry.endianSwap();
     leafEntry.endianSwap();
+    visibilityEntry.endianSwap();
 
     planes.resize(planeEntry.length / sizeof(kdBinPlane));
     textures.resize(textureEntry.length / sizeof(kdBinTexture));
@@ -86,6 +92,7 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
     vertices.resize(vertexEntry.length / sizeof(kdBinVertex));
     entities.resize(entEntry.length / sizeof(kdBinEnt));
     leafs.resize(leafEntry.length);
+    visibility.resize(visibilityEntry.length);
 
     // read all planes
     kdBinPlane plane;
@@ -129,6 +136,18 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
         }
     }
 
+    // potentially visible sets of the leafs
+    seek = visibilityEntry.offset;
+    uint32_t visibilitySize;
+    for (size_t i = 0; i < visibilityEntry.length; i++) {
+        seek = mapUnserialize(&visibilitySize, data, seek);
+        visibilitySize = u::endianSwap(visibilitySize);
+        visibility[i].data.resize(visibilitySize);
+        if (visibilitySize)
+            mapUnserialize(&visibility[i].data[0], data, seek, visibilitySize);
+        seek += visibilitySize;
+    }
+
     // integrity check
     uint32_t endMark;
     mapUnserialize(&endMark, data, seek);
@@ -162,6 +181,42 @@ bool kdMap::load(const u::vector<unsigned char> &compressedData) {
     return true;
 }
 
+int32_t kdMap::findLeaf(const m::vec3 &position) const {
+    int32_t node = 0;
+    while (node >= 0) {
+        const auto &it = nodes[node];
+        node = planes[it.plane].distance(position) >= 0.0f ? it.children[0] : it.children[1];
+    }
+    return -node - 1;
+}
+
+void kdMap::leafVisibility(size_t leaf, u::vector<unsigned char> &bits) const {
+    const size_t rowSize = (leafs.size() + 7) / 8;
+    bits.resize(rowSize);
+    if (!rowSize)
+        return;
+    // everything is visible without visibility information
+    if (leaf >= visibility.size()) {
+        memset(&bits[0], 0xFF, rowSize);
+        return;
+    }
+    const auto &data = visibility[leaf].data;
+    size_t write = 0;
+    for (size_t i = 0; i < data.size() && write < rowSize; i++) {
+        if (data[i]) {
+            bits[write++] = data[i];
+            continue;
+        }
+        // run of zeros
+        const size_t run = i + 1 < data.size() ? data[++i] : 0;
+        for (size_t j = 0; j < run && write < rowSize; j++)
+            bits[write++] = 0;
+    }
+    // anything missing from a malformed set is considered visible
+    while (write < rowSize)
+        bits[write++] = 0xFF;
+}
+
 bool kdMap::sphereTriangleIntersectStatic(size_t triangleIndex, const m::vec3 &spherePosition, float sphereRadius) const {
     const m::vec4 oa = m::vec4(vertices[triangles[triangleIndex].v[0]].vertex, 1.0f);
     const m::vec4 ob = m::vec4(vertices[triangles[triangleIndex].v[1]].vertex, 1.0f);
@@ -366,12 +421,12 @@ void kdMap::traceSphere(kdSphereTrace *trace, int32_t rootNode) {
     *trace = minTrace;
 }
 
-bool kdMap::inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius, int32_t root) {
-    m_stack.reset();
-    m_stack.push(root);
+bool kdMap::inSphere(kdStack &stack, u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius, int32_t root) const {
+    stack.reset();
+    stack.push(root);
 
-    while (m_stack) {
-        int32_t node = m_stack.pop();
+    while (stack) {
+        int32_t node = stack.pop();
         if (node < 0) {
             // leaf node
             const size_t leafIndex = -node - 1;
@@ -394,7 +449,7 @@ bool kdMap::inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position
         checkPlane.d -= radius;
         start = checkPlane.classify(position, kdTree::kEpsilon);
         if (start > m::plane::kOn) {
-            m_stack.push(nodes[node].children[0]);
+            stack.push(nodes[node].children[0]);
             continue;
         }
 
@@ -402,13 +457,13 @@ bool kdMap::inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position
         checkPlane.d = planes[nodes[node].plane].d + radius;
         start = checkPlane.classify(position, kdTree::kEpsilon);
         if (start < m::plane::kOn) {
-            m_stack.push(nodes[node].children[1]);
+            stack.push(nodes[node].children[1]);
             continue;
         }
 
         // check front and back
-        m_stack.push(nodes[node].children[1]);
-        m_stack.push(nodes[node].children[0]);
+        stack.push(nodes[node].children[1]);
+        stack.push(nodes[node].children[0]);
     }
 
     return triangleIndices.size();
@@ -417,7 +472,13 @@ bool kdMap::inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position
 bool kdMap::inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius) {
     if (nodes.size() == 0)
         return false;
-    return inSphere(triangleIndices, position, radius, 0);
+    return inSphere(m_stack, triangleIndices, position, radius, 0);
+}
+
+bool kdMap::inSphere(kdStack &stack, u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius) const {
+    if (nodes.size() == 0)
+        return false;
+    return inSphere(stack, triangleIndices, position, radius, 0);
 }
 
 bool kdMap::isSphereStuck(const m::vec3 &position, float radius) {
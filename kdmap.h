@@ -61,8 +61,15 @@ struct kdMap {
 
     void traceSphere(kdSphereTrace *trace);
     bool inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius);
+    // thread safe version using the given stack (sized for all the nodes)
+    bool inSphere(kdStack &stack, u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius) const;
     bool isSphereStuck(const m::vec3 &position, float radius);
 
+    // the leaf which contains `position'
+    int32_t findLeaf(const m::vec3 &position) const;
+    // decompress the potentially visible set of a leaf into a bit set of leafs
+    void leafVisibility(size_t leaf, u::vector<unsigned char> &bits) const;
+
     bool isLoaded() const;
 
     u::vector<m::plane>      planes;
@@ -72,6 +79,7 @@ struct kdMap {
     u::vector<kdBinVertex>   vertices;
     u::vector<kdBinEnt>      entities;
     u::vector<kdBinLeaf>     leafs;
+    u::vector<kdBinVisibility> visibility;
 
     static constexpr float kDistEpsilon = 0.02f; // 2cm epsilon for triangle collisions
     static constexpr float kMinFraction = 0.005f; // no less than 0.5% movement along a direction vector
@@ -94,7 +102,7 @@ private:
 
     void traceSphere(kdSphereTrace *trace, int32_t node);
     bool isSphereStuck(const m::vec3 &position, float radius, int32_t node);
-    bool inSphere(u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius, int32_t node);
+    bool inSphere(kdStack &stack, u::vector<size_t> &triangleIndices, const m::vec3 &position, float radius, int32_t node) const;
 
     kdStack m_stack;
 };
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <float.h>
 
 #include "kdtree.h"
 
@@ -8,6 +9,8 @@
 #include "u_zlib.h"
 #include "u_log.h"
 
+#include "m_trig.h"
+
 ///! triangle
 m::vec3 kdTriangle::getNormal(const kdTree *const tree) {
     if (m_plane.n.isNull())
@@ -476,6 +479,370 @@ static int32_t kdBinGetNodes(const kdTree &tree, const kdNode *node, u::vector<k
 
     return nodeIndex;
 }
+
+static void kdBinGetLeafBounds(const kdNode *node, const m::vec3 &min, const m::vec3 &max,
+    u::vector<u::pair<m::vec3, m::vec3>> &bounds)
+{
+    // leafs must be visited in the same order kdBinGetNodes inserts them
+    if (node->isLeaf()) {
+        bounds.push_back({ min, max });
+        return;
+    }
+
+    size_t axis = 0;
+    for (size_t i = 0; i < 3; i++) {
+        if (m::abs(node->m_splitPlane.n[i]) > m::kEpsilon) {
+            axis = i;
+            break;
+        }
+    }
+
+    // the front of the splitting plane is n*p + d > 0
+    const float normal = node->m_splitPlane.n[axis];
+    const float split = m::clamp(-node->m_splitPlane.d / normal, min[axis], max[axis]);
+    m::vec3 lower = max;
+    m::vec3 upper = min;
+    lower[axis] = split;
+    upper[axis] = split;
+    if (normal > 0.0f) {
+        kdBinGetLeafBounds(node->m_front, upper, max, bounds);
+        kdBinGetLeafBounds(node->m_back, min, lower, bounds);
+    } else {
+        kdBinGetLeafBounds(node->m_front, min, lower, bounds);
+        kdBinGetLeafBounds(node->m_back, upper, max, bounds);
+    }
+}
+
+static void kdBinCompressVisibility(const uint8_t *bits, size_t size, kdBinVisibility &visibility) {
+    for (size_t i = 0; i < size; ) {
+        if (bits[i]) {
+            visibility.data.push_back(bits[i++]);
+            continue;
+        }
+        size_t run = 0;
+        while (i < size && !bits[i] && run < 255) {
+            run++;
+            i++;
+        }
+        visibility.data.push_back(0);
+        visibility.data.push_back(run);
+    }
+}
+
+bool kdTree::isSegmentTriangle(size_t index, const m::vec3 &start, const m::vec3 &end) const {
+    const int *indexTo = m_triangles[index].m_vertices;
+    const m::vec3 &p0 = m_vertices[indexTo[0]];
+    const m::vec3 &p1 = m_vertices[indexTo[1]];
+    const m::vec3 &p2 = m_vertices[indexTo[2]];
+    const m::vec3 direction = end - start;
+    const m::vec3 e1 = p1 - p0;
+    const m::vec3 e2 = p2 - p0;
+    const m::vec3 p = direction.cross(e2);
+    const float det = e1 * p;
+    if (m::abs(det) < m::kEpsilon)
+        return false;
+    const float invDet = 1.0f / det;
+    const m::vec3 t = start - p0;
+    const float w1 = (t * p) * invDet;
+    if (w1 < 0.0f || w1 > 1.0f)
+        return false;
+    const m::vec3 q = t.cross(e1);
+    const float w2 = (direction * q) * invDet;
+    if (w2 < 0.0f || w1 + w2 > 1.0f)
+        return false;
+    // ignore hits at the ends of the segment since the centers of leafs can be on
+    // the very triangles which bound a leaf
+    const float fraction = (e2 * q) * invDet;
+    return fraction > kEpsilon && fraction < 1.0f - kEpsilon;
+}
+
+// Convex polygons in the plane of an occluder are counter-clockwise
+typedef u::vector<m::vec2> kdBinPolygon;
+
+static inline float kdBinCross(const m::vec2 &o, const m::vec2 &a, const m::vec2 &b) {
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+static kdBinPolygon kdBinConvexHull(u::vector<m::vec2> &points) {
+    u::sort(points.begin(), points.end(), [](const m::vec2 &lhs, const m::vec2 &rhs) {
+        return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+    });
+    // monotone chain: lower hull then upper hull
+    kdBinPolygon hull(2 * points.size());
+    size_t count = 0;
+    for (size_t i = 0; i < points.size(); i++) {
+        while (count >= 2 && kdBinCross(hull[count-2], hull[count-1], points[i]) <= 0.0f)
+            count--;
+        hull[count++] = points[i];
+    }
+    for (size_t i = points.size() - 1, lower = count + 1; i-- > 0; ) {
+        while (count >= lower && kdBinCross(hull[count-2], hull[count-1], points[i]) <= 0.0f)
+            count--;
+        hull[count++] = points[i];
+    }
+    hull.resize(count ? count - 1 : 0);
+    return hull;
+}
+
+// Slivers which remain between the shared edges of triangles are no wider than
+// the epsilon used to classify points against planes and are considered closed
+static bool kdBinPolygonEmpty(const kdBinPolygon &polygon, float epsilon) {
+    if (polygon.size() < 3)
+        return true;
+    float area = 0.0f;
+    float perimeter = 0.0f;
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const m::vec2 &a = polygon[i];
+        const m::vec2 &b = polygon[(i + 1) % polygon.size()];
+        area += a.x * b.y - b.x * a.y;
+        perimeter += m::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+    }
+    return area * 0.5f < epsilon * perimeter * 0.5f;
+}
+
+// the part of the polygon to the left of the line through a and b, or to the
+// right of it when side is negative
+static void kdBinClipPolygon(const kdBinPolygon &polygon, const m::vec2 &a, const m::vec2 &b,
+    float side, kdBinPolygon &result)
+{
+    result.clear();
+    for (size_t i = 0; i < polygon.size(); i++) {
+        const m::vec2 &p = polygon[i];
+        const m::vec2 &q = polygon[(i + 1) % polygon.size()];
+        const float dp = side * kdBinCross(a, b, p);
+        const float dq = side * kdBinCross(a, b, q);
+        if (dp >= 0.0f)
+            result.push_back(p);
+        if ((dp < 0.0f && dq > 0.0f) || (dp > 0.0f && dq < 0.0f)) {
+            const float f = dp / (dp - dq);
+            result.push_back({ p.x + (q.x - p.x) * f, p.y + (q.y - p.y) * f });
+        }
+    }
+}
+
+// the polygon without the triangle is made of at most three convex pieces
+static void kdBinSubtractTriangle(const kdBinPolygon &polygon, const m::vec2 (&triangle)[3],
+    float epsilon, u::vector<kdBinPolygon> &pieces)
+{
+    kdBinPolygon inside = polygon;
+    kdBinPolygon outside;
+    kdBinPolygon remaining;
+    for (size_t i = 0; i < 3 && !kdBinPolygonEmpty(inside, epsilon); i++) {
+        const m::vec2 &a = triangle[i];
+        const m::vec2 &b = triangle[(i + 1) % 3];
+        kdBinClipPolygon(inside, a, b, -1.0f, outside);
+        if (!kdBinPolygonEmpty(outside, epsilon))
+            pieces.push_back(outside);
+        kdBinClipPolygon(inside, a, b, 1.0f, remaining);
+        inside.swap(remaining);
+    }
+}
+
+static void kdBinUnique(u::vector<size_t> &values) {
+    if (values.empty())
+        return;
+    u::sort(values.begin(), values.end(), [](size_t lhs, size_t rhs) { return lhs < rhs; });
+    size_t count = 1;
+    for (size_t i = 1; i < values.size(); i++)
+        if (values[i] != values[count - 1])
+            values[count++] = values[i];
+    values.resize(count);
+}
+
+void kdTree::segmentTriangles(const kdNode *node, const m::vec3 &start, const m::vec3 &end,
+    u::vector<size_t> &triangles) const
+{
+    if (node->isLeaf()) {
+        for (const auto &it : node->m_triangles)
+            if (isSegmentTriangle(it, start, end))
+                triangles.push_back(it);
+        return;
+    }
+    const float ds = node->m_splitPlane.distance(start);
+    const float de = node->m_splitPlane.distance(end);
+    if (ds > -kEpsilon || de > -kEpsilon)
+        segmentTriangles(node->m_front, start, end, triangles);
+    if (ds < kEpsilon || de < kEpsilon)
+        segmentTriangles(node->m_back, start, end, triangles);
+}
+
+void kdTree::boxTriangles(const kdNode *node, const m::vec3 &min, const m::vec3 &max,
+    u::vector<size_t> &triangles) const
+{
+    if (node->isLeaf()) {
+        triangles.insert(triangles.end(), node->m_triangles.begin(), node->m_triangles.end());
+        return;
+    }
+    // nearest and farthest distance of the box to the splitting plane
+    const m::plane &plane = node->m_splitPlane;
+    float nearest = plane.d;
+    float farthest = plane.d;
+    for (size_t i = 0; i < 3; i++) {
+        nearest += u::min(plane.n[i] * min[i], plane.n[i] * max[i]);
+        farthest += u::max(plane.n[i] * min[i], plane.n[i] * max[i]);
+    }
+    if (farthest > -kEpsilon)
+        boxTriangles(node->m_front, min, max, triangles);
+    if (nearest < kEpsilon)
+        boxTriangles(node->m_back, min, max, triangles);
+}
+
+bool kdTree::isOccluded(const m::vec3 *lhs, const m::vec3 *rhs, size_t triangle,
+    u::vector<size_t> &triangles) const
+{
+    const int *indexTo = m_triangles[triangle].m_vertices;
+    const m::vec3 &p0 = m_vertices[indexTo[0]];
+    const m::vec3 normal = (m_vertices[indexTo[1]] - p0).cross(m_vertices[indexTo[2]] - p0);
+    if (normal.isNullEpsilon(m::kEpsilon))
+        return false;
+    const m::plane plane(p0, normal.normalized());
+
+    // the plane must separate the cells
+    float distances[16];
+    for (size_t i = 0; i < 8; i++) {
+        distances[i] = plane.distance(lhs[i]);
+        distances[8 + i] = plane.distance(rhs[i]);
+    }
+    const float side = distances[0] > 0.0f ? 1.0f : -1.0f;
+    for (size_t i = 0; i < 16; i++)
+        if ((i < 8 ? side : -side) * distances[i] <= kEpsilon)
+            return false;
+
+    // every segment between the cells crosses the plane inside of the convex
+    // hull of where the segments between their corners cross it
+    size_t u = 0;
+    for (size_t i = 1; i < 3; i++)
+        if (m::abs(plane.n[i]) > m::abs(plane.n[u]))
+            u = i;
+    const size_t v = (u + 2) % 3;
+    u = (u + 1) % 3;
+    u::vector<m::vec2> points;
+    m::vec3 min(FLT_MAX);
+    m::vec3 max(-FLT_MAX);
+    for (size_t i = 0; i < 8; i++) {
+        for (size_t j = 0; j < 8; j++) {
+            const float f = distances[i] / (distances[i] - distances[8 + j]);
+            const m::vec3 point = lhs[i] + (rhs[j] - lhs[i]) * f;
+            min = m::vec3::min(min, point);
+            max = m::vec3::max(max, point);
+            points.push_back({ point[u], point[v] });
+        }
+    }
+    kdBinPolygon hull = kdBinConvexHull(points);
+    if (hull.size() < 3)
+        return false;
+
+    // which must be covered entirely by the triangles in the plane
+    triangles.clear();
+    boxTriangles(m_root, min - m::vec3(kEpsilon), max + m::vec3(kEpsilon), triangles);
+    kdBinUnique(triangles);
+    u::vector<kdBinPolygon> pieces;
+    u::vector<kdBinPolygon> next;
+    pieces.push_back(hull);
+    size_t covering = 0;
+    for (const auto &it : triangles) {
+        const int *vertices = m_triangles[it].m_vertices;
+        m::vec2 corners[3];
+        bool coplanar = true;
+        for (size_t i = 0; i < 3 && coplanar; i++) {
+            const m::vec3 &vertex = m_vertices[vertices[i]];
+            coplanar = m::abs(plane.distance(vertex)) < kEpsilon;
+            corners[i] = { vertex[u], vertex[v] };
+        }
+        const float area = kdBinCross(corners[0], corners[1], corners[2]);
+        if (!coplanar || m::abs(area) < m::kEpsilon)
+            continue;
+        if (++covering > kMaxVisibilityTriangles)
+            return false;
+        if (area < 0.0f)
+            u::swap(corners[1], corners[2]);
+        next.clear();
+        for (const auto &piece : pieces)
+            kdBinSubtractTriangle(piece, corners, kEpsilon, next);
+        pieces.swap(next);
+        if (pieces.empty())
+            return true;
+        if (pieces.size() > kMaxVisibilityPieces)
+            return false;
+    }
+    return false;
+}
+
+u::vector<kdBinVisibility> kdTree::calculateVisibility() const {
+    m::vec3 min(FLT_MAX);
+    m::vec3 max(-FLT_MAX);
+    for (const auto &it : m_vertices) {
+        min = m::vec3::min(min, it);
+        max = m::vec3::max(max, it);
+    }
+
+    u::vector<u::pair<m::vec3, m::vec3>> bounds;
+    kdBinGetLeafBounds(m_root, min, max, bounds);
+
+    const size_t leafCount = bounds.size();
+    u::vector<m::vec3> corners;
+    corners.reserve(leafCount * 8);
+    for (const auto &it : bounds) {
+        for (size_t i = 0; i < 8; i++) {
+            corners.push_back({ i & 1 ? it.second.x : it.first.x,
+                                i & 2 ? it.second.y : it.first.y,
+                                i & 4 ? it.second.z : it.first.z });
+        }
+    }
+
+    // Two leafs are only hidden from each other when it's proven that every
+    // segment between their cells is blocked by the surface of the triangles
+    // crossed by the segment between their centers. Anything which can't be
+    // proven in the budget of tests is visible; visibility is symmetric
+    const size_t rowSize = (leafCount + 7) / 8;
+    u::vector<uint8_t> bits(leafCount * rowSize, 0);
+    u::vector<size_t> hits;
+    u::vector<size_t> triangles;
+    size_t tests = 0;
+    size_t hidden = 0;
+    size_t untested = 0;
+    for (size_t i = 0; i < leafCount; i++) {
+        bits[i*rowSize + i/8] |= 1 << (i%8);
+        const m::vec3 &lhsMin = bounds[i].first;
+        const m::vec3 &lhsMax = bounds[i].second;
+        for (size_t j = i + 1; j < leafCount; j++) {
+            const m::vec3 &rhsMin = bounds[j].first;
+            const m::vec3 &rhsMax = bounds[j].second;
+            // cells which touch can't be separated by a plane
+            const bool touching = lhsMin.x <= rhsMax.x + kEpsilon && rhsMin.x <= lhsMax.x + kEpsilon
+                               && lhsMin.y <= rhsMax.y + kEpsilon && rhsMin.y <= lhsMax.y + kEpsilon
+                               && lhsMin.z <= rhsMax.z + kEpsilon && rhsMin.z <= lhsMax.z + kEpsilon;
+            bool visible = true;
+            if (!touching && tests >= kMaxVisibilityTests) {
+                untested++;
+            } else if (!touching) {
+                tests++;
+                hits.clear();
+                segmentTriangles(m_root, (lhsMin + lhsMax) * 0.5f, (rhsMin + rhsMax) * 0.5f, hits);
+                kdBinUnique(hits);
+                for (size_t k = 0; k < hits.size() && k < kMaxVisibilityOccluders && visible; k++)
+                    visible = !isOccluded(&corners[i*8], &corners[j*8], hits[k], triangles);
+            }
+            if (!visible) {
+                hidden++;
+                continue;
+            }
+            bits[i*rowSize + j/8] |= 1 << (j%8);
+            bits[j*rowSize + i/8] |= 1 << (i%8);
+        }
+    }
+
+    u::Log::out("[world] => potentially visible sets of %zu leafs: %zu pairs hidden in %zu tests\n",
+        leafCount, hidden, tests);
+    if (untested)
+        u::Log::out("[world] => %zu pairs of leafs exceeded the budget of tests and are visible\n", untested);
+
+    u::vector<kdBinVisibility> visibility(leafCount);
+    for (size_t i = 0; i < leafCount; i++)
+        kdBinCompressVisibility(&bits[i*rowSize], rowSize, visibility[i]);
+    return visibility;
+}
+
 template <typename T>
 static void kdSerialize(u::vector<unsigned char> &buffer, const T *data, size_t size) {
     const unsigned char *const beg = (const unsigned char *const)data;
@@ -508,6 +875,16 @@ inline void kdSerializeLump<kdBinLeaf>(u::vector<unsigned char> &buffer, const u
     }
 }
 
+template <>
+inline void kdSerializeLump<kdBinVisibility>(u::vector<unsigned char> &buffer, const u::vector<kdBinVisibility> &visibility) {
+    for (const auto &it : visibility) {
+        const uint32_t size = u::endianSwap(uint32_t(it.data.size()));
+        kdSerialize(buffer, &size, sizeof size);
+        if (it.data.size())
+            kdSerialize(buffer, &it.data[0], it.data.size());
+    }
+}
+
 u::vector<unsigned char> kdTree::serialize() {
     u::vector<kdBinPlane>    compiledPlanes;
     u::vector<kdBinTexture>  compiledTextures;
@@ -551,6 +928,9 @@ u::vector<unsigned char> kdTree::serialize() {
 
     kdBinGetNodes(*this, m_root, compiledPlanes, compiledNodes, compiledLeafs);
 
+    // potentially visible sets for every leaf
+    const u::vector<kdBinVisibility> compiledVisibility = calculateVisibility();
+
     // Get entities
     for (const auto &it : m_entities) {
         kdBinEnt ent;
@@ -590,9 +970,15 @@ u::vector<unsigned char> kdTree::serialize() {
     kdBinEntry entryVertices;
     kdBinEntry entryEntities;
     kdBinEntry entryLeafs;
+    kdBinEntry entryVisibility;
     kdBinHeader header;
 
-    entryPlanes.offset = sizeof header + 7*sizeof(kdBinEntry);
+    // leafs are variable sized
+    size_t leafsLength = 0;
+    for (const auto &it : compiledLeafs)
+        leafsLength += sizeof(uint32_t) * (1 + it.triangles.size());
+
+    entryPlanes.offset = sizeof header + 8*sizeof(kdBinEntry);
     entryPlanes.length = compiledPlanes.size() * sizeof(kdBinPlane);
     entryTextures.offset = entryPlanes.length + entryPlanes.offset;
     entryTextures.length = compiledTextures.size() * sizeof(kdBinTexture);
@@ -606,6 +992,8 @@ u::vector<unsigned char> kdTree::serialize() {
     entryEntities.length = compiledEntities.size() * sizeof(kdBinEnt);
     entryLeafs.offset = entryEntities.length + entryEntities.offset;
     entryLeafs.length = compiledLeafs.size();
+    entryVisibility.offset = leafsLength + entryLeafs.offset;
+    entryVisibility.length = compiledVisibility.size();
 
     u::vector<unsigned char> store;
 
@@ -617,6 +1005,7 @@ u::vector<unsigned char> kdTree::serialize() {
     kdSerializeEntry(store, entryVertices);
     kdSerializeEntry(store, entryEntities);
     kdSerializeEntry(store, entryLeafs);
+    kdSerializeEntry(store, entryVisibility);
     kdSerializeLump(store, compiledPlanes);
     kdSerializeLump(store, compiledTextures);
     kdSerializeLump(store, compiledNodes);
@@ -624,6 +1013,7 @@ u::vector<unsigned char> kdTree::serialize() {
     kdSerializeLump(store, compiledVertices);
     kdSerializeLump(store, compiledEntities);
     kdSerializeLump(store, compiledLeafs);
+    kdSerializeLump(store, compiledVisibility);
 
     const uint32_t end = u::endianSwap(kdBinHeader::kMagic);
     kdSerialize(store, &end, sizeof end);
@@ -10,6 +10,7 @@
 #include "m_quat.h"
 
 struct kdTree;
+struct kdBinVisibility;
 
 struct kdEnt {
     uint32_t id;
@@ -79,6 +80,11 @@ struct kdTree {
     static constexpr float kEpsilon = 0.01f; // Plane offset for point classification
     static constexpr size_t kMaxTrianglesPerLeaf = 5;
     static constexpr size_t kMaxRecursionDepth = 35;
+    // Limits of the potentially visible set calculation
+    static constexpr size_t kMaxVisibilityTests = 1 << 24; // Pairs of leafs tested
+    static constexpr size_t kMaxVisibilityOccluders = 4; // Planes tested per pair
+    static constexpr size_t kMaxVisibilityTriangles = 256; // Triangles covering a plane
+    static constexpr size_t kMaxVisibilityPieces = 64; // Uncovered pieces of a plane
 
     bool load(const u::string &file);
     polyPlane testTriangle(size_t index, const m::plane &plane) const;
@@ -89,6 +95,18 @@ private:
     friend struct kdNode;
     friend struct kdTriangle;
 
+    // Potentially visible set calculation
+    u::vector<kdBinVisibility> calculateVisibility() const;
+    bool isSegmentTriangle(size_t index, const m::vec3 &start, const m::vec3 &end) const;
+    void segmentTriangles(const kdNode *node, const m::vec3 &start, const m::vec3 &end,
+        u::vector<size_t> &triangles) const;
+    void boxTriangles(const kdNode *node, const m::vec3 &min, const m::vec3 &max,
+        u::vector<size_t> &triangles) const;
+    // Cells given by their corners are hidden from each other by the triangles
+    // in the plane of the triangle
+    bool isOccluded(const m::vec3 *lhs, const m::vec3 *rhs, size_t triangle,
+        u::vector<size_t> &triangles) const;
+
     kdNode *m_root;
     u::vector<m::vec3> m_vertices;
     u::vector<m::vec2> m_texCoords;
@@ -113,7 +131,10 @@ struct kdBinHeader {
 
     enum : uint32_t {
         kMagic   = 0x66551133,
-        kVersion = 1
+        kVersion = 2,
+        // maps compiled before the potentially visible sets were stored, they
+        // lack the visibility entry and are loaded with everything visible
+        kVersionWithoutVisibility = 1
     };
 
     uint32_t magic;
@@ -189,4 +210,10 @@ struct kdBinLeaf {
     u::vector<uint32_t> triangles;
 };
 
+struct kdBinVisibility {
+    // bit set of leafs potentially visible from a leaf; runs of zero bytes
+    // are compressed into a zero followed by the length of the run
+    u::vector<uint8_t> data;
+};
+
 #endif
@@ -49,6 +49,91 @@ bool frustum::testBox(const m::bbox& box) {
     return true;
 }
 
+void boxBounds::add(const m::bbox &box) {
+    minX.push_back(box.min().x);
+    minY.push_back(box.min().y);
+    minZ.push_back(box.min().z);
+    maxX.push_back(box.max().x);
+    maxY.push_back(box.max().y);
+    maxZ.push_back(box.max().z);
+}
+
+void frustum::testSpheres(const sphereBounds &spheres, size_t begin, size_t end, bool *visible) const {
+    if (begin == end)
+        return;
+    const float *const x = &spheres.x[0];
+    const float *const y = &spheres.y[0];
+    const float *const z = &spheres.z[0];
+    const float *const radius = &spheres.radius[0];
+    size_t i = begin;
+#ifdef __SSE2__
+    for (; i + 4 <= end; i += 4) {
+        const __m128 px = _mm_loadu_ps(x + i);
+        const __m128 py = _mm_loadu_ps(y + i);
+        const __m128 pz = _mm_loadu_ps(z + i);
+        const __m128 r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto &it : m_planes) {
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(it.n.x)), _mm_mul_ps(py, _mm_set1_ps(it.n.y))),
+                _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(it.n.z)), _mm_set1_ps(it.d)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, r));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (size_t j = 0; j < 4; j++)
+            visible[i - begin + j] = mask & (1 << j);
+    }
+#endif
+    for (; i < end; i++) {
+        bool inside = true;
+        for (const auto &it : m_planes)
+            inside = inside && it.n.x*x[i] + it.n.y*y[i] + it.n.z*z[i] + it.d >= -radius[i];
+        visible[i - begin] = inside;
+    }
+}
+
+void frustum::testBoxes(const boxBounds &boxes, size_t begin, size_t end, bool *visible) const {
+    if (begin == end)
+        return;
+    // a box is outside when its corner furthest along the normal of a plane
+    // is behind it, which corner that is only depends on the plane
+    const float *corners[6][3];
+    for (size_t k = 0; k < 6; k++) {
+        const auto &n = m_planes[k].n;
+        corners[k][0] = n.x >= 0.0f ? &boxes.maxX[0] : &boxes.minX[0];
+        corners[k][1] = n.y >= 0.0f ? &boxes.maxY[0] : &boxes.minY[0];
+        corners[k][2] = n.z >= 0.0f ? &boxes.maxZ[0] : &boxes.minZ[0];
+    }
+    size_t i = begin;
+#ifdef __SSE2__
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= end; i += 4) {
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (size_t k = 0; k < 6; k++) {
+            const auto &it = m_planes[k];
+            const __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(corners[k][0] + i), _mm_set1_ps(it.n.x)),
+                           _mm_mul_ps(_mm_loadu_ps(corners[k][1] + i), _mm_set1_ps(it.n.y))),
+                _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(corners[k][2] + i), _mm_set1_ps(it.n.z)),
+                           _mm_set1_ps(it.d)));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+        }
+        const int mask = _mm_movemask_ps(inside);
+        for (size_t j = 0; j < 4; j++)
+            visible[i - begin + j] = mask & (1 << j);
+    }
+#endif
+    for (; i < end; i++) {
+        bool inside = true;
+        for (size_t k = 0; k < 6; k++) {
+            const auto &it = m_planes[k];
+            inside = inside && it.n.x*corners[k][0][i] + it.n.y*corners[k][1][i]
+                             + it.n.z*corners[k][2][i] + it.d >= 0.0f;
+        }
+        visible[i - begin] = inside;
+    }
+}
+
 bool frustum::testPoint(const m::vec3 &point) {
     for (size_t i = 0; i < 6; i++)
         if (m_planes[i].distance(point) < 0.0f)
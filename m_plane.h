@@ -2,6 +2,8 @@
 #define M_PLANE_HDR
 #include "m_vec.h"
 
+#include "u_vector.h"
+
 namespace m {
 
 struct mat4;
@@ -72,6 +74,23 @@ inline plane::point plane::classify(const m::vec3 &p, float epsilon) const {
     return dist > epsilon ? kFront : dist < -epsilon ? kBack : kOn;
 }
 
+// Spheres and boxes stored as streams such that they can be tested against
+// the frustum four at a time
+struct sphereBounds {
+    void clear();
+    void add(const m::vec3 &position, float radius);
+    size_t size() const;
+    u::vector<float> x, y, z, radius;
+};
+
+struct boxBounds {
+    void clear();
+    void add(const m::bbox &box);
+    size_t size() const;
+    u::vector<float> minX, minY, minZ;
+    u::vector<float> maxX, maxY, maxZ;
+};
+
 struct frustum {
     void update(const m::mat4 &wvp);
 
@@ -79,10 +98,46 @@ struct frustum {
     bool testBox(const m::bbox& box);
     bool testPoint(const m::vec3 &point);
 
+    // test the spheres or boxes in [begin, end), whether each one is visible
+    // is written into visible[i - begin]
+    void testSpheres(const sphereBounds &spheres, size_t begin, size_t end, bool *visible) const;
+    void testBoxes(const boxBounds &boxes, size_t begin, size_t end, bool *visible) const;
+
 private:
     plane m_planes[6];
 };
 
+inline void sphereBounds::clear() {
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+}
+
+inline void sphereBounds::add(const m::vec3 &position, float r) {
+    x.push_back(position.x);
+    y.push_back(position.y);
+    z.push_back(position.z);
+    radius.push_back(r);
+}
+
+inline size_t sphereBounds::size() const {
+    return x.size();
+}
+
+inline void boxBounds::clear() {
+    minX.clear();
+    minY.clear();
+    minZ.clear();
+    maxX.clear();
+    maxY.clear();
+    maxZ.clear();
+}
+
+inline size_t boxBounds::size() const {
+    return minX.size();
+}
+
 }
 
 #endif
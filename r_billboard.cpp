@@ -1,5 +1,6 @@
 #include "r_billboard.h"
 #include "r_pipeline.h"
+#include "r_buffer.h"
 
 namespace r {
 
@@ -59,19 +60,16 @@ bool billboard::upload() {
     if (!m_method.init())
         return false;
 
-    geom::upload();
+    auto &stream = streamBuffers::instance();
+    if (!stream.init())
+        return false;
 
+    // the vertices are streamed, only the vertex array object is needed
+    gl::GenVertexArrays(1, &vao);
     gl::BindVertexArray(vao);
     gl::EnableVertexAttribArray(0);
     gl::EnableVertexAttribArray(1);
-
-    gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
-    gl::BufferData(GL_ARRAY_BUFFER, sizeof(vertex), 0, GL_DYNAMIC_DRAW);
-    gl::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::position));
-    gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::coordinate));
-
-    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint), 0, GL_DYNAMIC_DRAW);
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.quadIndices());
 
     m_method.enable();
     m_method.setColorTextureUnit(0);
@@ -88,63 +86,47 @@ void billboard::render(const pipeline &pl, float size) {
     m::vec3 side;
     rotation.getOrient(nullptr, &up, &side);
 
-    m_stats->decVBOMemory(sizeof m_vertices[0] * m_vertices.size());
-    m_stats->decIBOMemory(sizeof m_indices[0] * m_indices.size());
-
-    m_vertices.destroy();
-    m_vertices.reserve(m_entries.size() * 4);
-    m_indices.destroy();
-    m_indices.reserve(m_entries.size() * 6);
-
+    // sort back to front, squared distances order the same as distances
+    const m::vec3 &eye = pl.position();
     u::sort(m_entries.begin(), m_entries.end(),
-        [&pl](const entry &lhs, const entry &rhs) {
-            const float d1 = (lhs.position - pl.position()).abs();
-            const float d2 = (rhs.position - pl.position()).abs();
-            return d1 > d2;
+        [&eye](const entry &lhs, const entry &rhs) {
+            const m::vec3 d1 = lhs.position - eye;
+            const m::vec3 d2 = rhs.position - eye;
+            return d1*d1 > d2*d2;
         }
     );
 
-    for (const auto &e : m_entries) {
+    // the farthest billboards are dropped when there are too many to draw
+    const size_t count = u::min(m_entries.size(), streamBuffers::kMaxQuads);
+    if (!count)
+        return;
+
+    auto &stream = streamBuffers::instance();
+    size_t offset = 0;
+    vertex *vertices = (vertex *)stream.map(sizeof(vertex) * count * 4, offset);
+    for (size_t i = m_entries.size() - count; i < m_entries.size(); i++) {
+        const auto &e = m_entries[i];
         const auto &it = e.position;
         const m::vec3 x = size * 0.5f * ((e.flags & kSide) ? side : e.side);
         const m::vec3 y = size * 0.5f * ((e.flags & kUp) ? up : e.up);
-        const m::vec3 q1 =  x + y + it;
-        const m::vec3 q2 = -x + y + it;
-        const m::vec3 q3 = -x - y + it;
-        const m::vec3 q4 =  x - y + it;
-
-        const size_t index = m_vertices.size();
-        m_vertices.push_back({q1, {0.0f, 0.0f}});
-        m_vertices.push_back({q2, {1.0f, 0.0f}});
-        m_vertices.push_back({q3, {1.0f, 1.0f}});
-        m_vertices.push_back({q4, {0.0f, 1.0f}});
-
-        m_indices.push_back(index + 0);
-        m_indices.push_back(index + 1);
-        m_indices.push_back(index + 2);
-        m_indices.push_back(index + 2);
-        m_indices.push_back(index + 3);
-        m_indices.push_back(index + 0);
+        *vertices++ = { x + y + it, { 0.0f, 0.0f } };
+        *vertices++ = { -x + y + it, { 1.0f, 0.0f } };
+        *vertices++ = { -x - y + it, { 1.0f, 1.0f } };
+        *vertices++ = { x - y + it, { 0.0f, 1.0f } };
     }
-    if (m_indices.empty())
-        return;
+    stream.unmap();
 
     gl::BindVertexArray(vao);
-    gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
-    gl::BufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof m_vertices[0], &m_vertices[0], GL_DYNAMIC_DRAW);
-    gl::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof m_vertices[0], u::offset_of(&vertex::position));
-    gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof m_vertices[0], u::offset_of(&vertex::coordinate));
-
-    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof m_indices[0], &m_indices[0], GL_DYNAMIC_DRAW);
-
-    m_stats->incVBOMemory(sizeof(vertex) * m_vertices.size());
-    m_stats->incIBOMemory(sizeof(GLuint) * m_indices.size());
+    gl::BindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    gl::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex),
+        (const GLvoid *)(offset + size_t(u::offset_of(&vertex::position))));
+    gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex),
+        (const GLvoid *)(offset + size_t(u::offset_of(&vertex::coordinate))));
 
     m_method.enable();
-    m_method.setVP(pl.projection() * pl.view());
+    m_method.setVP(pl.viewProjection());
     m_texture.bind(GL_TEXTURE0);
-    gl::DrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_INT, nullptr);
+    gl::DrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, nullptr);
     m_entries.clear();
 }
 
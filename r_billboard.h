@@ -68,8 +68,6 @@ private:
     };
 
     u::vector<entry> m_entries;
-    u::vector<vertex> m_vertices;
-    u::vector<GLuint> m_indices;
     texture2D m_texture;
     billboardMethod m_method;
     r::stat *m_stats;
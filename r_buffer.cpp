@@ -0,0 +1,280 @@
+#include <string.h>
+
+#include "r_buffer.h"
+#include "r_stats.h"
+
+#include "u_log.h"
+
+namespace r {
+
+ringBuffer::ringBuffer()
+    : m_target(0)
+    , m_buffer(0)
+    , m_mapping(nullptr)
+    , m_fences()
+    , m_size(0)
+    , m_alignment(1)
+    , m_frame(0)
+    , m_offset(0)
+    , m_streamed(0)
+    , m_stagingOffset(0)
+    , m_mapped(0)
+{
+}
+
+ringBuffer::~ringBuffer() {
+    destroy();
+}
+
+bool ringBuffer::init(GLenum target, size_t size, size_t alignment) {
+    destroy();
+
+    m_target = target;
+    m_alignment = alignment ? alignment : 1;
+    // every region must start on an aligned offset too
+    m_size = (size + m_alignment - 1) / m_alignment * m_alignment;
+
+    gl::GenBuffers(1, &m_buffer);
+    gl::BindBuffer(m_target, m_buffer);
+
+    if (gl::has(gl::ARB_buffer_storage)) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        gl::BufferStorage(m_target, m_size * kFrames, nullptr, flags);
+        m_mapping = (unsigned char *)gl::MapBufferRange(m_target, 0, m_size * kFrames, flags);
+        if (m_mapping)
+            return true;
+        // fall back to orphaning with a buffer of mutable storage
+        u::Log::err("[buffer] => failed to map ring buffer persistently\n");
+        gl::DeleteBuffers(1, &m_buffer);
+        gl::GenBuffers(1, &m_buffer);
+        gl::BindBuffer(m_target, m_buffer);
+    }
+
+    gl::BufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+    return true;
+}
+
+void ringBuffer::destroy() {
+    if (!m_buffer)
+        return;
+    for (auto &it : m_fences)
+        if (it)
+            wait(it);
+    if (m_mapping) {
+        gl::BindBuffer(m_target, m_buffer);
+        gl::UnmapBuffer(m_target);
+        m_mapping = nullptr;
+    }
+    gl::DeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
+
+void ringBuffer::wait(GLsync &fence) {
+    while (gl::ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+        ;
+    gl::DeleteSync(fence);
+    fence = nullptr;
+}
+
+void ringBuffer::begin() {
+    m_offset = 0;
+    m_streamed = 0;
+    for (auto &it : m_bindings)
+        it.clear();
+    if (m_mapping) {
+        // the GPU may still be reading from this region
+        if (m_fences[m_frame])
+            wait(m_fences[m_frame]);
+    } else {
+        gl::BindBuffer(m_target, m_buffer);
+        gl::BufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void ringBuffer::end() {
+    if (!m_mapping)
+        return;
+    m_fences[m_frame] = gl::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_frame = (m_frame + 1) % kFrames;
+}
+
+void ringBuffer::grow(size_t size) {
+    // draws which were issued with the old buffer keep it alive until GL is
+    // done with them. Users ask for the buffer after every write so they pick
+    // up the new one
+    size_t grown = m_size ? m_size * 2 : size;
+    while (grown < size)
+        grown *= 2;
+    u::Log::out("[buffer] => ring buffer grew from %zu to %zu bytes per frame\n", m_size, grown);
+    const size_t streamed = m_streamed;
+    init(m_target, grown, m_alignment);
+    m_frame = 0;
+    m_offset = 0;
+    m_streamed = streamed;
+    // deleting the old buffer reset the indexed binding points which referred
+    // to it
+    rebind();
+}
+
+size_t ringBuffer::bound() const {
+    size_t size = 0;
+    for (const auto &it : m_bindings)
+        size += (it.size() + m_alignment - 1) / m_alignment * m_alignment;
+    return size;
+}
+
+void ringBuffer::rebind() {
+    // draws later in the frame still expect the ranges bound earlier in it,
+    // write their data again at the start of the buffer. There is always room
+    // for it since allocate makes sure the bindings and the request fit
+    u::vector<u::vector<unsigned char>> bindings;
+    bindings.swap(m_bindings);
+    for (size_t i = 0; i < bindings.size(); i++)
+        if (bindings[i].size())
+            bind(i, &bindings[i][0], bindings[i].size());
+}
+
+size_t ringBuffer::allocate(size_t size) {
+    // a request which would not fit in a whole frame along with the ranges
+    // bound so far is given a larger buffer
+    const size_t required = size + bound();
+    if (required > m_size)
+        grow(required);
+    if (m_offset + size > m_size) {
+        // out of space for this frame: start over once the GPU is done with
+        // everything written so far
+        if (m_mapping) {
+            GLsync fence = gl::FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            wait(fence);
+        } else {
+            gl::BindBuffer(m_target, m_buffer);
+            gl::BufferData(m_target, m_size, nullptr, GL_STREAM_DRAW);
+        }
+        m_offset = 0;
+        // the ranges bound earlier in the frame were overwritten
+        rebind();
+    }
+
+    const size_t offset = m_offset;
+    m_offset = (m_offset + size + m_alignment - 1) / m_alignment * m_alignment;
+    m_streamed += size;
+    // uploads through the persistent mapping bypass the entry points
+    if (m_mapping)
+        gl::countStreamed(size);
+
+    return m_mapping ? m_size * m_frame + offset : offset;
+}
+
+size_t ringBuffer::write(const void *data, size_t size) {
+    const size_t offset = allocate(size);
+    if (m_mapping) {
+        memcpy(m_mapping + offset, data, size);
+        // writes through the mapping are invisible to the capture
+        if (gl::capturing())
+            gl::captureBufferWrite(m_buffer, offset, data, size);
+    } else {
+        gl::BindBuffer(m_target, m_buffer);
+        gl::BufferSubData(m_target, offset, size, data);
+    }
+    return offset;
+}
+
+unsigned char *ringBuffer::map(size_t size, size_t &offset) {
+    offset = allocate(size);
+    m_stagingOffset = offset;
+    if (m_mapping) {
+        m_mapped = size;
+        return m_mapping + offset;
+    }
+    m_staging.resize(size);
+    return &m_staging[0];
+}
+
+void ringBuffer::unmap() {
+    if (m_mapping) {
+        if (m_mapped && gl::capturing())
+            gl::captureBufferWrite(m_buffer, m_stagingOffset, m_mapping + m_stagingOffset, m_mapped);
+        m_mapped = 0;
+        return;
+    }
+    if (m_staging.empty())
+        return;
+    gl::BindBuffer(m_target, m_buffer);
+    gl::BufferSubData(m_target, m_stagingOffset, m_staging.size(), &m_staging[0]);
+    m_staging.clear();
+}
+
+void ringBuffer::bind(GLuint index, const void *data, size_t size) {
+    const size_t offset = write(data, size);
+    gl::BindBufferRange(m_target, index, m_buffer, offset, size);
+    if (index >= m_bindings.size())
+        m_bindings.resize(index + 1);
+    auto &binding = m_bindings[index];
+    binding.resize(size);
+    memcpy(&binding[0], data, size);
+}
+
+///! streamBuffers
+constexpr size_t streamBuffers::kVertexMemory;
+constexpr size_t streamBuffers::kMaxQuads;
+
+streamBuffers::streamBuffers()
+    : m_quadIndices(0)
+    , m_stats(nullptr)
+    , m_initialized(false)
+{
+}
+
+bool streamBuffers::init() {
+    if (m_initialized)
+        return true;
+
+    if (!m_vertices.init(GL_ARRAY_BUFFER, kVertexMemory, 16))
+        return false;
+
+    u::vector<GLushort> indices(kMaxQuads * 6);
+    for (size_t i = 0; i < kMaxQuads; i++) {
+        const GLushort index = i * 4;
+        indices[i*6+0] = index + 0;
+        indices[i*6+1] = index + 1;
+        indices[i*6+2] = index + 2;
+        indices[i*6+3] = index + 2;
+        indices[i*6+4] = index + 3;
+        indices[i*6+5] = index + 0;
+    }
+    gl::GenBuffers(1, &m_quadIndices);
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_quadIndices);
+    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof indices[0],
+        &indices[0], GL_STATIC_DRAW);
+
+    m_stats = stat::add("stream", "Streaming");
+    m_stats->incVBOMemory(kVertexMemory * (m_vertices.persistent() ? ringBuffer::kFrames : 1));
+    m_stats->incIBOMemory(indices.size() * sizeof indices[0]);
+
+    return m_initialized = true;
+}
+
+void streamBuffers::release() {
+    if (!m_initialized)
+        return;
+    m_vertices.destroy();
+    gl::DeleteBuffers(1, &m_quadIndices);
+    m_quadIndices = 0;
+    m_initialized = false;
+}
+
+void streamBuffers::begin() {
+    if (m_initialized)
+        m_vertices.begin();
+}
+
+void streamBuffers::end() {
+    if (!m_initialized)
+        return;
+    m_stats->setStreamed(m_vertices.streamed());
+    m_vertices.end();
+}
+
+streamBuffers streamBuffers::m_instance;
+
+}
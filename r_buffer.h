@@ -0,0 +1,140 @@
+#ifndef R_BUFFER_HDR
+#define R_BUFFER_HDR
+#include "r_common.h"
+
+#include "u_vector.h"
+
+namespace r {
+
+struct stat;
+
+// A buffer the CPU streams data into every frame. When ARB_buffer_storage is
+// available the buffer is persistently mapped and split into one region for
+// every frame in flight, a fence guards each region from being overwritten
+// before the GPU is done reading it. Otherwise the storage is orphaned at the
+// start of every frame and written to with glBufferSubData.
+struct ringBuffer {
+    static constexpr size_t kFrames = 3;
+
+    ringBuffer();
+    ~ringBuffer();
+
+    // size is the amount of memory available to a single frame, it's doubled
+    // when a single write or map would not fit otherwise
+    bool init(GLenum target, size_t size, size_t alignment);
+    void destroy();
+
+    void begin(); // must be called at the start of a frame
+    void end(); // must be called at the end of a frame
+
+    // copy data into the buffer and return the offset it was written to
+    size_t write(const void *data, size_t size);
+    // copy data into the buffer and bind it to an indexed binding point, the
+    // range stays valid for the rest of the frame even if the buffer grows or
+    // wraps around
+    void bind(GLuint index, const void *data, size_t size);
+
+    // reserve room in the buffer to be written to directly, the memory stays
+    // valid until unmap is called
+    unsigned char *map(size_t size, size_t &offset);
+    void unmap();
+
+    GLuint buffer() const;
+    bool persistent() const;
+    size_t streamed() const; // bytes written since the start of the frame
+
+private:
+    size_t allocate(size_t size);
+    void grow(size_t size);
+    size_t bound() const;
+    void rebind();
+    void wait(GLsync &fence);
+
+    GLenum m_target;
+    GLuint m_buffer;
+    unsigned char *m_mapping;
+    GLsync m_fences[kFrames];
+    size_t m_size;
+    size_t m_alignment;
+    size_t m_frame;
+    size_t m_offset;
+    size_t m_streamed;
+    // without a persistent mapping, mapped memory is staged and uploaded on unmap
+    u::vector<unsigned char> m_staging;
+    size_t m_stagingOffset;
+    size_t m_mapped; // size of the region mapped through the persistent mapping
+    // the data last bound to every indexed binding point this frame
+    u::vector<u::vector<unsigned char>> m_bindings;
+};
+
+inline GLuint ringBuffer::buffer() const {
+    return m_buffer;
+}
+
+inline bool ringBuffer::persistent() const {
+    return m_mapping;
+}
+
+inline size_t ringBuffer::streamed() const {
+    return m_streamed;
+}
+
+// Billboards, particles and the GUI stream their vertices through one shared
+// ring buffer every frame. Their quads are drawn with a static index buffer
+// which is built once instead of being uploaded along with the vertices.
+struct streamBuffers {
+    static constexpr size_t kVertexMemory = 4 << 20; // for a single frame
+    static constexpr size_t kMaxQuads = 16384; // the most quads a draw can reference
+
+    static streamBuffers &instance() {
+        return m_instance;
+    }
+
+    bool init();
+    void release();
+
+    void begin(); // called by the engine at the start of a frame
+    void end(); // called by the engine at the end of a frame
+
+    size_t write(const void *data, size_t size);
+    unsigned char *map(size_t size, size_t &offset);
+    void unmap();
+
+    GLuint vertexBuffer() const;
+    GLuint quadIndices() const; // GL_UNSIGNED_SHORT indices for kMaxQuads quads
+
+private:
+    streamBuffers();
+    streamBuffers(const streamBuffers &) = delete;
+    void operator =(const streamBuffers &) = delete;
+
+    ringBuffer m_vertices;
+    GLuint m_quadIndices;
+    stat *m_stats;
+    bool m_initialized;
+    static streamBuffers m_instance;
+};
+
+inline size_t streamBuffers::write(const void *data, size_t size) {
+    return m_vertices.write(data, size);
+}
+
+inline unsigned char *streamBuffers::map(size_t size, size_t &offset) {
+    return m_vertices.map(size, offset);
+}
+
+inline void streamBuffers::unmap() {
+    m_vertices.unmap();
+}
+
+inline GLuint streamBuffers::vertexBuffer() const {
+    return m_vertices.buffer();
+}
+
+inline GLuint streamBuffers::quadIndices() const {
+    return m_quadIndices;
+}
+
+}
+
+#endif
@@ -0,0 +1,273 @@
+#include "r_cluster.h"
+#include "r_light.h"
+
+#include "m_mat.h"
+#include "m_trig.h"
+#include "m_const.h"
+
+#include "u_algorithm.h"
+
+namespace r {
+
+constexpr size_t lightClusters::kTilesX;
+constexpr size_t lightClusters::kTilesY;
+constexpr size_t lightClusters::kSlices;
+constexpr size_t lightClusters::kClusters;
+constexpr size_t lightClusters::kMaxLights;
+constexpr size_t lightClusters::kIndexWidth;
+constexpr size_t lightClusters::kMaxIndices;
+
+lightClusters::lightClusters()
+    : m_count(0)
+    , m_indexCount(0)
+{
+    m_textures[0] = 0;
+    m_textures[1] = 0;
+    m_textures[2] = 0;
+}
+
+lightClusters::~lightClusters() {
+    if (m_textures[0])
+        gl::DeleteTextures(3, m_textures);
+}
+
+bool lightClusters::init() {
+    gl::GenTextures(3, m_textures);
+
+    static const struct {
+        GLint internalFormat;
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLenum type;
+    } kFormats[] = {
+        { GL_RG32UI, kTilesX, kTilesY * kSlices, GL_RG_INTEGER, GL_UNSIGNED_INT },
+        { GL_R16UI, kIndexWidth, kMaxIndices / kIndexWidth, GL_RED_INTEGER, GL_UNSIGNED_SHORT },
+        { GL_RGBA32F, 3, kMaxLights, GL_RGBA, GL_FLOAT }
+    };
+
+    for (size_t i = 0; i < 3; i++) {
+        const auto &it = kFormats[i];
+        gl::BindTexture(GL_TEXTURE_2D, m_textures[i]);
+        gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl::TexImage2D(GL_TEXTURE_2D, 0, it.internalFormat, it.width, it.height,
+            0, it.format, it.type, nullptr);
+    }
+
+    m_clusters.resize(kClusters * 2);
+    m_fill.resize(kClusters);
+    m_indices.resize(kMaxIndices);
+    m_lights.reserve(kMaxLights * 3);
+
+    return true;
+}
+
+void lightClusters::clear() {
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_radius.clear();
+    m_lights.clear();
+    m_count = 0;
+}
+
+void lightClusters::addSphere(const m::vec3 &position, float radius) {
+    m_x.push_back(position.x);
+    m_y.push_back(position.y);
+    m_z.push_back(position.z);
+    m_radius.push_back(radius);
+    m_count++;
+}
+
+bool lightClusters::add(const pointLight &light) {
+    if (m_count == kMaxLights)
+        return false;
+    m_lights.push_back({ light.color, light.diffuse });
+    m_lights.push_back({ light.position, light.radius });
+    // a cutoff larger than one marks the light as a point light
+    m_lights.push_back({ 0.0f, 0.0f, 0.0f, 2.0f });
+    addSphere(light.position, light.radius);
+    return true;
+}
+
+bool lightClusters::add(const spotLight &light) {
+    if (m_count == kMaxLights)
+        return false;
+    m_lights.push_back({ light.color, light.diffuse });
+    m_lights.push_back({ light.position, light.radius });
+    m_lights.push_back({ light.direction.normalized(), m::cos(m::toRadian(light.cutOff)) });
+    addSphere(light.position, light.radius);
+    return true;
+}
+
+void lightClusters::calculateBounds(const m::mat4 &view, const m::perspective &p) {
+    // pad the streams such that they can be transformed four at a time
+    const size_t count = (m_count + 3) & ~3;
+    for (size_t i = m_count; i < count; i++) {
+        m_x.push_back(0.0f);
+        m_y.push_back(0.0f);
+        m_z.push_back(0.0f);
+        m_radius.push_back(0.0f);
+    }
+
+    // transform the light positions into view space
+#ifdef __SSE2__
+    const __m128 ax = _mm_set1_ps(view.a.x), ay = _mm_set1_ps(view.a.y),
+                 az = _mm_set1_ps(view.a.z), aw = _mm_set1_ps(view.a.w);
+    const __m128 bx = _mm_set1_ps(view.b.x), by = _mm_set1_ps(view.b.y),
+                 bz = _mm_set1_ps(view.b.z), bw = _mm_set1_ps(view.b.w);
+    const __m128 cx = _mm_set1_ps(view.c.x), cy = _mm_set1_ps(view.c.y),
+                 cz = _mm_set1_ps(view.c.z), cw = _mm_set1_ps(view.c.w);
+    for (size_t i = 0; i < count; i += 4) {
+        const __m128 x = _mm_loadu_ps(&m_x[i]);
+        const __m128 y = _mm_loadu_ps(&m_y[i]);
+        const __m128 z = _mm_loadu_ps(&m_z[i]);
+        _mm_storeu_ps(&m_x[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, x), _mm_mul_ps(ay, y)),
+                                          _mm_add_ps(_mm_mul_ps(az, z), aw)));
+        _mm_storeu_ps(&m_y[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(bx, x), _mm_mul_ps(by, y)),
+                                          _mm_add_ps(_mm_mul_ps(bz, z), bw)));
+        _mm_storeu_ps(&m_z[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, x), _mm_mul_ps(cy, y)),
+                                          _mm_add_ps(_mm_mul_ps(cz, z), cw)));
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        const float x = m_x[i];
+        const float y = m_y[i];
+        const float z = m_z[i];
+        m_x[i] = view.a.x*x + view.a.y*y + view.a.z*z + view.a.w;
+        m_y[i] = view.b.x*x + view.b.y*y + view.b.z*z + view.b.w;
+        m_z[i] = view.c.x*x + view.c.y*y + view.c.z*z + view.c.w;
+    }
+#endif
+
+    const float halfFov = m::tan(m::toRadian(p.fov) * 0.5f);
+    const float sx = 1.0f / (halfFov * (p.width / p.height));
+    const float sy = 1.0f / halfFov;
+
+    const auto tile = [](float ndc, size_t tiles) -> uint8_t {
+        const int index = int(m::floor((ndc * 0.5f + 0.5f) * tiles));
+        return m::clamp(index, 0, int(tiles) - 1);
+    };
+    const auto slice = [this](float z) -> uint8_t {
+        const int index = int(m::floor(m::log2(z) * m_grid.z + m_grid.w));
+        return m::clamp(index, 0, int(kSlices) - 1);
+    };
+
+    m_bounds.resize(m_count);
+    for (size_t i = 0; i < m_count; i++) {
+        auto &bounds = m_bounds[i];
+        bounds.dropped = false;
+        const float x = m_x[i];
+        const float y = m_y[i];
+        const float radius = m_radius[i];
+        const float zmin = m_z[i] - radius;
+        const float zmax = m_z[i] + radius;
+
+        bounds.visible = zmax >= p.nearp && zmin <= p.farp;
+        if (!bounds.visible)
+            continue;
+
+        bounds.z0 = zmin <= p.nearp ? 0 : slice(zmin);
+        bounds.z1 = slice(zmax);
+
+        // the sphere contains the eye, it covers the whole screen
+        if (zmin <= p.nearp) {
+            bounds.x0 = 0;
+            bounds.x1 = kTilesX - 1;
+            bounds.y0 = 0;
+            bounds.y1 = kTilesY - 1;
+            continue;
+        }
+
+        // conservative screen extents of the sphere: the largest projection
+        // of a positive extent is at the nearest depth and of a negative
+        // extent at the farthest depth
+        const float maxX = x + radius, minX = x - radius;
+        const float maxY = y + radius, minY = y - radius;
+        bounds.x0 = tile(minX / (minX < 0.0f ? zmin : zmax) * sx, kTilesX);
+        bounds.x1 = tile(maxX / (maxX > 0.0f ? zmin : zmax) * sx, kTilesX);
+        bounds.y0 = tile(minY / (minY < 0.0f ? zmin : zmax) * sy, kTilesY);
+        bounds.y1 = tile(maxY / (maxY > 0.0f ? zmin : zmax) * sy, kTilesY);
+    }
+}
+
+void lightClusters::update(const m::mat4 &view, const m::perspective &p) {
+    const float range = m::log2(p.farp / p.nearp);
+    m_grid = { float(kTilesX), float(kTilesY),
+               kSlices / range, -float(kSlices) * m::log2(p.nearp) / range };
+
+    calculateBounds(view, p);
+
+    const auto cluster = [](size_t x, size_t y, size_t z) {
+        return (z * kTilesY + y) * kTilesX + x;
+    };
+
+    // count the lights of every cluster. Lights which do not fit into the
+    // index list entirely are dropped, they're not in any cluster such that
+    // they can be shaded by other means
+    for (size_t i = 0; i < kClusters; i++) {
+        m_clusters[i*2+1] = 0;
+        m_fill[i] = 0;
+    }
+    m_indexCount = 0;
+    for (size_t i = 0; i < m_count; i++) {
+        auto &bounds = m_bounds[i];
+        if (!bounds.visible)
+            continue;
+        const size_t count = size_t(bounds.x1 - bounds.x0 + 1)
+                           * size_t(bounds.y1 - bounds.y0 + 1)
+                           * size_t(bounds.z1 - bounds.z0 + 1);
+        if (m_indexCount + count > kMaxIndices) {
+            bounds.visible = false;
+            bounds.dropped = true;
+            continue;
+        }
+        m_indexCount += count;
+        for (size_t z = bounds.z0; z <= bounds.z1; z++)
+            for (size_t y = bounds.y0; y <= bounds.y1; y++)
+                for (size_t x = bounds.x0; x <= bounds.x1; x++)
+                    m_clusters[cluster(x, y, z)*2+1]++;
+    }
+
+    // allocate ranges in the index list
+    for (size_t i = 0, offset = 0; i < kClusters; i++) {
+        m_clusters[i*2+0] = offset;
+        offset += m_clusters[i*2+1];
+    }
+
+    // fill the index list
+    for (size_t i = 0; i < m_count; i++) {
+        const auto &bounds = m_bounds[i];
+        if (!bounds.visible)
+            continue;
+        for (size_t z = bounds.z0; z <= bounds.z1; z++) {
+            for (size_t y = bounds.y0; y <= bounds.y1; y++) {
+                for (size_t x = bounds.x0; x <= bounds.x1; x++) {
+                    const size_t index = cluster(x, y, z);
+                    m_indices[m_clusters[index*2] + m_fill[index]++] = i;
+                }
+            }
+        }
+    }
+
+    // upload
+    gl::BindTexture(GL_TEXTURE_2D, m_textures[0]);
+    gl::TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kTilesX, kTilesY * kSlices,
+        GL_RG_INTEGER, GL_UNSIGNED_INT, &m_clusters[0]);
+    if (m_indexCount) {
+        const size_t rows = (m_indexCount + kIndexWidth - 1) / kIndexWidth;
+        gl::BindTexture(GL_TEXTURE_2D, m_textures[1]);
+        gl::TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, kIndexWidth, rows,
+            GL_RED_INTEGER, GL_UNSIGNED_SHORT, &m_indices[0]);
+    }
+    if (m_count) {
+        gl::BindTexture(GL_TEXTURE_2D, m_textures[2]);
+        gl::TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 3, m_count,
+            GL_RGBA, GL_FLOAT, &m_lights[0]);
+    }
+}
+
+}
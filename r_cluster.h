@@ -0,0 +1,120 @@
+#ifndef R_CLUSTER_HDR
+#define R_CLUSTER_HDR
+#include <stdint.h>
+
+#include "r_common.h"
+
+#include "m_vec.h"
+
+#include "u_vector.h"
+
+namespace m {
+    struct mat4;
+    struct perspective;
+}
+
+namespace r {
+
+struct pointLight;
+struct spotLight;
+
+// Assigns lights to the cells of a grid which subdivides the view frustum into
+// kTilesX by kTilesY tiles on screen and kSlices exponentially distributed
+// slices in depth (froxels.) The lights of every cell are gathered into an
+// index list on the CPU which is uploaded into textures along with the lights
+// such that all of them can be shaded in a single screen space pass.
+struct lightClusters {
+    static constexpr size_t kTilesX = 16;
+    static constexpr size_t kTilesY = 8;
+    static constexpr size_t kSlices = 24;
+    static constexpr size_t kClusters = kTilesX * kTilesY * kSlices;
+    static constexpr size_t kMaxLights = 1024;
+    static constexpr size_t kIndexWidth = 1024;
+    static constexpr size_t kMaxIndices = kIndexWidth * 64;
+
+    lightClusters();
+    ~lightClusters();
+
+    bool init();
+
+    void clear();
+    // returns false when there is no more room for the light
+    bool add(const pointLight &light);
+    bool add(const spotLight &light);
+
+    // assign the added lights to the clusters of the view and upload them
+    void update(const m::mat4 &view, const m::perspective &p);
+    // false when the light added index-th did not fit into the index list and
+    // has to be shaded some other way
+    bool assigned(size_t index) const;
+
+    GLuint clusterTexture() const; // { offset, count } of every cluster
+    GLuint indexTexture() const; // the light indices of all clusters
+    GLuint lightTexture() const; // three texels for every light
+
+    // { tiles x, tiles y, slice scale, slice bias }
+    const m::vec4 &grid() const;
+
+    size_t lights() const;
+    size_t indices() const;
+
+private:
+    // inclusive range of clusters a light touches
+    struct lightBounds {
+        bool visible;
+        bool dropped;
+        uint8_t x0, x1;
+        uint8_t y0, y1;
+        uint8_t z0, z1;
+    };
+
+    void addSphere(const m::vec3 &position, float radius);
+    void calculateBounds(const m::mat4 &view, const m::perspective &p);
+
+    GLuint m_textures[3];
+    // light spheres in SoA form such that they can be transformed four at a time
+    u::vector<float> m_x;
+    u::vector<float> m_y;
+    u::vector<float> m_z;
+    u::vector<float> m_radius;
+    u::vector<lightBounds> m_bounds;
+    u::vector<m::vec4> m_lights;
+    u::vector<uint32_t> m_clusters; // { offset, count } of every cluster
+    u::vector<uint32_t> m_fill; // lights written into every cluster so far
+    u::vector<uint16_t> m_indices;
+    m::vec4 m_grid;
+    size_t m_count;
+    size_t m_indexCount;
+};
+
+inline GLuint lightClusters::clusterTexture() const {
+    return m_textures[0];
+}
+
+inline GLuint lightClusters::indexTexture() const {
+    return m_textures[1];
+}
+
+inline GLuint lightClusters::lightTexture() const {
+    return m_textures[2];
+}
+
+inline const m::vec4 &lightClusters::grid() const {
+    return m_grid;
+}
+
+inline bool lightClusters::assigned(size_t index) const {
+    return !m_bounds[index].dropped;
+}
+
+inline size_t lightClusters::lights() const {
+    return m_count;
+}
+
+inline size_t lightClusters::indices() const {
+    return m_indexCount;
+}
+
+}
+
+#endif
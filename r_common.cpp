@@ -5,7 +5,11 @@
 
 #include "u_string.h"
 #include "u_set.h"
+#include "u_map.h"
 #include "u_misc.h"
+#include "u_file.h"
+#include "u_log.h"
+#include "u_vector.h"
 #include "u_traits.h"
 
 #include "engine.h"
@@ -141,103 +145,133 @@ typedef void (APIENTRYP MYPFNGLDEPTHRANGEPROC)(GLclampd, GLclampd);
 typedef void (APIENTRYP MYPFNGLPROGRAMPARAMETERIPROC)(GLuint, GLenum, GLint);
 typedef void (APIENTRYP MYPFNGLGETPROGRAMBINARYPROC)(GLuint, GLsizei, GLsizei*, GLenum*, GLvoid*);
 typedef void (APIENTRYP MYPFNGLPROGRAMBINARYPROC)(GLuint, GLenum, const GLvoid*, GLsizei);
-
-static MYPFNGLCREATESHADERPROC              glCreateShader_             = nullptr;
-static MYPFNGLSHADERSOURCEPROC              glShaderSource_             = nullptr;
-static MYPFNGLCOMPILESHADERPROC             glCompileShader_            = nullptr;
-static MYPFNGLATTACHSHADERPROC              glAttachShader_             = nullptr;
-static MYPFNGLCREATEPROGRAMPROC             glCreateProgram_            = nullptr;
-static MYPFNGLLINKPROGRAMPROC               glLinkProgram_              = nullptr;
-static MYPFNGLUSEPROGRAMPROC                glUseProgram_               = nullptr;
-static MYPFNGLGETUNIFORMLOCATIONPROC        glGetUniformLocation_       = nullptr;
-static MYPFNGLENABLEVERTEXATTRIBARRAYPROC   glEnableVertexAttribArray_  = nullptr;
-static MYPFNGLDISABLEVERTEXATTRIBARRAYPROC  glDisableVertexAttribArray_ = nullptr;
-static MYPFNGLUNIFORMMATRIX4FVPROC          glUniformMatrix4fv_         = nullptr;
-static MYPFNGLBINDBUFFERPROC                glBindBuffer_               = nullptr;
-static MYPFNGLGENBUFFERSPROC                glGenBuffers_               = nullptr;
-static MYPFNGLVERTEXATTRIBPOINTERPROC       glVertexAttribPointer_      = nullptr;
-static MYPFNGLBUFFERDATAPROC                glBufferData_               = nullptr;
-static MYPFNGLVALIDATEPROGRAMPROC           glValidateProgram_          = nullptr;
-static MYPFNGLGENVERTEXARRAYSPROC           glGenVertexArrays_          = nullptr;
-static MYPFNGLBINDVERTEXARRAYPROC           glBindVertexArray_          = nullptr;
-static MYPFNGLDELETEPROGRAMPROC             glDeleteProgram_            = nullptr;
-static MYPFNGLDELETEBUFFERSPROC             glDeleteBuffers_            = nullptr;
-static MYPFNGLDELETEVERTEXARRAYSPROC        glDeleteVertexArrays_       = nullptr;
-static MYPFNGLUNIFORM1IPROC                 glUniform1i_                = nullptr;
-static MYPFNGLUNIFORM2IPROC                 glUniform2i_                = nullptr;
-static MYPFNGLUNIFORM1FPROC                 glUniform1f_                = nullptr;
-static MYPFNGLUNIFORM2FPROC                 glUniform2f_                = nullptr;
-static MYPFNGLUNIFORM2FVPROC                glUniform2fv_               = nullptr;
-static MYPFNGLUNIFORM3FVPROC                glUniform3fv_               = nullptr;
-static MYPFNGLUNIFORM4FVPROC                glUniform4fv_               = nullptr;
-static MYPFNGLUNIFORMMATRIX3X4FVPROC        glUniformMatrix3x4fv_       = nullptr;
-static MYPFNGLGENERATEMIPMAPPROC            glGenerateMipmap_           = nullptr;
-static MYPFNGLDELETESHADERPROC              glDeleteShader_             = nullptr;
-static MYPFNGLGETSHADERIVPROC               glGetShaderiv_              = nullptr;
-static MYPFNGLGETPROGRAMIVPROC              glGetProgramiv_             = nullptr;
-static MYPFNGLGETSHADERINFOLOGPROC          glGetShaderInfoLog_         = nullptr;
-static MYPFNGLACTIVETEXTUREPROC             glActiveTexture_            = nullptr;
-static MYPFNGLGENFRAMEBUFFERSPROC           glGenFramebuffers_          = nullptr;
-static MYPFNGLBINDFRAMEBUFFERPROC           glBindFramebuffer_          = nullptr;
-static MYPFNGLFRAMEBUFFERTEXTURE2DPROC      glFramebufferTexture2D_     = nullptr;
-static MYPFNGLDRAWBUFFERSPROC               glDrawBuffers_              = nullptr;
-static MYPFNGLCHECKFRAMEBUFFERSTATUSPROC    glCheckFramebufferStatus_   = nullptr;
-static MYPFNGLDELETEFRAMEBUFFERSPROC        glDeleteFramebuffers_       = nullptr;
-static MYPFNGLCLEARPROC                     glClear_                    = nullptr;
-static MYPFNGLCLEARCOLORPROC                glClearColor_               = nullptr;
-static MYPFNGLFRONTFACEPROC                 glFrontFace_                = nullptr;
-static MYPFNGLCULLFACEPROC                  glCullFace_                 = nullptr;
-static MYPFNGLENABLEPROC                    glEnable_                   = nullptr;
-static MYPFNGLDISABLEPROC                   glDisable_                  = nullptr;
-static MYPFNGLDRAWELEMENTSPROC              glDrawElements_             = nullptr;
-static MYPFNGLDEPTHMASKPROC                 glDepthMask_                = nullptr;
-static MYPFNGLBINDTEXTUREPROC               glBindTexture_              = nullptr;
-static MYPFNGLTEXIMAGE2DPROC                glTexImage2D_               = nullptr;
-static MYPFNGLDELETETEXTURESPROC            glDeleteTextures_           = nullptr;
-static MYPFNGLGENTEXTURESPROC               glGenTextures_              = nullptr;
-static MYPFNGLTEXPARAMETERFPROC             glTexParameterf_            = nullptr;
-static MYPFNGLTEXPARAMETERIPROC             glTexParameteri_            = nullptr;
-static MYPFNGLDRAWARRAYSPROC                glDrawArrays_               = nullptr;
-static MYPFNGLBLENDEQUATIONPROC             glBlendEquation_            = nullptr;
-static MYPFNGLBLENDFUNCPROC                 glBlendFunc_                = nullptr;
-static MYPFNGLDEPTHFUNCPROC                 glDepthFunc_                = nullptr;
-static MYPFNGLCOLORMASKPROC                 glColorMask_                = nullptr;
-static MYPFNGLREADPIXELSPROC                glReadPixels_               = nullptr;
-static MYPFNGLVIEWPORTPROC                  glViewport_                 = nullptr;
-static MYPFNGLGETINTEGERVPROC               glGetIntegerv_              = nullptr;
-static MYPFNGLGETSTRINGPROC                 glGetString_                = nullptr;
-static MYPFNGLGETSTRINGIPROC                glGetStringi_               = nullptr;
-static MYPFNGLGETFLOATVPROC                 glGetFloatv_                = nullptr;
-static MYPFNGLGETERRORPROC                  glGetError_                 = nullptr;
-static MYPFNGLGETTEXLEVELPARAMETERIVPROC    glGetTexLevelParameteriv_   = nullptr;
-static MYPFNGLGETCOMPRESSEDTEXIMAGEPROC     glGetCompressedTexImage_    = nullptr;
-static MYPFNGLCOMPRESSEDTEXIMAGE2DPROC      glCompressedTexImage2D_     = nullptr;
-static MYPFNGLPIXELSTOREIPROC               glPixelStorei_              = nullptr;
-static MYPFNGLSCISSORPROC                   glScissor_                  = nullptr;
-static MYPFNGLPOLYGONMODEPROC               glPolygonMode_              = nullptr;
-static MYPFNGLHINTPROC                      glHint_                     = nullptr;
-static MYPFNGLGENQUERIESPROC                glGenQueries_               = nullptr;
-static MYPFNGLBEGINQUERYPROC                glBeginQuery_               = nullptr;
-static MYPFNGLENDQUERYPROC                  glEndQuery_                 = nullptr;
-static MYPFNGLDELETEQUERIESPROC             glDeleteQueries_            = nullptr;
-static MYPFNGLGETQUERYOBJECTUIVPROC         glGetQueryObjectuiv_        = nullptr;
-static MYPFNGLFLUSHPROC                     glFlush_                    = nullptr;
-static MYPFNGLSTENCILFUNCPROC               glStencilFunc_              = nullptr;
-static MYPFNGLSTENCILOPPROC                 glStencilOp_                = nullptr;
-static MYPFNGLTEXIMAGE3DPROC                glTexImage3D_               = nullptr;
-static MYPFNGLTEXSUBIMAGE3DPROC             glTexSubImage3D_            = nullptr;
-static MYPFNGLGETPROGRAMINFOLOGPROC         glGetProgramInfoLog_        = nullptr;
-static MYPFNGLBINDATTRIBLOCATIONPROC        glBindAttribLocation_       = nullptr;
-static MYPFNGLBINDFRAGDATALOCATIONPROC      glBindFragDataLocation_     = nullptr;
-static MYPFNGLTEXSUBIMAGE2DPROC             glTexSubImage2D_            = nullptr;
-static MYPFNGLDRAWBUFFERPROC                glDrawBuffer_               = nullptr;
-static MYPFNGLREADBUFFERPROC                glReadBuffer_               = nullptr;
-static MYPFNGLBUFFERSUBDATAPROC             glBufferSubData_            = nullptr;
-static MYPFNGLPOLYGONOFFSETPROC             glPolygonOffset_            = nullptr;
-static MYPFNGLDEPTHRANGEPROC                glDepthRange_               = nullptr;
-static MYPFNGLPROGRAMPARAMETERIPROC         glProgramParameteri_        = nullptr;
-static MYPFNGLGETPROGRAMBINARYPROC          glGetProgramBinary_         = nullptr;
-static MYPFNGLPROGRAMBINARYPROC             glProgramBinary_            = nullptr;
+typedef void (APIENTRYP MYPFNGLBINDBUFFERBASEPROC)(GLenum, GLuint, GLuint);
+typedef void (APIENTRYP MYPFNGLBINDBUFFERRANGEPROC)(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr);
+typedef GLuint (APIENTRYP MYPFNGLGETUNIFORMBLOCKINDEXPROC)(GLuint, const GLchar*);
+typedef void (APIENTRYP MYPFNGLUNIFORMBLOCKBINDINGPROC)(GLuint, GLuint, GLuint);
+typedef void* (APIENTRYP MYPFNGLMAPBUFFERRANGEPROC)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
+typedef GLboolean (APIENTRYP MYPFNGLUNMAPBUFFERPROC)(GLenum);
+typedef void (APIENTRYP MYPFNGLBUFFERSTORAGEPROC)(GLenum, GLsizeiptr, const GLvoid*, GLbitfield);
+typedef GLsync (APIENTRYP MYPFNGLFENCESYNCPROC)(GLenum, GLbitfield);
+typedef GLenum (APIENTRYP MYPFNGLCLIENTWAITSYNCPROC)(GLsync, GLbitfield, GLuint64);
+typedef void (APIENTRYP MYPFNGLDELETESYNCPROC)(GLsync);
+typedef void (APIENTRYP MYPFNGLDRAWELEMENTSINSTANCEDPROC)(GLenum, GLsizei, GLenum, const GLvoid*, GLsizei);
+typedef void (APIENTRYP MYPFNGLVERTEXATTRIBDIVISORPROC)(GLuint, GLuint);
+typedef void (APIENTRYP MYPFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum, GLenum, const GLvoid*, GLsizei, GLsizei);
+typedef void (APIENTRYP MYPFNGLTEXSTORAGE3DPROC)(GLenum, GLsizei, GLenum, GLsizei, GLsizei, GLsizei);
+typedef void (APIENTRYP MYPFNGLCOPYIMAGESUBDATAPROC)(GLuint, GLenum, GLint, GLint, GLint, GLint, GLuint, GLenum, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei);
+
+static MYPFNGLCREATESHADERPROC               glCreateShader_              = nullptr;
+static MYPFNGLSHADERSOURCEPROC               glShaderSource_              = nullptr;
+static MYPFNGLCOMPILESHADERPROC              glCompileShader_             = nullptr;
+static MYPFNGLATTACHSHADERPROC               glAttachShader_              = nullptr;
+static MYPFNGLCREATEPROGRAMPROC              glCreateProgram_             = nullptr;
+static MYPFNGLLINKPROGRAMPROC                glLinkProgram_               = nullptr;
+static MYPFNGLUSEPROGRAMPROC                 glUseProgram_                = nullptr;
+static MYPFNGLGETUNIFORMLOCATIONPROC         glGetUniformLocation_        = nullptr;
+static MYPFNGLENABLEVERTEXATTRIBARRAYPROC    glEnableVertexAttribArray_   = nullptr;
+static MYPFNGLDISABLEVERTEXATTRIBARRAYPROC   glDisableVertexAttribArray_  = nullptr;
+static MYPFNGLUNIFORMMATRIX4FVPROC           glUniformMatrix4fv_          = nullptr;
+static MYPFNGLBINDBUFFERPROC                 glBindBuffer_                = nullptr;
+static MYPFNGLGENBUFFERSPROC                 glGenBuffers_                = nullptr;
+static MYPFNGLVERTEXATTRIBPOINTERPROC        glVertexAttribPointer_       = nullptr;
+static MYPFNGLBUFFERDATAPROC                 glBufferData_                = nullptr;
+static MYPFNGLVALIDATEPROGRAMPROC            glValidateProgram_           = nullptr;
+static MYPFNGLGENVERTEXARRAYSPROC            glGenVertexArrays_           = nullptr;
+static MYPFNGLBINDVERTEXARRAYPROC            glBindVertexArray_           = nullptr;
+static MYPFNGLDELETEPROGRAMPROC              glDeleteProgram_             = nullptr;
+static MYPFNGLDELETEBUFFERSPROC              glDeleteBuffers_             = nullptr;
+static MYPFNGLDELETEVERTEXARRAYSPROC         glDeleteVertexArrays_        = nullptr;
+static MYPFNGLUNIFORM1IPROC                  glUniform1i_                 = nullptr;
+static MYPFNGLUNIFORM2IPROC                  glUniform2i_                 = nullptr;
+static MYPFNGLUNIFORM1FPROC                  glUniform1f_                 = nullptr;
+static MYPFNGLUNIFORM2FPROC                  glUniform2f_                 = nullptr;
+static MYPFNGLUNIFORM2FVPROC                 glUniform2fv_                = nullptr;
+static MYPFNGLUNIFORM3FVPROC                 glUniform3fv_                = nullptr;
+static MYPFNGLUNIFORM4FVPROC                 glUniform4fv_                = nullptr;
+static MYPFNGLUNIFORMMATRIX3X4FVPROC         glUniformMatrix3x4fv_        = nullptr;
+static MYPFNGLGENERATEMIPMAPPROC             glGenerateMipmap_            = nullptr;
+static MYPFNGLDELETESHADERPROC               glDeleteShader_              = nullptr;
+static MYPFNGLGETSHADERIVPROC                glGetShaderiv_               = nullptr;
+static MYPFNGLGETPROGRAMIVPROC               glGetProgramiv_              = nullptr;
+static MYPFNGLGETSHADERINFOLOGPROC           glGetShaderInfoLog_          = nullptr;
+static MYPFNGLACTIVETEXTUREPROC              glActiveTexture_             = nullptr;
+static MYPFNGLGENFRAMEBUFFERSPROC            glGenFramebuffers_           = nullptr;
+static MYPFNGLBINDFRAMEBUFFERPROC            glBindFramebuffer_           = nullptr;
+static MYPFNGLFRAMEBUFFERTEXTURE2DPROC       glFramebufferTexture2D_      = nullptr;
+static MYPFNGLDRAWBUFFERSPROC                glDrawBuffers_               = nullptr;
+static MYPFNGLCHECKFRAMEBUFFERSTATUSPROC     glCheckFramebufferStatus_    = nullptr;
+static MYPFNGLDELETEFRAMEBUFFERSPROC         glDeleteFramebuffers_        = nullptr;
+static MYPFNGLCLEARPROC                      glClear_                     = nullptr;
+static MYPFNGLCLEARCOLORPROC                 glClearColor_                = nullptr;
+static MYPFNGLFRONTFACEPROC                  glFrontFace_                 = nullptr;
+static MYPFNGLCULLFACEPROC                   glCullFace_                  = nullptr;
+static MYPFNGLENABLEPROC                     glEnable_                    = nullptr;
+static MYPFNGLDISABLEPROC                    glDisable_                   = nullptr;
+static MYPFNGLDRAWELEMENTSPROC               glDrawElements_              = nullptr;
+static MYPFNGLDEPTHMASKPROC                  glDepthMask_                 = nullptr;
+static MYPFNGLBINDTEXTUREPROC                glBindTexture_               = nullptr;
+static MYPFNGLTEXIMAGE2DPROC                 glTexImage2D_                = nullptr;
+static MYPFNGLDELETETEXTURESPROC             glDeleteTextures_            = nullptr;
+static MYPFNGLGENTEXTURESPROC                glGenTextures_               = nullptr;
+static MYPFNGLTEXPARAMETERFPROC              glTexParameterf_             = nullptr;
+static MYPFNGLTEXPARAMETERIPROC              glTexParameteri_             = nullptr;
+static MYPFNGLDRAWARRAYSPROC                 glDrawArrays_                = nullptr;
+static MYPFNGLBLENDEQUATIONPROC              glBlendEquation_             = nullptr;
+static MYPFNGLBLENDFUNCPROC                  glBlendFunc_                 = nullptr;
+static MYPFNGLDEPTHFUNCPROC                  glDepthFunc_                 = nullptr;
+static MYPFNGLCOLORMASKPROC                  glColorMask_                 = nullptr;
+static MYPFNGLREADPIXELSPROC                 glReadPixels_                = nullptr;
+static MYPFNGLVIEWPORTPROC                   glViewport_                  = nullptr;
+static MYPFNGLGETINTEGERVPROC                glGetIntegerv_               = nullptr;
+static MYPFNGLGETSTRINGPROC                  glGetString_                 = nullptr;
+static MYPFNGLGETSTRINGIPROC                 glGetStringi_                = nullptr;
+static MYPFNGLGETFLOATVPROC                  glGetFloatv_                 = nullptr;
+static MYPFNGLGETERRORPROC                   glGetError_                  = nullptr;
+static MYPFNGLGETTEXLEVELPARAMETERIVPROC     glGetTexLevelParameteriv_    = nullptr;
+static MYPFNGLGETCOMPRESSEDTEXIMAGEPROC      glGetCompressedTexImage_     = nullptr;
+static MYPFNGLCOMPRESSEDTEXIMAGE2DPROC       glCompressedTexImage2D_      = nullptr;
+static MYPFNGLPIXELSTOREIPROC                glPixelStorei_               = nullptr;
+static MYPFNGLSCISSORPROC                    glScissor_                   = nullptr;
+static MYPFNGLPOLYGONMODEPROC                glPolygonMode_               = nullptr;
+static MYPFNGLHINTPROC                       glHint_                      = nullptr;
+static MYPFNGLGENQUERIESPROC                 glGenQueries_                = nullptr;
+static MYPFNGLBEGINQUERYPROC                 glBeginQuery_                = nullptr;
+static MYPFNGLENDQUERYPROC                   glEndQuery_                  = nullptr;
+static MYPFNGLDELETEQUERIESPROC              glDeleteQueries_             = nullptr;
+static MYPFNGLGETQUERYOBJECTUIVPROC          glGetQueryObjectuiv_         = nullptr;
+static MYPFNGLFLUSHPROC                      glFlush_                     = nullptr;
+static MYPFNGLSTENCILFUNCPROC                glStencilFunc_               = nullptr;
+static MYPFNGLSTENCILOPPROC                  glStencilOp_                 = nullptr;
+static MYPFNGLTEXIMAGE3DPROC                 glTexImage3D_                = nullptr;
+static MYPFNGLTEXSUBIMAGE3DPROC              glTexSubImage3D_             = nullptr;
+static MYPFNGLGETPROGRAMINFOLOGPROC          glGetProgramInfoLog_         = nullptr;
+static MYPFNGLBINDATTRIBLOCATIONPROC         glBindAttribLocation_        = nullptr;
+static MYPFNGLBINDFRAGDATALOCATIONPROC       glBindFragDataLocation_      = nullptr;
+static MYPFNGLTEXSUBIMAGE2DPROC              glTexSubImage2D_             = nullptr;
+static MYPFNGLDRAWBUFFERPROC                 glDrawBuffer_                = nullptr;
+static MYPFNGLREADBUFFERPROC                 glReadBuffer_                = nullptr;
+static MYPFNGLBUFFERSUBDATAPROC              glBufferSubData_             = nullptr;
+static MYPFNGLPOLYGONOFFSETPROC              glPolygonOffset_             = nullptr;
+static MYPFNGLDEPTHRANGEPROC                 glDepthRange_                = nullptr;
+static MYPFNGLPROGRAMPARAMETERIPROC          glProgramParameteri_         = nullptr;
+static MYPFNGLGETPROGRAMBINARYPROC           glGetProgramBinary_          = nullptr;
+static MYPFNGLPROGRAMBINARYPROC              glProgramBinary_             = nullptr;
+static MYPFNGLBINDBUFFERBASEPROC             glBindBufferBase_            = nullptr;
+static MYPFNGLBINDBUFFERRANGEPROC            glBindBufferRange_           = nullptr;
+static MYPFNGLGETUNIFORMBLOCKINDEXPROC       glGetUniformBlockIndex_      = nullptr;
+static MYPFNGLUNIFORMBLOCKBINDINGPROC        glUniformBlockBinding_       = nullptr;
+static MYPFNGLMAPBUFFERRANGEPROC             glMapBufferRange_            = nullptr;
+static MYPFNGLUNMAPBUFFERPROC                glUnmapBuffer_               = nullptr;
+static MYPFNGLBUFFERSTORAGEPROC              glBufferStorage_             = nullptr;
+static MYPFNGLFENCESYNCPROC                  glFenceSync_                 = nullptr;
+static MYPFNGLCLIENTWAITSYNCPROC             glClientWaitSync_            = nullptr;
+static MYPFNGLDELETESYNCPROC                 glDeleteSync_                = nullptr;
+static MYPFNGLDRAWELEMENTSINSTANCEDPROC      glDrawElementsInstanced_     = nullptr;
+static MYPFNGLVERTEXATTRIBDIVISORPROC        glVertexAttribDivisor_       = nullptr;
+static MYPFNGLMULTIDRAWELEMENTSINDIRECTPROC  glMultiDrawElementsIndirect_ = nullptr;
+static MYPFNGLTEXSTORAGE3DPROC               glTexStorage3D_              = nullptr;
+static MYPFNGLCOPYIMAGESUBDATAPROC           glCopyImageSubData_          = nullptr;
 
 #if defined(DEBUG_GL)
 ///! ARB_debug_output
@@ -312,6 +346,14 @@ template<>
 u::string stringize<'g', GLclampd>(GLclampd value, char) {
     return u::format("GLclampd=%.2f", value);
 }
+template<>
+u::string stringize<'h', GLsync>(GLsync value, char) {
+    return u::format("GLsync=%p", value);
+}
+template<>
+u::string stringize<'i', GLuint64>(GLuint64 value, char) {
+    return u::format("GLuint64=%llu", value);
+}
 template <>
 u::string stringize<'*', void *>(void *value, char base) {
     switch (base) {
@@ -333,6 +375,8 @@ u::string stringize<'*', void *>(void *value, char base) {
         case 'e': return u::format("GLintptr*=%p", value);
         case 'f': return u::format("GLsizeiptr*=%p", value);
         case 'g': return u::format("GLclampd*=%p", value);
+        case 'h': return u::format("GLsync*=%p", value);
+        case 'i': return u::format("GLuint64*=%p", value);
     }
 
     return u::format("GLchar*=\"%s\"", (const char *)value);
@@ -411,6 +455,12 @@ static void debugCheck(const char *spec, const char *function, const char *file,
             case 'g':
                 contents += stringize<'g'>((GLclampd)va_arg(va, double));
                 break;
+            case 'h':
+                contents += stringize<'h'>((GLsync)va_arg(va, GLsync));
+                break;
+            case 'i':
+                contents += stringize<'i'>((GLuint64)va_arg(va, GLuint64));
+                break;
             case '*':
                 contents += stringize<'*'>(va_arg(va, void *), s[1]);
                 s++; // skip basetype spec
@@ -477,7 +527,16 @@ static const char *kExtensions[] = {
     "GL_ARB_half_float_vertex",
     "GL_ARB_get_program_binary",
     "GL_ATI_meminfo",
-    "GL_NVX_gpu_memory_info"
+    "GL_NVX_gpu_memory_info",
+    "GL_ARB_uniform_buffer_object",
+    "GL_ARB_buffer_storage",
+    "GL_ARB_draw_instanced",
+    "GL_ARB_instanced_arrays",
+    "GL_ARB_draw_indirect",
+    "GL_ARB_multi_draw_indirect",
+    "GL_ARB_base_instance",
+    "GL_ARB_texture_storage",
+    "GL_ARB_copy_image"
 };
 
 static int gGLSLVersion = -1;
@@ -508,638 +567,3214 @@ bool has(size_t ext) {
     return gExtensions.find(ext) != gExtensions.end();
 }
 
-void init() {
-    glCreateShader_             = (MYPFNGLCREATESHADERPROC)neoGetProcAddress("glCreateShader");
-    glShaderSource_             = (MYPFNGLSHADERSOURCEPROC)neoGetProcAddress("glShaderSource");
-    glCompileShader_            = (MYPFNGLCOMPILESHADERPROC)neoGetProcAddress("glCompileShader");
-    glAttachShader_             = (MYPFNGLATTACHSHADERPROC)neoGetProcAddress("glAttachShader");
-    glCreateProgram_            = (MYPFNGLCREATEPROGRAMPROC)neoGetProcAddress("glCreateProgram");
-    glLinkProgram_              = (MYPFNGLLINKPROGRAMPROC)neoGetProcAddress("glLinkProgram");
-    glUseProgram_               = (MYPFNGLUSEPROGRAMPROC)neoGetProcAddress("glUseProgram");
-    glGetUniformLocation_       = (MYPFNGLGETUNIFORMLOCATIONPROC)neoGetProcAddress("glGetUniformLocation");
-    glEnableVertexAttribArray_  = (MYPFNGLENABLEVERTEXATTRIBARRAYPROC)neoGetProcAddress("glEnableVertexAttribArray");
-    glDisableVertexAttribArray_ = (MYPFNGLDISABLEVERTEXATTRIBARRAYPROC)neoGetProcAddress("glDisableVertexAttribArray");
-    glUniformMatrix4fv_         = (MYPFNGLUNIFORMMATRIX4FVPROC)neoGetProcAddress("glUniformMatrix4fv");
-    glBindBuffer_               = (MYPFNGLBINDBUFFERPROC)neoGetProcAddress("glBindBuffer");
-    glGenBuffers_               = (MYPFNGLGENBUFFERSPROC)neoGetProcAddress("glGenBuffers");
-    glVertexAttribPointer_      = (MYPFNGLVERTEXATTRIBPOINTERPROC)neoGetProcAddress("glVertexAttribPointer");
-    glBufferData_               = (MYPFNGLBUFFERDATAPROC)neoGetProcAddress("glBufferData");
-    glValidateProgram_          = (MYPFNGLVALIDATEPROGRAMPROC)neoGetProcAddress("glValidateProgram");
-    glGenVertexArrays_          = (MYPFNGLGENVERTEXARRAYSPROC)neoGetProcAddress("glGenVertexArrays");
-    glBindVertexArray_          = (MYPFNGLBINDVERTEXARRAYPROC)neoGetProcAddress("glBindVertexArray");
-    glDeleteProgram_            = (MYPFNGLDELETEPROGRAMPROC)neoGetProcAddress("glDeleteProgram");
-    glDeleteBuffers_            = (MYPFNGLDELETEBUFFERSPROC)neoGetProcAddress("glDeleteBuffers");
-    glDeleteVertexArrays_       = (MYPFNGLDELETEVERTEXARRAYSPROC)neoGetProcAddress("glDeleteVertexArrays");
-    glUniform1i_                = (MYPFNGLUNIFORM1IPROC)neoGetProcAddress("glUniform1i");
-    glUniform2i_                = (MYPFNGLUNIFORM2IPROC)neoGetProcAddress("glUniform2i");
-    glUniform1f_                = (MYPFNGLUNIFORM1FPROC)neoGetProcAddress("glUniform1f");
-    glUniform2f_                = (MYPFNGLUNIFORM2FPROC)neoGetProcAddress("glUniform2f");
-    glUniform2fv_               = (MYPFNGLUNIFORM2FVPROC)neoGetProcAddress("glUniform2fv");
-    glUniform3fv_               = (MYPFNGLUNIFORM3FVPROC)neoGetProcAddress("glUniform3fv");
-    glUniform4fv_               = (MYPFNGLUNIFORM4FVPROC)neoGetProcAddress("glUniform4fv");
-    glUniformMatrix3x4fv_       = (MYPFNGLUNIFORMMATRIX3X4FVPROC)neoGetProcAddress("glUniformMatrix3x4fv");
-    glGenerateMipmap_           = (MYPFNGLGENERATEMIPMAPPROC)neoGetProcAddress("glGenerateMipmap");
-    glDeleteShader_             = (MYPFNGLDELETESHADERPROC)neoGetProcAddress("glDeleteShader");
-    glGetShaderiv_              = (MYPFNGLGETSHADERIVPROC)neoGetProcAddress("glGetShaderiv");
-    glGetProgramiv_             = (MYPFNGLGETPROGRAMIVPROC)neoGetProcAddress("glGetProgramiv");
-    glGetShaderInfoLog_         = (MYPFNGLGETSHADERINFOLOGPROC)neoGetProcAddress("glGetShaderInfoLog");
-    glActiveTexture_            = (MYPFNGLACTIVETEXTUREPROC)neoGetProcAddress("glActiveTexture");
-    glGenFramebuffers_          = (MYPFNGLGENFRAMEBUFFERSPROC)neoGetProcAddress("glGenFramebuffers");
-    glBindFramebuffer_          = (MYPFNGLBINDFRAMEBUFFERPROC)neoGetProcAddress("glBindFramebuffer");
-    glFramebufferTexture2D_     = (MYPFNGLFRAMEBUFFERTEXTURE2DPROC)neoGetProcAddress("glFramebufferTexture2D");
-    glDrawBuffers_              = (MYPFNGLDRAWBUFFERSPROC)neoGetProcAddress("glDrawBuffers");
-    glCheckFramebufferStatus_   = (MYPFNGLCHECKFRAMEBUFFERSTATUSPROC)neoGetProcAddress("glCheckFramebufferStatus");
-    glDeleteFramebuffers_       = (MYPFNGLDELETEFRAMEBUFFERSPROC)neoGetProcAddress("glDeleteFramebuffers");
-    glClear_                    = (MYPFNGLCLEARPROC)neoGetProcAddress("glClear");
-    glClearColor_               = (MYPFNGLCLEARCOLORPROC)neoGetProcAddress("glClearColor");
-    glFrontFace_                = (MYPFNGLFRONTFACEPROC)neoGetProcAddress("glFrontFace");
-    glCullFace_                 = (MYPFNGLCULLFACEPROC)neoGetProcAddress("glCullFace");
-    glEnable_                   = (MYPFNGLENABLEPROC)neoGetProcAddress("glEnable");
-    glDisable_                  = (MYPFNGLDISABLEPROC)neoGetProcAddress("glDisable");
-    glDrawElements_             = (MYPFNGLDRAWELEMENTSPROC)neoGetProcAddress("glDrawElements");
-    glDepthMask_                = (MYPFNGLDEPTHMASKPROC)neoGetProcAddress("glDepthMask");
-    glBindTexture_              = (MYPFNGLBINDTEXTUREPROC)neoGetProcAddress("glBindTexture");
-    glTexImage2D_               = (MYPFNGLTEXIMAGE2DPROC)neoGetProcAddress("glTexImage2D");
-    glDeleteTextures_           = (MYPFNGLDELETETEXTURESPROC)neoGetProcAddress("glDeleteTextures");
-    glGenTextures_              = (MYPFNGLGENTEXTURESPROC)neoGetProcAddress("glGenTextures");
-    glTexParameterf_            = (MYPFNGLTEXPARAMETERFPROC)neoGetProcAddress("glTexParameterf");
-    glTexParameteri_            = (MYPFNGLTEXPARAMETERIPROC)neoGetProcAddress("glTexParameteri");
-    glDrawArrays_               = (MYPFNGLDRAWARRAYSPROC)neoGetProcAddress("glDrawArrays");
-    glBlendEquation_            = (MYPFNGLBLENDEQUATIONPROC)neoGetProcAddress("glBlendEquation");
-    glBlendFunc_                = (MYPFNGLBLENDFUNCPROC)neoGetProcAddress("glBlendFunc");
-    glDepthFunc_                = (MYPFNGLDEPTHFUNCPROC)neoGetProcAddress("glDepthFunc");
-    glColorMask_                = (MYPFNGLCOLORMASKPROC)neoGetProcAddress("glColorMask");
-    glReadPixels_               = (MYPFNGLREADPIXELSPROC)neoGetProcAddress("glReadPixels");
-    glViewport_                 = (MYPFNGLVIEWPORTPROC)neoGetProcAddress("glViewport");
-    glGetIntegerv_              = (MYPFNGLGETINTEGERVPROC)neoGetProcAddress("glGetIntegerv");
-    glGetString_                = (MYPFNGLGETSTRINGPROC)neoGetProcAddress("glGetString");
-    glGetStringi_               = (MYPFNGLGETSTRINGIPROC)neoGetProcAddress("glGetStringi");
-    glGetFloatv_                = (MYPFNGLGETFLOATVPROC)neoGetProcAddress("glGetFloatv");
-    glGetError_                 = (MYPFNGLGETERRORPROC)neoGetProcAddress("glGetError");
-    glGetTexLevelParameteriv_   = (MYPFNGLGETTEXLEVELPARAMETERIVPROC)neoGetProcAddress("glGetTexLevelParameteriv");
-    glGetCompressedTexImage_    = (MYPFNGLGETCOMPRESSEDTEXIMAGEPROC)neoGetProcAddress("glGetCompressedTexImage");
-    glCompressedTexImage2D_     = (MYPFNGLCOMPRESSEDTEXIMAGE2DPROC)neoGetProcAddress("glCompressedTexImage2D");
-    glPixelStorei_              = (MYPFNGLPIXELSTOREIPROC)neoGetProcAddress("glPixelStorei");
-    glScissor_                  = (MYPFNGLSCISSORPROC)neoGetProcAddress("glScissor");
-    glPolygonMode_              = (MYPFNGLPOLYGONMODEPROC)neoGetProcAddress("glPolygonMode");
-    glHint_                     = (MYPFNGLHINTPROC)neoGetProcAddress("glHint");
-    glGenQueries_               = (MYPFNGLGENQUERIESPROC)neoGetProcAddress("glGenQueries");
-    glBeginQuery_               = (MYPFNGLBEGINQUERYPROC)neoGetProcAddress("glBeginQuery");
-    glEndQuery_                 = (MYPFNGLENDQUERYPROC)neoGetProcAddress("glEndQuery");
-    glDeleteQueries_            = (MYPFNGLDELETEQUERIESPROC)neoGetProcAddress("glDeleteQueries");
-    glGetQueryObjectuiv_        = (MYPFNGLGETQUERYOBJECTUIVPROC)neoGetProcAddress("glGetQueryObjectuiv");
-    glFlush_                    = (MYPFNGLFLUSHPROC)neoGetProcAddress("glFlush");
-    glStencilFunc_              = (MYPFNGLSTENCILFUNCPROC)neoGetProcAddress("glStencilFunc");
-    glStencilOp_                = (MYPFNGLSTENCILOPPROC)neoGetProcAddress("glStencilOp");
-    glTexImage3D_               = (MYPFNGLTEXIMAGE3DPROC)neoGetProcAddress("glTexImage3D");
-    glTexSubImage3D_            = (MYPFNGLTEXSUBIMAGE3DPROC)neoGetProcAddress("glTexSubImage3D");
-    glGetProgramInfoLog_        = (MYPFNGLGETPROGRAMINFOLOGPROC)neoGetProcAddress("glGetProgramInfoLog");
-    glBindAttribLocation_       = (MYPFNGLBINDATTRIBLOCATIONPROC)neoGetProcAddress("glBindAttribLocation");
-    glBindFragDataLocation_     = (MYPFNGLBINDFRAGDATALOCATIONPROC)neoGetProcAddress("glBindFragDataLocation");
-    glTexSubImage2D_            = (MYPFNGLTEXSUBIMAGE2DPROC)neoGetProcAddress("glTexSubImage2D");
-    glDrawBuffer_               = (MYPFNGLDRAWBUFFERPROC)neoGetProcAddress("glDrawBuffer");
-    glReadBuffer_               = (MYPFNGLREADBUFFERPROC)neoGetProcAddress("glReadBuffer");
-    glBufferSubData_            = (MYPFNGLBUFFERSUBDATAPROC)neoGetProcAddress("glBufferSubData");
-    glPolygonOffset_            = (MYPFNGLPOLYGONOFFSETPROC)neoGetProcAddress("glPolygonOffset");
-    glDepthRange_               = (MYPFNGLDEPTHRANGEPROC)neoGetProcAddress("glDepthRange");
-    glProgramParameteri_        = (MYPFNGLPROGRAMPARAMETERIPROC)neoGetProcAddress("glProgramParameteri");
-    glGetProgramBinary_         = (MYPFNGLGETPROGRAMBINARYPROC)neoGetProcAddress("glGetProgramBinary");
-    glProgramBinary_            = (MYPFNGLPROGRAMBINARYPROC)neoGetProcAddress("glProgramBinary");
+static constexpr GLuint kStateUnknown = ~0u;
+static constexpr size_t kStateTextureUnits = 32;
+static constexpr size_t kStateUniformBlocks = 16;
 
-    if (!glGetIntegerv_ || !glGetStringi_)
-        neoFatal("Failed to initialize OpenGL\n");
+static constexpr GLenum kStateTextureTargets[] = {
+    GL_TEXTURE_2D,
+    GL_TEXTURE_RECTANGLE,
+    GL_TEXTURE_3D,
+    GL_TEXTURE_CUBE_MAP,
+    GL_TEXTURE_2D_ARRAY
+};
 
-    GLint count = 0;
-    glGetIntegerv_(GL_NUM_EXTENSIONS, &count);
-    for (GLint i = 0; i < count; i++)
-        for (size_t j = 0; j < sizeof(kExtensions)/sizeof(*kExtensions); j++)
-            if (!strcmp(kExtensions[j], (const char *)glGetStringi_(GL_EXTENSIONS, i)))
-                gExtensions.insert(j);
+static constexpr GLenum kStateBufferTargets[] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_UNIFORM_BUFFER
+};
 
-    auto &aniso = c::Console::value<int>("r_aniso");
-    if (has(gl::EXT_texture_filter_anisotropic)) {
-        float largest;
-        glGetFloatv_(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest);
-        aniso.setMax(int(largest));
-    } else {
-        aniso.setMax(0);
-    }
+static constexpr GLenum kStateCapabilities[] = {
+    GL_DEPTH_TEST,
+    GL_BLEND,
+    GL_CULL_FACE,
+    GL_STENCIL_TEST,
+    GL_SCISSOR_TEST,
+    GL_POLYGON_OFFSET_FILL
+};
 
-    static constexpr int kGLSLVersions[] = {
-        130, 140, 150, 330
-    };
+static constexpr size_t kStateTextureTargetCount = sizeof kStateTextureTargets / sizeof *kStateTextureTargets;
+static constexpr size_t kStateBufferTargetCount = sizeof kStateBufferTargets / sizeof *kStateBufferTargets;
+static constexpr size_t kStateCapabilityCount = sizeof kStateCapabilities / sizeof *kStateCapabilities;
+
+static const char *kStateNames[] = {
+    "UseProgram",
+    "ActiveTexture",
+    "BindTexture",
+    "BindBuffer",
+    "BindBufferRange",
+    "Enable",
+    "Disable",
+    "BlendFunc"
+};
 
-    for (auto &it : kGLSLVersions) {
-        const u::string source = u::format("#version %d\nvoid main() { }\n", it);
-        const char *sources[1] = { source.c_str() };
-        GLuint s = glCreateShader_(GL_VERTEX_SHADER);
-        glShaderSource_(s, 1, sources, nullptr);
-        glCompileShader_(s);
-        GLint compiled = 0;
-        glGetShaderiv_(s, GL_COMPILE_STATUS, &compiled);
-        if (compiled) {
-            gGLSLVersion = it;
-            break;
+// Shadow copy of the state, kStateUnknown is used for state which was
+// never set or can no longer be trusted
+struct State {
+    GLuint program;
+    GLuint textureUnit;
+    GLuint textures[kStateTextureUnits][kStateTextureTargetCount];
+    GLuint buffers[kStateBufferTargetCount];
+    struct {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    } uniformBlocks[kStateUniformBlocks];
+    GLuint capabilities[kStateCapabilityCount];
+    GLenum blendSource;
+    GLenum blendDestination;
+    StateCounters counters;
+};
+
+static State gState;
+
+template <size_t N>
+static inline size_t stateIndex(const GLenum (&list)[N], GLenum value) {
+    for (size_t i = 0; i < N; i++)
+        if (list[i] == value)
+            return i;
+    return N;
+}
+
+static inline bool stateElide(size_t what, bool redundant) {
+    if (redundant)
+        gState.counters.elided[what]++;
+    else
+        gState.counters.issued[what]++;
+    return redundant;
+}
+
+static inline void stateForget(GLuint *names, size_t count, GLsizei n, const GLuint *deleted) {
+    // deleting a bound object reverts the binding to zero
+    for (GLsizei i = 0; i < n; i++)
+        for (size_t j = 0; j < count; j++)
+            if (names[j] == deleted[i])
+                names[j] = 0;
+}
+
+static bool stateUseProgram(GLuint program) {
+    if (stateElide(kStateUseProgram, gState.program == program))
+        return true;
+    gState.program = program;
+    return false;
+}
+
+static bool stateActiveTexture(GLenum texture) {
+    const GLuint unit = texture - GL_TEXTURE0;
+    if (stateElide(kStateActiveTexture, gState.textureUnit == unit))
+        return true;
+    gState.textureUnit = unit;
+    return false;
+}
+
+static bool stateBindTexture(GLenum target, GLuint texture) {
+    const size_t index = stateIndex(kStateTextureTargets, target);
+    const GLuint unit = gState.textureUnit;
+    if (index == kStateTextureTargetCount || unit >= kStateTextureUnits)
+        return stateElide(kStateBindTexture, false);
+    GLuint &bound = gState.textures[unit][index];
+    if (stateElide(kStateBindTexture, bound == texture))
+        return true;
+    bound = texture;
+    return false;
+}
+
+static bool stateBindBuffer(GLenum target, GLuint buffer) {
+    const size_t index = stateIndex(kStateBufferTargets, target);
+    if (index == kStateBufferTargetCount)
+        return stateElide(kStateBindBuffer, false);
+    GLuint &bound = gState.buffers[index];
+    if (stateElide(kStateBindBuffer, bound == buffer))
+        return true;
+    bound = buffer;
+    return false;
+}
+
+static bool stateBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    // Both the indexed and the generic binding point change, but only
+    // when the call is issued: an elided call leaves the generic
+    // binding alone and shadowing it anyway would elide a later bind
+    // of the generic binding point which is still needed
+    const size_t generic = stateIndex(kStateBufferTargets, target);
+    if (target == GL_UNIFORM_BUFFER && index < kStateUniformBlocks) {
+        auto &bound = gState.uniformBlocks[index];
+        if (stateElide(kStateBindBufferRange, bound.buffer == buffer
+                                           && bound.offset == offset
+                                           && bound.size == size))
+        {
+            return true;
         }
+        bound.buffer = buffer;
+        bound.offset = offset;
+        bound.size = size;
+    } else {
+        stateElide(kStateBindBufferRange, false);
     }
+    if (generic != kStateBufferTargetCount)
+        gState.buffers[generic] = buffer;
+    return false;
+}
 
-    if (gGLSLVersion == -1)
-        neoFatal("Failed to initialize OpenGL\n");
+static bool stateBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    // an offset of -1 can never match a range
+    return stateBindBufferRange(target, index, buffer, -1, 0);
+}
 
-#if defined(DEBUG_GL)
-    if (has(gl::ARB_debug_output)) {
-        glEnable_(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
-        ((MYPFNGLDEBUGMESSAGECALLBACKARBPROC)neoGetProcAddress("glDebugMessageCallbackARB"))(&debugCallback, nullptr);
-    }
-#endif
+static bool stateCapability(size_t what, GLenum cap, GLuint enable) {
+    const size_t index = stateIndex(kStateCapabilities, cap);
+    if (index == kStateCapabilityCount)
+        return stateElide(what, false);
+    if (stateElide(what, gState.capabilities[index] == enable))
+        return true;
+    gState.capabilities[index] = enable;
+    return false;
 }
 
+static bool stateEnable(GLenum cap) {
+    return stateCapability(kStateEnable, cap, 1);
+}
 
-GLuint CreateShader(GLenum shaderType GL_INFOP) {
-    GLuint result = glCreateShader_(shaderType);
-    GL_CHECK("2", shaderType);
-    return result;
+static bool stateDisable(GLenum cap) {
+    return stateCapability(kStateDisable, cap, 0);
 }
 
-void ShaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length GL_INFOP) {
-    glShaderSource_(shader, count, string, length);
-    GL_CHECK("b8*0*7", shader, count, string, length);
+static bool stateBlendFunc(GLenum sfactor, GLenum dfactor) {
+    if (stateElide(kStateBlendFunc, gState.blendSource == sfactor
+                                 && gState.blendDestination == dfactor))
+    {
+        return true;
+    }
+    gState.blendSource = sfactor;
+    gState.blendDestination = dfactor;
+    return false;
 }
 
-void CompileShader(GLuint shader GL_INFOP) {
-    glCompileShader_(shader);
-    GL_CHECK("b", shader);
+static void stateBindVertexArray(GLuint) {
+    // the element array binding is part of the vertex array object
+    gState.buffers[stateIndex(kStateBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = kStateUnknown;
 }
 
-void AttachShader(GLuint program, GLuint shader GL_INFOP) {
-    glAttachShader_(program, shader);
-    GL_CHECK("bb", program, shader);
+static void stateDeleteProgram(GLuint program) {
+    if (gState.program == program)
+        gState.program = kStateUnknown;
+}
+
+static void stateDeleteTextures(GLsizei n, const GLuint *textures) {
+    stateForget(&gState.textures[0][0], kStateTextureUnits * kStateTextureTargetCount, n, textures);
+}
+
+static void stateDeleteBuffers(GLsizei n, const GLuint *buffers) {
+    stateForget(gState.buffers, kStateBufferTargetCount, n, buffers);
+    for (auto &it : gState.uniformBlocks)
+        stateForget(&it.buffer, 1, n, buffers);
+}
+
+static void stateDeleteVertexArrays(GLsizei, const GLuint *) {
+    stateBindVertexArray(0);
+}
+
+void invalidateState() {
+    gState.program = kStateUnknown;
+    gState.textureUnit = kStateUnknown;
+    for (auto &unit : gState.textures)
+        for (auto &it : unit)
+            it = kStateUnknown;
+    for (auto &it : gState.buffers)
+        it = kStateUnknown;
+    for (auto &it : gState.uniformBlocks)
+        it.buffer = kStateUnknown;
+    for (auto &it : gState.capabilities)
+        it = kStateUnknown;
+    gState.blendSource = kStateUnknown;
+    gState.blendDestination = kStateUnknown;
+}
+
+void stateCounters(StateCounters &counters) {
+    counters = gState.counters;
+    memset(&gState.counters, 0, sizeof gState.counters);
+}
+
+const char *stateName(size_t what) {
+    return kStateNames[what];
+}
+
+static size_t gDrawCalls = 0;
+static Counters gUncounted;
+static Counters *gCounters = &gUncounted;
+
+size_t drawCalls() {
+    return gDrawCalls;
+}
+
+Counters *countInto(Counters *counters) {
+    Counters *const previous = gCounters;
+    gCounters = counters ? counters : &gUncounted;
+    return previous == &gUncounted ? nullptr : previous;
+}
+
+void countStreamed(size_t bytes) {
+    gCounters->streamed += bytes;
+}
+
+static inline void countDraw(GLenum mode, GLsizei count, GLsizei instances = 1) {
+    gDrawCalls++;
+    gCounters->draws++;
+    if (mode == GL_TRIANGLES)
+        gCounters->triangles += size_t(count / 3) * instances;
+    else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+        gCounters->triangles += size_t(count - 2) * instances;
+}
+
+enum : uint16_t {
+    kCallCreateShader,
+    kCallShaderSource,
+    kCallCompileShader,
+    kCallAttachShader,
+    kCallCreateProgram,
+    kCallLinkProgram,
+    kCallUseProgram,
+    kCallGetUniformLocation,
+    kCallEnableVertexAttribArray,
+    kCallDisableVertexAttribArray,
+    kCallUniformMatrix4fv,
+    kCallBindBuffer,
+    kCallGenBuffers,
+    kCallVertexAttribPointer,
+    kCallBufferData,
+    kCallValidateProgram,
+    kCallGenVertexArrays,
+    kCallBindVertexArray,
+    kCallDeleteProgram,
+    kCallDeleteBuffers,
+    kCallDeleteVertexArrays,
+    kCallUniform1i,
+    kCallUniform2i,
+    kCallUniform1f,
+    kCallUniform2f,
+    kCallUniform2fv,
+    kCallUniform3fv,
+    kCallUniform4fv,
+    kCallUniformMatrix3x4fv,
+    kCallGenerateMipmap,
+    kCallDeleteShader,
+    kCallGetShaderiv,
+    kCallGetProgramiv,
+    kCallGetShaderInfoLog,
+    kCallActiveTexture,
+    kCallGenFramebuffers,
+    kCallBindFramebuffer,
+    kCallFramebufferTexture2D,
+    kCallDrawBuffers,
+    kCallCheckFramebufferStatus,
+    kCallDeleteFramebuffers,
+    kCallClear,
+    kCallClearColor,
+    kCallFrontFace,
+    kCallCullFace,
+    kCallEnable,
+    kCallDisable,
+    kCallDrawElements,
+    kCallDepthMask,
+    kCallBindTexture,
+    kCallTexImage2D,
+    kCallDeleteTextures,
+    kCallGenTextures,
+    kCallTexParameterf,
+    kCallTexParameteri,
+    kCallDrawArrays,
+    kCallBlendEquation,
+    kCallBlendFunc,
+    kCallDepthFunc,
+    kCallColorMask,
+    kCallReadPixels,
+    kCallViewport,
+    kCallGetIntegerv,
+    kCallGetString,
+    kCallGetStringi,
+    kCallGetFloatv,
+    kCallGetError,
+    kCallGetTexLevelParameteriv,
+    kCallGetCompressedTexImage,
+    kCallCompressedTexImage2D,
+    kCallPixelStorei,
+    kCallScissor,
+    kCallPolygonMode,
+    kCallHint,
+    kCallGenQueries,
+    kCallBeginQuery,
+    kCallEndQuery,
+    kCallDeleteQueries,
+    kCallGetQueryObjectuiv,
+    kCallFlush,
+    kCallStencilFunc,
+    kCallStencilOp,
+    kCallTexImage3D,
+    kCallTexSubImage3D,
+    kCallGetProgramInfoLog,
+    kCallBindAttribLocation,
+    kCallBindFragDataLocation,
+    kCallTexSubImage2D,
+    kCallDrawBuffer,
+    kCallReadBuffer,
+    kCallBufferSubData,
+    kCallPolygonOffset,
+    kCallDepthRange,
+    kCallProgramParameteri,
+    kCallGetProgramBinary,
+    kCallProgramBinary,
+    kCallBindBufferBase,
+    kCallBindBufferRange,
+    kCallGetUniformBlockIndex,
+    kCallUniformBlockBinding,
+    kCallMapBufferRange,
+    kCallUnmapBuffer,
+    kCallBufferStorage,
+    kCallFenceSync,
+    kCallClientWaitSync,
+    kCallDeleteSync,
+    kCallDrawElementsInstanced,
+    kCallVertexAttribDivisor,
+    kCallMultiDrawElementsIndirect,
+    kCallTexStorage3D,
+    kCallCopyImageSubData,
+    kCallFrame,
+    kCallBufferWrite
+};
+
+// A capture is the magic followed by the calls, every call is its identifier
+// followed by its arguments and its result. Data is stored as its size followed
+// by the bytes which are aligned such that the replay can use them in place
+static const char kCaptureMagic[8] = { 'N', 'E', 'O', 'C', 'A', 'P', '0', '1' };
+
+struct Capture {
+    u::file file;
+    size_t position;
+};
+
+static Capture gCapture;
+static bool gCapturing = false;
+
+static void captureBytes(const void *data, size_t size) {
+    fwrite(data, size, 1, gCapture.file);
+    gCapture.position += size;
 }
 
-GLuint CreateProgram(GL_INFO) {
-    GLuint result = glCreateProgram_();
-    GL_CHECK("",0);
-    return result;
+template <typename T>
+static inline void captureValue(const T &value) {
+    captureBytes(&value, sizeof value);
 }
 
-void LinkProgram(GLuint program GL_INFOP) {
-    glLinkProgram_(program);
-    GL_CHECK("b", program);
+static void captureAlign() {
+    static const unsigned char kPadding[8] = { 0 };
+    const size_t padding = -gCapture.position & (sizeof kPadding - 1);
+    if (padding)
+        captureBytes(kPadding, padding);
 }
 
-void UseProgram(GLuint program GL_INFOP) {
-    glUseProgram_(program);
-    GL_CHECK("b", program);
+static void captureData(const void *data, size_t size) {
+    captureValue(uint32_t(data ? size : 0));
+    captureAlign();
+    if (data && size)
+        captureBytes(data, size);
 }
 
-GLint GetUniformLocation(GLuint program, const GLchar* name GL_INFOP) {
-    GLint result = glGetUniformLocation_(program, name);
-    GL_CHECK("b*1", program, name);
-    return result;
+static void captureString(const GLchar *string) {
+    captureData(string, strlen(string) + 1);
 }
 
-void EnableVertexAttribArray(GLuint index GL_INFOP) {
-    glEnableVertexAttribArray_(index);
-    GL_CHECK("b", index);
+static void captureStrings(GLsizei count, const GLchar **strings, const GLint *lengths) {
+    // the sources are stored null terminated
+    for (GLsizei i = 0; i < count; i++) {
+        const size_t length = lengths && lengths[i] >= 0 ? lengths[i] : strlen(strings[i]);
+        captureValue(uint32_t(length + 1));
+        captureAlign();
+        captureBytes(strings[i], length);
+        captureBytes("", 1);
+    }
 }
 
-void DisableVertexAttribArray(GLuint index GL_INFOP) {
-    glDisableVertexAttribArray_(index);
-    GL_CHECK("b", index);
+// the size of the pixels read by a texture upload
+static size_t captureImageSize(GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth) {
+    size_t components = 4;
+    switch (format) {
+    case GL_RED: case GL_RED_INTEGER: case GL_ALPHA: case GL_LUMINANCE:
+    case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA: case GL_DEPTH_STENCIL:
+        components = 2;
+        break;
+    case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    }
+    size_t bytes = components * 4;
+    switch (type) {
+    case GL_UNSIGNED_BYTE: case GL_BYTE:
+        bytes = components;
+        break;
+    case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+        bytes = components * 2;
+        break;
+    case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+        bytes = 2;
+        break;
+    case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_5_9_9_9_REV:
+        bytes = 4;
+        break;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        bytes = 8;
+        break;
+    }
+    if (width <= 0 || height <= 0 || depth <= 0)
+        return 0;
+    GLint alignment = 4;
+    GLint length = 0;
+    glGetIntegerv_(GL_UNPACK_ALIGNMENT, &alignment);
+    glGetIntegerv_(GL_UNPACK_ROW_LENGTH, &length);
+    const size_t row = (bytes * (length ? length : width) + alignment - 1) / alignment * alignment;
+    // the last row is not padded
+    return row * (size_t(height) * depth - 1) + bytes * width;
+}
+
+bool startCapture(const char *file) {
+    stopCapture();
+    gCapture.file = u::fopen(file, "wb");
+    if (!gCapture.file)
+        return false;
+    setvbuf(gCapture.file, nullptr, _IOFBF, 1 << 20);
+    gCapture.position = 0;
+    captureBytes(kCaptureMagic, sizeof kCaptureMagic);
+    return gCapturing = true;
+}
+
+void stopCapture() {
+    if (!gCapturing)
+        return;
+    gCapture.file.close();
+    gCapturing = false;
 }
 
-void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value GL_INFOP) {
-    glUniformMatrix4fv_(location, count, transpose, value);
-    GL_CHECK("783*c", location, count, transpose, value);
+bool capturing() {
+    return gCapturing;
 }
 
-void BindBuffer(GLenum target, GLuint buffer GL_INFOP) {
-    glBindBuffer_(target, buffer);
-    GL_CHECK("2b", target, buffer);
+void captureFrame() {
+    if (gCapturing)
+        captureValue(uint16_t(kCallFrame));
 }
 
-void GenBuffers(GLsizei n, GLuint* buffers GL_INFOP) {
-    glGenBuffers_(n, buffers);
-    GL_CHECK("8*b", n, buffers);
+void captureBufferWrite(GLuint buffer, size_t offset, const void *data, size_t size) {
+    if (!gCapturing)
+        return;
+    captureValue(uint16_t(kCallBufferWrite));
+    captureValue(buffer);
+    captureValue(uint64_t(offset));
+    captureData(data, size);
 }
 
-void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer GL_INFOP) {
-    glVertexAttribPointer_(index, size, type, normalized, stride, pointer);
-    GL_CHECK("b7238*0", index, size, type, normalized, stride, pointer);
+static void captureCreateShader(GLenum shaderType, GLuint result) {
+    captureValue(uint16_t(kCallCreateShader));
+    captureValue(shaderType);
+    captureValue(result);
 }
 
-void BufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage GL_INFOP) {
-    glBufferData_(target, size, data, usage);
-    GL_CHECK("2f*02", target, size, data, usage);
+static void captureShaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length) {
+    captureValue(uint16_t(kCallShaderSource));
+    captureValue(shader);
+    captureValue(count);
+    captureStrings(count, string, length);
 }
 
-void ValidateProgram(GLuint program GL_INFOP) {
-    glValidateProgram_(program);
-    GL_CHECK("b", program);
+static void captureCompileShader(GLuint shader) {
+    captureValue(uint16_t(kCallCompileShader));
+    captureValue(shader);
 }
 
-void GenVertexArrays(GLsizei n, GLuint* arrays GL_INFOP) {
-    glGenVertexArrays_(n, arrays);
-    GL_CHECK("8*b", n, arrays);
+static void captureAttachShader(GLuint program, GLuint shader) {
+    captureValue(uint16_t(kCallAttachShader));
+    captureValue(program);
+    captureValue(shader);
 }
 
-void BindVertexArray(GLuint array GL_INFOP) {
-    glBindVertexArray_(array);
-    GL_CHECK("b", array);
+static void captureCreateProgram(GLuint result) {
+    captureValue(uint16_t(kCallCreateProgram));
+    captureValue(result);
 }
 
-void DeleteProgram(GLuint program GL_INFOP) {
-    glDeleteProgram_(program);
-    GL_CHECK("b", program);
+static void captureLinkProgram(GLuint program) {
+    captureValue(uint16_t(kCallLinkProgram));
+    captureValue(program);
 }
 
-void DeleteBuffers(GLsizei n, const GLuint* buffers GL_INFOP) {
-    glDeleteBuffers_(n, buffers);
-    GL_CHECK("8*b", n, buffers);
+static void captureUseProgram(GLuint program) {
+    captureValue(uint16_t(kCallUseProgram));
+    captureValue(program);
 }
 
-void DeleteVertexArrays(GLsizei n, const GLuint* arrays GL_INFOP) {
-    glDeleteVertexArrays_(n, arrays);
-    GL_CHECK("8*b", n, arrays);
+static void captureGetUniformLocation(GLuint program, const GLchar* name, GLint result) {
+    captureValue(uint16_t(kCallGetUniformLocation));
+    captureValue(program);
+    captureString(name);
+    captureValue(result);
 }
 
-void Uniform1i(GLint location, GLint v0 GL_INFOP) {
-    glUniform1i_(location, v0);
-    GL_CHECK("77", location, v0);
+static void captureEnableVertexAttribArray(GLuint index) {
+    captureValue(uint16_t(kCallEnableVertexAttribArray));
+    captureValue(index);
 }
 
-void Uniform2i(GLint location, GLint v0, GLint v1 GL_INFOP) {
-    glUniform2i_(location, v0, v1);
-    GL_CHECK("777", location, v0, v1);
+static void captureDisableVertexAttribArray(GLuint index) {
+    captureValue(uint16_t(kCallDisableVertexAttribArray));
+    captureValue(index);
 }
 
-void Uniform1f(GLint location, GLfloat v0 GL_INFOP) {
-    glUniform1f_(location, v0);
-    GL_CHECK("7c", location, v0);
+static void captureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    captureValue(uint16_t(kCallUniformMatrix4fv));
+    captureValue(location);
+    captureValue(count);
+    captureValue(transpose);
+    captureData(value, count * 16 * sizeof(GLfloat));
 }
 
-void Uniform2f(GLint location, GLfloat v0, GLfloat v1 GL_INFOP) {
-    glUniform2f_(location, v0, v1);
-    GL_CHECK("7cc", location, v0, v1);
+static void captureBindBuffer(GLenum target, GLuint buffer) {
+    captureValue(uint16_t(kCallBindBuffer));
+    captureValue(target);
+    captureValue(buffer);
 }
 
-void Uniform2fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
-    glUniform2fv_(location, count, value);
-    GL_CHECK("78*c", location, count, value);
+static void captureGenBuffers(GLsizei n, GLuint* buffers) {
+    captureValue(uint16_t(kCallGenBuffers));
+    captureValue(n);
+    captureData(buffers, n * sizeof(GLuint));
 }
 
-void Uniform3fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
-    glUniform3fv_(location, count, value);
-    GL_CHECK("78*c", location, count, value);
+static void captureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer) {
+    captureValue(uint16_t(kCallVertexAttribPointer));
+    captureValue(index);
+    captureValue(size);
+    captureValue(type);
+    captureValue(normalized);
+    captureValue(stride);
+    captureValue(uint64_t(uintptr_t(pointer)));
 }
 
-void Uniform4fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
-    glUniform4fv_(location, count, value);
-    GL_CHECK("78*c", location, count, value);
+static void captureBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) {
+    captureValue(uint16_t(kCallBufferData));
+    captureValue(target);
+    captureValue(int64_t(size));
+    captureData(data, size);
+    captureValue(usage);
 }
 
-void UniformMatrix3x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value GL_INFOP) {
-    glUniformMatrix3x4fv_(location, count, transpose, value);
-    GL_CHECK("783*c", location, count, transpose, value);
+static void captureValidateProgram(GLuint program) {
+    captureValue(uint16_t(kCallValidateProgram));
+    captureValue(program);
 }
 
-void GenerateMipmap(GLenum target GL_INFOP) {
-    glGenerateMipmap_(target);
-    GL_CHECK("2", target);
+static void captureGenVertexArrays(GLsizei n, GLuint* arrays) {
+    captureValue(uint16_t(kCallGenVertexArrays));
+    captureValue(n);
+    captureData(arrays, n * sizeof(GLuint));
 }
 
-void DeleteShader(GLuint shader GL_INFOP) {
-    glDeleteShader_(shader);
-    GL_CHECK("b", shader);
+static void captureBindVertexArray(GLuint array) {
+    captureValue(uint16_t(kCallBindVertexArray));
+    captureValue(array);
 }
 
-void GetShaderiv(GLuint shader, GLenum pname, GLint* params GL_INFOP) {
-    glGetShaderiv_(shader, pname, params);
-    GL_CHECK("b2*7", shader, pname, params);
+static void captureDeleteProgram(GLuint program) {
+    captureValue(uint16_t(kCallDeleteProgram));
+    captureValue(program);
 }
 
-void GetProgramiv(GLuint program, GLenum pname, GLint* params GL_INFOP) {
-    glGetProgramiv_(program, pname, params);
-    GL_CHECK("b2*7", program, pname, params);
+static void captureDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    captureValue(uint16_t(kCallDeleteBuffers));
+    captureValue(n);
+    captureData(buffers, n * sizeof(GLuint));
 }
 
-void GetShaderInfoLog(GLuint shader, GLsizei maxLength, GLsizei* length, GLchar* infoLog GL_INFOP) {
-    glGetShaderInfoLog_(shader, maxLength, length, infoLog);
-    GL_CHECK("b8*8*1", shader, maxLength, length, infoLog);
+static void captureDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    captureValue(uint16_t(kCallDeleteVertexArrays));
+    captureValue(n);
+    captureData(arrays, n * sizeof(GLuint));
 }
 
-void ActiveTexture(GLenum texture GL_INFOP) {
-    glActiveTexture_(texture);
-    GL_CHECK("2", texture);
+static void captureUniform1i(GLint location, GLint v0) {
+    captureValue(uint16_t(kCallUniform1i));
+    captureValue(location);
+    captureValue(v0);
 }
 
-void GenFramebuffers(GLsizei n, GLuint* ids GL_INFOP) {
-    glGenFramebuffers_(n, ids);
-    GL_CHECK("8*b", n, ids);
+static void captureUniform2i(GLint location, GLint v0, GLint v1) {
+    captureValue(uint16_t(kCallUniform2i));
+    captureValue(location);
+    captureValue(v0);
+    captureValue(v1);
 }
 
-void BindFramebuffer(GLenum target, GLuint framebuffer GL_INFOP) {
-    glBindFramebuffer_(target, framebuffer);
-    GL_CHECK("2b", target, framebuffer);
+static void captureUniform1f(GLint location, GLfloat v0) {
+    captureValue(uint16_t(kCallUniform1f));
+    captureValue(location);
+    captureValue(v0);
 }
 
-void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level GL_INFOP) {
-    glFramebufferTexture2D_(target, attachment, textarget, texture, level);
-    GL_CHECK("222b7", target, attachment, textarget, texture, level);
+static void captureUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    captureValue(uint16_t(kCallUniform2f));
+    captureValue(location);
+    captureValue(v0);
+    captureValue(v1);
 }
 
-void DrawBuffers(GLsizei n, const GLenum* bufs GL_INFOP) {
-    glDrawBuffers_(n, bufs);
-    GL_CHECK("8*2", n, bufs);
+static void captureUniform2fv(GLint location, GLsizei count, const GLfloat* value) {
+    captureValue(uint16_t(kCallUniform2fv));
+    captureValue(location);
+    captureValue(count);
+    captureData(value, count * 2 * sizeof(GLfloat));
 }
 
-GLenum CheckFramebufferStatus(GLenum target GL_INFOP) {
-    GLenum result = glCheckFramebufferStatus_(target);
-    GL_CHECK("2", target);
-    return result;
+static void captureUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+    captureValue(uint16_t(kCallUniform3fv));
+    captureValue(location);
+    captureValue(count);
+    captureData(value, count * 3 * sizeof(GLfloat));
 }
 
-void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers GL_INFOP) {
-    glDeleteFramebuffers_(n, framebuffers);
-    GL_CHECK("8*b", n, framebuffers);
+static void captureUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+    captureValue(uint16_t(kCallUniform4fv));
+    captureValue(location);
+    captureValue(count);
+    captureData(value, count * 4 * sizeof(GLfloat));
 }
 
-void Clear(GLbitfield mask GL_INFOP) {
-    glClear_(mask);
-    GL_CHECK("4", mask);
+static void captureUniformMatrix3x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+    captureValue(uint16_t(kCallUniformMatrix3x4fv));
+    captureValue(location);
+    captureValue(count);
+    captureValue(transpose);
+    captureData(value, count * 12 * sizeof(GLfloat));
 }
 
-void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha GL_INFOP) {
-    glClearColor_(red, green, blue, alpha);
-    GL_CHECK("cccc", red, green, blue, alpha);
+static void captureGenerateMipmap(GLenum target) {
+    captureValue(uint16_t(kCallGenerateMipmap));
+    captureValue(target);
 }
 
-void FrontFace(GLenum mode GL_INFOP) {
-    glFrontFace_(mode);
-    GL_CHECK("2", mode);
+static void captureDeleteShader(GLuint shader) {
+    captureValue(uint16_t(kCallDeleteShader));
+    captureValue(shader);
 }
 
-void CullFace(GLenum mode GL_INFOP) {
-    glCullFace_(mode);
-    GL_CHECK("2", mode);
+static void captureGetShaderiv(GLuint shader, GLenum pname, GLint*) {
+    captureValue(uint16_t(kCallGetShaderiv));
+    captureValue(shader);
+    captureValue(pname);
 }
 
-void Enable(GLenum cap GL_INFOP) {
-    glEnable_(cap);
-    GL_CHECK("2", cap);
+static void captureGetProgramiv(GLuint program, GLenum pname, GLint*) {
+    captureValue(uint16_t(kCallGetProgramiv));
+    captureValue(program);
+    captureValue(pname);
 }
 
-void Disable(GLenum cap GL_INFOP) {
-    glDisable_(cap);
-    GL_CHECK("2", cap);
+static void captureGetShaderInfoLog(GLuint shader, GLsizei maxLength, GLsizei*, GLchar*) {
+    captureValue(uint16_t(kCallGetShaderInfoLog));
+    captureValue(shader);
+    captureValue(maxLength);
 }
 
-void DrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices GL_INFOP) {
-    glDrawElements_(mode, count, type, indices);
-    GL_CHECK("282*0", mode, count, type, indices);
+static void captureActiveTexture(GLenum texture) {
+    captureValue(uint16_t(kCallActiveTexture));
+    captureValue(texture);
 }
 
-void DepthMask(GLboolean flag GL_INFOP) {
-    glDepthMask_(flag);
-    GL_CHECK("3", flag);
+static void captureGenFramebuffers(GLsizei n, GLuint* ids) {
+    captureValue(uint16_t(kCallGenFramebuffers));
+    captureValue(n);
+    captureData(ids, n * sizeof(GLuint));
 }
 
-void BindTexture(GLenum target, GLuint texture GL_INFOP) {
-    glBindTexture_(target, texture);
-    GL_CHECK("2b", target, texture);
+static void captureBindFramebuffer(GLenum target, GLuint framebuffer) {
+    captureValue(uint16_t(kCallBindFramebuffer));
+    captureValue(target);
+    captureValue(framebuffer);
 }
 
-void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
-    glTexImage2D_(target, level, internalFormat, width, height, border, format, type, data);
-    GL_CHECK("27788722*0", target, level, internalFormat, width, height, border, format, type, data);
+static void captureFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+    captureValue(uint16_t(kCallFramebufferTexture2D));
+    captureValue(target);
+    captureValue(attachment);
+    captureValue(textarget);
+    captureValue(texture);
+    captureValue(level);
 }
 
-void DeleteTextures(GLsizei n, const GLuint* textures GL_INFOP) {
-    glDeleteTextures_(n, textures);
-    GL_CHECK("8*b", n, textures);
+static void captureDrawBuffers(GLsizei n, const GLenum* bufs) {
+    captureValue(uint16_t(kCallDrawBuffers));
+    captureValue(n);
+    captureData(bufs, n * sizeof(GLenum));
 }
 
-void GenTextures(GLsizei n, GLuint* textures GL_INFOP) {
-    glGenTextures_(n, textures);
-    GL_CHECK("8*b", n, textures);
+static void captureCheckFramebufferStatus(GLenum target, GLenum result) {
+    captureValue(uint16_t(kCallCheckFramebufferStatus));
+    captureValue(target);
+    captureValue(result);
 }
 
-void TexParameterf(GLenum target, GLenum pname, GLfloat param GL_INFOP) {
-    glTexParameterf_(target, pname, param);
-    GL_CHECK("22c", target, pname, param);
+static void captureDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    captureValue(uint16_t(kCallDeleteFramebuffers));
+    captureValue(n);
+    captureData(framebuffers, n * sizeof(GLuint));
 }
 
-void TexParameteri(GLenum target, GLenum pname, GLint param GL_INFOP) {
-    glTexParameteri_(target, pname, param);
-    GL_CHECK("227", target, pname, param);
+static void captureClear(GLbitfield mask) {
+    captureValue(uint16_t(kCallClear));
+    captureValue(mask);
 }
 
-void DrawArrays(GLenum mode, GLint first, GLsizei count GL_INFOP) {
-    glDrawArrays_(mode, first, count);
-    GL_CHECK("278", mode, first, count);
+static void captureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+    captureValue(uint16_t(kCallClearColor));
+    captureValue(red);
+    captureValue(green);
+    captureValue(blue);
+    captureValue(alpha);
 }
 
-void BlendEquation(GLenum mode GL_INFOP) {
-    glBlendEquation_(mode);
-    GL_CHECK("2", mode);
+static void captureFrontFace(GLenum mode) {
+    captureValue(uint16_t(kCallFrontFace));
+    captureValue(mode);
 }
 
-void BlendFunc(GLenum sfactor, GLenum dfactor GL_INFOP) {
-    glBlendFunc_(sfactor, dfactor);
-    GL_CHECK("22", sfactor, dfactor);
+static void captureCullFace(GLenum mode) {
+    captureValue(uint16_t(kCallCullFace));
+    captureValue(mode);
 }
 
-void DepthFunc(GLenum func GL_INFOP) {
-    glDepthFunc_(func);
-    GL_CHECK("2", func);
+static void captureEnable(GLenum cap) {
+    captureValue(uint16_t(kCallEnable));
+    captureValue(cap);
 }
 
-void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha GL_INFOP) {
-    glColorMask_(red, green, blue, alpha);
-    GL_CHECK("3333", red, green, blue, alpha);
+static void captureDisable(GLenum cap) {
+    captureValue(uint16_t(kCallDisable));
+    captureValue(cap);
 }
 
-void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* data GL_INFOP) {
-    glReadPixels_(x, y, width, height, format, type, data);
-    GL_CHECK("778822*0", x, y, width, height, format, type, data);
+static void captureDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) {
+    captureValue(uint16_t(kCallDrawElements));
+    captureValue(mode);
+    captureValue(count);
+    captureValue(type);
+    captureValue(uint64_t(uintptr_t(indices)));
 }
 
-void Viewport(GLint x, GLint y, GLsizei width, GLsizei height GL_INFOP) {
-    glViewport_(x, y, width, height);
-    GL_CHECK("7788", x, y, width, height);
+static void captureDepthMask(GLboolean flag) {
+    captureValue(uint16_t(kCallDepthMask));
+    captureValue(flag);
 }
 
-void GetIntegerv(GLenum pname, GLint* data GL_INFOP) {
-    glGetIntegerv_(pname, data);
-    GL_CHECK("2*7", pname, data);
+static void captureBindTexture(GLenum target, GLuint texture) {
+    captureValue(uint16_t(kCallBindTexture));
+    captureValue(target);
+    captureValue(texture);
 }
 
-const GLubyte* GetString(GLenum name GL_INFOP) {
-    const GLubyte* result = glGetString_(name);
-    GL_CHECK("2", name);
-    return result;
+static void captureTexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* data) {
+    captureValue(uint16_t(kCallTexImage2D));
+    captureValue(target);
+    captureValue(level);
+    captureValue(internalFormat);
+    captureValue(width);
+    captureValue(height);
+    captureValue(border);
+    captureValue(format);
+    captureValue(type);
+    captureData(data, captureImageSize(format, type, width, height, 1));
 }
 
-const GLubyte* GetStringi(GLenum name, GLuint index GL_INFOP) {
-    const GLubyte* result = glGetStringi_(name, index);
-    GL_CHECK("2b", name, index);
-    return result;
+static void captureDeleteTextures(GLsizei n, const GLuint* textures) {
+    captureValue(uint16_t(kCallDeleteTextures));
+    captureValue(n);
+    captureData(textures, n * sizeof(GLuint));
 }
 
-void GetFloatv(GLenum pname, GLfloat* params GL_INFOP) {
-    glGetFloatv_(pname, params);
-    GL_CHECK("2*c", pname, params);
+static void captureGenTextures(GLsizei n, GLuint* textures) {
+    captureValue(uint16_t(kCallGenTextures));
+    captureValue(n);
+    captureData(textures, n * sizeof(GLuint));
 }
 
-GLenum GetError(GL_INFO) {
-    GLenum result = glGetError_();
-    GL_CHECK("",0);
-    return result;
+static void captureTexParameterf(GLenum target, GLenum pname, GLfloat param) {
+    captureValue(uint16_t(kCallTexParameterf));
+    captureValue(target);
+    captureValue(pname);
+    captureValue(param);
 }
 
-void GetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params GL_INFOP) {
-    glGetTexLevelParameteriv_(target, level, pname, params);
-    GL_CHECK("272*7", target, level, pname, params);
+static void captureTexParameteri(GLenum target, GLenum pname, GLint param) {
+    captureValue(uint16_t(kCallTexParameteri));
+    captureValue(target);
+    captureValue(pname);
+    captureValue(param);
 }
 
-void GetCompressedTexImage(GLenum target, GLint lod, GLvoid* img GL_INFOP) {
-    glGetCompressedTexImage_(target, lod, img);
-    GL_CHECK("27*0", target, lod, img);
+static void captureDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    captureValue(uint16_t(kCallDrawArrays));
+    captureValue(mode);
+    captureValue(first);
+    captureValue(count);
 }
 
-void CompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data GL_INFOP) {
-    glCompressedTexImage2D_(target, level, internalformat, width, height, border, imageSize, data);
-    GL_CHECK("2728878*0", target, level, internalformat, width, height, border, imageSize, data);
+static void captureBlendEquation(GLenum mode) {
+    captureValue(uint16_t(kCallBlendEquation));
+    captureValue(mode);
 }
 
-void PixelStorei(GLenum pname, GLint param GL_INFOP) {
-    glPixelStorei_(pname, param);
-    GL_CHECK("27", pname, param);
+static void captureBlendFunc(GLenum sfactor, GLenum dfactor) {
+    captureValue(uint16_t(kCallBlendFunc));
+    captureValue(sfactor);
+    captureValue(dfactor);
 }
 
-void Scissor(GLint x, GLint y, GLsizei width, GLsizei height GL_INFOP) {
-    glScissor_(x, y, width, height);
-    GL_CHECK("7788", x, y, width, height);
+static void captureDepthFunc(GLenum func) {
+    captureValue(uint16_t(kCallDepthFunc));
+    captureValue(func);
 }
 
-void PolygonMode(GLenum face, GLenum mode GL_INFOP) {
-    glPolygonMode_(face, mode);
-    GL_CHECK("22", face, mode);
+static void captureColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    captureValue(uint16_t(kCallColorMask));
+    captureValue(red);
+    captureValue(green);
+    captureValue(blue);
+    captureValue(alpha);
 }
 
-void Hint(GLenum target, GLenum mode GL_INFOP) {
-    glHint_(target, mode);
-    GL_CHECK("22", target, mode);
+static void captureReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* data) {
+    captureValue(uint16_t(kCallReadPixels));
+    captureValue(x);
+    captureValue(y);
+    captureValue(width);
+    captureValue(height);
+    captureValue(format);
+    captureValue(type);
+    captureValue(uint64_t(uintptr_t(data)));
 }
 
-void GenQueries(GLsizei n, GLuint* ids GL_INFOP) {
-    glGenQueries_(n, ids);
-    GL_CHECK("8*b", n, ids);
+static void captureViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    captureValue(uint16_t(kCallViewport));
+    captureValue(x);
+    captureValue(y);
+    captureValue(width);
+    captureValue(height);
 }
 
-void BeginQuery(GLenum target, GLuint id GL_INFOP) {
-    glBeginQuery_(target, id);
-    GL_CHECK("2b", target, id);
+static void captureGetIntegerv(GLenum pname, GLint*) {
+    captureValue(uint16_t(kCallGetIntegerv));
+    captureValue(pname);
 }
 
-void EndQuery(GLenum target, GLuint id GL_INFOP) {
-    glEndQuery_(target, id);
-    GL_CHECK("2b", target, id);
+static void captureGetString(GLenum name) {
+    captureValue(uint16_t(kCallGetString));
+    captureValue(name);
 }
 
-void DeleteQueries(GLsizei n, const GLuint* ids GL_INFOP) {
-    glDeleteQueries_(n, ids);
-    GL_CHECK("8*b", n, ids);
+static void captureGetStringi(GLenum name, GLuint index) {
+    captureValue(uint16_t(kCallGetStringi));
+    captureValue(name);
+    captureValue(index);
 }
 
-void GetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params GL_INFOP) {
-    glGetQueryObjectuiv_(id, pname, params);
-    GL_CHECK("b2*b", id, pname, params);
+static void captureGetFloatv(GLenum pname, GLfloat*) {
+    captureValue(uint16_t(kCallGetFloatv));
+    captureValue(pname);
 }
 
-void Flush(GL_INFO) {
-    glFlush_();
-    GL_CHECK("",0);
+static void captureGetError(GLenum result) {
+    captureValue(uint16_t(kCallGetError));
+    captureValue(result);
 }
 
-void StencilFunc(GLenum func, GLint ref, GLuint mask GL_INFOP) {
-    glStencilFunc_(func, ref, mask);
-    GL_CHECK("27b", func, ref, mask);
+static void captureGetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint*) {
+    captureValue(uint16_t(kCallGetTexLevelParameteriv));
+    captureValue(target);
+    captureValue(level);
+    captureValue(pname);
 }
 
-void StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass GL_INFOP) {
-    glStencilOp_(sfail, dpfail, dppass);
-    GL_CHECK("222", sfail, dpfail, dppass);
+static void captureGetCompressedTexImage(GLenum target, GLint lod, GLvoid* img) {
+    captureValue(uint16_t(kCallGetCompressedTexImage));
+    captureValue(target);
+    captureValue(lod);
+    captureValue(uint64_t(uintptr_t(img)));
 }
 
-void TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
-    glTexImage3D_(target, level, internalFormat, width, height, depth, border, format, type, data);
-    GL_CHECK("277888722*0", target, level, internalFormat, width, height, depth, border, format, type, data);
+static void captureCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data) {
+    captureValue(uint16_t(kCallCompressedTexImage2D));
+    captureValue(target);
+    captureValue(level);
+    captureValue(internalformat);
+    captureValue(width);
+    captureValue(height);
+    captureValue(border);
+    captureValue(imageSize);
+    captureData(data, imageSize);
 }
 
-void TexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const GLvoid * data GL_INFOP) {
-    glTexSubImage3D_(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
-    GL_CHECK("2777788822*0", target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+static void capturePixelStorei(GLenum pname, GLint param) {
+    captureValue(uint16_t(kCallPixelStorei));
+    captureValue(pname);
+    captureValue(param);
 }
 
-void GetProgramInfoLog(GLuint program, GLsizei maxLength, GLsizei* length, GLchar* infoLog GL_INFOP) {
-    glGetProgramInfoLog_(program, maxLength, length, infoLog);
-    GL_CHECK("b8*8*1", program, maxLength, length, infoLog);
+static void captureScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    captureValue(uint16_t(kCallScissor));
+    captureValue(x);
+    captureValue(y);
+    captureValue(width);
+    captureValue(height);
 }
 
-void BindAttribLocation(GLuint program, GLuint index, const GLchar* name GL_INFOP) {
-    glBindAttribLocation_(program, index, name);
-    GL_CHECK("bb*1", program, index, name);
+static void capturePolygonMode(GLenum face, GLenum mode) {
+    captureValue(uint16_t(kCallPolygonMode));
+    captureValue(face);
+    captureValue(mode);
 }
 
-void BindFragDataLocation(GLuint program, GLuint colorNumber, const GLchar* name GL_INFOP) {
-    glBindFragDataLocation_(program, colorNumber, name);
-    GL_CHECK("bb*1", program, colorNumber, name);
+static void captureHint(GLenum target, GLenum mode) {
+    captureValue(uint16_t(kCallHint));
+    captureValue(target);
+    captureValue(mode);
 }
 
-void TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
-    glTexSubImage2D_(target, level, xoffset, yoffset, width, height, format, type, data);
-    GL_CHECK("27778822*0", target, level, xoffset, yoffset, width, height, format, type, data);
+static void captureGenQueries(GLsizei n, GLuint* ids) {
+    captureValue(uint16_t(kCallGenQueries));
+    captureValue(n);
+    captureData(ids, n * sizeof(GLuint));
 }
 
-void DrawBuffer(GLenum mode GL_INFOP) {
-    glDrawBuffer_(mode);
-    GL_CHECK("2", mode);
+static void captureBeginQuery(GLenum target, GLuint id) {
+    captureValue(uint16_t(kCallBeginQuery));
+    captureValue(target);
+    captureValue(id);
 }
 
-void ReadBuffer(GLenum mode GL_INFOP) {
-    glReadBuffer_(mode);
-    GL_CHECK("2", mode);
+static void captureEndQuery(GLenum target, GLuint id) {
+    captureValue(uint16_t(kCallEndQuery));
+    captureValue(target);
+    captureValue(id);
 }
 
-void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data GL_INFOP) {
-    glBufferSubData_(target, offset, size, data);
-    GL_CHECK("2ef*0", target, offset, size, data);
+static void captureDeleteQueries(GLsizei n, const GLuint* ids) {
+    captureValue(uint16_t(kCallDeleteQueries));
+    captureValue(n);
+    captureData(ids, n * sizeof(GLuint));
 }
 
-void PolygonOffset(GLfloat factor, GLfloat units GL_INFOP) {
-    glPolygonOffset_(factor, units);
-    GL_CHECK("cc", factor, units);
+static void captureGetQueryObjectuiv(GLuint id, GLenum pname, GLuint*) {
+    captureValue(uint16_t(kCallGetQueryObjectuiv));
+    captureValue(id);
+    captureValue(pname);
 }
 
-void DepthRange(GLclampd nearVal, GLclampd farVal GL_INFOP) {
-    glDepthRange_(nearVal, farVal);
-    GL_CHECK("gg", nearVal, farVal);
+static void captureFlush() {
+    captureValue(uint16_t(kCallFlush));
 }
 
-void ProgramParameteri(GLuint program, GLenum pname, GLint value GL_INFOP) {
-    glProgramParameteri_(program, pname, value);
-    GL_CHECK("b27", program, pname, value);
+static void captureStencilFunc(GLenum func, GLint ref, GLuint mask) {
+    captureValue(uint16_t(kCallStencilFunc));
+    captureValue(func);
+    captureValue(ref);
+    captureValue(mask);
 }
 
-void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, GLvoid* binary GL_INFOP) {
-    glGetProgramBinary_(program, bufSize, length, binaryFormat, binary);
-    GL_CHECK("b8*8*2*0", program, bufSize, length, binaryFormat, binary);
+static void captureStencilOp(GLenum sfail, GLenum dpfail, GLenum dppass) {
+    captureValue(uint16_t(kCallStencilOp));
+    captureValue(sfail);
+    captureValue(dpfail);
+    captureValue(dppass);
 }
 
-void ProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid* binary, GLsizei length GL_INFOP) {
-    glProgramBinary_(program, binaryFormat, binary, length);
-    GL_CHECK("b2*08", program, binaryFormat, binary, length);
+static void captureTexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid* data) {
+    captureValue(uint16_t(kCallTexImage3D));
+    captureValue(target);
+    captureValue(level);
+    captureValue(internalFormat);
+    captureValue(width);
+    captureValue(height);
+    captureValue(depth);
+    captureValue(border);
+    captureValue(format);
+    captureValue(type);
+    captureData(data, captureImageSize(format, type, width, height, depth));
+}
+
+static void captureTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const GLvoid * data) {
+    captureValue(uint16_t(kCallTexSubImage3D));
+    captureValue(target);
+    captureValue(level);
+    captureValue(xoffset);
+    captureValue(yoffset);
+    captureValue(zoffset);
+    captureValue(width);
+    captureValue(height);
+    captureValue(depth);
+    captureValue(format);
+    captureValue(type);
+    captureData(data, captureImageSize(format, type, width, height, depth));
+}
+
+static void captureGetProgramInfoLog(GLuint program, GLsizei maxLength, GLsizei*, GLchar*) {
+    captureValue(uint16_t(kCallGetProgramInfoLog));
+    captureValue(program);
+    captureValue(maxLength);
+}
+
+static void captureBindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+    captureValue(uint16_t(kCallBindAttribLocation));
+    captureValue(program);
+    captureValue(index);
+    captureString(name);
+}
+
+static void captureBindFragDataLocation(GLuint program, GLuint colorNumber, const GLchar* name) {
+    captureValue(uint16_t(kCallBindFragDataLocation));
+    captureValue(program);
+    captureValue(colorNumber);
+    captureString(name);
+}
+
+static void captureTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* data) {
+    captureValue(uint16_t(kCallTexSubImage2D));
+    captureValue(target);
+    captureValue(level);
+    captureValue(xoffset);
+    captureValue(yoffset);
+    captureValue(width);
+    captureValue(height);
+    captureValue(format);
+    captureValue(type);
+    captureData(data, captureImageSize(format, type, width, height, 1));
+}
+
+static void captureDrawBuffer(GLenum mode) {
+    captureValue(uint16_t(kCallDrawBuffer));
+    captureValue(mode);
+}
+
+static void captureReadBuffer(GLenum mode) {
+    captureValue(uint16_t(kCallReadBuffer));
+    captureValue(mode);
+}
+
+static void captureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) {
+    captureValue(uint16_t(kCallBufferSubData));
+    captureValue(target);
+    captureValue(int64_t(offset));
+    captureValue(int64_t(size));
+    captureData(data, size);
+}
+
+static void capturePolygonOffset(GLfloat factor, GLfloat units) {
+    captureValue(uint16_t(kCallPolygonOffset));
+    captureValue(factor);
+    captureValue(units);
+}
+
+static void captureDepthRange(GLclampd nearVal, GLclampd farVal) {
+    captureValue(uint16_t(kCallDepthRange));
+    captureValue(nearVal);
+    captureValue(farVal);
+}
+
+static void captureProgramParameteri(GLuint program, GLenum pname, GLint value) {
+    captureValue(uint16_t(kCallProgramParameteri));
+    captureValue(program);
+    captureValue(pname);
+    captureValue(value);
+}
+
+static void captureGetProgramBinary(GLuint program, GLsizei bufSize, GLsizei*, GLenum*, GLvoid*) {
+    captureValue(uint16_t(kCallGetProgramBinary));
+    captureValue(program);
+    captureValue(bufSize);
+}
+
+static void captureProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid* binary, GLsizei length) {
+    captureValue(uint16_t(kCallProgramBinary));
+    captureValue(program);
+    captureValue(binaryFormat);
+    captureData(binary, length);
+    captureValue(length);
+}
+
+static void captureBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    captureValue(uint16_t(kCallBindBufferBase));
+    captureValue(target);
+    captureValue(index);
+    captureValue(buffer);
+}
+
+static void captureBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    captureValue(uint16_t(kCallBindBufferRange));
+    captureValue(target);
+    captureValue(index);
+    captureValue(buffer);
+    captureValue(int64_t(offset));
+    captureValue(int64_t(size));
+}
+
+static void captureGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName, GLuint result) {
+    captureValue(uint16_t(kCallGetUniformBlockIndex));
+    captureValue(program);
+    captureString(uniformBlockName);
+    captureValue(result);
+}
+
+static void captureUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding) {
+    captureValue(uint16_t(kCallUniformBlockBinding));
+    captureValue(program);
+    captureValue(uniformBlockIndex);
+    captureValue(uniformBlockBinding);
+}
+
+static void captureMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    captureValue(uint16_t(kCallMapBufferRange));
+    captureValue(target);
+    captureValue(int64_t(offset));
+    captureValue(int64_t(length));
+    captureValue(access);
+}
+
+static void captureUnmapBuffer(GLenum target, GLboolean result) {
+    captureValue(uint16_t(kCallUnmapBuffer));
+    captureValue(target);
+    captureValue(result);
+}
+
+static void captureBufferStorage(GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags) {
+    captureValue(uint16_t(kCallBufferStorage));
+    captureValue(target);
+    captureValue(int64_t(size));
+    captureData(data, size);
+    captureValue(flags);
+}
+
+static void captureFenceSync(GLenum condition, GLbitfield flags, GLsync result) {
+    captureValue(uint16_t(kCallFenceSync));
+    captureValue(condition);
+    captureValue(flags);
+    captureValue(uint64_t(uintptr_t(result)));
+}
+
+static void captureClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout, GLenum result) {
+    captureValue(uint16_t(kCallClientWaitSync));
+    captureValue(uint64_t(uintptr_t(sync)));
+    captureValue(flags);
+    captureValue(timeout);
+    captureValue(result);
+}
+
+static void captureDeleteSync(GLsync sync) {
+    captureValue(uint16_t(kCallDeleteSync));
+    captureValue(uint64_t(uintptr_t(sync)));
+}
+
+static void captureDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei primcount) {
+    captureValue(uint16_t(kCallDrawElementsInstanced));
+    captureValue(mode);
+    captureValue(count);
+    captureValue(type);
+    captureValue(uint64_t(uintptr_t(indices)));
+    captureValue(primcount);
+}
+
+static void captureVertexAttribDivisor(GLuint index, GLuint divisor) {
+    captureValue(uint16_t(kCallVertexAttribDivisor));
+    captureValue(index);
+    captureValue(divisor);
+}
+
+static void captureMultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid* indirect, GLsizei drawcount, GLsizei stride) {
+    captureValue(uint16_t(kCallMultiDrawElementsIndirect));
+    captureValue(mode);
+    captureValue(type);
+    captureValue(uint64_t(uintptr_t(indirect)));
+    captureValue(drawcount);
+    captureValue(stride);
+}
+
+static void captureTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth) {
+    captureValue(uint16_t(kCallTexStorage3D));
+    captureValue(target);
+    captureValue(levels);
+    captureValue(internalformat);
+    captureValue(width);
+    captureValue(height);
+    captureValue(depth);
+}
+
+static void captureCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth) {
+    captureValue(uint16_t(kCallCopyImageSubData));
+    captureValue(srcName);
+    captureValue(srcTarget);
+    captureValue(srcLevel);
+    captureValue(srcX);
+    captureValue(srcY);
+    captureValue(srcZ);
+    captureValue(dstName);
+    captureValue(dstTarget);
+    captureValue(dstLevel);
+    captureValue(dstX);
+    captureValue(dstY);
+    captureValue(dstZ);
+    captureValue(srcWidth);
+    captureValue(srcHeight);
+    captureValue(srcDepth);
+}
+
+void init() {
+    invalidateState();
+
+    glCreateShader_              = (MYPFNGLCREATESHADERPROC)neoGetProcAddress("glCreateShader");
+    glShaderSource_              = (MYPFNGLSHADERSOURCEPROC)neoGetProcAddress("glShaderSource");
+    glCompileShader_             = (MYPFNGLCOMPILESHADERPROC)neoGetProcAddress("glCompileShader");
+    glAttachShader_              = (MYPFNGLATTACHSHADERPROC)neoGetProcAddress("glAttachShader");
+    glCreateProgram_             = (MYPFNGLCREATEPROGRAMPROC)neoGetProcAddress("glCreateProgram");
+    glLinkProgram_               = (MYPFNGLLINKPROGRAMPROC)neoGetProcAddress("glLinkProgram");
+    glUseProgram_                = (MYPFNGLUSEPROGRAMPROC)neoGetProcAddress("glUseProgram");
+    glGetUniformLocation_        = (MYPFNGLGETUNIFORMLOCATIONPROC)neoGetProcAddress("glGetUniformLocation");
+    glEnableVertexAttribArray_   = (MYPFNGLENABLEVERTEXATTRIBARRAYPROC)neoGetProcAddress("glEnableVertexAttribArray");
+    glDisableVertexAttribArray_  = (MYPFNGLDISABLEVERTEXATTRIBARRAYPROC)neoGetProcAddress("glDisableVertexAttribArray");
+    glUniformMatrix4fv_          = (MYPFNGLUNIFORMMATRIX4FVPROC)neoGetProcAddress("glUniformMatrix4fv");
+    glBindBuffer_                = (MYPFNGLBINDBUFFERPROC)neoGetProcAddress("glBindBuffer");
+    glGenBuffers_                = (MYPFNGLGENBUFFERSPROC)neoGetProcAddress("glGenBuffers");
+    glVertexAttribPointer_       = (MYPFNGLVERTEXATTRIBPOINTERPROC)neoGetProcAddress("glVertexAttribPointer");
+    glBufferData_                = (MYPFNGLBUFFERDATAPROC)neoGetProcAddress("glBufferData");
+    glValidateProgram_           = (MYPFNGLVALIDATEPROGRAMPROC)neoGetProcAddress("glValidateProgram");
+    glGenVertexArrays_           = (MYPFNGLGENVERTEXARRAYSPROC)neoGetProcAddress("glGenVertexArrays");
+    glBindVertexArray_           = (MYPFNGLBINDVERTEXARRAYPROC)neoGetProcAddress("glBindVertexArray");
+    glDeleteProgram_             = (MYPFNGLDELETEPROGRAMPROC)neoGetProcAddress("glDeleteProgram");
+    glDeleteBuffers_             = (MYPFNGLDELETEBUFFERSPROC)neoGetProcAddress("glDeleteBuffers");
+    glDeleteVertexArrays_        = (MYPFNGLDELETEVERTEXARRAYSPROC)neoGetProcAddress("glDeleteVertexArrays");
+    glUniform1i_                 = (MYPFNGLUNIFORM1IPROC)neoGetProcAddress("glUniform1i");
+    glUniform2i_                 = (MYPFNGLUNIFORM2IPROC)neoGetProcAddress("glUniform2i");
+    glUniform1f_                 = (MYPFNGLUNIFORM1FPROC)neoGetProcAddress("glUniform1f");
+    glUniform2f_                 = (MYPFNGLUNIFORM2FPROC)neoGetProcAddress("glUniform2f");
+    glUniform2fv_                = (MYPFNGLUNIFORM2FVPROC)neoGetProcAddress("glUniform2fv");
+    glUniform3fv_                = (MYPFNGLUNIFORM3FVPROC)neoGetProcAddress("glUniform3fv");
+    glUniform4fv_                = (MYPFNGLUNIFORM4FVPROC)neoGetProcAddress("glUniform4fv");
+    glUniformMatrix3x4fv_        = (MYPFNGLUNIFORMMATRIX3X4FVPROC)neoGetProcAddress("glUniformMatrix3x4fv");
+    glGenerateMipmap_            = (MYPFNGLGENERATEMIPMAPPROC)neoGetProcAddress("glGenerateMipmap");
+    glDeleteShader_              = (MYPFNGLDELETESHADERPROC)neoGetProcAddress("glDeleteShader");
+    glGetShaderiv_               = (MYPFNGLGETSHADERIVPROC)neoGetProcAddress("glGetShaderiv");
+    glGetProgramiv_              = (MYPFNGLGETPROGRAMIVPROC)neoGetProcAddress("glGetProgramiv");
+    glGetShaderInfoLog_          = (MYPFNGLGETSHADERINFOLOGPROC)neoGetProcAddress("glGetShaderInfoLog");
+    glActiveTexture_             = (MYPFNGLACTIVETEXTUREPROC)neoGetProcAddress("glActiveTexture");
+    glGenFramebuffers_           = (MYPFNGLGENFRAMEBUFFERSPROC)neoGetProcAddress("glGenFramebuffers");
+    glBindFramebuffer_           = (MYPFNGLBINDFRAMEBUFFERPROC)neoGetProcAddress("glBindFramebuffer");
+    glFramebufferTexture2D_      = (MYPFNGLFRAMEBUFFERTEXTURE2DPROC)neoGetProcAddress("glFramebufferTexture2D");
+    glDrawBuffers_               = (MYPFNGLDRAWBUFFERSPROC)neoGetProcAddress("glDrawBuffers");
+    glCheckFramebufferStatus_    = (MYPFNGLCHECKFRAMEBUFFERSTATUSPROC)neoGetProcAddress("glCheckFramebufferStatus");
+    glDeleteFramebuffers_        = (MYPFNGLDELETEFRAMEBUFFERSPROC)neoGetProcAddress("glDeleteFramebuffers");
+    glClear_                     = (MYPFNGLCLEARPROC)neoGetProcAddress("glClear");
+    glClearColor_                = (MYPFNGLCLEARCOLORPROC)neoGetProcAddress("glClearColor");
+    glFrontFace_                 = (MYPFNGLFRONTFACEPROC)neoGetProcAddress("glFrontFace");
+    glCullFace_                  = (MYPFNGLCULLFACEPROC)neoGetProcAddress("glCullFace");
+    glEnable_                    = (MYPFNGLENABLEPROC)neoGetProcAddress("glEnable");
+    glDisable_                   = (MYPFNGLDISABLEPROC)neoGetProcAddress("glDisable");
+    glDrawElements_              = (MYPFNGLDRAWELEMENTSPROC)neoGetProcAddress("glDrawElements");
+    glDepthMask_                 = (MYPFNGLDEPTHMASKPROC)neoGetProcAddress("glDepthMask");
+    glBindTexture_               = (MYPFNGLBINDTEXTUREPROC)neoGetProcAddress("glBindTexture");
+    glTexImage2D_                = (MYPFNGLTEXIMAGE2DPROC)neoGetProcAddress("glTexImage2D");
+    glDeleteTextures_            = (MYPFNGLDELETETEXTURESPROC)neoGetProcAddress("glDeleteTextures");
+    glGenTextures_               = (MYPFNGLGENTEXTURESPROC)neoGetProcAddress("glGenTextures");
+    glTexParameterf_             = (MYPFNGLTEXPARAMETERFPROC)neoGetProcAddress("glTexParameterf");
+    glTexParameteri_             = (MYPFNGLTEXPARAMETERIPROC)neoGetProcAddress("glTexParameteri");
+    glDrawArrays_                = (MYPFNGLDRAWARRAYSPROC)neoGetProcAddress("glDrawArrays");
+    glBlendEquation_             = (MYPFNGLBLENDEQUATIONPROC)neoGetProcAddress("glBlendEquation");
+    glBlendFunc_                 = (MYPFNGLBLENDFUNCPROC)neoGetProcAddress("glBlendFunc");
+    glDepthFunc_                 = (MYPFNGLDEPTHFUNCPROC)neoGetProcAddress("glDepthFunc");
+    glColorMask_                 = (MYPFNGLCOLORMASKPROC)neoGetProcAddress("glColorMask");
+    glReadPixels_                = (MYPFNGLREADPIXELSPROC)neoGetProcAddress("glReadPixels");
+    glViewport_                  = (MYPFNGLVIEWPORTPROC)neoGetProcAddress("glViewport");
+    glGetIntegerv_               = (MYPFNGLGETINTEGERVPROC)neoGetProcAddress("glGetIntegerv");
+    glGetString_                 = (MYPFNGLGETSTRINGPROC)neoGetProcAddress("glGetString");
+    glGetStringi_                = (MYPFNGLGETSTRINGIPROC)neoGetProcAddress("glGetStringi");
+    glGetFloatv_                 = (MYPFNGLGETFLOATVPROC)neoGetProcAddress("glGetFloatv");
+    glGetError_                  = (MYPFNGLGETERRORPROC)neoGetProcAddress("glGetError");
+    glGetTexLevelParameteriv_    = (MYPFNGLGETTEXLEVELPARAMETERIVPROC)neoGetProcAddress("glGetTexLevelParameteriv");
+    glGetCompressedTexImage_     = (MYPFNGLGETCOMPRESSEDTEXIMAGEPROC)neoGetProcAddress("glGetCompressedTexImage");
+    glCompressedTexImage2D_      = (MYPFNGLCOMPRESSEDTEXIMAGE2DPROC)neoGetProcAddress("glCompressedTexImage2D");
+    glPixelStorei_               = (MYPFNGLPIXELSTOREIPROC)neoGetProcAddress("glPixelStorei");
+    glScissor_                   = (MYPFNGLSCISSORPROC)neoGetProcAddress("glScissor");
+    glPolygonMode_               = (MYPFNGLPOLYGONMODEPROC)neoGetProcAddress("glPolygonMode");
+    glHint_                      = (MYPFNGLHINTPROC)neoGetProcAddress("glHint");
+    glGenQueries_                = (MYPFNGLGENQUERIESPROC)neoGetProcAddress("glGenQueries");
+    glBeginQuery_                = (MYPFNGLBEGINQUERYPROC)neoGetProcAddress("glBeginQuery");
+    glEndQuery_                  = (MYPFNGLENDQUERYPROC)neoGetProcAddress("glEndQuery");
+    glDeleteQueries_             = (MYPFNGLDELETEQUERIESPROC)neoGetProcAddress("glDeleteQueries");
+    glGetQueryObjectuiv_         = (MYPFNGLGETQUERYOBJECTUIVPROC)neoGetProcAddress("glGetQueryObjectuiv");
+    glFlush_                     = (MYPFNGLFLUSHPROC)neoGetProcAddress("glFlush");
+    glStencilFunc_               = (MYPFNGLSTENCILFUNCPROC)neoGetProcAddress("glStencilFunc");
+    glStencilOp_                 = (MYPFNGLSTENCILOPPROC)neoGetProcAddress("glStencilOp");
+    glTexImage3D_                = (MYPFNGLTEXIMAGE3DPROC)neoGetProcAddress("glTexImage3D");
+    glTexSubImage3D_             = (MYPFNGLTEXSUBIMAGE3DPROC)neoGetProcAddress("glTexSubImage3D");
+    glGetProgramInfoLog_         = (MYPFNGLGETPROGRAMINFOLOGPROC)neoGetProcAddress("glGetProgramInfoLog");
+    glBindAttribLocation_        = (MYPFNGLBINDATTRIBLOCATIONPROC)neoGetProcAddress("glBindAttribLocation");
+    glBindFragDataLocation_      = (MYPFNGLBINDFRAGDATALOCATIONPROC)neoGetProcAddress("glBindFragDataLocation");
+    glTexSubImage2D_             = (MYPFNGLTEXSUBIMAGE2DPROC)neoGetProcAddress("glTexSubImage2D");
+    glDrawBuffer_                = (MYPFNGLDRAWBUFFERPROC)neoGetProcAddress("glDrawBuffer");
+    glReadBuffer_                = (MYPFNGLREADBUFFERPROC)neoGetProcAddress("glReadBuffer");
+    glBufferSubData_             = (MYPFNGLBUFFERSUBDATAPROC)neoGetProcAddress("glBufferSubData");
+    glPolygonOffset_             = (MYPFNGLPOLYGONOFFSETPROC)neoGetProcAddress("glPolygonOffset");
+    glDepthRange_                = (MYPFNGLDEPTHRANGEPROC)neoGetProcAddress("glDepthRange");
+    glProgramParameteri_         = (MYPFNGLPROGRAMPARAMETERIPROC)neoGetProcAddress("glProgramParameteri");
+    glGetProgramBinary_          = (MYPFNGLGETPROGRAMBINARYPROC)neoGetProcAddress("glGetProgramBinary");
+    glProgramBinary_             = (MYPFNGLPROGRAMBINARYPROC)neoGetProcAddress("glProgramBinary");
+    glBindBufferBase_            = (MYPFNGLBINDBUFFERBASEPROC)neoGetProcAddress("glBindBufferBase");
+    glBindBufferRange_           = (MYPFNGLBINDBUFFERRANGEPROC)neoGetProcAddress("glBindBufferRange");
+    glGetUniformBlockIndex_      = (MYPFNGLGETUNIFORMBLOCKINDEXPROC)neoGetProcAddress("glGetUniformBlockIndex");
+    glUniformBlockBinding_       = (MYPFNGLUNIFORMBLOCKBINDINGPROC)neoGetProcAddress("glUniformBlockBinding");
+    glMapBufferRange_            = (MYPFNGLMAPBUFFERRANGEPROC)neoGetProcAddress("glMapBufferRange");
+    glUnmapBuffer_               = (MYPFNGLUNMAPBUFFERPROC)neoGetProcAddress("glUnmapBuffer");
+    glBufferStorage_             = (MYPFNGLBUFFERSTORAGEPROC)neoGetProcAddress("glBufferStorage");
+    glFenceSync_                 = (MYPFNGLFENCESYNCPROC)neoGetProcAddress("glFenceSync");
+    glClientWaitSync_            = (MYPFNGLCLIENTWAITSYNCPROC)neoGetProcAddress("glClientWaitSync");
+    glDeleteSync_                = (MYPFNGLDELETESYNCPROC)neoGetProcAddress("glDeleteSync");
+    glDrawElementsInstanced_     = (MYPFNGLDRAWELEMENTSINSTANCEDPROC)neoGetProcAddress("glDrawElementsInstanced");
+    glVertexAttribDivisor_       = (MYPFNGLVERTEXATTRIBDIVISORPROC)neoGetProcAddress("glVertexAttribDivisor");
+    glMultiDrawElementsIndirect_ = (MYPFNGLMULTIDRAWELEMENTSINDIRECTPROC)neoGetProcAddress("glMultiDrawElementsIndirect");
+    glTexStorage3D_              = (MYPFNGLTEXSTORAGE3DPROC)neoGetProcAddress("glTexStorage3D");
+    glCopyImageSubData_          = (MYPFNGLCOPYIMAGESUBDATAPROC)neoGetProcAddress("glCopyImageSubData");
+
+    if (!glGetIntegerv_ || !glGetStringi_)
+        neoFatal("Failed to initialize OpenGL\n");
+
+    GLint count = 0;
+    glGetIntegerv_(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        for (size_t j = 0; j < sizeof(kExtensions)/sizeof(*kExtensions); j++)
+            if (!strcmp(kExtensions[j], (const char *)glGetStringi_(GL_EXTENSIONS, i)))
+                gExtensions.insert(j);
+
+    auto &aniso = c::Console::value<int>("r_aniso");
+    if (has(gl::EXT_texture_filter_anisotropic)) {
+        float largest;
+        glGetFloatv_(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest);
+        aniso.setMax(int(largest));
+    } else {
+        aniso.setMax(0);
+    }
+
+    static constexpr int kGLSLVersions[] = {
+        130, 140, 150, 330
+    };
+
+    for (auto &it : kGLSLVersions) {
+        const u::string source = u::format("#version %d\nvoid main() { }\n", it);
+        const char *sources[1] = { source.c_str() };
+        GLuint s = glCreateShader_(GL_VERTEX_SHADER);
+        glShaderSource_(s, 1, sources, nullptr);
+        glCompileShader_(s);
+        GLint compiled = 0;
+        glGetShaderiv_(s, GL_COMPILE_STATUS, &compiled);
+        if (compiled) {
+            gGLSLVersion = it;
+            break;
+        }
+    }
+
+    if (gGLSLVersion == -1)
+        neoFatal("Failed to initialize OpenGL\n");
+
+#if defined(DEBUG_GL)
+    if (has(gl::ARB_debug_output)) {
+        glEnable_(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+        ((MYPFNGLDEBUGMESSAGECALLBACKARBPROC)neoGetProcAddress("glDebugMessageCallbackARB"))(&debugCallback, nullptr);
+    }
+#endif
+}
+
+
+GLuint CreateShader(GLenum shaderType GL_INFOP) {
+    GLuint result = glCreateShader_(shaderType);
+    GL_CHECK("2", shaderType);
+    if (gCapturing)
+        captureCreateShader(shaderType, result);
+    return result;
+}
+
+void ShaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length GL_INFOP) {
+    glShaderSource_(shader, count, string, length);
+    GL_CHECK("b8*0*7", shader, count, string, length);
+    if (gCapturing)
+        captureShaderSource(shader, count, string, length);
+}
+
+void CompileShader(GLuint shader GL_INFOP) {
+    glCompileShader_(shader);
+    GL_CHECK("b", shader);
+    if (gCapturing)
+        captureCompileShader(shader);
+}
+
+void AttachShader(GLuint program, GLuint shader GL_INFOP) {
+    glAttachShader_(program, shader);
+    GL_CHECK("bb", program, shader);
+    if (gCapturing)
+        captureAttachShader(program, shader);
+}
+
+GLuint CreateProgram(GL_INFO) {
+    GLuint result = glCreateProgram_();
+    GL_CHECK("",0);
+    if (gCapturing)
+        captureCreateProgram(result);
+    return result;
+}
+
+void LinkProgram(GLuint program GL_INFOP) {
+    glLinkProgram_(program);
+    GL_CHECK("b", program);
+    if (gCapturing)
+        captureLinkProgram(program);
+}
+
+void UseProgram(GLuint program GL_INFOP) {
+    if (stateUseProgram(program))
+        return;
+    glUseProgram_(program);
+    gCounters->programs++;
+    GL_CHECK("b", program);
+    if (gCapturing)
+        captureUseProgram(program);
+}
+
+GLint GetUniformLocation(GLuint program, const GLchar* name GL_INFOP) {
+    GLint result = glGetUniformLocation_(program, name);
+    GL_CHECK("b*1", program, name);
+    if (gCapturing)
+        captureGetUniformLocation(program, name, result);
+    return result;
+}
+
+void EnableVertexAttribArray(GLuint index GL_INFOP) {
+    glEnableVertexAttribArray_(index);
+    GL_CHECK("b", index);
+    if (gCapturing)
+        captureEnableVertexAttribArray(index);
+}
+
+void DisableVertexAttribArray(GLuint index GL_INFOP) {
+    glDisableVertexAttribArray_(index);
+    GL_CHECK("b", index);
+    if (gCapturing)
+        captureDisableVertexAttribArray(index);
+}
+
+void UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value GL_INFOP) {
+    glUniformMatrix4fv_(location, count, transpose, value);
+    gCounters->uniforms++;
+    GL_CHECK("783*c", location, count, transpose, value);
+    if (gCapturing)
+        captureUniformMatrix4fv(location, count, transpose, value);
+}
+
+void BindBuffer(GLenum target, GLuint buffer GL_INFOP) {
+    if (stateBindBuffer(target, buffer))
+        return;
+    glBindBuffer_(target, buffer);
+    GL_CHECK("2b", target, buffer);
+    if (gCapturing)
+        captureBindBuffer(target, buffer);
+}
+
+void GenBuffers(GLsizei n, GLuint* buffers GL_INFOP) {
+    glGenBuffers_(n, buffers);
+    GL_CHECK("8*b", n, buffers);
+    if (gCapturing)
+        captureGenBuffers(n, buffers);
+}
+
+void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer GL_INFOP) {
+    glVertexAttribPointer_(index, size, type, normalized, stride, pointer);
+    GL_CHECK("b7238*0", index, size, type, normalized, stride, pointer);
+    if (gCapturing)
+        captureVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void BufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage GL_INFOP) {
+    glBufferData_(target, size, data, usage);
+    if (data)
+        gCounters->streamed += size;
+    GL_CHECK("2f*02", target, size, data, usage);
+    if (gCapturing)
+        captureBufferData(target, size, data, usage);
+}
+
+void ValidateProgram(GLuint program GL_INFOP) {
+    glValidateProgram_(program);
+    GL_CHECK("b", program);
+    if (gCapturing)
+        captureValidateProgram(program);
+}
+
+void GenVertexArrays(GLsizei n, GLuint* arrays GL_INFOP) {
+    glGenVertexArrays_(n, arrays);
+    GL_CHECK("8*b", n, arrays);
+    if (gCapturing)
+        captureGenVertexArrays(n, arrays);
+}
+
+void BindVertexArray(GLuint array GL_INFOP) {
+    glBindVertexArray_(array);
+    stateBindVertexArray(array);
+    GL_CHECK("b", array);
+    if (gCapturing)
+        captureBindVertexArray(array);
+}
+
+void DeleteProgram(GLuint program GL_INFOP) {
+    glDeleteProgram_(program);
+    stateDeleteProgram(program);
+    GL_CHECK("b", program);
+    if (gCapturing)
+        captureDeleteProgram(program);
+}
+
+void DeleteBuffers(GLsizei n, const GLuint* buffers GL_INFOP) {
+    glDeleteBuffers_(n, buffers);
+    stateDeleteBuffers(n, buffers);
+    GL_CHECK("8*b", n, buffers);
+    if (gCapturing)
+        captureDeleteBuffers(n, buffers);
+}
+
+void DeleteVertexArrays(GLsizei n, const GLuint* arrays GL_INFOP) {
+    glDeleteVertexArrays_(n, arrays);
+    stateDeleteVertexArrays(n, arrays);
+    GL_CHECK("8*b", n, arrays);
+    if (gCapturing)
+        captureDeleteVertexArrays(n, arrays);
+}
+
+void Uniform1i(GLint location, GLint v0 GL_INFOP) {
+    glUniform1i_(location, v0);
+    gCounters->uniforms++;
+    GL_CHECK("77", location, v0);
+    if (gCapturing)
+        captureUniform1i(location, v0);
+}
+
+void Uniform2i(GLint location, GLint v0, GLint v1 GL_INFOP) {
+    glUniform2i_(location, v0, v1);
+    gCounters->uniforms++;
+    GL_CHECK("777", location, v0, v1);
+    if (gCapturing)
+        captureUniform2i(location, v0, v1);
+}
+
+void Uniform1f(GLint location, GLfloat v0 GL_INFOP) {
+    glUniform1f_(location, v0);
+    gCounters->uniforms++;
+    GL_CHECK("7c", location, v0);
+    if (gCapturing)
+        captureUniform1f(location, v0);
+}
+
+void Uniform2f(GLint location, GLfloat v0, GLfloat v1 GL_INFOP) {
+    glUniform2f_(location, v0, v1);
+    gCounters->uniforms++;
+    GL_CHECK("7cc", location, v0, v1);
+    if (gCapturing)
+        captureUniform2f(location, v0, v1);
+}
+
+void Uniform2fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
+    glUniform2fv_(location, count, value);
+    gCounters->uniforms++;
+    GL_CHECK("78*c", location, count, value);
+    if (gCapturing)
+        captureUniform2fv(location, count, value);
+}
+
+void Uniform3fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
+    glUniform3fv_(location, count, value);
+    gCounters->uniforms++;
+    GL_CHECK("78*c", location, count, value);
+    if (gCapturing)
+        captureUniform3fv(location, count, value);
+}
+
+void Uniform4fv(GLint location, GLsizei count, const GLfloat* value GL_INFOP) {
+    glUniform4fv_(location, count, value);
+    gCounters->uniforms++;
+    GL_CHECK("78*c", location, count, value);
+    if (gCapturing)
+        captureUniform4fv(location, count, value);
+}
+
+void UniformMatrix3x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value GL_INFOP) {
+    glUniformMatrix3x4fv_(location, count, transpose, value);
+    gCounters->uniforms++;
+    GL_CHECK("783*c", location, count, transpose, value);
+    if (gCapturing)
+        captureUniformMatrix3x4fv(location, count, transpose, value);
+}
+
+void GenerateMipmap(GLenum target GL_INFOP) {
+    glGenerateMipmap_(target);
+    GL_CHECK("2", target);
+    if (gCapturing)
+        captureGenerateMipmap(target);
+}
+
+void DeleteShader(GLuint shader GL_INFOP) {
+    glDeleteShader_(shader);
+    GL_CHECK("b", shader);
+    if (gCapturing)
+        captureDeleteShader(shader);
+}
+
+void GetShaderiv(GLuint shader, GLenum pname, GLint* params GL_INFOP) {
+    glGetShaderiv_(shader, pname, params);
+    GL_CHECK("b2*7", shader, pname, params);
+    if (gCapturing)
+        captureGetShaderiv(shader, pname, params);
+}
+
+void GetProgramiv(GLuint program, GLenum pname, GLint* params GL_INFOP) {
+    glGetProgramiv_(program, pname, params);
+    GL_CHECK("b2*7", program, pname, params);
+    if (gCapturing)
+        captureGetProgramiv(program, pname, params);
+}
+
+void GetShaderInfoLog(GLuint shader, GLsizei maxLength, GLsizei* length, GLchar* infoLog GL_INFOP) {
+    glGetShaderInfoLog_(shader, maxLength, length, infoLog);
+    GL_CHECK("b8*8*1", shader, maxLength, length, infoLog);
+    if (gCapturing)
+        captureGetShaderInfoLog(shader, maxLength, length, infoLog);
+}
+
+void ActiveTexture(GLenum texture GL_INFOP) {
+    if (stateActiveTexture(texture))
+        return;
+    glActiveTexture_(texture);
+    GL_CHECK("2", texture);
+    if (gCapturing)
+        captureActiveTexture(texture);
+}
+
+void GenFramebuffers(GLsizei n, GLuint* ids GL_INFOP) {
+    glGenFramebuffers_(n, ids);
+    GL_CHECK("8*b", n, ids);
+    if (gCapturing)
+        captureGenFramebuffers(n, ids);
+}
+
+void BindFramebuffer(GLenum target, GLuint framebuffer GL_INFOP) {
+    glBindFramebuffer_(target, framebuffer);
+    GL_CHECK("2b", target, framebuffer);
+    if (gCapturing)
+        captureBindFramebuffer(target, framebuffer);
+}
+
+void FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level GL_INFOP) {
+    glFramebufferTexture2D_(target, attachment, textarget, texture, level);
+    GL_CHECK("222b7", target, attachment, textarget, texture, level);
+    if (gCapturing)
+        captureFramebufferTexture2D(target, attachment, textarget, texture, level);
+}
+
+void DrawBuffers(GLsizei n, const GLenum* bufs GL_INFOP) {
+    glDrawBuffers_(n, bufs);
+    GL_CHECK("8*2", n, bufs);
+    if (gCapturing)
+        captureDrawBuffers(n, bufs);
+}
+
+GLenum CheckFramebufferStatus(GLenum target GL_INFOP) {
+    GLenum result = glCheckFramebufferStatus_(target);
+    GL_CHECK("2", target);
+    if (gCapturing)
+        captureCheckFramebufferStatus(target, result);
+    return result;
+}
+
+void DeleteFramebuffers(GLsizei n, const GLuint* framebuffers GL_INFOP) {
+    glDeleteFramebuffers_(n, framebuffers);
+    GL_CHECK("8*b", n, framebuffers);
+    if (gCapturing)
+        captureDeleteFramebuffers(n, framebuffers);
+}
+
+void Clear(GLbitfield mask GL_INFOP) {
+    glClear_(mask);
+    GL_CHECK("4", mask);
+    if (gCapturing)
+        captureClear(mask);
+}
+
+void ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha GL_INFOP) {
+    glClearColor_(red, green, blue, alpha);
+    GL_CHECK("cccc", red, green, blue, alpha);
+    if (gCapturing)
+        captureClearColor(red, green, blue, alpha);
+}
+
+void FrontFace(GLenum mode GL_INFOP) {
+    glFrontFace_(mode);
+    GL_CHECK("2", mode);
+    if (gCapturing)
+        captureFrontFace(mode);
+}
+
+void CullFace(GLenum mode GL_INFOP) {
+    glCullFace_(mode);
+    GL_CHECK("2", mode);
+    if (gCapturing)
+        captureCullFace(mode);
+}
+
+void Enable(GLenum cap GL_INFOP) {
+    if (stateEnable(cap))
+        return;
+    glEnable_(cap);
+    GL_CHECK("2", cap);
+    if (gCapturing)
+        captureEnable(cap);
+}
+
+void Disable(GLenum cap GL_INFOP) {
+    if (stateDisable(cap))
+        return;
+    glDisable_(cap);
+    GL_CHECK("2", cap);
+    if (gCapturing)
+        captureDisable(cap);
+}
+
+void DrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices GL_INFOP) {
+    glDrawElements_(mode, count, type, indices);
+    countDraw(mode, count);
+    GL_CHECK("282*0", mode, count, type, indices);
+    if (gCapturing)
+        captureDrawElements(mode, count, type, indices);
+}
+
+void DepthMask(GLboolean flag GL_INFOP) {
+    glDepthMask_(flag);
+    GL_CHECK("3", flag);
+    if (gCapturing)
+        captureDepthMask(flag);
+}
+
+void BindTexture(GLenum target, GLuint texture GL_INFOP) {
+    if (stateBindTexture(target, texture))
+        return;
+    glBindTexture_(target, texture);
+    gCounters->textures++;
+    GL_CHECK("2b", target, texture);
+    if (gCapturing)
+        captureBindTexture(target, texture);
+}
+
+void TexImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
+    glTexImage2D_(target, level, internalFormat, width, height, border, format, type, data);
+    GL_CHECK("27788722*0", target, level, internalFormat, width, height, border, format, type, data);
+    if (gCapturing)
+        captureTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+}
+
+void DeleteTextures(GLsizei n, const GLuint* textures GL_INFOP) {
+    glDeleteTextures_(n, textures);
+    stateDeleteTextures(n, textures);
+    GL_CHECK("8*b", n, textures);
+    if (gCapturing)
+        captureDeleteTextures(n, textures);
+}
+
+void GenTextures(GLsizei n, GLuint* textures GL_INFOP) {
+    glGenTextures_(n, textures);
+    GL_CHECK("8*b", n, textures);
+    if (gCapturing)
+        captureGenTextures(n, textures);
+}
+
+void TexParameterf(GLenum target, GLenum pname, GLfloat param GL_INFOP) {
+    glTexParameterf_(target, pname, param);
+    GL_CHECK("22c", target, pname, param);
+    if (gCapturing)
+        captureTexParameterf(target, pname, param);
+}
+
+void TexParameteri(GLenum target, GLenum pname, GLint param GL_INFOP) {
+    glTexParameteri_(target, pname, param);
+    GL_CHECK("227", target, pname, param);
+    if (gCapturing)
+        captureTexParameteri(target, pname, param);
+}
+
+void DrawArrays(GLenum mode, GLint first, GLsizei count GL_INFOP) {
+    glDrawArrays_(mode, first, count);
+    countDraw(mode, count);
+    GL_CHECK("278", mode, first, count);
+    if (gCapturing)
+        captureDrawArrays(mode, first, count);
+}
+
+void BlendEquation(GLenum mode GL_INFOP) {
+    glBlendEquation_(mode);
+    GL_CHECK("2", mode);
+    if (gCapturing)
+        captureBlendEquation(mode);
+}
+
+void BlendFunc(GLenum sfactor, GLenum dfactor GL_INFOP) {
+    if (stateBlendFunc(sfactor, dfactor))
+        return;
+    glBlendFunc_(sfactor, dfactor);
+    GL_CHECK("22", sfactor, dfactor);
+    if (gCapturing)
+        captureBlendFunc(sfactor, dfactor);
+}
+
+void DepthFunc(GLenum func GL_INFOP) {
+    glDepthFunc_(func);
+    GL_CHECK("2", func);
+    if (gCapturing)
+        captureDepthFunc(func);
+}
+
+void ColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha GL_INFOP) {
+    glColorMask_(red, green, blue, alpha);
+    GL_CHECK("3333", red, green, blue, alpha);
+    if (gCapturing)
+        captureColorMask(red, green, blue, alpha);
+}
+
+void ReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid* data GL_INFOP) {
+    glReadPixels_(x, y, width, height, format, type, data);
+    GL_CHECK("778822*0", x, y, width, height, format, type, data);
+    if (gCapturing)
+        captureReadPixels(x, y, width, height, format, type, data);
+}
+
+void Viewport(GLint x, GLint y, GLsizei width, GLsizei height GL_INFOP) {
+    glViewport_(x, y, width, height);
+    GL_CHECK("7788", x, y, width, height);
+    if (gCapturing)
+        captureViewport(x, y, width, height);
+}
+
+void GetIntegerv(GLenum pname, GLint* data GL_INFOP) {
+    glGetIntegerv_(pname, data);
+    GL_CHECK("2*7", pname, data);
+    if (gCapturing)
+        captureGetIntegerv(pname, data);
+}
+
+const GLubyte* GetString(GLenum name GL_INFOP) {
+    const GLubyte* result = glGetString_(name);
+    GL_CHECK("2", name);
+    if (gCapturing)
+        captureGetString(name);
+    return result;
+}
+
+const GLubyte* GetStringi(GLenum name, GLuint index GL_INFOP) {
+    const GLubyte* result = glGetStringi_(name, index);
+    GL_CHECK("2b", name, index);
+    if (gCapturing)
+        captureGetStringi(name, index);
+    return result;
+}
+
+void GetFloatv(GLenum pname, GLfloat* params GL_INFOP) {
+    glGetFloatv_(pname, params);
+    GL_CHECK("2*c", pname, params);
+    if (gCapturing)
+        captureGetFloatv(pname, params);
+}
+
+GLenum GetError(GL_INFO) {
+    GLenum result = glGetError_();
+    GL_CHECK("",0);
+    if (gCapturing)
+        captureGetError(result);
+    return result;
+}
+
+void GetTexLevelParameteriv(GLenum target, GLint level, GLenum pname, GLint* params GL_INFOP) {
+    glGetTexLevelParameteriv_(target, level, pname, params);
+    GL_CHECK("272*7", target, level, pname, params);
+    if (gCapturing)
+        captureGetTexLevelParameteriv(target, level, pname, params);
+}
+
+void GetCompressedTexImage(GLenum target, GLint lod, GLvoid* img GL_INFOP) {
+    glGetCompressedTexImage_(target, lod, img);
+    GL_CHECK("27*0", target, lod, img);
+    if (gCapturing)
+        captureGetCompressedTexImage(target, lod, img);
+}
+
+void CompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid* data GL_INFOP) {
+    glCompressedTexImage2D_(target, level, internalformat, width, height, border, imageSize, data);
+    GL_CHECK("2728878*0", target, level, internalformat, width, height, border, imageSize, data);
+    if (gCapturing)
+        captureCompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+}
+
+void PixelStorei(GLenum pname, GLint param GL_INFOP) {
+    glPixelStorei_(pname, param);
+    GL_CHECK("27", pname, param);
+    if (gCapturing)
+        capturePixelStorei(pname, param);
+}
+
+void Scissor(GLint x, GLint y, GLsizei width, GLsizei height GL_INFOP) {
+    glScissor_(x, y, width, height);
+    GL_CHECK("7788", x, y, width, height);
+    if (gCapturing)
+        captureScissor(x, y, width, height);
+}
+
+void PolygonMode(GLenum face, GLenum mode GL_INFOP) {
+    glPolygonMode_(face, mode);
+    GL_CHECK("22", face, mode);
+    if (gCapturing)
+        capturePolygonMode(face, mode);
+}
+
+void Hint(GLenum target, GLenum mode GL_INFOP) {
+    glHint_(target, mode);
+    GL_CHECK("22", target, mode);
+    if (gCapturing)
+        captureHint(target, mode);
+}
+
+void GenQueries(GLsizei n, GLuint* ids GL_INFOP) {
+    glGenQueries_(n, ids);
+    GL_CHECK("8*b", n, ids);
+    if (gCapturing)
+        captureGenQueries(n, ids);
+}
+
+void BeginQuery(GLenum target, GLuint id GL_INFOP) {
+    glBeginQuery_(target, id);
+    GL_CHECK("2b", target, id);
+    if (gCapturing)
+        captureBeginQuery(target, id);
+}
+
+void EndQuery(GLenum target, GLuint id GL_INFOP) {
+    glEndQuery_(target, id);
+    GL_CHECK("2b", target, id);
+    if (gCapturing)
+        captureEndQuery(target, id);
+}
+
+void DeleteQueries(GLsizei n, const GLuint* ids GL_INFOP) {
+    glDeleteQueries_(n, ids);
+    GL_CHECK("8*b", n, ids);
+    if (gCapturing)
+        captureDeleteQueries(n, ids);
+}
+
+void GetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params GL_INFOP) {
+    glGetQueryObjectuiv_(id, pname, params);
+    GL_CHECK("b2*b", id, pname, params);
+    if (gCapturing)
+        captureGetQueryObjectuiv(id, pname, params);
+}
+
+void Flush(GL_INFO) {
+    glFlush_();
+    GL_CHECK("",0);
+    if (gCapturing)
+        captureFlush();
+}
+
+void StencilFunc(GLenum func, GLint ref, GLuint mask GL_INFOP) {
+    glStencilFunc_(func, ref, mask);
+    GL_CHECK("27b", func, ref, mask);
+    if (gCapturing)
+        captureStencilFunc(func, ref, mask);
+}
+
+void StencilOp(GLenum sfail, GLenum dpfail, GLenum dppass GL_INFOP) {
+    glStencilOp_(sfail, dpfail, dppass);
+    GL_CHECK("222", sfail, dpfail, dppass);
+    if (gCapturing)
+        captureStencilOp(sfail, dpfail, dppass);
+}
+
+void TexImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
+    glTexImage3D_(target, level, internalFormat, width, height, depth, border, format, type, data);
+    GL_CHECK("277888722*0", target, level, internalFormat, width, height, depth, border, format, type, data);
+    if (gCapturing)
+        captureTexImage3D(target, level, internalFormat, width, height, depth, border, format, type, data);
+}
+
+void TexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const GLvoid * data GL_INFOP) {
+    glTexSubImage3D_(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+    GL_CHECK("2777788822*0", target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+    if (gCapturing)
+        captureTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+}
+
+void GetProgramInfoLog(GLuint program, GLsizei maxLength, GLsizei* length, GLchar* infoLog GL_INFOP) {
+    glGetProgramInfoLog_(program, maxLength, length, infoLog);
+    GL_CHECK("b8*8*1", program, maxLength, length, infoLog);
+    if (gCapturing)
+        captureGetProgramInfoLog(program, maxLength, length, infoLog);
+}
+
+void BindAttribLocation(GLuint program, GLuint index, const GLchar* name GL_INFOP) {
+    glBindAttribLocation_(program, index, name);
+    GL_CHECK("bb*1", program, index, name);
+    if (gCapturing)
+        captureBindAttribLocation(program, index, name);
+}
+
+void BindFragDataLocation(GLuint program, GLuint colorNumber, const GLchar* name GL_INFOP) {
+    glBindFragDataLocation_(program, colorNumber, name);
+    GL_CHECK("bb*1", program, colorNumber, name);
+    if (gCapturing)
+        captureBindFragDataLocation(program, colorNumber, name);
+}
+
+void TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid* data GL_INFOP) {
+    glTexSubImage2D_(target, level, xoffset, yoffset, width, height, format, type, data);
+    GL_CHECK("27778822*0", target, level, xoffset, yoffset, width, height, format, type, data);
+    if (gCapturing)
+        captureTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, data);
+}
+
+void DrawBuffer(GLenum mode GL_INFOP) {
+    glDrawBuffer_(mode);
+    GL_CHECK("2", mode);
+    if (gCapturing)
+        captureDrawBuffer(mode);
+}
+
+void ReadBuffer(GLenum mode GL_INFOP) {
+    glReadBuffer_(mode);
+    GL_CHECK("2", mode);
+    if (gCapturing)
+        captureReadBuffer(mode);
+}
+
+void BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data GL_INFOP) {
+    glBufferSubData_(target, offset, size, data);
+    gCounters->streamed += size;
+    GL_CHECK("2ef*0", target, offset, size, data);
+    if (gCapturing)
+        captureBufferSubData(target, offset, size, data);
+}
+
+void PolygonOffset(GLfloat factor, GLfloat units GL_INFOP) {
+    glPolygonOffset_(factor, units);
+    GL_CHECK("cc", factor, units);
+    if (gCapturing)
+        capturePolygonOffset(factor, units);
+}
+
+void DepthRange(GLclampd nearVal, GLclampd farVal GL_INFOP) {
+    glDepthRange_(nearVal, farVal);
+    GL_CHECK("gg", nearVal, farVal);
+    if (gCapturing)
+        captureDepthRange(nearVal, farVal);
+}
+
+void ProgramParameteri(GLuint program, GLenum pname, GLint value GL_INFOP) {
+    glProgramParameteri_(program, pname, value);
+    GL_CHECK("b27", program, pname, value);
+    if (gCapturing)
+        captureProgramParameteri(program, pname, value);
+}
+
+void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, GLvoid* binary GL_INFOP) {
+    glGetProgramBinary_(program, bufSize, length, binaryFormat, binary);
+    GL_CHECK("b8*8*2*0", program, bufSize, length, binaryFormat, binary);
+    if (gCapturing)
+        captureGetProgramBinary(program, bufSize, length, binaryFormat, binary);
+}
+
+void ProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid* binary, GLsizei length GL_INFOP) {
+    glProgramBinary_(program, binaryFormat, binary, length);
+    GL_CHECK("b2*08", program, binaryFormat, binary, length);
+    if (gCapturing)
+        captureProgramBinary(program, binaryFormat, binary, length);
+}
+
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer GL_INFOP) {
+    if (stateBindBufferBase(target, index, buffer))
+        return;
+    glBindBufferBase_(target, index, buffer);
+    GL_CHECK("2bb", target, index, buffer);
+    if (gCapturing)
+        captureBindBufferBase(target, index, buffer);
+}
+
+void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size GL_INFOP) {
+    if (stateBindBufferRange(target, index, buffer, offset, size))
+        return;
+    glBindBufferRange_(target, index, buffer, offset, size);
+    GL_CHECK("2bbef", target, index, buffer, offset, size);
+    if (gCapturing)
+        captureBindBufferRange(target, index, buffer, offset, size);
+}
+
+GLuint GetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName GL_INFOP) {
+    GLuint result = glGetUniformBlockIndex_(program, uniformBlockName);
+    GL_CHECK("b*1", program, uniformBlockName);
+    if (gCapturing)
+        captureGetUniformBlockIndex(program, uniformBlockName, result);
+    return result;
+}
+
+void UniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding GL_INFOP) {
+    glUniformBlockBinding_(program, uniformBlockIndex, uniformBlockBinding);
+    GL_CHECK("bbb", program, uniformBlockIndex, uniformBlockBinding);
+    if (gCapturing)
+        captureUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access GL_INFOP) {
+    void* result = glMapBufferRange_(target, offset, length, access);
+    GL_CHECK("2ef4", target, offset, length, access);
+    if (gCapturing)
+        captureMapBufferRange(target, offset, length, access);
+    return result;
+}
+
+GLboolean UnmapBuffer(GLenum target GL_INFOP) {
+    GLboolean result = glUnmapBuffer_(target);
+    GL_CHECK("2", target);
+    if (gCapturing)
+        captureUnmapBuffer(target, result);
+    return result;
+}
+
+void BufferStorage(GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags GL_INFOP) {
+    glBufferStorage_(target, size, data, flags);
+    GL_CHECK("2f*04", target, size, data, flags);
+    if (gCapturing)
+        captureBufferStorage(target, size, data, flags);
+}
+
+GLsync FenceSync(GLenum condition, GLbitfield flags GL_INFOP) {
+    GLsync result = glFenceSync_(condition, flags);
+    GL_CHECK("24", condition, flags);
+    if (gCapturing)
+        captureFenceSync(condition, flags, result);
+    return result;
+}
+
+GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout GL_INFOP) {
+    GLenum result = glClientWaitSync_(sync, flags, timeout);
+    GL_CHECK("h4i", sync, flags, timeout);
+    if (gCapturing)
+        captureClientWaitSync(sync, flags, timeout, result);
+    return result;
+}
+
+void DeleteSync(GLsync sync GL_INFOP) {
+    glDeleteSync_(sync);
+    GL_CHECK("h", sync);
+    if (gCapturing)
+        captureDeleteSync(sync);
+}
+
+void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei primcount GL_INFOP) {
+    glDrawElementsInstanced_(mode, count, type, indices, primcount);
+    countDraw(mode, count, primcount);
+    GL_CHECK("282*08", mode, count, type, indices, primcount);
+    if (gCapturing)
+        captureDrawElementsInstanced(mode, count, type, indices, primcount);
+}
+
+void VertexAttribDivisor(GLuint index, GLuint divisor GL_INFOP) {
+    glVertexAttribDivisor_(index, divisor);
+    GL_CHECK("bb", index, divisor);
+    if (gCapturing)
+        captureVertexAttribDivisor(index, divisor);
+}
+
+void MultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid* indirect, GLsizei drawcount, GLsizei stride GL_INFOP) {
+    glMultiDrawElementsIndirect_(mode, type, indirect, drawcount, stride);
+    // the commands live in a buffer, their triangles can't be counted
+    gDrawCalls++;
+    gCounters->draws++;
+    GL_CHECK("22*088", mode, type, indirect, drawcount, stride);
+    if (gCapturing)
+        captureMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+}
+
+void TexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth GL_INFOP) {
+    glTexStorage3D_(target, levels, internalformat, width, height, depth);
+    GL_CHECK("282888", target, levels, internalformat, width, height, depth);
+    if (gCapturing)
+        captureTexStorage3D(target, levels, internalformat, width, height, depth);
+}
+
+void CopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth GL_INFOP) {
+    glCopyImageSubData_(srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
+    GL_CHECK("b27777b27777888", srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
+    if (gCapturing)
+        captureCopyImageSubData(srcName, srcTarget, srcLevel, srcX, srcY, srcZ, dstName, dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
+}
+
+enum {
+    kNameBuffer,
+    kNameVertexArray,
+    kNameTexture,
+    kNameFramebuffer,
+    kNameQuery,
+    kNameShader,
+    kNameProgram,
+    kNameCount
+};
+
+struct Replay {
+    u::vector<unsigned char> data;
+    size_t position;
+    // the names the replay created for the recorded ones
+    u::map<GLuint, GLuint> names[kNameCount];
+    u::map<uint64_t, GLint> locations;
+    u::map<uint64_t, GLuint> blocks;
+    u::map<uint64_t, GLsync> syncs;
+    u::vector<unsigned char> scratch[4];
+    u::vector<const GLchar *> strings;
+    GLuint program;
+    GLuint packBuffer;
+    ReplayStats stats;
+};
+
+static Replay gReplay;
+
+template <typename T>
+static T replayValue() {
+    T value = T();
+    if (gReplay.position + sizeof value > gReplay.data.size()) {
+        gReplay.position = gReplay.data.size();
+        return value;
+    }
+    memcpy(&value, &gReplay.data[gReplay.position], sizeof value);
+    gReplay.position += sizeof value;
+    return value;
+}
+
+static const void *replayData(size_t *size = nullptr) {
+    const size_t length = replayValue<uint32_t>();
+    gReplay.position += -gReplay.position & 7;
+    if (size)
+        *size = 0;
+    if (!length || gReplay.position + length > gReplay.data.size())
+        return nullptr;
+    const void *const data = &gReplay.data[gReplay.position];
+    gReplay.position += length;
+    gReplay.stats.bytes += length;
+    if (size)
+        *size = length;
+    return data;
+}
+
+static const GLchar **replayStrings(GLsizei count) {
+    gReplay.strings.resize(count);
+    for (GLsizei i = 0; i < count; i++)
+        gReplay.strings[i] = (const GLchar *)replayData();
+    return gReplay.strings.data();
+}
+
+// memory the calls which return data can write into
+static void *replayScratch(size_t index, size_t size) {
+    auto &scratch = gReplay.scratch[index];
+    if (scratch.size() < size)
+        scratch.resize(size);
+    return scratch.data();
+}
+
+static GLuint replayName(size_t kind, GLuint name) {
+    if (!name)
+        return 0;
+    const auto find = gReplay.names[kind].find(name);
+    return find != gReplay.names[kind].end() ? find->second : name;
+}
+
+static const GLuint *replayNames(size_t kind, const GLuint *names, GLsizei count) {
+    GLuint *const replay = (GLuint *)replayScratch(0, count * sizeof(GLuint));
+    for (GLsizei i = 0; i < count; i++)
+        replay[i] = replayName(kind, names ? names[i] : 0);
+    return replay;
+}
+
+static void replayGenerated(size_t kind, const GLuint *names, const GLuint *generated, GLsizei count) {
+    if (!names)
+        return;
+    for (GLsizei i = 0; i < count; i++)
+        gReplay.names[kind][names[i]] = generated[i];
+}
+
+static inline uint64_t replayKey(GLuint program, uint32_t value) {
+    return (uint64_t(program) << 32) | value;
+}
+
+static GLint replayLocation(GLint location) {
+    const auto find = gReplay.locations.find(replayKey(gReplay.program, location));
+    return find != gReplay.locations.end() ? find->second : location;
+}
+
+static GLuint replayBlock(GLuint program, GLuint index) {
+    const auto find = gReplay.blocks.find(replayKey(program, index));
+    return find != gReplay.blocks.end() ? find->second : index;
+}
+
+static GLsync replaySync(uint64_t sync) {
+    const auto find = gReplay.syncs.find(sync);
+    return find != gReplay.syncs.end() ? find->second : nullptr;
+}
+
+bool replayOpen(const char *file) {
+    replayClose();
+    auto read = u::read(file, "rb");
+    if (!read || read->size() < sizeof kCaptureMagic)
+        return false;
+    if (memcmp(read->data(), kCaptureMagic, sizeof kCaptureMagic))
+        return false;
+    gReplay.data = u::move(*read);
+    gReplay.position = sizeof kCaptureMagic;
+    return true;
+}
+
+void replayClose() {
+    gReplay.data.destroy();
+    gReplay.position = 0;
+    for (auto &it : gReplay.names)
+        it.clear();
+    gReplay.locations.clear();
+    gReplay.blocks.clear();
+    gReplay.syncs.clear();
+    gReplay.program = 0;
+    gReplay.packBuffer = 0;
+    gReplay.stats = ReplayStats();
+}
+
+const ReplayStats &replayStats() {
+    return gReplay.stats;
+}
+
+bool replayFrame() {
+    while (gReplay.position < gReplay.data.size()) {
+        const uint16_t call = replayValue<uint16_t>();
+        if (call == kCallFrame) {
+            gReplay.stats.frames++;
+            return true;
+        }
+        gReplay.stats.calls++;
+        switch (call) {
+        case kCallBufferWrite: {
+            const GLuint buffer = replayName(kNameBuffer, replayValue<GLuint>());
+            const GLintptr offset = GLintptr(replayValue<uint64_t>());
+            size_t size = 0;
+            const void *const data = replayData(&size);
+            glBindBuffer_(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferSubData_(GL_COPY_WRITE_BUFFER, offset, size, data);
+            break;
+        }
+        case kCallCreateShader: {
+            const GLenum shaderType = replayValue<GLenum>();
+            const GLuint recorded = replayValue<GLuint>();
+            const GLuint result = glCreateShader_(shaderType);
+            gReplay.names[kNameShader][recorded] = result;
+            break;
+        }
+        case kCallShaderSource: {
+            const GLuint shader = replayValue<GLuint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLchar **string = replayStrings(count);
+            glShaderSource_(replayName(kNameShader, shader), count, string, nullptr);
+            break;
+        }
+        case kCallCompileShader: {
+            const GLuint shader = replayValue<GLuint>();
+            glCompileShader_(replayName(kNameShader, shader));
+            break;
+        }
+        case kCallAttachShader: {
+            const GLuint program = replayValue<GLuint>();
+            const GLuint shader = replayValue<GLuint>();
+            glAttachShader_(replayName(kNameProgram, program), replayName(kNameShader, shader));
+            break;
+        }
+        case kCallCreateProgram: {
+            const GLuint recorded = replayValue<GLuint>();
+            const GLuint result = glCreateProgram_();
+            gReplay.names[kNameProgram][recorded] = result;
+            break;
+        }
+        case kCallLinkProgram: {
+            const GLuint program = replayValue<GLuint>();
+            glLinkProgram_(replayName(kNameProgram, program));
+            break;
+        }
+        case kCallUseProgram: {
+            const GLuint program = replayValue<GLuint>();
+            glUseProgram_(replayName(kNameProgram, program));
+            gReplay.program = program;
+            break;
+        }
+        case kCallGetUniformLocation: {
+            const GLuint program = replayValue<GLuint>();
+            const GLchar *name = (const GLchar *)replayData();
+            const GLint recorded = replayValue<GLint>();
+            const GLint result = glGetUniformLocation_(replayName(kNameProgram, program), name);
+            gReplay.locations[replayKey(program, recorded)] = result;
+            break;
+        }
+        case kCallEnableVertexAttribArray: {
+            const GLuint index = replayValue<GLuint>();
+            glEnableVertexAttribArray_(index);
+            break;
+        }
+        case kCallDisableVertexAttribArray: {
+            const GLuint index = replayValue<GLuint>();
+            glDisableVertexAttribArray_(index);
+            break;
+        }
+        case kCallUniformMatrix4fv: {
+            const GLint location = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLboolean transpose = replayValue<GLboolean>();
+            const GLfloat *value = (const GLfloat *)replayData();
+            glUniformMatrix4fv_(replayLocation(location), count, transpose, value);
+            break;
+        }
+        case kCallBindBuffer: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint buffer = replayValue<GLuint>();
+            glBindBuffer_(target, replayName(kNameBuffer, buffer));
+            if (target == GL_PIXEL_PACK_BUFFER)
+                gReplay.packBuffer = buffer;
+            break;
+        }
+        case kCallGenBuffers: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *buffers = (const GLuint *)replayData();
+            GLuint *const generated = (GLuint *)replayScratch(0, n * sizeof(GLuint));
+            glGenBuffers_(n, generated);
+            replayGenerated(kNameBuffer, buffers, generated, n);
+            break;
+        }
+        case kCallVertexAttribPointer: {
+            const GLuint index = replayValue<GLuint>();
+            const GLint size = replayValue<GLint>();
+            const GLenum type = replayValue<GLenum>();
+            const GLboolean normalized = replayValue<GLboolean>();
+            const GLsizei stride = replayValue<GLsizei>();
+            const GLvoid *pointer = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            glVertexAttribPointer_(index, size, type, normalized, stride, (const GLvoid*)pointer);
+            break;
+        }
+        case kCallBufferData: {
+            const GLenum target = replayValue<GLenum>();
+            const GLsizeiptr size = GLsizeiptr(replayValue<int64_t>());
+            const GLvoid *data = (const GLvoid *)replayData();
+            const GLenum usage = replayValue<GLenum>();
+            glBufferData_(target, size, data, usage);
+            break;
+        }
+        case kCallValidateProgram: {
+            const GLuint program = replayValue<GLuint>();
+            glValidateProgram_(replayName(kNameProgram, program));
+            break;
+        }
+        case kCallGenVertexArrays: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *arrays = (const GLuint *)replayData();
+            GLuint *const generated = (GLuint *)replayScratch(0, n * sizeof(GLuint));
+            glGenVertexArrays_(n, generated);
+            replayGenerated(kNameVertexArray, arrays, generated, n);
+            break;
+        }
+        case kCallBindVertexArray: {
+            const GLuint array = replayValue<GLuint>();
+            glBindVertexArray_(replayName(kNameVertexArray, array));
+            break;
+        }
+        case kCallDeleteProgram: {
+            const GLuint program = replayValue<GLuint>();
+            glDeleteProgram_(replayName(kNameProgram, program));
+            break;
+        }
+        case kCallDeleteBuffers: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *buffers = (const GLuint *)replayData();
+            glDeleteBuffers_(n, replayNames(kNameBuffer, buffers, n));
+            break;
+        }
+        case kCallDeleteVertexArrays: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *arrays = (const GLuint *)replayData();
+            glDeleteVertexArrays_(n, replayNames(kNameVertexArray, arrays, n));
+            break;
+        }
+        case kCallUniform1i: {
+            const GLint location = replayValue<GLint>();
+            const GLint v0 = replayValue<GLint>();
+            glUniform1i_(replayLocation(location), v0);
+            break;
+        }
+        case kCallUniform2i: {
+            const GLint location = replayValue<GLint>();
+            const GLint v0 = replayValue<GLint>();
+            const GLint v1 = replayValue<GLint>();
+            glUniform2i_(replayLocation(location), v0, v1);
+            break;
+        }
+        case kCallUniform1f: {
+            const GLint location = replayValue<GLint>();
+            const GLfloat v0 = replayValue<GLfloat>();
+            glUniform1f_(replayLocation(location), v0);
+            break;
+        }
+        case kCallUniform2f: {
+            const GLint location = replayValue<GLint>();
+            const GLfloat v0 = replayValue<GLfloat>();
+            const GLfloat v1 = replayValue<GLfloat>();
+            glUniform2f_(replayLocation(location), v0, v1);
+            break;
+        }
+        case kCallUniform2fv: {
+            const GLint location = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLfloat *value = (const GLfloat *)replayData();
+            glUniform2fv_(replayLocation(location), count, value);
+            break;
+        }
+        case kCallUniform3fv: {
+            const GLint location = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLfloat *value = (const GLfloat *)replayData();
+            glUniform3fv_(replayLocation(location), count, value);
+            break;
+        }
+        case kCallUniform4fv: {
+            const GLint location = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLfloat *value = (const GLfloat *)replayData();
+            glUniform4fv_(replayLocation(location), count, value);
+            break;
+        }
+        case kCallUniformMatrix3x4fv: {
+            const GLint location = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLboolean transpose = replayValue<GLboolean>();
+            const GLfloat *value = (const GLfloat *)replayData();
+            glUniformMatrix3x4fv_(replayLocation(location), count, transpose, value);
+            break;
+        }
+        case kCallGenerateMipmap: {
+            const GLenum target = replayValue<GLenum>();
+            glGenerateMipmap_(target);
+            break;
+        }
+        case kCallDeleteShader: {
+            const GLuint shader = replayValue<GLuint>();
+            glDeleteShader_(replayName(kNameShader, shader));
+            break;
+        }
+        case kCallGetShaderiv: {
+            const GLuint shader = replayValue<GLuint>();
+            const GLenum pname = replayValue<GLenum>();
+            glGetShaderiv_(replayName(kNameShader, shader), pname, (GLint*)replayScratch(0, 16 * sizeof(GLint)));
+            break;
+        }
+        case kCallGetProgramiv: {
+            const GLuint program = replayValue<GLuint>();
+            const GLenum pname = replayValue<GLenum>();
+            glGetProgramiv_(replayName(kNameProgram, program), pname, (GLint*)replayScratch(0, 16 * sizeof(GLint)));
+            break;
+        }
+        case kCallGetShaderInfoLog: {
+            const GLuint shader = replayValue<GLuint>();
+            const GLsizei maxLength = replayValue<GLsizei>();
+            glGetShaderInfoLog_(replayName(kNameShader, shader), maxLength, (GLsizei*)replayScratch(0, sizeof(GLsizei)), (GLchar*)replayScratch(1, maxLength));
+            break;
+        }
+        case kCallActiveTexture: {
+            const GLenum texture = replayValue<GLenum>();
+            glActiveTexture_(texture);
+            break;
+        }
+        case kCallGenFramebuffers: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *ids = (const GLuint *)replayData();
+            GLuint *const generated = (GLuint *)replayScratch(0, n * sizeof(GLuint));
+            glGenFramebuffers_(n, generated);
+            replayGenerated(kNameFramebuffer, ids, generated, n);
+            break;
+        }
+        case kCallBindFramebuffer: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint framebuffer = replayValue<GLuint>();
+            glBindFramebuffer_(target, replayName(kNameFramebuffer, framebuffer));
+            break;
+        }
+        case kCallFramebufferTexture2D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLenum attachment = replayValue<GLenum>();
+            const GLenum textarget = replayValue<GLenum>();
+            const GLuint texture = replayValue<GLuint>();
+            const GLint level = replayValue<GLint>();
+            glFramebufferTexture2D_(target, attachment, textarget, replayName(kNameTexture, texture), level);
+            break;
+        }
+        case kCallDrawBuffers: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLenum *bufs = (const GLenum *)replayData();
+            glDrawBuffers_(n, bufs);
+            break;
+        }
+        case kCallCheckFramebufferStatus: {
+            const GLenum target = replayValue<GLenum>();
+            replayValue<GLenum>();
+            glCheckFramebufferStatus_(target);
+            break;
+        }
+        case kCallDeleteFramebuffers: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *framebuffers = (const GLuint *)replayData();
+            glDeleteFramebuffers_(n, replayNames(kNameFramebuffer, framebuffers, n));
+            break;
+        }
+        case kCallClear: {
+            const GLbitfield mask = replayValue<GLbitfield>();
+            glClear_(mask);
+            break;
+        }
+        case kCallClearColor: {
+            const GLfloat red = replayValue<GLfloat>();
+            const GLfloat green = replayValue<GLfloat>();
+            const GLfloat blue = replayValue<GLfloat>();
+            const GLfloat alpha = replayValue<GLfloat>();
+            glClearColor_(red, green, blue, alpha);
+            break;
+        }
+        case kCallFrontFace: {
+            const GLenum mode = replayValue<GLenum>();
+            glFrontFace_(mode);
+            break;
+        }
+        case kCallCullFace: {
+            const GLenum mode = replayValue<GLenum>();
+            glCullFace_(mode);
+            break;
+        }
+        case kCallEnable: {
+            const GLenum cap = replayValue<GLenum>();
+            glEnable_(cap);
+            break;
+        }
+        case kCallDisable: {
+            const GLenum cap = replayValue<GLenum>();
+            glDisable_(cap);
+            break;
+        }
+        case kCallDrawElements: {
+            const GLenum mode = replayValue<GLenum>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *indices = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            glDrawElements_(mode, count, type, (const GLvoid*)indices);
+            break;
+        }
+        case kCallDepthMask: {
+            const GLboolean flag = replayValue<GLboolean>();
+            glDepthMask_(flag);
+            break;
+        }
+        case kCallBindTexture: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint texture = replayValue<GLuint>();
+            glBindTexture_(target, replayName(kNameTexture, texture));
+            break;
+        }
+        case kCallTexImage2D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLint internalFormat = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLint border = replayValue<GLint>();
+            const GLenum format = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *data = (const GLvoid *)replayData();
+            glTexImage2D_(target, level, internalFormat, width, height, border, format, type, data);
+            break;
+        }
+        case kCallDeleteTextures: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *textures = (const GLuint *)replayData();
+            glDeleteTextures_(n, replayNames(kNameTexture, textures, n));
+            break;
+        }
+        case kCallGenTextures: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *textures = (const GLuint *)replayData();
+            GLuint *const generated = (GLuint *)replayScratch(0, n * sizeof(GLuint));
+            glGenTextures_(n, generated);
+            replayGenerated(kNameTexture, textures, generated, n);
+            break;
+        }
+        case kCallTexParameterf: {
+            const GLenum target = replayValue<GLenum>();
+            const GLenum pname = replayValue<GLenum>();
+            const GLfloat param = replayValue<GLfloat>();
+            glTexParameterf_(target, pname, param);
+            break;
+        }
+        case kCallTexParameteri: {
+            const GLenum target = replayValue<GLenum>();
+            const GLenum pname = replayValue<GLenum>();
+            const GLint param = replayValue<GLint>();
+            glTexParameteri_(target, pname, param);
+            break;
+        }
+        case kCallDrawArrays: {
+            const GLenum mode = replayValue<GLenum>();
+            const GLint first = replayValue<GLint>();
+            const GLsizei count = replayValue<GLsizei>();
+            glDrawArrays_(mode, first, count);
+            break;
+        }
+        case kCallBlendEquation: {
+            const GLenum mode = replayValue<GLenum>();
+            glBlendEquation_(mode);
+            break;
+        }
+        case kCallBlendFunc: {
+            const GLenum sfactor = replayValue<GLenum>();
+            const GLenum dfactor = replayValue<GLenum>();
+            glBlendFunc_(sfactor, dfactor);
+            break;
+        }
+        case kCallDepthFunc: {
+            const GLenum func = replayValue<GLenum>();
+            glDepthFunc_(func);
+            break;
+        }
+        case kCallColorMask: {
+            const GLboolean red = replayValue<GLboolean>();
+            const GLboolean green = replayValue<GLboolean>();
+            const GLboolean blue = replayValue<GLboolean>();
+            const GLboolean alpha = replayValue<GLboolean>();
+            glColorMask_(red, green, blue, alpha);
+            break;
+        }
+        case kCallReadPixels: {
+            const GLint x = replayValue<GLint>();
+            const GLint y = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLenum format = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *data = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            if (gReplay.packBuffer)
+                glReadPixels_(x, y, width, height, format, type, (GLvoid*)data);
+            break;
+        }
+        case kCallViewport: {
+            const GLint x = replayValue<GLint>();
+            const GLint y = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            glViewport_(x, y, width, height);
+            break;
+        }
+        case kCallGetIntegerv: {
+            const GLenum pname = replayValue<GLenum>();
+            glGetIntegerv_(pname, (GLint*)replayScratch(0, 16 * sizeof(GLint)));
+            break;
+        }
+        case kCallGetString: {
+            const GLenum name = replayValue<GLenum>();
+            glGetString_(name);
+            break;
+        }
+        case kCallGetStringi: {
+            const GLenum name = replayValue<GLenum>();
+            const GLuint index = replayValue<GLuint>();
+            glGetStringi_(name, index);
+            break;
+        }
+        case kCallGetFloatv: {
+            const GLenum pname = replayValue<GLenum>();
+            glGetFloatv_(pname, (GLfloat*)replayScratch(0, 16 * sizeof(GLfloat)));
+            break;
+        }
+        case kCallGetError: {
+            replayValue<GLenum>();
+            glGetError_();
+            break;
+        }
+        case kCallGetTexLevelParameteriv: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLenum pname = replayValue<GLenum>();
+            glGetTexLevelParameteriv_(target, level, pname, (GLint*)replayScratch(0, 16 * sizeof(GLint)));
+            break;
+        }
+        case kCallGetCompressedTexImage: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint lod = replayValue<GLint>();
+            const GLvoid *img = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            if (gReplay.packBuffer)
+                glGetCompressedTexImage_(target, lod, (GLvoid*)img);
+            break;
+        }
+        case kCallCompressedTexImage2D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLenum internalformat = replayValue<GLenum>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLint border = replayValue<GLint>();
+            const GLsizei imageSize = replayValue<GLsizei>();
+            const GLvoid *data = (const GLvoid *)replayData();
+            glCompressedTexImage2D_(target, level, internalformat, width, height, border, imageSize, data);
+            break;
+        }
+        case kCallPixelStorei: {
+            const GLenum pname = replayValue<GLenum>();
+            const GLint param = replayValue<GLint>();
+            glPixelStorei_(pname, param);
+            break;
+        }
+        case kCallScissor: {
+            const GLint x = replayValue<GLint>();
+            const GLint y = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            glScissor_(x, y, width, height);
+            break;
+        }
+        case kCallPolygonMode: {
+            const GLenum face = replayValue<GLenum>();
+            const GLenum mode = replayValue<GLenum>();
+            glPolygonMode_(face, mode);
+            break;
+        }
+        case kCallHint: {
+            const GLenum target = replayValue<GLenum>();
+            const GLenum mode = replayValue<GLenum>();
+            glHint_(target, mode);
+            break;
+        }
+        case kCallGenQueries: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *ids = (const GLuint *)replayData();
+            GLuint *const generated = (GLuint *)replayScratch(0, n * sizeof(GLuint));
+            glGenQueries_(n, generated);
+            replayGenerated(kNameQuery, ids, generated, n);
+            break;
+        }
+        case kCallBeginQuery: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint id = replayValue<GLuint>();
+            glBeginQuery_(target, replayName(kNameQuery, id));
+            break;
+        }
+        case kCallEndQuery: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint id = replayValue<GLuint>();
+            glEndQuery_(target, replayName(kNameQuery, id));
+            break;
+        }
+        case kCallDeleteQueries: {
+            const GLsizei n = replayValue<GLsizei>();
+            const GLuint *ids = (const GLuint *)replayData();
+            glDeleteQueries_(n, replayNames(kNameQuery, ids, n));
+            break;
+        }
+        case kCallGetQueryObjectuiv: {
+            const GLuint id = replayValue<GLuint>();
+            const GLenum pname = replayValue<GLenum>();
+            glGetQueryObjectuiv_(replayName(kNameQuery, id), pname, (GLuint*)replayScratch(0, 16 * sizeof(GLuint)));
+            break;
+        }
+        case kCallFlush: {
+            glFlush_();
+            break;
+        }
+        case kCallStencilFunc: {
+            const GLenum func = replayValue<GLenum>();
+            const GLint ref = replayValue<GLint>();
+            const GLuint mask = replayValue<GLuint>();
+            glStencilFunc_(func, ref, mask);
+            break;
+        }
+        case kCallStencilOp: {
+            const GLenum sfail = replayValue<GLenum>();
+            const GLenum dpfail = replayValue<GLenum>();
+            const GLenum dppass = replayValue<GLenum>();
+            glStencilOp_(sfail, dpfail, dppass);
+            break;
+        }
+        case kCallTexImage3D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLint internalFormat = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLsizei depth = replayValue<GLsizei>();
+            const GLint border = replayValue<GLint>();
+            const GLenum format = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *data = (const GLvoid *)replayData();
+            glTexImage3D_(target, level, internalFormat, width, height, depth, border, format, type, data);
+            break;
+        }
+        case kCallTexSubImage3D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLint xoffset = replayValue<GLint>();
+            const GLint yoffset = replayValue<GLint>();
+            const GLint zoffset = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLsizei depth = replayValue<GLsizei>();
+            const GLenum format = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *data = (const GLvoid *)replayData();
+            glTexSubImage3D_(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+            break;
+        }
+        case kCallGetProgramInfoLog: {
+            const GLuint program = replayValue<GLuint>();
+            const GLsizei maxLength = replayValue<GLsizei>();
+            glGetProgramInfoLog_(replayName(kNameProgram, program), maxLength, (GLsizei*)replayScratch(0, sizeof(GLsizei)), (GLchar*)replayScratch(1, maxLength));
+            break;
+        }
+        case kCallBindAttribLocation: {
+            const GLuint program = replayValue<GLuint>();
+            const GLuint index = replayValue<GLuint>();
+            const GLchar *name = (const GLchar *)replayData();
+            glBindAttribLocation_(replayName(kNameProgram, program), index, name);
+            break;
+        }
+        case kCallBindFragDataLocation: {
+            const GLuint program = replayValue<GLuint>();
+            const GLuint colorNumber = replayValue<GLuint>();
+            const GLchar *name = (const GLchar *)replayData();
+            glBindFragDataLocation_(replayName(kNameProgram, program), colorNumber, name);
+            break;
+        }
+        case kCallTexSubImage2D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLint level = replayValue<GLint>();
+            const GLint xoffset = replayValue<GLint>();
+            const GLint yoffset = replayValue<GLint>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLenum format = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *data = (const GLvoid *)replayData();
+            glTexSubImage2D_(target, level, xoffset, yoffset, width, height, format, type, data);
+            break;
+        }
+        case kCallDrawBuffer: {
+            const GLenum mode = replayValue<GLenum>();
+            glDrawBuffer_(mode);
+            break;
+        }
+        case kCallReadBuffer: {
+            const GLenum mode = replayValue<GLenum>();
+            glReadBuffer_(mode);
+            break;
+        }
+        case kCallBufferSubData: {
+            const GLenum target = replayValue<GLenum>();
+            const GLintptr offset = GLintptr(replayValue<int64_t>());
+            const GLsizeiptr size = GLsizeiptr(replayValue<int64_t>());
+            const GLvoid *data = (const GLvoid *)replayData();
+            glBufferSubData_(target, offset, size, data);
+            break;
+        }
+        case kCallPolygonOffset: {
+            const GLfloat factor = replayValue<GLfloat>();
+            const GLfloat units = replayValue<GLfloat>();
+            glPolygonOffset_(factor, units);
+            break;
+        }
+        case kCallDepthRange: {
+            const GLclampd nearVal = replayValue<GLclampd>();
+            const GLclampd farVal = replayValue<GLclampd>();
+            glDepthRange_(nearVal, farVal);
+            break;
+        }
+        case kCallProgramParameteri: {
+            const GLuint program = replayValue<GLuint>();
+            const GLenum pname = replayValue<GLenum>();
+            const GLint value = replayValue<GLint>();
+            glProgramParameteri_(replayName(kNameProgram, program), pname, value);
+            break;
+        }
+        case kCallGetProgramBinary: {
+            const GLuint program = replayValue<GLuint>();
+            const GLsizei bufSize = replayValue<GLsizei>();
+            glGetProgramBinary_(replayName(kNameProgram, program), bufSize, (GLsizei*)replayScratch(0, sizeof(GLsizei)), (GLenum*)replayScratch(1, sizeof(GLenum)), (GLvoid*)replayScratch(2, bufSize));
+            break;
+        }
+        case kCallProgramBinary: {
+            const GLuint program = replayValue<GLuint>();
+            const GLenum binaryFormat = replayValue<GLenum>();
+            const GLvoid *binary = (const GLvoid *)replayData();
+            const GLsizei length = replayValue<GLsizei>();
+            glProgramBinary_(replayName(kNameProgram, program), binaryFormat, binary, length);
+            break;
+        }
+        case kCallBindBufferBase: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint index = replayValue<GLuint>();
+            const GLuint buffer = replayValue<GLuint>();
+            glBindBufferBase_(target, index, replayName(kNameBuffer, buffer));
+            break;
+        }
+        case kCallBindBufferRange: {
+            const GLenum target = replayValue<GLenum>();
+            const GLuint index = replayValue<GLuint>();
+            const GLuint buffer = replayValue<GLuint>();
+            const GLintptr offset = GLintptr(replayValue<int64_t>());
+            const GLsizeiptr size = GLsizeiptr(replayValue<int64_t>());
+            glBindBufferRange_(target, index, replayName(kNameBuffer, buffer), offset, size);
+            break;
+        }
+        case kCallGetUniformBlockIndex: {
+            const GLuint program = replayValue<GLuint>();
+            const GLchar *uniformBlockName = (const GLchar *)replayData();
+            const GLuint recorded = replayValue<GLuint>();
+            const GLuint result = glGetUniformBlockIndex_(replayName(kNameProgram, program), uniformBlockName);
+            gReplay.blocks[replayKey(program, recorded)] = result;
+            break;
+        }
+        case kCallUniformBlockBinding: {
+            const GLuint program = replayValue<GLuint>();
+            const GLuint uniformBlockIndex = replayValue<GLuint>();
+            const GLuint uniformBlockBinding = replayValue<GLuint>();
+            glUniformBlockBinding_(replayName(kNameProgram, program), replayBlock(program, uniformBlockIndex), uniformBlockBinding);
+            break;
+        }
+        case kCallMapBufferRange: {
+            const GLenum target = replayValue<GLenum>();
+            const GLintptr offset = GLintptr(replayValue<int64_t>());
+            const GLsizeiptr length = GLsizeiptr(replayValue<int64_t>());
+            const GLbitfield access = replayValue<GLbitfield>();
+            glMapBufferRange_(target, offset, length, access);
+            break;
+        }
+        case kCallUnmapBuffer: {
+            const GLenum target = replayValue<GLenum>();
+            replayValue<GLboolean>();
+            glUnmapBuffer_(target);
+            break;
+        }
+        case kCallBufferStorage: {
+            const GLenum target = replayValue<GLenum>();
+            const GLsizeiptr size = GLsizeiptr(replayValue<int64_t>());
+            const GLvoid *data = (const GLvoid *)replayData();
+            const GLbitfield flags = replayValue<GLbitfield>();
+            glBufferStorage_(target, size, data, flags | GL_DYNAMIC_STORAGE_BIT);
+            break;
+        }
+        case kCallFenceSync: {
+            const GLenum condition = replayValue<GLenum>();
+            const GLbitfield flags = replayValue<GLbitfield>();
+            const uint64_t recorded = replayValue<uint64_t>();
+            const GLsync result = glFenceSync_(condition, flags);
+            gReplay.syncs[recorded] = result;
+            break;
+        }
+        case kCallClientWaitSync: {
+            const uint64_t sync = replayValue<uint64_t>();
+            const GLbitfield flags = replayValue<GLbitfield>();
+            const GLuint64 timeout = replayValue<GLuint64>();
+            replayValue<GLenum>();
+            glClientWaitSync_(replaySync(sync), flags, timeout);
+            break;
+        }
+        case kCallDeleteSync: {
+            const uint64_t sync = replayValue<uint64_t>();
+            glDeleteSync_(replaySync(sync));
+            break;
+        }
+        case kCallDrawElementsInstanced: {
+            const GLenum mode = replayValue<GLenum>();
+            const GLsizei count = replayValue<GLsizei>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *indices = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            const GLsizei primcount = replayValue<GLsizei>();
+            glDrawElementsInstanced_(mode, count, type, (const GLvoid*)indices, primcount);
+            break;
+        }
+        case kCallVertexAttribDivisor: {
+            const GLuint index = replayValue<GLuint>();
+            const GLuint divisor = replayValue<GLuint>();
+            glVertexAttribDivisor_(index, divisor);
+            break;
+        }
+        case kCallMultiDrawElementsIndirect: {
+            const GLenum mode = replayValue<GLenum>();
+            const GLenum type = replayValue<GLenum>();
+            const GLvoid *indirect = (const GLvoid *)uintptr_t(replayValue<uint64_t>());
+            const GLsizei drawcount = replayValue<GLsizei>();
+            const GLsizei stride = replayValue<GLsizei>();
+            glMultiDrawElementsIndirect_(mode, type, (const GLvoid*)indirect, drawcount, stride);
+            break;
+        }
+        case kCallTexStorage3D: {
+            const GLenum target = replayValue<GLenum>();
+            const GLsizei levels = replayValue<GLsizei>();
+            const GLenum internalformat = replayValue<GLenum>();
+            const GLsizei width = replayValue<GLsizei>();
+            const GLsizei height = replayValue<GLsizei>();
+            const GLsizei depth = replayValue<GLsizei>();
+            glTexStorage3D_(target, levels, internalformat, width, height, depth);
+            break;
+        }
+        case kCallCopyImageSubData: {
+            const GLuint srcName = replayValue<GLuint>();
+            const GLenum srcTarget = replayValue<GLenum>();
+            const GLint srcLevel = replayValue<GLint>();
+            const GLint srcX = replayValue<GLint>();
+            const GLint srcY = replayValue<GLint>();
+            const GLint srcZ = replayValue<GLint>();
+            const GLuint dstName = replayValue<GLuint>();
+            const GLenum dstTarget = replayValue<GLenum>();
+            const GLint dstLevel = replayValue<GLint>();
+            const GLint dstX = replayValue<GLint>();
+            const GLint dstY = replayValue<GLint>();
+            const GLint dstZ = replayValue<GLint>();
+            const GLsizei srcWidth = replayValue<GLsizei>();
+            const GLsizei srcHeight = replayValue<GLsizei>();
+            const GLsizei srcDepth = replayValue<GLsizei>();
+            glCopyImageSubData_(replayName(kNameTexture, srcName), srcTarget, srcLevel, srcX, srcY, srcZ, replayName(kNameTexture, dstName), dstTarget, dstLevel, dstX, dstY, dstZ, srcWidth, srcHeight, srcDepth);
+            break;
+        }
+        default:
+            u::Log::err("[gl] => corrupt capture at %zu\n", gReplay.position);
+            gReplay.position = gReplay.data.size();
+            return false;
+        }
+    }
+    return false;
 }
 
 }
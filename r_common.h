@@ -73,7 +73,16 @@ enum : size_t {
     ARB_half_float_vertex,
     ARB_get_program_binary,
     ATI_meminfo,
-    NVX_gpu_memory_info
+    NVX_gpu_memory_info,
+    ARB_uniform_buffer_object,
+    ARB_buffer_storage,
+    ARB_draw_instanced,
+    ARB_instanced_arrays,
+    ARB_draw_indirect,
+    ARB_multi_draw_indirect,
+    ARB_base_instance,
+    ARB_texture_storage,
+    ARB_copy_image
 };
 
 void init();
@@ -83,6 +92,78 @@ const char *glslVersionString();
 const u::set<size_t> &extensions();
 bool has(size_t ext);
 
+// The most frequently changed state is shadowed, redundant changes
+// through these entry points never reach the driver
+enum : size_t {
+    kStateUseProgram,
+    kStateActiveTexture,
+    kStateBindTexture,
+    kStateBindBuffer,
+    kStateBindBufferRange,
+    kStateEnable,
+    kStateDisable,
+    kStateBlendFunc,
+    kStateCount
+};
+
+struct StateCounters {
+    size_t issued[kStateCount];
+    size_t elided[kStateCount];
+};
+
+// collect the state change counters since the last call
+void stateCounters(StateCounters &counters);
+const char *stateName(size_t what);
+// forget all shadowed state; must be called when the state is changed
+// without going through the entry points
+void invalidateState();
+
+// the number of draw calls issued since startup
+size_t drawCalls();
+
+// The work issued through the entry points. It's counted into the target
+// given to countInto such that the cost of a frame can be attributed to the
+// passes which issued it
+struct Counters {
+    size_t draws;
+    size_t triangles;
+    size_t programs; // program switches which reached the driver
+    size_t textures; // texture binds which reached the driver
+    size_t uniforms;
+    size_t streamed; // bytes uploaded into buffers
+};
+
+// count into counters from now on (nullptr to stop counting), returns the
+// previous target
+Counters *countInto(Counters *counters);
+// count bytes uploaded without going through an entry point, e.g. through a
+// persistent mapping
+void countStreamed(size_t bytes);
+
+// Every call which reaches the driver through the entry points can be
+// captured into a file along with the data it reads. The capture must be
+// started before any object is created, it can then be replayed without
+// the engine to measure the cost of submitting the calls alone
+bool startCapture(const char *file);
+void stopCapture();
+bool capturing();
+// mark the end of a frame
+void captureFrame();
+// capture data written into a buffer through a mapping
+void captureBufferWrite(GLuint buffer, size_t offset, const void *data, size_t size);
+
+struct ReplayStats {
+    size_t frames;
+    size_t calls;
+    size_t bytes; // data handed to the driver
+};
+
+bool replayOpen(const char *file);
+// issue the calls of the next frame, returns false at the end of the capture
+bool replayFrame();
+void replayClose();
+const ReplayStats &replayStats();
+
 GLuint CreateShader(GLenum shaderType GL_INFOP);
 void ShaderSource(GLuint shader, GLsizei count, const GLchar** string, const GLint* length GL_INFOP);
 void CompileShader(GLuint shader GL_INFOP);
@@ -179,104 +260,134 @@ void DepthRange(GLclampd nearVal, GLclampd farVal GL_INFOP);
 void ProgramParameteri(GLuint program, GLenum pname, GLint value GL_INFOP);
 void GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, GLvoid* binary GL_INFOP);
 void ProgramBinary(GLuint program, GLenum binaryFormat, const GLvoid* binary, GLsizei length GL_INFOP);
+void BindBufferBase(GLenum target, GLuint index, GLuint buffer GL_INFOP);
+void BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size GL_INFOP);
+GLuint GetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName GL_INFOP);
+void UniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding GL_INFOP);
+void* MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access GL_INFOP);
+GLboolean UnmapBuffer(GLenum target GL_INFOP);
+void BufferStorage(GLenum target, GLsizeiptr size, const GLvoid* data, GLbitfield flags GL_INFOP);
+GLsync FenceSync(GLenum condition, GLbitfield flags GL_INFOP);
+GLenum ClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout GL_INFOP);
+void DeleteSync(GLsync sync GL_INFOP);
+void DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLsizei primcount GL_INFOP);
+void VertexAttribDivisor(GLuint index, GLuint divisor GL_INFOP);
+void MultiDrawElementsIndirect(GLenum mode, GLenum type, const GLvoid* indirect, GLsizei drawcount, GLsizei stride GL_INFOP);
+void TexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth GL_INFOP);
+void CopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth GL_INFOP);
 
 }
 #if defined(DEBUG_GL) && !defined(R_COMMON_NO_DEFINES)
-#   define CreateShader(...)             CreateShader(__VA_ARGS__, __FILE__, __LINE__)
-#   define ShaderSource(...)             ShaderSource(__VA_ARGS__, __FILE__, __LINE__)
-#   define CompileShader(...)            CompileShader(__VA_ARGS__, __FILE__, __LINE__)
-#   define AttachShader(...)             AttachShader(__VA_ARGS__, __FILE__, __LINE__)
-#   define CreateProgram(...)            CreateProgram(/* no arg */ __FILE__, __LINE__)
-#   define LinkProgram(...)              LinkProgram(__VA_ARGS__, __FILE__, __LINE__)
-#   define UseProgram(...)               UseProgram(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetUniformLocation(...)       GetUniformLocation(__VA_ARGS__, __FILE__, __LINE__)
-#   define EnableVertexAttribArray(...)  EnableVertexAttribArray(__VA_ARGS__, __FILE__, __LINE__)
-#   define DisableVertexAttribArray(...) DisableVertexAttribArray(__VA_ARGS__, __FILE__, __LINE__)
-#   define UniformMatrix4fv(...)         UniformMatrix4fv(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindBuffer(...)               BindBuffer(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenBuffers(...)               GenBuffers(__VA_ARGS__, __FILE__, __LINE__)
-#   define VertexAttribPointer(...)      VertexAttribPointer(__VA_ARGS__, __FILE__, __LINE__)
-#   define BufferData(...)               BufferData(__VA_ARGS__, __FILE__, __LINE__)
-#   define ValidateProgram(...)          ValidateProgram(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenVertexArrays(...)          GenVertexArrays(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindVertexArray(...)          BindVertexArray(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteProgram(...)            DeleteProgram(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteBuffers(...)            DeleteBuffers(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteVertexArrays(...)       DeleteVertexArrays(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform1i(...)                Uniform1i(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform2i(...)                Uniform2i(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform1f(...)                Uniform1f(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform2f(...)                Uniform2f(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform2fv(...)               Uniform2fv(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform3fv(...)               Uniform3fv(__VA_ARGS__, __FILE__, __LINE__)
-#   define Uniform4fv(...)               Uniform4fv(__VA_ARGS__, __FILE__, __LINE__)
-#   define UniformMatrix3x4fv(...)       UniformMatrix3x4fv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenerateMipmap(...)           GenerateMipmap(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteShader(...)             DeleteShader(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetShaderiv(...)              GetShaderiv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetProgramiv(...)             GetProgramiv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetShaderInfoLog(...)         GetShaderInfoLog(__VA_ARGS__, __FILE__, __LINE__)
-#   define ActiveTexture(...)            ActiveTexture(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenFramebuffers(...)          GenFramebuffers(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindFramebuffer(...)          BindFramebuffer(__VA_ARGS__, __FILE__, __LINE__)
-#   define FramebufferTexture2D(...)     FramebufferTexture2D(__VA_ARGS__, __FILE__, __LINE__)
-#   define DrawBuffers(...)              DrawBuffers(__VA_ARGS__, __FILE__, __LINE__)
-#   define CheckFramebufferStatus(...)   CheckFramebufferStatus(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteFramebuffers(...)       DeleteFramebuffers(__VA_ARGS__, __FILE__, __LINE__)
-#   define Clear(...)                    Clear(__VA_ARGS__, __FILE__, __LINE__)
-#   define ClearColor(...)               ClearColor(__VA_ARGS__, __FILE__, __LINE__)
-#   define FrontFace(...)                FrontFace(__VA_ARGS__, __FILE__, __LINE__)
-#   define CullFace(...)                 CullFace(__VA_ARGS__, __FILE__, __LINE__)
-#   define Enable(...)                   Enable(__VA_ARGS__, __FILE__, __LINE__)
-#   define Disable(...)                  Disable(__VA_ARGS__, __FILE__, __LINE__)
-#   define DrawElements(...)             DrawElements(__VA_ARGS__, __FILE__, __LINE__)
-#   define DepthMask(...)                DepthMask(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindTexture(...)              BindTexture(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexImage2D(...)               TexImage2D(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteTextures(...)           DeleteTextures(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenTextures(...)              GenTextures(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexParameterf(...)            TexParameterf(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexParameteri(...)            TexParameteri(__VA_ARGS__, __FILE__, __LINE__)
-#   define DrawArrays(...)               DrawArrays(__VA_ARGS__, __FILE__, __LINE__)
-#   define BlendEquation(...)            BlendEquation(__VA_ARGS__, __FILE__, __LINE__)
-#   define BlendFunc(...)                BlendFunc(__VA_ARGS__, __FILE__, __LINE__)
-#   define DepthFunc(...)                DepthFunc(__VA_ARGS__, __FILE__, __LINE__)
-#   define ColorMask(...)                ColorMask(__VA_ARGS__, __FILE__, __LINE__)
-#   define ReadPixels(...)               ReadPixels(__VA_ARGS__, __FILE__, __LINE__)
-#   define Viewport(...)                 Viewport(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetIntegerv(...)              GetIntegerv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetString(...)                GetString(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetStringi(...)               GetStringi(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetFloatv(...)                GetFloatv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetError(...)                 GetError(/* no arg */ __FILE__, __LINE__)
-#   define GetTexLevelParameteriv(...)   GetTexLevelParameteriv(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetCompressedTexImage(...)    GetCompressedTexImage(__VA_ARGS__, __FILE__, __LINE__)
-#   define CompressedTexImage2D(...)     CompressedTexImage2D(__VA_ARGS__, __FILE__, __LINE__)
-#   define PixelStorei(...)              PixelStorei(__VA_ARGS__, __FILE__, __LINE__)
-#   define Scissor(...)                  Scissor(__VA_ARGS__, __FILE__, __LINE__)
-#   define PolygonMode(...)              PolygonMode(__VA_ARGS__, __FILE__, __LINE__)
-#   define Hint(...)                     Hint(__VA_ARGS__, __FILE__, __LINE__)
-#   define GenQueries(...)               GenQueries(__VA_ARGS__, __FILE__, __LINE__)
-#   define BeginQuery(...)               BeginQuery(__VA_ARGS__, __FILE__, __LINE__)
-#   define EndQuery(...)                 EndQuery(__VA_ARGS__, __FILE__, __LINE__)
-#   define DeleteQueries(...)            DeleteQueries(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetQueryObjectuiv(...)        GetQueryObjectuiv(__VA_ARGS__, __FILE__, __LINE__)
-#   define Flush(...)                    Flush(/* no arg */ __FILE__, __LINE__)
-#   define StencilFunc(...)              StencilFunc(__VA_ARGS__, __FILE__, __LINE__)
-#   define StencilOp(...)                StencilOp(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexImage3D(...)               TexImage3D(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexSubImage3D(...)            TexSubImage3D(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetProgramInfoLog(...)        GetProgramInfoLog(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindAttribLocation(...)       BindAttribLocation(__VA_ARGS__, __FILE__, __LINE__)
-#   define BindFragDataLocation(...)     BindFragDataLocation(__VA_ARGS__, __FILE__, __LINE__)
-#   define TexSubImage2D(...)            TexSubImage2D(__VA_ARGS__, __FILE__, __LINE__)
-#   define DrawBuffer(...)               DrawBuffer(__VA_ARGS__, __FILE__, __LINE__)
-#   define ReadBuffer(...)               ReadBuffer(__VA_ARGS__, __FILE__, __LINE__)
-#   define BufferSubData(...)            BufferSubData(__VA_ARGS__, __FILE__, __LINE__)
-#   define PolygonOffset(...)            PolygonOffset(__VA_ARGS__, __FILE__, __LINE__)
-#   define DepthRange(...)               DepthRange(__VA_ARGS__, __FILE__, __LINE__)
-#   define ProgramParameteri(...)        ProgramParameteri(__VA_ARGS__, __FILE__, __LINE__)
-#   define GetProgramBinary(...)         GetProgramBinary(__VA_ARGS__, __FILE__, __LINE__)
-#   define ProgramBinary(...)            ProgramBinary(__VA_ARGS__, __FILE__, __LINE__)
+#   define CreateShader(...)              CreateShader(__VA_ARGS__, __FILE__, __LINE__)
+#   define ShaderSource(...)              ShaderSource(__VA_ARGS__, __FILE__, __LINE__)
+#   define CompileShader(...)             CompileShader(__VA_ARGS__, __FILE__, __LINE__)
+#   define AttachShader(...)              AttachShader(__VA_ARGS__, __FILE__, __LINE__)
+#   define CreateProgram(...)             CreateProgram(/* no arg */ __FILE__, __LINE__)
+#   define LinkProgram(...)               LinkProgram(__VA_ARGS__, __FILE__, __LINE__)
+#   define UseProgram(...)                UseProgram(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetUniformLocation(...)        GetUniformLocation(__VA_ARGS__, __FILE__, __LINE__)
+#   define EnableVertexAttribArray(...)   EnableVertexAttribArray(__VA_ARGS__, __FILE__, __LINE__)
+#   define DisableVertexAttribArray(...)  DisableVertexAttribArray(__VA_ARGS__, __FILE__, __LINE__)
+#   define UniformMatrix4fv(...)          UniformMatrix4fv(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindBuffer(...)                BindBuffer(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenBuffers(...)                GenBuffers(__VA_ARGS__, __FILE__, __LINE__)
+#   define VertexAttribPointer(...)       VertexAttribPointer(__VA_ARGS__, __FILE__, __LINE__)
+#   define BufferData(...)                BufferData(__VA_ARGS__, __FILE__, __LINE__)
+#   define ValidateProgram(...)           ValidateProgram(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenVertexArrays(...)           GenVertexArrays(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindVertexArray(...)           BindVertexArray(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteProgram(...)             DeleteProgram(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteBuffers(...)             DeleteBuffers(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteVertexArrays(...)        DeleteVertexArrays(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform1i(...)                 Uniform1i(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform2i(...)                 Uniform2i(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform1f(...)                 Uniform1f(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform2f(...)                 Uniform2f(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform2fv(...)                Uniform2fv(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform3fv(...)                Uniform3fv(__VA_ARGS__, __FILE__, __LINE__)
+#   define Uniform4fv(...)                Uniform4fv(__VA_ARGS__, __FILE__, __LINE__)
+#   define UniformMatrix3x4fv(...)        UniformMatrix3x4fv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenerateMipmap(...)            GenerateMipmap(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteShader(...)              DeleteShader(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetShaderiv(...)               GetShaderiv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetProgramiv(...)              GetProgramiv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetShaderInfoLog(...)          GetShaderInfoLog(__VA_ARGS__, __FILE__, __LINE__)
+#   define ActiveTexture(...)             ActiveTexture(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenFramebuffers(...)           GenFramebuffers(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindFramebuffer(...)           BindFramebuffer(__VA_ARGS__, __FILE__, __LINE__)
+#   define FramebufferTexture2D(...)      FramebufferTexture2D(__VA_ARGS__, __FILE__, __LINE__)
+#   define DrawBuffers(...)               DrawBuffers(__VA_ARGS__, __FILE__, __LINE__)
+#   define CheckFramebufferStatus(...)    CheckFramebufferStatus(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteFramebuffers(...)        DeleteFramebuffers(__VA_ARGS__, __FILE__, __LINE__)
+#   define Clear(...)                     Clear(__VA_ARGS__, __FILE__, __LINE__)
+#   define ClearColor(...)                ClearColor(__VA_ARGS__, __FILE__, __LINE__)
+#   define FrontFace(...)                 FrontFace(__VA_ARGS__, __FILE__, __LINE__)
+#   define CullFace(...)                  CullFace(__VA_ARGS__, __FILE__, __LINE__)
+#   define Enable(...)                    Enable(__VA_ARGS__, __FILE__, __LINE__)
+#   define Disable(...)                   Disable(__VA_ARGS__, __FILE__, __LINE__)
+#   define DrawElements(...)              DrawElements(__VA_ARGS__, __FILE__, __LINE__)
+#   define DepthMask(...)                 DepthMask(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindTexture(...)               BindTexture(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexImage2D(...)                TexImage2D(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteTextures(...)            DeleteTextures(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenTextures(...)               GenTextures(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexParameterf(...)             TexParameterf(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexParameteri(...)             TexParameteri(__VA_ARGS__, __FILE__, __LINE__)
+#   define DrawArrays(...)                DrawArrays(__VA_ARGS__, __FILE__, __LINE__)
+#   define BlendEquation(...)             BlendEquation(__VA_ARGS__, __FILE__, __LINE__)
+#   define BlendFunc(...)                 BlendFunc(__VA_ARGS__, __FILE__, __LINE__)
+#   define DepthFunc(...)                 DepthFunc(__VA_ARGS__, __FILE__, __LINE__)
+#   define ColorMask(...)                 ColorMask(__VA_ARGS__, __FILE__, __LINE__)
+#   define ReadPixels(...)                ReadPixels(__VA_ARGS__, __FILE__, __LINE__)
+#   define Viewport(...)                  Viewport(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetIntegerv(...)               GetIntegerv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetString(...)                 GetString(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetStringi(...)                GetStringi(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetFloatv(...)                 GetFloatv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetError(...)                  GetError(/* no arg */ __FILE__, __LINE__)
+#   define GetTexLevelParameteriv(...)    GetTexLevelParameteriv(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetCompressedTexImage(...)     GetCompressedTexImage(__VA_ARGS__, __FILE__, __LINE__)
+#   define CompressedTexImage2D(...)      CompressedTexImage2D(__VA_ARGS__, __FILE__, __LINE__)
+#   define PixelStorei(...)               PixelStorei(__VA_ARGS__, __FILE__, __LINE__)
+#   define Scissor(...)                   Scissor(__VA_ARGS__, __FILE__, __LINE__)
+#   define PolygonMode(...)               PolygonMode(__VA_ARGS__, __FILE__, __LINE__)
+#   define Hint(...)                      Hint(__VA_ARGS__, __FILE__, __LINE__)
+#   define GenQueries(...)                GenQueries(__VA_ARGS__, __FILE__, __LINE__)
+#   define BeginQuery(...)                BeginQuery(__VA_ARGS__, __FILE__, __LINE__)
+#   define EndQuery(...)                  EndQuery(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteQueries(...)             DeleteQueries(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetQueryObjectuiv(...)         GetQueryObjectuiv(__VA_ARGS__, __FILE__, __LINE__)
+#   define Flush(...)                     Flush(/* no arg */ __FILE__, __LINE__)
+#   define StencilFunc(...)               StencilFunc(__VA_ARGS__, __FILE__, __LINE__)
+#   define StencilOp(...)                 StencilOp(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexImage3D(...)                TexImage3D(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexSubImage3D(...)             TexSubImage3D(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetProgramInfoLog(...)         GetProgramInfoLog(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindAttribLocation(...)        BindAttribLocation(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindFragDataLocation(...)      BindFragDataLocation(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexSubImage2D(...)             TexSubImage2D(__VA_ARGS__, __FILE__, __LINE__)
+#   define DrawBuffer(...)                DrawBuffer(__VA_ARGS__, __FILE__, __LINE__)
+#   define ReadBuffer(...)                ReadBuffer(__VA_ARGS__, __FILE__, __LINE__)
+#   define BufferSubData(...)             BufferSubData(__VA_ARGS__, __FILE__, __LINE__)
+#   define PolygonOffset(...)             PolygonOffset(__VA_ARGS__, __FILE__, __LINE__)
+#   define DepthRange(...)                DepthRange(__VA_ARGS__, __FILE__, __LINE__)
+#   define ProgramParameteri(...)         ProgramParameteri(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetProgramBinary(...)          GetProgramBinary(__VA_ARGS__, __FILE__, __LINE__)
+#   define ProgramBinary(...)             ProgramBinary(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindBufferBase(...)            BindBufferBase(__VA_ARGS__, __FILE__, __LINE__)
+#   define BindBufferRange(...)           BindBufferRange(__VA_ARGS__, __FILE__, __LINE__)
+#   define GetUniformBlockIndex(...)      GetUniformBlockIndex(__VA_ARGS__, __FILE__, __LINE__)
+#   define UniformBlockBinding(...)       UniformBlockBinding(__VA_ARGS__, __FILE__, __LINE__)
+#   define MapBufferRange(...)            MapBufferRange(__VA_ARGS__, __FILE__, __LINE__)
+#   define UnmapBuffer(...)               UnmapBuffer(__VA_ARGS__, __FILE__, __LINE__)
+#   define BufferStorage(...)             BufferStorage(__VA_ARGS__, __FILE__, __LINE__)
+#   define FenceSync(...)                 FenceSync(__VA_ARGS__, __FILE__, __LINE__)
+#   define ClientWaitSync(...)            ClientWaitSync(__VA_ARGS__, __FILE__, __LINE__)
+#   define DeleteSync(...)                DeleteSync(__VA_ARGS__, __FILE__, __LINE__)
+#   define DrawElementsInstanced(...)     DrawElementsInstanced(__VA_ARGS__, __FILE__, __LINE__)
+#   define VertexAttribDivisor(...)       VertexAttribDivisor(__VA_ARGS__, __FILE__, __LINE__)
+#   define MultiDrawElementsIndirect(...) MultiDrawElementsIndirect(__VA_ARGS__, __FILE__, __LINE__)
+#   define TexStorage3D(...)              TexStorage3D(__VA_ARGS__, __FILE__, __LINE__)
+#   define CopyImageSubData(...)          CopyImageSubData(__VA_ARGS__, __FILE__, __LINE__)
 #endif
 #endif
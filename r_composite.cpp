@@ -78,8 +78,8 @@ void composite::update(const m::perspective &p) {
     gl::BindTexture(format, m_texture);
     gl::TexImage2D(format, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA,
         GL_FLOAT, nullptr);
-    gl::TexParameteri(format, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    gl::TexParameteri(format, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl::TexParameteri(format, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl::TexParameteri(format, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     gl::TexParameteri(format, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     gl::TexParameteri(format, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
@@ -95,12 +95,14 @@ bool composite::init(const m::perspective &p, GLuint depth) {
 
     const GLenum format = gl::has(gl::ARB_texture_rectangle) ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D;
 
-    // output composite
+    // output composite, filtered as it's upscaled when rendered at a lower
+    // resolution than the window. Texels are sampled at their centers
+    // otherwise so this makes no difference then
     gl::BindTexture(format, m_texture);
     gl::TexImage2D(format, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_FLOAT,
         nullptr);
-    gl::TexParameteri(format, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    gl::TexParameteri(format, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl::TexParameteri(format, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl::TexParameteri(format, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     gl::TexParameteri(format, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     gl::TexParameteri(format, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     gl::FramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, format,
@@ -29,7 +29,7 @@ void gBuffer::update(const m::perspective &p) {
     const size_t width = p.width;
     const size_t height = p.height;
 
-    if (m_width == width && m_height != height)
+    if (m_width == width && m_height == height)
         return;
 
     const GLenum format = gl::has(gl::ARB_texture_rectangle) ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D;
@@ -4,6 +4,7 @@
 #include "r_gui.h"
 #include "r_pipeline.h"
 #include "r_model.h"
+#include "r_buffer.h"
 
 #include "u_file.h"
 #include "u_misc.h"
@@ -302,15 +303,12 @@ static const size_t kAtlasSize = 1024;
 
 gui::gui()
     : m_vao(0)
-    , m_bufferIndex(0)
     , m_notex(nullptr)
     , m_atlasData(new unsigned char[kAtlasSize*kAtlasSize*4])
     , m_atlasTexture(0)
     , m_miscTexture(0)
     , m_coalesced(0)
 {
-    memset(m_vbos, 0, sizeof m_vbos);
-
     for (size_t i = 0; i < kCircleVertices; ++i) {
         const float a = float(i) / float(kCircleVertices) * m::kTau;
         const m::vec2 sc = m::sincos(a);
@@ -327,8 +325,6 @@ gui::gui()
 gui::~gui() {
     if (m_vao)
         gl::DeleteVertexArrays(1, &m_vao);
-    if (m_vbos[0])
-        gl::DeleteBuffers(sizeof m_vbos / sizeof *m_vbos, m_vbos);
     for (auto &it : m_models)
         delete it.second;
     for (auto &it : m_modelTextures)
@@ -474,21 +470,16 @@ bool gui::upload() {
     gl::TexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 0, 0, 0, GL_RGBA,
         GL_UNSIGNED_BYTE, nullptr);
 
+    // the vertices are streamed, the attributes are pointed at them when drawn
+    if (!streamBuffers::instance().init())
+        return false;
+
     gl::GenVertexArrays(1, &m_vao);
     gl::BindVertexArray(m_vao);
     gl::EnableVertexAttribArray(0);
     gl::EnableVertexAttribArray(1);
     gl::EnableVertexAttribArray(2);
 
-    gl::GenBuffers(sizeof m_vbos / sizeof *m_vbos, m_vbos);
-    for (auto &vbo : m_vbos) {
-        gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
-        gl::BufferData(GL_ARRAY_BUFFER, sizeof(vertex), 0, GL_DYNAMIC_DRAW);
-        gl::VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::position));
-        gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::coordinate));
-        gl::VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::color));
-    }
-
     // Rendering methods for GUI
     if (!m_methods[kMethodNormal].init())
         return false;
@@ -517,7 +508,7 @@ bool gui::upload() {
     return true;
 }
 
-void gui::render(const pipeline &pl) {
+void gui::render(const pipeline &pl, const ::gui::Queue &queue) {
     auto perspective = pl.perspective();
 
     gl::Disable(GL_DEPTH_TEST);
@@ -537,7 +528,7 @@ void gui::render(const pipeline &pl) {
         m_resolution = resolution;
     }
 
-    for (const auto &it : ::gui::commands()()) {
+    for (const auto &it : queue()) {
         U_ASSERT(it.type != -1);
 #if defined(DEBUG_GUI)
         printCommand(it);
@@ -623,21 +614,17 @@ void gui::render(const pipeline &pl) {
     if (m_batches.empty())
         return;
 
-    GLuint &vbo = m_vbos[m_bufferIndex];
-    m_bufferIndex = (m_bufferIndex + 1) % (sizeof m_vbos / sizeof *m_vbos);
-
-    // Invalidate next buffer a frame in advance to hint the driver that we're
-    // doing double-buffering
-    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbos[m_bufferIndex]);
-    gl::BufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
-
     // Blast it all out in one giant shot
+    auto &stream = streamBuffers::instance();
+    const size_t offset = stream.write(&m_vertices[0], m_vertices.size() * sizeof(vertex));
     gl::BindVertexArray(m_vao);
-    gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
-    gl::BufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(vertex), &m_vertices[0], GL_DYNAMIC_DRAW);
-    gl::VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::position));
-    gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::coordinate));
-    gl::VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(vertex), u::offset_of(&vertex::color));
+    gl::BindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    gl::VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertex),
+        (const GLvoid *)(offset + size_t(u::offset_of(&vertex::position))));
+    gl::VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(vertex),
+        (const GLvoid *)(offset + size_t(u::offset_of(&vertex::coordinate))));
+    gl::VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(vertex),
+        (const GLvoid *)(offset + size_t(u::offset_of(&vertex::color))));
 
     enum { kTextureText, kTextureMisc, kTextureAtlas };
     int texture = -1;
@@ -659,7 +646,7 @@ void gui::render(const pipeline &pl) {
         b++;
     };
 
-    for (auto &it : ::gui::commands()()) {
+    for (auto &it : queue()) {
         if (it.type == ::gui::kCommandModel) {
             gl::Enable(GL_DEPTH_TEST);
             gl::Clear(GL_DEPTH_BUFFER_BIT);
@@ -675,11 +662,11 @@ void gui::render(const pipeline &pl) {
                 m_modelScrollMethod.enable();
                 m_modelScrollMethod.setScroll(it.asModel.su, it.asModel.sv, p.time() * -0.00001f);
                 m_modelScrollMethod.setWorld(p.world());
-                m_modelScrollMethod.setWVP(p.projection() * p.view() * p.world());
+                m_modelScrollMethod.setWVP(p.worldViewProjection());
             } else {
                 m_modelMethod.enable();
                 m_modelMethod.setWorld(p.world());
-                m_modelMethod.setWVP(p.projection() * p.view() * p.world());
+                m_modelMethod.setWVP(p.worldViewProjection());
             }
             mdl->render();
             gl::Disable(GL_DEPTH_TEST);
@@ -10,6 +10,10 @@ namespace m {
     struct perspective;
 }
 
+namespace gui {
+    struct Queue;
+}
+
 namespace r {
 
 struct model;
@@ -52,7 +56,7 @@ struct gui {
     ~gui();
     bool load(const u::string &font);
     bool upload();
-    void render(const pipeline &pl);
+    void render(const pipeline &pl, const ::gui::Queue &queue);
 
 protected:
     template <size_t E>
@@ -146,9 +150,7 @@ private:
     float m_normals[kCoordCount * 2];
     float m_circleVertices[kCircleVertices * 2];
 
-    GLuint m_vbos[2];
     GLuint m_vao;
-    unsigned char m_bufferIndex;
 
     u::map<u::string, texture2D*> m_modelTextures;
     u::map<u::string, atlas::node*> m_textures;
@@ -14,6 +14,45 @@ size_t spotLight::hash() const {
     return pointLight::hash() ^ u::hash((const unsigned char *)this, sizeof *this);
 }
 
+///! Uniform Blocks
+frameBlock::frameBlock(const m::perspective &p, const m::vec3 &eye, const m::mat4 &inverse, const r::fog &f)
+    : inverse(inverse)
+    , eyeWorldPosition { eye.x, eye.y, eye.z, 0.0f }
+    , screenSize { p.width, p.height }
+    , screenFrustum { p.nearp, p.farp }
+    , fog { { f.color.x, f.color.y, f.color.z, 0.0f }, { f.start, f.end, f.density, 0.0f } }
+    , fogEquation(f.equation)
+    , padding { 0, 0, 0 }
+{
+}
+
+lightBlock::lightBlock(const m::mat4 &wvp, const directionalLight &light)
+    : wvp(wvp)
+    , lightWVP(m::mat4::kIdentity)
+    , light { { light.color, light.ambient },
+              { light.direction.normalized(), light.diffuse },
+              { 0.0f, 0.0f, 0.0f, 0.0f } }
+{
+}
+
+lightBlock::lightBlock(const m::mat4 &wvp, const m::mat4 &lightWVP, const pointLight &light, const m::vec2 &shadowFace)
+    : wvp(wvp)
+    , lightWVP(lightWVP)
+    , light { { light.color, light.diffuse },
+              { light.position, light.radius },
+              { shadowFace.x, shadowFace.y, 0.0f, 0.0f } }
+{
+}
+
+lightBlock::lightBlock(const m::mat4 &wvp, const m::mat4 &lightWVP, const spotLight &light)
+    : wvp(wvp)
+    , lightWVP(lightWVP)
+    , light { { light.color, light.diffuse },
+              { light.position, light.radius },
+              { light.direction.normalized(), m::cos(m::toRadian(light.cutOff)) } }
+{
+}
+
 ///! Light Rendering Method
 lightMethod::lightMethod()
     : m_WVP(nullptr)
@@ -39,6 +78,8 @@ bool lightMethod::init(const char *vs,
 
     if (gl::has(gl::ARB_texture_rectangle))
         method::define("HAS_TEXTURE_RECTANGLE");
+    if (uniformBlocks())
+        method::define("USE_UNIFORM_BLOCKS");
 
     for (const auto &it : defines)
         method::define(it);
@@ -154,6 +195,7 @@ bool pointLightMethod::init(const u::vector<const char *> &defines) {
     m_light1 = getUniform("gPointLight[1]", uniform::kVec4);
 
     m_lightWVP = getUniform("gLightWVP", uniform::kMat4);
+    m_shadowFace = getUniform("gShadowFace", uniform::kVec2);
 
     post();
     return true;
@@ -168,6 +210,10 @@ void pointLightMethod::setLightWVP(const m::mat4 &wvp) {
     m_lightWVP->set(wvp);
 }
 
+void pointLightMethod::setShadowFace(const m::vec2 &size) {
+    m_shadowFace->set(size);
+}
+
 ///! Spot Light Rendering Method
 bool spotLightMethod::init(const u::vector<const char *> &defines) {
     if (!lightMethod::init("shaders/slight.vs",
@@ -196,4 +242,37 @@ void spotLightMethod::setLightWVP(const m::mat4 &wvp) {
     m_lightWVP->set(wvp);
 }
 
+///! Clustered Light Rendering Method
+bool clusteredLightMethod::init(const u::vector<const char *> &defines) {
+    if (!lightMethod::init("shaders/clight.vs",
+                           "shaders/clight.fs",
+                           "clustered lighting",
+                           defines))
+        return false;
+
+    m_clusterGrid = getUniform("gClusterGrid", uniform::kVec4);
+    m_clusterMapTextureUnit = getUniform("gClusterMap", uniform::kSampler);
+    m_lightIndexMapTextureUnit = getUniform("gLightIndexMap", uniform::kSampler);
+    m_lightMapTextureUnit = getUniform("gLightMap", uniform::kSampler);
+
+    post();
+    return true;
+}
+
+void clusteredLightMethod::setClusterGrid(const m::vec4 &grid) {
+    m_clusterGrid->set(grid);
+}
+
+void clusteredLightMethod::setClusterMapTextureUnit(int unit) {
+    m_clusterMapTextureUnit->set(unit);
+}
+
+void clusteredLightMethod::setLightIndexMapTextureUnit(int unit) {
+    m_lightIndexMapTextureUnit->set(unit);
+}
+
+void clusteredLightMethod::setLightMapTextureUnit(int unit) {
+    m_lightMapTextureUnit->set(unit);
+}
+
 }
@@ -62,6 +62,30 @@ inline spotLight::spotLight()
 {
 }
 
+// std140 layout of the neoFrame uniform block: the per frame constants of the
+// light methods
+struct frameBlock {
+    frameBlock(const m::perspective &p, const m::vec3 &eye, const m::mat4 &inverse, const r::fog &f);
+    m::mat4 inverse;
+    float eyeWorldPosition[4];
+    float screenSize[2];
+    float screenFrustum[2];
+    float fog[2][4];
+    int32_t fogEquation;
+    int32_t padding[3];
+};
+
+// std140 layout of the neoLight uniform block: the per light constants of the
+// light methods
+struct lightBlock {
+    lightBlock(const m::mat4 &wvp, const directionalLight &light);
+    lightBlock(const m::mat4 &wvp, const m::mat4 &lightWVP, const pointLight &light, const m::vec2 &shadowFace);
+    lightBlock(const m::mat4 &wvp, const m::mat4 &lightWVP, const spotLight &light);
+    m::mat4 wvp;
+    m::mat4 lightWVP;
+    m::vec4 light[3];
+};
+
 struct lightMethod : method {
     lightMethod();
 
@@ -76,7 +100,10 @@ struct lightMethod : method {
         kNormal = gBuffer::kNormal,
         kDepth  = gBuffer::kDepth,
         kShadowMap,
-        kOcclusion
+        kOcclusion,
+        kClusterMap,
+        kLightIndexMap,
+        kLightMap
     };
 
     void setWVP(const m::mat4 &wvp);
@@ -124,11 +151,13 @@ struct pointLightMethod : lightMethod {
 
     void setLight(const pointLight &light);
     void setLightWVP(const m::mat4 &wvp);
+    void setShadowFace(const m::vec2 &size);
 
 private:
     uniform *m_light0; // { r, g, b, diffuse }
     uniform *m_light1; // { pos.x, pos.y, pos.z, radius }
     uniform *m_lightWVP;
+    uniform *m_shadowFace; // { width, height } of a face in the shadow map
 };
 
 struct spotLightMethod : lightMethod {
@@ -144,6 +173,22 @@ private:
     uniform *m_lightWVP;
 };
 
+// shades all lights of the lightClusters in a single screen space pass
+struct clusteredLightMethod : lightMethod {
+    bool init(const u::vector<const char *> &defines = u::vector<const char *>());
+
+    void setClusterGrid(const m::vec4 &grid);
+    void setClusterMapTextureUnit(int unit);
+    void setLightIndexMapTextureUnit(int unit);
+    void setLightMapTextureUnit(int unit);
+
+private:
+    uniform *m_clusterGrid; // { tiles x, tiles y, slice scale, slice bias }
+    uniform *m_clusterMapTextureUnit;
+    uniform *m_lightIndexMapTextureUnit;
+    uniform *m_lightMapTextureUnit;
+};
+
 }
 
 #endif
@@ -264,6 +264,10 @@ void method::post() {
     }
 }
 
+bool method::uniformBlocks() {
+    return gl::has(gl::ARB_uniform_buffer_object) && gl::glslVersion() >= 140;
+}
+
 uniform *method::getUniform(const u::string &name, uniform::type type) {
     auto *const value = &m_uniforms[name];
     value->m_type = type;
@@ -469,6 +473,16 @@ bool method::finalize(const u::initializer_list<const char *> &attributes,
         }
     }
 
+    // Linking resets the binding points of the uniform blocks
+    if (uniformBlocks()) {
+        static const char *kBlocks[] = { "neoFrame", "neoLight", "neoMaterial" };
+        for (GLuint i = 0; i < sizeof kBlocks / sizeof *kBlocks; i++) {
+            const GLuint index = gl::GetUniformBlockIndex(m_program, kBlocks[i]);
+            if (index != GL_INVALID_INDEX)
+                gl::UniformBlockBinding(m_program, index, i);
+        }
+    }
+
     // Make a copy of these for reloads
     m_attributes = attributes;
     m_fragData = fragData;
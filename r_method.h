@@ -76,6 +76,13 @@ inline uniform::uniform(type t)
 struct method {
     static constexpr size_t kMat3x4Space = 80;
 
+    // Binding points of the uniform blocks shared between methods
+    enum : GLuint {
+        kFrameBlock,    // neoFrame
+        kLightBlock,    // neoLight
+        kMaterialBlock  // neoMaterial
+    };
+
     method();
     ~method();
 
@@ -91,6 +98,9 @@ struct method {
 
     uniform *getUniform(const u::string &name, uniform::type type);
 
+    // true when methods can source uniforms from uniform buffers
+    static bool uniformBlocks();
+
 protected:
     bool addShader(GLenum shaderType, const char *shaderText);
 
@@ -7,6 +7,7 @@
 #include "u_misc.h"
 #include "u_file.h"
 #include "u_log.h"
+#include "u_assert.h"
 
 #include "c_console.h"
 
@@ -19,6 +20,9 @@ bool geomMethod::init(const u::vector<const char *> &defines) {
     if (!method::init("geometry"))
         return false;
 
+    if (uniformBlocks())
+        method::define("USE_UNIFORM_BLOCKS");
+
     for (const auto &it : defines)
         method::define(it);
 
@@ -27,13 +31,15 @@ bool geomMethod::init(const u::vector<const char *> &defines) {
     if (!addShader(GL_FRAGMENT_SHADER, "shaders/geom.fs"))
         return false;
 
-    if (!finalize({ "position", "normal", "texCoord", "tangent", "weights", "bones" },
+    if (!finalize({ "position", "normal", "texCoord", "tangent", "weights", "bones",
+                    "materialLayers", "materialParams", "instanceWorld" },
                   { "diffuseOut", "normalOut" }))
     {
         return false;
     }
 
     m_WVP = getUniform("gWVP", uniform::kMat4);
+    m_VP = getUniform("gVP", uniform::kMat4);
     m_world = getUniform("gWorld", uniform::kMat4);
     m_colorTextureUnit = getUniform("gColorMap", uniform::kSampler);
     m_normalTextureUnit = getUniform("gNormalMap", uniform::kSampler);
@@ -56,6 +62,10 @@ void geomMethod::setWVP(const m::mat4 &wvp) {
     m_WVP->set(wvp);
 }
 
+void geomMethod::setVP(const m::mat4 &vp) {
+    m_VP->set(vp);
+}
+
 void geomMethod::setWorld(const m::mat4 &worldInverse) {
     m_world->set(worldInverse);
 }
@@ -128,7 +138,9 @@ enum {
     kGeomPermSpecParams     = 1 << 3,
     kGeomPermParallax       = 1 << 4,
     kGeomPermSkeletal       = 1 << 5,
-    kGeomPermAnimated       = 1 << 6
+    kGeomPermAnimated       = 1 << 6,
+    kGeomPermInstanced      = 1 << 7,
+    kGeomPermTextureArray   = 1 << 8
 };
 
 ///! Geometry shading permutation singleton
@@ -146,6 +158,16 @@ static const geomPermutation kGeomPermutations[] = {
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermParallax,                                                               0,  1, -1,  2 },
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermParallax,                                         0,  1,  2,  3 },
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermParallax,                                         0,  1, -1,  2 },
+    // Geometry permutations (texture arrays)
+    { kGeomPermDiffuse | kGeomPermTextureArray,                                                                                 0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermTextureArray,                                                           0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecMap    | kGeomPermTextureArray,                                                           0, -1,  1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecParams | kGeomPermTextureArray,                                                           0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermTextureArray,                                     0,  1,  2, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermTextureArray,                                     0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermParallax   | kGeomPermTextureArray,                                     0,  1, -1,  2 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermParallax | kGeomPermTextureArray,                 0,  1,  2,  3 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermParallax | kGeomPermTextureArray,                 0,  1, -1,  2 },
     // Geometry permutations (animated)
     { kGeomPermDiffuse | kGeomPermAnimated,                                                                                     0, -1, -1, -1 },
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermAnimated,                                                               0,  1, -1, -1 },
@@ -157,6 +179,27 @@ static const geomPermutation kGeomPermutations[] = {
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermParallax   | kGeomPermAnimated,                                         0,  1, -1,  2 },
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermParallax | kGeomPermAnimated,                     0,  1,  2,  3 },
     { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermParallax | kGeomPermAnimated,                     0,  1, -1,  2 },
+    // Geometry permutations (instanced)
+    { kGeomPermDiffuse | kGeomPermInstanced,                                                                                    0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap | kGeomPermInstanced,                                                               0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecMap | kGeomPermInstanced,                                                                 0, -1,  1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecParams | kGeomPermInstanced,                                                              0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap | kGeomPermInstanced,                                                               0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap | kGeomPermInstanced,                                           0,  1,  2, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermInstanced,                                        0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermParallax | kGeomPermInstanced,                                          0,  1, -1,  2 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermParallax | kGeomPermInstanced,                    0,  1,  2,  3 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermParallax | kGeomPermInstanced,                    0,  1, -1,  2 },
+    { kGeomPermDiffuse | kGeomPermAnimated | kGeomPermInstanced,                                                                0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermAnimated | kGeomPermInstanced,                                          0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecMap    | kGeomPermAnimated | kGeomPermInstanced,                                          0, -1,  1, -1 },
+    { kGeomPermDiffuse | kGeomPermSpecParams | kGeomPermAnimated | kGeomPermInstanced,                                          0, -1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermAnimated | kGeomPermInstanced,                                          0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermAnimated | kGeomPermInstanced,                    0,  1,  2, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermAnimated | kGeomPermInstanced,                    0,  1, -1, -1 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermParallax   | kGeomPermAnimated | kGeomPermInstanced,                    0,  1, -1,  2 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecMap    | kGeomPermParallax | kGeomPermAnimated | kGeomPermInstanced, 0,  1,  2,  3 },
+    { kGeomPermDiffuse | kGeomPermNormalMap  | kGeomPermSpecParams | kGeomPermParallax | kGeomPermAnimated | kGeomPermInstanced, 0,  1, -1,  2 },
     // Skeletal permutations (static)
     { kGeomPermSkeletal,                                                                                                       -1, -1, -1, -1 },
     { kGeomPermDiffuse | kGeomPermSkeletal,                                                                                     0, -1, -1, -1 },
@@ -190,18 +233,26 @@ static const char *kGeomPermutationNames[] = {
     "USE_SPECPARAMS",
     "USE_PARALLAX",
     "USE_SKELETAL",
-    "USE_ANIMATION"
+    "USE_ANIMATION",
+    "USE_INSTANCING",
+    "USE_TEXTURE_ARRAY"
 };
 
 ///! Singleton representing all the possible geometry methods (used by model and world.)
 geomMethods::geomMethods()
     : m_geomMethods(nullptr)
+    , m_materialBuffer(0)
+    , m_materialStride(0)
     , m_initialized(false)
 {
 }
 
 void geomMethods::release() {
     delete m_geomMethods;
+    if (m_materialBuffer)
+        gl::DeleteBuffers(1, &m_materialBuffer);
+    m_materialBuffer = 0;
+    m_materialBlocks.destroy();
 }
 
 bool geomMethods::init() {
@@ -222,6 +273,15 @@ bool geomMethods::init() {
         if (p.disp   != -1) (*m_geomMethods)[i].setDispTextureUnit(p.disp);
     }
 
+    if (method::uniformBlocks()) {
+        GLint alignment = 0;
+        gl::GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        m_materialStride = sizeof(materialBlock);
+        if (alignment > 0)
+            m_materialStride = (m_materialStride + alignment - 1) / alignment * alignment;
+        gl::GenBuffers(1, &m_materialBuffer);
+    }
+
     return m_initialized = true;
 }
 
@@ -234,6 +294,26 @@ bool geomMethods::reload() {
     return true;
 }
 
+size_t geomMethods::addMaterialBlock(const materialBlock &block) {
+    for (size_t i = 0; i < m_materialBlocks.size(); i++)
+        if (!memcmp(&m_materialBlocks[i], &block, sizeof block))
+            return i * m_materialStride;
+
+    // materials are only loaded along with maps, reupload all of them
+    m_materialBlocks.push_back(block);
+    u::vector<unsigned char> contents(m_materialBlocks.size() * m_materialStride);
+    for (size_t i = 0; i < m_materialBlocks.size(); i++)
+        memcpy(&contents[i * m_materialStride], &m_materialBlocks[i], sizeof block);
+    gl::BindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+    gl::BufferData(GL_UNIFORM_BUFFER, contents.size(), &contents[0], GL_STATIC_DRAW);
+    return (m_materialBlocks.size() - 1) * m_materialStride;
+}
+
+void geomMethods::bindMaterialBlock(size_t offset) {
+    gl::BindBufferRange(GL_UNIFORM_BUFFER, method::kMaterialBlock, m_materialBuffer,
+        offset, sizeof(materialBlock));
+}
+
 geomMethods geomMethods::m_instance;
 
 ///! Model Material Loading (used by model and world.)
@@ -243,6 +323,7 @@ material::material()
     , normal(nullptr)
     , spec(nullptr)
     , displacement(nullptr)
+    , arrays(nullptr)
     , specParams(false)
     , specPower(0.0f)
     , specIntensity(0.0f)
@@ -262,6 +343,7 @@ material::material()
     , m_scrollRateU(0)
     , m_scrollRateV(0)
     , m_scrollMillis(0)
+    , m_materialBlock(0)
     , m_geomMethods(&geomMethods::instance())
 {
 }
@@ -425,16 +507,20 @@ bool material::upload() {
         return false;
     if (displacement && !displacement->upload())
         return false;
+    if (method::uniformBlocks())
+        m_materialBlock = m_geomMethods->addMaterialBlock({ { dispScale, dispBias }, specPower, specIntensity });
     return true;
 }
 
-void material::calculatePermutation(bool skeletal) {
+void material::calculatePermutation(bool skeletal, bool instanced) {
     c::Variable<int> &spec_ = c::Console::value<int>("r_spec");
     c::Variable<int> &parallax_ = c::Console::value<int>("r_parallax");
 
     int p = 0;
     if (skeletal)
         p |= kGeomPermSkeletal;
+    if (instanced)
+        p |= kGeomPermInstanced;
     if (m_animFrames)
         p |= kGeomPermAnimated;
     if (diffuse)
@@ -447,6 +533,8 @@ void material::calculatePermutation(bool skeletal) {
         p |= kGeomPermParallax;
     if (specParams && spec_.get())
         p |= kGeomPermSpecParams;
+    if (arrays)
+        p |= kGeomPermTextureArray;
     for (auto &it : kGeomPermutations) {
         if (it.permute == p) {
             permute = &it - kGeomPermutations;
@@ -455,29 +543,42 @@ void material::calculatePermutation(bool skeletal) {
     }
 }
 
-geomMethod *material::bind(const r::pipeline &pl, const m::mat4 &rw, bool skeletal) {
-    calculatePermutation(skeletal);
-    auto &permutation = kGeomPermutations[permute];
-    auto &method = (*m_geomMethods)[permute];
+geomMethod *material::bind(const r::pipeline &pl, const m::mat4 &rw, bool skeletal, bool instanced) {
+    calculatePermutation(skeletal, instanced);
+    auto &method = this->method();
     method.enable();
-    method.setWVP(pl.projection() * pl.view() * pl.world());
-    method.setWorld(rw);
-    if (permutation.permute & kGeomPermParallax) {
-        method.setEyeWorldPos(pl.position());
-        method.setParallax(dispScale, dispBias);
-    }
-    if (permutation.permute & kGeomPermSpecParams) {
-        method.setSpecIntensity(specIntensity);
-        method.setSpecPower(specPower);
+    bindUniforms(method, pl, rw);
+    bindTextures();
+    return &method;
+}
+
+geomMethod &material::method() {
+    return (*m_geomMethods)[permute];
+}
+
+void material::bindUniforms(geomMethod &method, const r::pipeline &pl, const m::mat4 &rw) {
+    auto &permutation = kGeomPermutations[permute];
+    if (permutation.permute & kGeomPermInstanced) {
+        // world matrices are sourced from the instance buffer
+        method.setVP(pl.viewProjection());
+    } else {
+        method.setWVP(pl.worldViewProjection());
+        method.setWorld(rw);
     }
-    if (permutation.permute & kGeomPermDiffuse)
-        diffuse->bind(GL_TEXTURE0 + permutation.color);
-    if (permutation.permute & kGeomPermNormalMap)
-        normal->bind(GL_TEXTURE0 + permutation.normal);
-    if (permutation.permute & kGeomPermSpecMap)
-        spec->bind(GL_TEXTURE0 + permutation.spec);
     if (permutation.permute & kGeomPermParallax)
-        displacement->bind(GL_TEXTURE0 + permutation.disp);
+        method.setEyeWorldPos(pl.position());
+    // materials drawn from texture arrays source their constants per draw
+    const bool constants = !(permutation.permute & kGeomPermTextureArray);
+    if (constants && method::uniformBlocks()) {
+        m_geomMethods->bindMaterialBlock(m_materialBlock);
+    } else if (constants) {
+        if (permutation.permute & kGeomPermParallax)
+            method.setParallax(dispScale, dispBias);
+        if (permutation.permute & kGeomPermSpecParams) {
+            method.setSpecIntensity(specIntensity);
+            method.setSpecPower(specPower);
+        }
+    }
     if (m_animFrames) {
         const float mspf = 1.0f / (float(m_animFramerate) / 1000.0f);
         if (pl.time() - m_animMillis >= mspf) {
@@ -491,7 +592,66 @@ geomMethod *material::bind(const r::pipeline &pl, const m::mat4 &rw, bool skelet
             m_animMillis = pl.time();
         }
     }
-    return &method;
+}
+
+size_t material::bindTextures() {
+    auto &permutation = kGeomPermutations[permute];
+    size_t count = 0;
+    if (permutation.permute & kGeomPermTextureArray) {
+        if (permutation.permute & kGeomPermDiffuse) {
+            arrays->diffuse->bind(GL_TEXTURE0 + permutation.color);
+            count++;
+        }
+        if (permutation.permute & kGeomPermNormalMap) {
+            arrays->normal->bind(GL_TEXTURE0 + permutation.normal);
+            count++;
+        }
+        if (permutation.permute & kGeomPermSpecMap) {
+            arrays->spec->bind(GL_TEXTURE0 + permutation.spec);
+            count++;
+        }
+        if (permutation.permute & kGeomPermParallax) {
+            arrays->displacement->bind(GL_TEXTURE0 + permutation.disp);
+            count++;
+        }
+        return count;
+    }
+    if (permutation.permute & kGeomPermDiffuse) {
+        diffuse->bind(GL_TEXTURE0 + permutation.color);
+        count++;
+    }
+    if (permutation.permute & kGeomPermNormalMap) {
+        normal->bind(GL_TEXTURE0 + permutation.normal);
+        count++;
+    }
+    if (permutation.permute & kGeomPermSpecMap) {
+        spec->bind(GL_TEXTURE0 + permutation.spec);
+        count++;
+    }
+    if (permutation.permute & kGeomPermParallax) {
+        displacement->bind(GL_TEXTURE0 + permutation.disp);
+        count++;
+    }
+    return count;
+}
+
+bool material::animated() const {
+    return m_animFrames;
+}
+
+void material::instance(materialInstance &instance) const {
+    instance.params[0] = dispScale;
+    instance.params[1] = dispBias;
+    instance.params[2] = specParams ? specPower : 0.0f;
+    instance.params[3] = specParams ? specIntensity : 0.0f;
+}
+
+size_t material::textures() const {
+    const int flags = kGeomPermutations[permute].permute;
+    return !!(flags & kGeomPermDiffuse)
+         + !!(flags & kGeomPermNormalMap)
+         + !!(flags & kGeomPermSpecMap)
+         + !!(flags & kGeomPermParallax);
 }
 
 ///! Model Loading and Rendering
@@ -767,6 +927,30 @@ void model::render(const r::pipeline &pl, const m::mat4 &w) {
     }
 }
 
+void model::render(const r::pipeline &pl, GLuint buffer, size_t offset, size_t count) {
+    U_ASSERT(!animated());
+    gl::BindVertexArray(vao);
+
+    // one row of the world matrix per attribute, advanced once per instance
+    gl::BindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (GLuint i = 0; i < 4; i++) {
+        const GLuint index = geomMethod::kInstanceWorld + i;
+        gl::VertexAttribPointer(index, 4, GL_FLOAT, GL_FALSE, sizeof(m::mat4),
+            (const GLvoid *)(offset + sizeof(float[4]) * i));
+        gl::VertexAttribDivisor(index, 1);
+        gl::EnableVertexAttribArray(index);
+    }
+
+    for (const auto &it : m_batches) {
+        m_materials[it.material].bind(pl, m::mat4::kIdentity, false, true);
+        gl::DrawElementsInstanced(GL_TRIANGLES, it.count, GL_UNSIGNED_INT, it.offset, count);
+    }
+
+    // the instance buffer is only valid for this draw
+    for (GLuint i = 0; i < 4; i++)
+        gl::DisableVertexAttribArray(geomMethod::kInstanceWorld + i);
+}
+
 void model::render() {
     gl::BindVertexArray(vao);
     m_materials[0].diffuse->bind(GL_TEXTURE0);
@@ -13,13 +13,21 @@ namespace r {
 
 struct pipeline;
 struct texture2D;
+struct texture2DArray;
 
 struct geomMethod : method {
+    // the texture layers and constants of a material drawn from texture arrays
+    static constexpr GLuint kMaterialLayers = 6;
+    static constexpr GLuint kMaterialParams = 7;
+    // the world matrix of an instance occupies four attributes starting here
+    static constexpr GLuint kInstanceWorld = 8;
+
     geomMethod();
 
     bool init(const u::vector<const char *> &defines = u::vector<const char *>());
 
     void setWVP(const m::mat4 &wvp);
+    void setVP(const m::mat4 &vp);
     void setWorld(const m::mat4 &wvp);
     void setColorTextureUnit(int unit);
     void setNormalTextureUnit(int unit);
@@ -35,6 +43,7 @@ struct geomMethod : method {
 
 private:
     uniform *m_WVP;
+    uniform *m_VP;
     uniform *m_world;
     uniform *m_colorTextureUnit;
     uniform *m_normalTextureUnit;
@@ -54,6 +63,7 @@ private:
 
 inline geomMethod::geomMethod()
     : m_WVP(nullptr)
+    , m_VP(nullptr)
     , m_world(nullptr)
     , m_colorTextureUnit(nullptr)
     , m_normalTextureUnit(nullptr)
@@ -72,6 +82,13 @@ inline geomMethod::geomMethod()
 {
 }
 
+// std140 layout of the neoMaterial uniform block
+struct materialBlock {
+    float parallax[2];
+    float specPower;
+    float specIntensity;
+};
+
 struct geomMethods {
     static geomMethods &instance() {
         return m_instance;
@@ -83,12 +100,20 @@ struct geomMethods {
     geomMethod &operator[](size_t index);
     const geomMethod &operator[](size_t index) const;
 
+    // materials with the same constants share a uniform block in a single
+    // buffer: returns the offset of the block in it
+    size_t addMaterialBlock(const materialBlock &block);
+    void bindMaterialBlock(size_t offset);
+
 private:
     geomMethods();
     geomMethods(const geomMethods &) = delete;
     void operator =(const geomMethods &) = delete;
 
     u::vector<geomMethod> *m_geomMethods;
+    u::vector<materialBlock> m_materialBlocks;
+    GLuint m_materialBuffer;
+    size_t m_materialStride;
     bool m_initialized;
     static geomMethods m_instance;
 };
@@ -101,6 +126,22 @@ inline const geomMethod &geomMethods::operator[](size_t index) const {
     return (*m_geomMethods)[index];
 }
 
+// The texture arrays holding the textures of materials which are drawn
+// together. Which layer of them and which constants are used is sourced per
+// draw from the attributes of the material
+struct materialArrays {
+    texture2DArray *diffuse;
+    texture2DArray *normal;
+    texture2DArray *spec;
+    texture2DArray *displacement;
+};
+
+// Layout of the per draw attributes of a material drawn from texture arrays
+struct materialInstance {
+    float layers[4]; // { diffuse, normal, spec, displacement }
+    float params[4]; // { parallax scale, parallax bias, spec power, spec intensity }
+};
+
 struct material {
     material();
 
@@ -109,17 +150,32 @@ struct material {
     texture2D *normal;
     texture2D *spec;
     texture2D *displacement;
+    // when set the textures are bound from these arrays instead, the ones
+    // above only decide the permutation
+    const materialArrays *arrays;
     bool specParams;
     float specPower;
     float specIntensity;
     float dispScale;
     float dispBias;
 
-    void calculatePermutation(bool skeletal = false);
-    geomMethod *bind(const r::pipeline &pl, const m::mat4 &rw, bool skeletal = false);
+    void calculatePermutation(bool skeletal = false, bool instanced = false);
+    geomMethod *bind(const r::pipeline &pl, const m::mat4 &rw, bool skeletal = false, bool instanced = false);
+
+    // the individual steps of bind: the method is the one of the last
+    // calculated permutation
+    geomMethod &method();
+    void bindUniforms(geomMethod &method, const r::pipeline &pl, const m::mat4 &rw);
+    size_t bindTextures(); // returns the number of textures bound
+    size_t textures() const; // the number of textures bindTextures binds
     geomMethod *bind(geomMethod &method, const pipeline &pl, bool skeletal = false);
     bool load(u::map<u::string, texture2D*> &textures, const u::string &file, const u::string &basePath);
     bool upload();
+
+    // animated materials can't share a draw with other materials
+    bool animated() const;
+    // the constants of the material as sourced per draw
+    void instance(materialInstance &instance) const;
 private:
     int m_animFrameWidth;    // The width of one frame of animation
     int m_animFrameHeight;   // The height of one frame of animation
@@ -137,6 +193,8 @@ private:
     int m_scrollRateV;       // The scroll rate for V
     uint32_t m_scrollMillis; // The last scroll update time
 
+    size_t m_materialBlock;  // Offset of the uniform block of the material
+
     geomMethods *m_geomMethods;
 };
 
@@ -148,10 +206,14 @@ struct model : geom {
     bool upload();
 
     void render(const r::pipeline &pl, const m::mat4 &w);
+    // instanced rendering: the world matrices of `count' instances are sourced
+    // from `buffer' starting at `offset'
+    void render(const r::pipeline &pl, GLuint buffer, size_t offset, size_t count);
     void render(); // GUI model rendering (diffuse only, single material, entire model)
 
     void animate(float curFrame);
     bool animated() const;
+    size_t batches() const;
 
     m::vec3 scale;
     m::vec3 rotate;
@@ -172,5 +234,9 @@ inline m::bbox model::bounds() const {
     return m_model.bounds();
 }
 
+inline size_t model::batches() const {
+    return m_batches.size();
+}
+
 }
 #endif
@@ -0,0 +1,259 @@
+#include <string.h>
+#include <float.h>
+
+#include "r_occlusion.h"
+
+#include "m_bbox.h"
+
+#include "c_variable.h"
+
+#include "u_log.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+NVAR(int, r_occlusion_verify, "verify occlusion results against exhaustive tests", 0, 1, 0);
+
+namespace r {
+
+occlusionBuffer::occlusionBuffer()
+    : m_depth(kWidth * kHeight, 0.0f)
+    , m_tiles(kTilesX * kTilesY, 0.0f)
+    , m_occluders(0)
+{
+}
+
+void occlusionBuffer::clear(const m::mat4 &wvp) {
+    m_wvp = wvp;
+    m_occluders = 0;
+    memset(&m_depth[0], 0, sizeof m_depth[0] * m_depth.size());
+    memset(&m_tiles[0], 0, sizeof m_tiles[0] * m_tiles.size());
+}
+
+void occlusionBuffer::rasterize(const m::vec3 &v0, const m::vec3 &v1, const m::vec3 &v2) {
+    // transform into clip space
+    m::vec4 clip[3];
+    const m::vec3 *const points[] = { &v0, &v1, &v2 };
+    for (size_t i = 0; i < 3; i++) {
+        const m::vec4 p(*points[i], 1.0f);
+        clip[i] = { m::vec4::dot(m_wvp.a, p), m::vec4::dot(m_wvp.b, p),
+                    m::vec4::dot(m_wvp.c, p), m::vec4::dot(m_wvp.d, p) };
+    }
+
+    // clip against the near plane (z = -w): a triangle becomes at most a quad
+    m::vec4 polygon[4];
+    size_t count = 0;
+    for (size_t i = 0; i < 3; i++) {
+        const m::vec4 &a = clip[i];
+        const m::vec4 &b = clip[(i + 1) % 3];
+        const float da = a.z + a.w;
+        const float db = b.z + b.w;
+        if (da >= 0.0f)
+            polygon[count++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            const float t = da / (da - db);
+            polygon[count++] = a + (b - a) * t;
+        }
+    }
+    if (count < 3)
+        return;
+
+    // project into the buffer
+    vertex screen[4];
+    for (size_t i = 0; i < count; i++) {
+        const float w = polygon[i].w;
+        if (w <= m::kEpsilon)
+            return;
+        const float iw = 1.0f / w;
+        screen[i].x = (polygon[i].x * iw * 0.5f + 0.5f) * kWidth;
+        screen[i].y = (polygon[i].y * iw * 0.5f + 0.5f) * kHeight;
+        screen[i].z = iw;
+    }
+
+    rasterize(screen[0], screen[1], screen[2]);
+    if (count == 4)
+        rasterize(screen[0], screen[2], screen[3]);
+    m_occluders++;
+}
+
+void occlusionBuffer::rasterize(const vertex &v0, const vertex &v1, const vertex &in2) {
+    float area = (v1.x - v0.x) * (in2.y - v0.y) - (in2.x - v0.x) * (v1.y - v0.y);
+    if (m::abs(area) < m::kEpsilon)
+        return;
+
+    // occluders are double sided: make the winding counter-clockwise
+    const vertex &a = v0;
+    const vertex &b = area > 0.0f ? v1 : in2;
+    const vertex &c = area > 0.0f ? in2 : v1;
+    area = m::abs(area);
+
+    // bounding rectangle clamped to the buffer, the left edge is aligned to
+    // four pixels for the vectorized inner loop
+    const float minX = u::min(a.x, u::min(b.x, c.x));
+    const float maxX = u::max(a.x, u::max(b.x, c.x));
+    const float minY = u::min(a.y, u::min(b.y, c.y));
+    const float maxY = u::max(a.y, u::max(b.y, c.y));
+    if (maxX < 0.0f || maxY < 0.0f || minX >= kWidth || minY >= kHeight)
+        return;
+    const size_t x0 = size_t(u::max(minX, 0.0f)) & ~3_z;
+    const size_t y0 = size_t(u::max(minY, 0.0f));
+    const size_t x1 = u::min(size_t(maxX), kWidth - 1);
+    const size_t y1 = u::min(size_t(maxY), kHeight - 1);
+
+    // edge equations: e(x, y) = A*x + B*y + C which is positive inside
+    const float A0 = b.y - c.y, B0 = c.x - b.x, C0 = b.x*c.y - c.x*b.y;
+    const float A1 = c.y - a.y, B1 = a.x - c.x, C1 = c.x*a.y - a.x*c.y;
+    const float A2 = a.y - b.y, B2 = b.x - a.x, C2 = a.x*b.y - b.x*a.y;
+
+    // depth plane equation
+    const float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+    const float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+    const float z0 = a.z - dzdx * a.x - dzdy * a.y;
+
+#ifdef __SSE2__
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 A0v = _mm_set1_ps(A0);
+    const __m128 A1v = _mm_set1_ps(A1);
+    const __m128 A2v = _mm_set1_ps(A2);
+    const __m128 dzdxv = _mm_set1_ps(dzdx);
+    for (size_t y = y0; y <= y1; y++) {
+        const float py = y + 0.5f;
+        const __m128 E0 = _mm_set1_ps(B0 * py + C0);
+        const __m128 E1 = _mm_set1_ps(B1 * py + C1);
+        const __m128 E2 = _mm_set1_ps(B2 * py + C2);
+        const __m128 Z = _mm_set1_ps(dzdy * py + z0);
+        float *row = &m_depth[y * kWidth];
+        for (size_t x = x0; x <= x1; x += 4) {
+            const __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+            const __m128 e0 = _mm_add_ps(_mm_mul_ps(A0v, px), E0);
+            const __m128 e1 = _mm_add_ps(_mm_mul_ps(A1v, px), E1);
+            const __m128 e2 = _mm_add_ps(_mm_mul_ps(A2v, px), E2);
+            const __m128 inside = _mm_and_ps(_mm_cmpge_ps(e0, zero),
+                _mm_and_ps(_mm_cmpge_ps(e1, zero), _mm_cmpge_ps(e2, zero)));
+            if (!_mm_movemask_ps(inside))
+                continue;
+            const __m128 z = _mm_add_ps(_mm_mul_ps(dzdxv, px), Z);
+            const __m128 depth = _mm_loadu_ps(row + x);
+            const __m128 closer = _mm_max_ps(depth, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closer),
+                _mm_andnot_ps(inside, depth)));
+        }
+    }
+#else
+    for (size_t y = y0; y <= y1; y++) {
+        const float py = y + 0.5f;
+        float *row = &m_depth[y * kWidth];
+        for (size_t x = x0; x <= x1; x++) {
+            const float px = x + 0.5f;
+            if (A0*px + B0*py + C0 < 0.0f) continue;
+            if (A1*px + B1*py + C1 < 0.0f) continue;
+            if (A2*px + B2*py + C2 < 0.0f) continue;
+            const float z = dzdx*px + dzdy*py + z0;
+            if (z > row[x])
+                row[x] = z;
+        }
+    }
+#endif
+}
+
+void occlusionBuffer::finalize() {
+    // every tile holds the farthest depth of all its pixels
+    for (size_t ty = 0; ty < kTilesY; ty++) {
+        for (size_t tx = 0; tx < kTilesX; tx++) {
+            float farthest = m_depth[ty * kTileSize * kWidth + tx * kTileSize];
+            for (size_t y = 0; y < kTileSize; y++) {
+                const float *row = &m_depth[(ty * kTileSize + y) * kWidth + tx * kTileSize];
+                for (size_t x = 0; x < kTileSize; x++)
+                    farthest = u::min(farthest, row[x]);
+            }
+            m_tiles[ty * kTilesX + tx] = farthest;
+        }
+    }
+}
+
+bool occlusionBuffer::project(const m::bbox &box, rect &area, float &depth) const {
+    const m::vec3 &min = box.min();
+    const m::vec3 &max = box.max();
+    float minX = FLT_MAX;
+    float minY = FLT_MAX;
+    float maxX = -FLT_MAX;
+    float maxY = -FLT_MAX;
+    depth = 0.0f;
+    for (size_t i = 0; i < 8; i++) {
+        const m::vec4 p(i & 1 ? max.x : min.x,
+                        i & 2 ? max.y : min.y,
+                        i & 4 ? max.z : min.z, 1.0f);
+        const float z = m::vec4::dot(m_wvp.c, p);
+        const float w = m::vec4::dot(m_wvp.d, p);
+        // crosses the near plane: can never be considered occluded
+        if (z + w < 0.0f || w <= m::kEpsilon)
+            return false;
+        const float iw = 1.0f / w;
+        const float x = (m::vec4::dot(m_wvp.a, p) * iw * 0.5f + 0.5f) * kWidth;
+        const float y = (m::vec4::dot(m_wvp.b, p) * iw * 0.5f + 0.5f) * kHeight;
+        minX = u::min(minX, x);
+        minY = u::min(minY, y);
+        maxX = u::max(maxX, x);
+        maxY = u::max(maxY, y);
+        depth = u::max(depth, iw);
+    }
+    if (maxX < 0.0f || maxY < 0.0f || minX >= kWidth || minY >= kHeight)
+        return false;
+    // grow by a pixel to stay conservative
+    area.x0 = size_t(u::max(minX - 1.0f, 0.0f));
+    area.y0 = size_t(u::max(minY - 1.0f, 0.0f));
+    area.x1 = u::min(size_t(maxX + 1.0f), kWidth - 1);
+    area.y1 = u::min(size_t(maxY + 1.0f), kHeight - 1);
+    return true;
+}
+
+bool occlusionBuffer::testPixels(const rect &area, float depth) const {
+    for (size_t y = area.y0; y <= area.y1; y++) {
+        const float *row = &m_depth[y * kWidth];
+        for (size_t x = area.x0; x <= area.x1; x++)
+            if (row[x] <= depth)
+                return true;
+    }
+    return false;
+}
+
+bool occlusionBuffer::testBox(const m::bbox &box) const {
+    if (!m_occluders)
+        return true;
+    rect area;
+    float depth;
+    if (!project(box, area, depth))
+        return true;
+
+    bool visible = false;
+    for (size_t ty = area.y0 / kTileSize; ty <= area.y1 / kTileSize && !visible; ty++) {
+        for (size_t tx = area.x0 / kTileSize; tx <= area.x1 / kTileSize; tx++) {
+            // entire tile is closer than the box
+            if (m_tiles[ty * kTilesX + tx] > depth)
+                continue;
+            const rect tile = {
+                u::max(area.x0, tx * kTileSize),
+                u::max(area.y0, ty * kTileSize),
+                u::min(area.x1, tx * kTileSize + kTileSize - 1),
+                u::min(area.y1, ty * kTileSize + kTileSize - 1)
+            };
+            if (testPixels(tile, depth)) {
+                visible = true;
+                break;
+            }
+        }
+    }
+
+    if (r_occlusion_verify && visible != testPixels(area, depth))
+        u::Log::err("[occlusion] => hierarchical test disagrees with exhaustive test\n");
+
+    return visible;
+}
+
+bool occlusionBuffer::testSphere(const m::vec3 &position, float radius) const {
+    return testBox({ position - radius, position + radius });
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef R_OCCLUSION_HDR
+#define R_OCCLUSION_HDR
+#include "m_mat.h"
+
+#include "u_vector.h"
+
+namespace m {
+    struct bbox;
+}
+
+namespace r {
+
+// A low resolution software depth buffer used for occlusion culling. Occluder
+// triangles are rasterized on the CPU and objects are tested against it before
+// they're handed to the GPU. Depth is stored as 1/w which interpolates linearly
+// in screen space, larger values are closer to the viewer and zero means nothing
+// was rasterized there. Every tile of the buffer also keeps the farthest depth
+// within it such that most tests can be answered without touching pixels.
+struct occlusionBuffer {
+    static constexpr size_t kWidth = 256;
+    static constexpr size_t kHeight = 128;
+    static constexpr size_t kTileSize = 8;
+
+    occlusionBuffer();
+
+    // start a new frame with the given world-view-projection matrix
+    void clear(const m::mat4 &wvp);
+    // rasterize an occluder triangle given in world space
+    void rasterize(const m::vec3 &v0, const m::vec3 &v1, const m::vec3 &v2);
+    // build the tile hierarchy: must be called before any tests
+    void finalize();
+
+    // true when (some of) the primitive may be visible
+    bool testBox(const m::bbox &box) const;
+    bool testSphere(const m::vec3 &position, float radius) const;
+
+    size_t occluders() const;
+
+private:
+    static constexpr size_t kTilesX = kWidth / kTileSize;
+    static constexpr size_t kTilesY = kHeight / kTileSize;
+
+    struct rect {
+        size_t x0, y0;
+        size_t x1, y1; // inclusive
+    };
+
+    struct vertex {
+        float x, y, z;
+    };
+
+    bool project(const m::bbox &box, rect &area, float &depth) const;
+    bool testPixels(const rect &area, float depth) const;
+    void rasterize(const vertex &v0, const vertex &v1, const vertex &v2);
+
+    m::mat4 m_wvp;
+    u::vector<float> m_depth;
+    u::vector<float> m_tiles;
+    size_t m_occluders;
+};
+
+inline size_t occlusionBuffer::occluders() const {
+    return m_occluders;
+}
+
+}
+
+#endif
@@ -1,12 +1,18 @@
-#include <limits.h>
+#include <string.h>
+
+#include <SDL_timer.h>
 
 #include "r_particles.h"
 #include "r_pipeline.h"
+#include "r_buffer.h"
 
 #include "u_string.h"
 #include "u_misc.h"
+#include "u_jobs.h"
+#include "u_algorithm.h"
 
 #include "m_plane.h"
+#include "m_const.h"
 
 #include "c_variable.h"
 
@@ -14,6 +20,99 @@ namespace r {
 
 VAR(int, r_particle_max_resolution, "maximum particle resolution", 16, 512, 128);
 
+// particles updated by a single job, a multiple of four for the SIMD update
+static constexpr size_t kParticleGrain = 256;
+
+// sin(x*pi) for x in [0, 1]: a parabola refined by a second parabola. The
+// absolute error is below 0.0011 which is plenty for fading particles
+static inline float sinPi(float x) {
+    const float s = 4.0f * x * (1.0f - x);
+    return s * (0.775f + 0.225f * s);
+}
+
+#ifdef __SSE2__
+static inline __m128 sinPi(__m128 x) {
+    const __m128 s = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(4.0f), x),
+                                _mm_sub_ps(_mm_set1_ps(1.0f), x));
+    return _mm_mul_ps(s, _mm_add_ps(_mm_set1_ps(0.775f),
+                                    _mm_mul_ps(_mm_set1_ps(0.225f), s)));
+}
+#endif
+
+///! particleData
+u::vector<float> particleSystem::particleData::*const particleSystem::particleData::kStreams[] = {
+    &particleSystem::particleData::originX,
+    &particleSystem::particleData::originY,
+    &particleSystem::particleData::originZ,
+    &particleSystem::particleData::velocityX,
+    &particleSystem::particleData::velocityY,
+    &particleSystem::particleData::velocityZ,
+    &particleSystem::particleData::sizes,
+    &particleSystem::particleData::startSizes,
+    &particleSystem::particleData::alphas,
+    &particleSystem::particleData::startAlphas,
+    &particleSystem::particleData::lifeTimes,
+    &particleSystem::particleData::totalLifeTimes
+};
+
+particleSystem::particleData::particleData()
+    : m_count(0)
+{
+}
+
+void particleSystem::particleData::reserve(size_t count) {
+    for (auto it : kStreams)
+        (this->*it).reserve(count);
+    colors.reserve(count);
+    flags.reserve(count);
+}
+
+void particleSystem::particleData::resize(size_t count) {
+    for (auto it : kStreams)
+        (this->*it).resize(count);
+    colors.resize(count);
+    flags.resize(count);
+    m_count = count;
+}
+
+void particleSystem::particleData::push_back(const particle &p) {
+    // the streams grow geometrically when pushed to while resize reallocates
+    // every one of them to the exact size
+    for (auto it : kStreams)
+        (this->*it).push_back(0.0f);
+    colors.push_back(p.color);
+    flags.push_back(0);
+    set(m_count++, p);
+}
+
+void particleSystem::particleData::set(size_t index, const particle &p) {
+    originX[index] = p.origin.x;
+    originY[index] = p.origin.y;
+    originZ[index] = p.origin.z;
+    velocityX[index] = p.velocity.x;
+    velocityY[index] = p.velocity.y;
+    velocityZ[index] = p.velocity.z;
+    sizes[index] = p.size;
+    startSizes[index] = p.startSize;
+    alphas[index] = p.alpha;
+    startAlphas[index] = p.startAlpha;
+    lifeTimes[index] = p.lifeTime;
+    totalLifeTimes[index] = p.totalLifeTime;
+    colors[index] = p.color;
+    flags[index] = (p.respawn ? kRespawn : 0) | (p.visible ? kVisible : 0);
+}
+
+void particleSystem::particleData::remove(size_t index) {
+    const size_t last = m_count - 1;
+    if (index != last) {
+        for (auto it : kStreams)
+            (this->*it)[index] = (this->*it)[last];
+        colors[index] = colors[last];
+        flags[index] = flags[last];
+    }
+    resize(last);
+}
+
 ///! particleSystemMethod
 particleSystemMethod::particleSystemMethod()
     : m_VP(nullptr)
@@ -68,18 +167,13 @@ void particleSystemMethod::setPower(float power) {
 ///! particleSystem
 particleSystem::particleSystem()
     : m_vao(0)
-    , m_bufferIndex(0)
     , m_stats(r::stat::add("particle", "Particle Systems"))
 {
-    memset(m_buffers, 0, sizeof m_buffers);
-
 }
 particleSystem::~particleSystem() {
     m_stats->decTextureCount();
     m_stats->decTextureMemory(m_texture.memory());
 
-    if (m_buffers[0])
-        gl::DeleteBuffers(sizeof m_buffers / sizeof *m_buffers, m_buffers);
     if (m_vao)
         gl::DeleteVertexArrays(1, &m_vao);
 }
@@ -107,28 +201,16 @@ bool particleSystem::upload() {
     if (!m_method.init())
         return false;
 
-    gl::GenVertexArrays(1, &m_vao);
-    gl::GenBuffers(sizeof m_buffers / sizeof *m_buffers, m_buffers);
+    auto &stream = streamBuffers::instance();
+    if (!stream.init())
+        return false;
 
+    // the vertices are streamed, the attributes are pointed at them when drawn
+    gl::GenVertexArrays(1, &m_vao);
     gl::BindVertexArray(m_vao);
     gl::EnableVertexAttribArray(0);
     gl::EnableVertexAttribArray(1);
-
-    for (size_t i = 0; i < sizeof m_vbos / sizeof *m_vbos; i++) {
-        gl::BindBuffer(GL_ARRAY_BUFFER, m_vbos[i]);
-        if (gl::has(gl::ARB_half_float_vertex)) {
-            gl::BufferData(GL_ARRAY_BUFFER, sizeof(halfVertex), 0, GL_DYNAMIC_DRAW);
-            gl::VertexAttribPointer(0, 3, GL_HALF_FLOAT,    GL_FALSE, sizeof(halfVertex), u::offset_of(&halfVertex::position)); // position
-            gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(halfVertex), u::offset_of(&halfVertex::color)); // color
-        } else {
-            gl::BufferData(GL_ARRAY_BUFFER, sizeof(singleVertex), 0, GL_DYNAMIC_DRAW);
-            gl::VertexAttribPointer(0, 3, GL_FLOAT,         GL_FALSE, sizeof(singleVertex), u::offset_of(&singleVertex::position)); // position
-            gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(singleVertex), u::offset_of(&singleVertex::color)); // color
-        }
-
-        gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibos[i]);
-        gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof m_indices[0], 0, GL_DYNAMIC_DRAW);
-    }
+    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, stream.quadIndices());
 
     m_method.enable();
     m_method.setColorTextureUnit(0);
@@ -146,124 +228,107 @@ void particleSystem::render(const pipeline &pl) {
     m::vec3 up;
     rotation.getOrient(nullptr, &up, &side);
 
-    if (gl::has(gl::ARB_half_float_vertex)) {
-        m_stats->decVBOMemory(sizeof m_halfVertices[0] * m_halfVertices.size());
-        m_halfVertices.destroy();
-        m_halfVertices.reserve(m_particles.size() * 4);
-    } else {
-        m_stats->decVBOMemory(sizeof m_singleVertices[0] * m_singleVertices.size());
-        m_singleVertices.destroy();
-        m_singleVertices.reserve(m_particles.size() * 4);
-    }
-
-    m_stats->decIBOMemory(sizeof m_indices[0] * m_indices.size());
+    // Particles are drawn with the shared quad indices
+    if (m_particles.size() > streamBuffers::kMaxQuads)
+        m_particles.resize(streamBuffers::kMaxQuads);
 
-    GLuint &vbo = m_vbos[m_bufferIndex];
-    GLuint &ibo = m_ibos[m_bufferIndex];
-    m_bufferIndex = (m_bufferIndex + 1) % (sizeof m_vbos / sizeof *m_vbos);
-
-    // Invalidate next buffer a frame in advance to hint the driver that we're
-    // doing double-buffering
-    gl::BindBuffer(GL_ARRAY_BUFFER, m_vbos[m_bufferIndex]);
-    gl::BufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
-
-    // We use a smaller index format for particles to reduce upload costs
-    if (m_particles.size() * 6 > SHRT_MAX) {
-        m_particles.resize(SHRT_MAX / 6);
-        m_particles.shrink_to_fit();
-    }
-
-    m_indices.destroy();
-    m_indices.reserve(m_particles.size() * 6);
+    const size_t count = m_particles.size();
 
     // TODO: kick off point in view frustum test for every particle
 
-    // sort particles by ones closest to camera
-    u::sort(m_particles.begin(), m_particles.end(),
-        [&pl](const particle &lhs, const particle &rhs) {
-            const float d1 = (lhs.origin - pl.position()).abs();
-            const float d2 = (rhs.origin - pl.position()).abs();
-            return d1 > d2;
-        }
-    );
-
-    for (const auto &it : m_particles) {
-        if (!it.visible || it.lifeTime < 0.0f)
+    // Live particles are ordered back to front with a radix sort of their view
+    // depth quantized to 16 bits over the view range
+    const auto &data = m_particles;
+    const m::vec4 &forward = pl.view().c;
+    const m::perspective &perspective = pl.perspective();
+    const float depthScale = 65535.0f / (perspective.farp - perspective.nearp);
+    m_keys.resize(count);
+    m_order.resize(count);
+    size_t live = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(data.flags[i] & particleData::kVisible) || data.lifeTimes[i] < 0.0f)
             continue;
-
-        const m::vec3 x = it.size * 0.5f * side;
-        const m::vec3 y = it.size * 0.5f * up;
-        const m::vec3 q[] = { x + y + it.origin,
-                             -x + y + it.origin,
-                             -x - y + it.origin,
-                              x - y + it.origin };
-
-        size_t index = 0;
-        if (gl::has(gl::ARB_half_float_vertex)) {
-            index = m_halfVertices.size();
-            const auto &c = m::convertToHalf(&q[0].x, 3*4);
-            for (size_t i = 0; i < c.size(); i += 3) {
-                halfVertex newVertex;
-                for (size_t j = 0; j < 3; j++) {
-                    newVertex.color[j] = it.color[j] * 255.0f;
-                    newVertex.position[j] = c[i+j];
-                }
-                newVertex.color[3] = it.alpha * 255.0f;
-                m_halfVertices.push_back(newVertex);
+        const float z = forward.x*data.originX[i] + forward.y*data.originY[i]
+                      + forward.z*data.originZ[i] + forward.w;
+        const float depth = m::clamp((z - perspective.nearp) * depthScale, 0.0f, 65535.0f);
+        m_keys[live] = 65535 - uint16_t(depth);
+        m_order[live++] = i;
+    }
+    if (!live)
+        return;
+    m_sortKeys.resize(live);
+    m_sortOrder.resize(live);
+    u::radixSort(&m_keys[0], &m_order[0], &m_sortKeys[0], &m_sortOrder[0], live);
+
+    // The vertices are written in sorted order straight into the stream
+    const bool half = gl::has(gl::ARB_half_float_vertex);
+    const size_t stride = half ? sizeof(halfVertex) : sizeof(singleVertex);
+    auto &stream = streamBuffers::instance();
+    size_t offset = 0;
+    unsigned char *vertices = stream.map(stride * live * 4, offset);
+    for (size_t i = 0; i < live; i++) {
+        const size_t id = m_order[i];
+        const float size = data.sizes[id];
+        const m::vec3 &color = data.colors[id];
+        const float alpha = data.alphas[id];
+        const m::vec3 center(data.originX[id], data.originY[id], data.originZ[id]);
+        const m::vec3 x = size * 0.5f * side;
+        const m::vec3 y = size * 0.5f * up;
+        const m::vec3 q[] = { x + y + center,
+                             -x + y + center,
+                             -x - y + center,
+                              x - y + center };
+        const unsigned char rgba[] = {
+            (unsigned char)(color.x * 255.0f),
+            (unsigned char)(color.y * 255.0f),
+            (unsigned char)(color.z * 255.0f),
+            (unsigned char)(alpha * 255.0f)
+        };
+
+        if (half) {
+            auto *out = (halfVertex *)vertices;
+            for (size_t j = 0; j < 4; j++) {
+                for (size_t k = 0; k < 3; k++)
+                    out[j].position[k] = m::convertToHalf(q[j][k]);
+                memcpy(out[j].color, rgba, sizeof rgba);
             }
         } else {
-            index = m_singleVertices.size();
-            for (const auto &jt : q) {
-                singleVertex newVertex;
-                newVertex.position = jt;
-                for (size_t i = 0; i < 3; i++)
-                    newVertex.color[i] = it.color[i] * 255.0f;
-                newVertex.color[3] = it.alpha * 255.0f;
-                m_singleVertices.push_back(newVertex);
+            auto *out = (singleVertex *)vertices;
+            for (size_t j = 0; j < 4; j++) {
+                out[j].position = q[j];
+                memcpy(out[j].color, rgba, sizeof rgba);
             }
         }
-        m_indices.push_back(index + 0);
-        m_indices.push_back(index + 1);
-        m_indices.push_back(index + 2);
-        m_indices.push_back(index + 2);
-        m_indices.push_back(index + 3);
-        m_indices.push_back(index + 0);
+        vertices += stride * 4;
     }
-    if (m_indices.empty())
-        return;
+    stream.unmap();
 
     gl::BindVertexArray(m_vao);
-    gl::BindBuffer(GL_ARRAY_BUFFER, vbo);
-
-    if (gl::has(gl::ARB_half_float_vertex)) {
-        gl::BufferData(GL_ARRAY_BUFFER, m_halfVertices.size() * sizeof(halfVertex), &m_halfVertices[0], GL_DYNAMIC_DRAW);
-        gl::VertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(halfVertex), u::offset_of(&halfVertex::position)); // position
-        gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(halfVertex), u::offset_of(&halfVertex::color)); // color
-        m_stats->incVBOMemory(sizeof m_halfVertices[0] * m_halfVertices.size());
+    gl::BindBuffer(GL_ARRAY_BUFFER, stream.vertexBuffer());
+    if (half) {
+        gl::VertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride,
+            (const GLvoid *)(offset + size_t(u::offset_of(&halfVertex::position)))); // position
+        gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+            (const GLvoid *)(offset + size_t(u::offset_of(&halfVertex::color)))); // color
     } else {
-        gl::BufferData(GL_ARRAY_BUFFER, m_singleVertices.size() * sizeof(singleVertex), &m_singleVertices[0], GL_DYNAMIC_DRAW);
-        gl::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(singleVertex), u::offset_of(&singleVertex::position)); // position
-        gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,  sizeof(singleVertex), u::offset_of(&singleVertex::color)); // color
-        m_stats->incVBOMemory(sizeof m_singleVertices[0] * m_singleVertices.size());
+        gl::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride,
+            (const GLvoid *)(offset + size_t(u::offset_of(&singleVertex::position)))); // position
+        gl::VertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride,
+            (const GLvoid *)(offset + size_t(u::offset_of(&singleVertex::color)))); // color
     }
 
-    gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof m_indices[0],
-        &m_indices[0], GL_DYNAMIC_DRAW);
-    m_stats->incIBOMemory(sizeof m_indices[0] * m_indices.size());
-
     m_texture.bind(GL_TEXTURE0);
 
     m_method.enable();
     m_method.setPerspective(pl.perspective());
-    m_method.setVP(pl.projection() * pl.view());
+    m_method.setVP(pl.viewProjection());
     m_method.setPower(power());
 
     gl::Disable(GL_CULL_FACE);
     gl::DepthFunc(GL_LESS);
     gl::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    gl::DrawElements(GL_TRIANGLES, m_indices.size(), GL_UNSIGNED_SHORT, nullptr);
+    gl::DrawElements(GL_TRIANGLES, live * 6, GL_UNSIGNED_SHORT, nullptr);
 
     gl::Enable(GL_CULL_FACE);
 }
@@ -272,25 +337,77 @@ void particleSystem::addParticle(particle &&p) {
     m_particles.push_back(p);
 }
 
+void particleSystem::integrate(particleData &data, size_t begin, size_t end, float dt, float g) {
+    const float fall = dt*dt*0.5f*g;
+    size_t i = begin;
+#ifdef __SSE2__
+    const __m128 delta = _mm_set1_ps(dt);
+    const __m128 falling = _mm_set1_ps(fall);
+    const __m128 accelerate = _mm_set1_ps(g*dt);
+    const __m128 minSize = _mm_set1_ps(0.1f);
+    for (; i + 4 <= end; i += 4) {
+        const __m128 velocityX = _mm_loadu_ps(&data.velocityX[i]);
+        const __m128 velocityY = _mm_loadu_ps(&data.velocityY[i]);
+        const __m128 velocityZ = _mm_loadu_ps(&data.velocityZ[i]);
+        _mm_storeu_ps(&data.originX[i],
+            _mm_add_ps(_mm_loadu_ps(&data.originX[i]), _mm_mul_ps(velocityX, delta)));
+        _mm_storeu_ps(&data.originY[i],
+            _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(&data.originY[i]), _mm_mul_ps(velocityY, delta)), falling));
+        _mm_storeu_ps(&data.originZ[i],
+            _mm_add_ps(_mm_loadu_ps(&data.originZ[i]), _mm_mul_ps(velocityZ, delta)));
+        _mm_storeu_ps(&data.velocityY[i], _mm_sub_ps(velocityY, accelerate));
+        const __m128 lifeTime = _mm_sub_ps(_mm_loadu_ps(&data.lifeTimes[i]), delta);
+        _mm_storeu_ps(&data.lifeTimes[i], lifeTime);
+        const __m128 scale = sinPi(_mm_div_ps(lifeTime, _mm_loadu_ps(&data.totalLifeTimes[i])));
+        _mm_storeu_ps(&data.alphas[i], _mm_mul_ps(_mm_loadu_ps(&data.startAlphas[i]), scale));
+        _mm_storeu_ps(&data.sizes[i],
+            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&data.startSizes[i]), scale), minSize));
+    }
+#endif
+    for (; i < end; i++) {
+        data.originX[i] += data.velocityX[i]*dt;
+        data.originY[i] += data.velocityY[i]*dt - fall;
+        data.originZ[i] += data.velocityZ[i]*dt;
+        data.velocityY[i] -= g*dt;
+        data.lifeTimes[i] -= dt;
+        const float scale = sinPi(data.lifeTimes[i] / data.totalLifeTimes[i]);
+        data.alphas[i] = data.startAlphas[i] * scale;
+        data.sizes[i] = scale * data.startSizes[i] + 0.1f;
+    }
+}
+
 void particleSystem::update(const pipeline &p) {
     const float dt = p.delta() * 0.1f;
     const float g = gravity();
 
-    for (auto &it : m_particles) {
-        if (it.lifeTime < 0.0f) {
-            if (it.respawn)
-                initParticle(it, p.position());
-            else
-                continue;
+    // respawn dead particles and compact away the ones which don't respawn
+    // such that the update below does not need to check. This is left on this
+    // thread: initParticle is free to use the random number generator which
+    // isn't thread safe
+    auto &data = m_particles;
+    for (size_t i = 0; i < data.size(); ) {
+        if (data.lifeTimes[i] >= 0.0f) {
+            i++;
+        } else if (data.flags[i] & particleData::kRespawn) {
+            particle spawn;
+            initParticle(spawn, p.position());
+            data.set(i++, spawn);
+        } else {
+            data.remove(i);
         }
-        it.origin = it.origin + it.velocity*dt - m::vec3(0.0f, dt*dt*0.5f*g, 0.0f);
-        it.velocity.y -= g*dt;
-        it.lifeTime -= dt;
-        const float f = it.lifeTime / it.totalLifeTime;
-        const float scale = m::sin(f * m::kPi);
-        it.alpha = it.startAlpha * scale;
-        it.size = scale * it.startSize + 0.1f;
     }
+
+    // only the update is timed for the particles updated per millisecond
+    const Uint64 start = SDL_GetPerformanceCounter();
+    u::gJobs.parallelFor("update particles", data.size(), kParticleGrain,
+        [&data, dt, g](size_t begin, size_t end) {
+            integrate(data, begin, end, dt, g);
+        }
+    );
+
+    const float milliseconds = float(SDL_GetPerformanceCounter() - start) * 1000.0f
+                             / float(SDL_GetPerformanceFrequency());
+    m_stats->setParticles(data.size(), milliseconds > 0.0f ? data.size() / milliseconds : 0.0f);
 }
 
 }
@@ -16,6 +16,7 @@ namespace r {
 
 struct pipeline;
 
+// a single particle, particle systems store them as a structure of arrays
 struct particle {
     m::vec3 origin;
     m::vec3 velocity;
@@ -63,8 +64,47 @@ protected:
     virtual float gravity() { return 25.0f; }
     virtual float power() { return 5.0f; }
 
-    u::vector<particle> m_particles;
+    // The particles as a structure of arrays such that the update can process
+    // four of them at a time. Dead particles are respawned or compacted away
+    // before every update.
+    struct particleData {
+        enum : unsigned char {
+            kRespawn = 1 << 0,
+            kVisible = 1 << 1
+        };
+
+        particleData();
+
+        size_t size() const;
+        void reserve(size_t count);
+        void resize(size_t count);
+        void push_back(const particle &p);
+        void set(size_t index, const particle &p);
+        void remove(size_t index); // moves the last particle into index
+
+        u::vector<float> originX;
+        u::vector<float> originY;
+        u::vector<float> originZ;
+        u::vector<float> velocityX;
+        u::vector<float> velocityY;
+        u::vector<float> velocityZ;
+        u::vector<float> sizes;
+        u::vector<float> startSizes;
+        u::vector<float> alphas;
+        u::vector<float> startAlphas;
+        u::vector<float> lifeTimes;
+        u::vector<float> totalLifeTimes;
+        u::vector<m::vec3> colors;
+        u::vector<unsigned char> flags;
+    private:
+        static u::vector<float> particleData::*const kStreams[12];
+        size_t m_count;
+    };
+
+    particleData m_particles;
 private:
+    static void integrate(particleData &data, size_t begin, size_t end, float dt, float g);
+
     struct singleVertex {
         // 16 bytes
         m::vec3 position;
@@ -75,24 +115,22 @@ private:
         m::half position[3];
         unsigned char color[4];
     };
-    u::vector<singleVertex> m_singleVertices;
-    u::vector<halfVertex> m_halfVertices;
 
     particleSystemMethod m_method;
     texture2D m_texture;
-    u::vector<GLushort> m_indices;
-    union {
-        struct {
-            GLuint m_vbos[2];
-            GLuint m_ibos[2];
-        };
-        GLuint m_buffers[4];
-    };
     GLuint m_vao;
-    unsigned char m_bufferIndex;
+    // live particles sorted back to front by depth and scratch for the sort
+    u::vector<uint16_t> m_keys;
+    u::vector<uint16_t> m_order;
+    u::vector<uint16_t> m_sortKeys;
+    u::vector<uint16_t> m_sortOrder;
     r::stat *m_stats;
 };
 
+inline size_t particleSystem::particleData::size() const {
+    return m_count;
+}
+
 }
 
 #endif
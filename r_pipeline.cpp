@@ -10,30 +10,69 @@ pipeline::pipeline()
     , m_delta(0.0f)
 {
     m_rotate = m::mat4::rotate(m::vec3::origin);
+    m_worldMatrix = m::mat4::translate(m_world) * m_rotate * m::mat4::scale(m_scale);
+    updateView();
+    updateProjection();
+    updateViewProjection();
+}
+
+void pipeline::updateWorld() {
+    m_worldMatrix = m::mat4::translate(m_world) * m_rotate * m::mat4::scale(m_scale);
+    m_worldViewProjectionMatrix = m_viewProjectionMatrix * m_worldMatrix;
+}
+
+void pipeline::updateView() {
+    m::vec3 target, up;
+    m_rotation.getOrient(&target, &up, nullptr);
+    m_viewMatrix = m::mat4::lookat(target, up) * m::mat4::translate(-m_position);
+}
+
+void pipeline::updateProjection() {
+    m_projectionMatrix = m::mat4::project(m_perspective);
+}
+
+void pipeline::updateViewProjection() {
+    m_viewProjectionMatrix = m_projectionMatrix * m_viewMatrix;
+    m_inverseViewProjectionMatrix = m_viewProjectionMatrix.inverse();
+    m_worldViewProjectionMatrix = m_viewProjectionMatrix * m_worldMatrix;
 }
 
 void pipeline::setScale(const m::vec3 &scale) {
     m_scale = scale;
+    updateWorld();
 }
 
 void pipeline::setWorld(const m::vec3 &world) {
     m_world = world;
+    updateWorld();
 }
 
 void pipeline::setRotate(const m::mat4 &rotate) {
     m_rotate = rotate;
+    updateWorld();
+}
+
+void pipeline::setWorldMatrix(const m::mat4 &world) {
+    m_worldMatrix = world;
+    m_worldViewProjectionMatrix = m_viewProjectionMatrix * m_worldMatrix;
 }
 
 void pipeline::setRotation(const m::quat &rotation) {
     m_rotation = rotation;
+    updateView();
+    updateViewProjection();
 }
 
 void pipeline::setPosition(const m::vec3 &position) {
     m_position = position;
+    updateView();
+    updateViewProjection();
 }
 
 void pipeline::setPerspective(const m::perspective &p) {
     m_perspective = p;
+    updateProjection();
+    updateViewProjection();
 }
 
 void pipeline::setTime(float time) {
@@ -44,18 +83,28 @@ void pipeline::setDelta(float delta) {
     m_delta = delta;
 }
 
-const m::mat4 pipeline::world() const {
-    return m::mat4::translate(m_world) * m_rotate * m::mat4::scale(m_scale);
+const m::mat4 &pipeline::world() const {
+    return m_worldMatrix;
 }
 
-const m::mat4 pipeline::view() const {
-    m::vec3 target, up;
-    m_rotation.getOrient(&target, &up, nullptr);
-    return m::mat4::lookat(target, up) * m::mat4::translate(-m_position);
+const m::mat4 &pipeline::view() const {
+    return m_viewMatrix;
+}
+
+const m::mat4 &pipeline::projection() const {
+    return m_projectionMatrix;
+}
+
+const m::mat4 &pipeline::viewProjection() const {
+    return m_viewProjectionMatrix;
+}
+
+const m::mat4 &pipeline::inverseViewProjection() const {
+    return m_inverseViewProjectionMatrix;
 }
 
-const m::mat4 pipeline::projection() const {
-    return m::mat4::project(m_perspective);
+const m::mat4 &pipeline::worldViewProjection() const {
+    return m_worldViewProjectionMatrix;
 }
 
 const m::perspective &pipeline::perspective() const {
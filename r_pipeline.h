@@ -12,15 +12,24 @@ struct pipeline {
     void setScale(const m::vec3 &scale);
     void setWorld(const m::vec3 &worldPosition);
     void setRotate(const m::mat4 &rotate);
+    // a world matrix calculated elsewhere, it's replaced when the scale, world
+    // position or rotation is set afterwards
+    void setWorldMatrix(const m::mat4 &world);
     void setPosition(const m::vec3 &position);
     void setRotation(const m::quat &rotation);
     void setPerspective(const m::perspective &p);
     void setTime(float time);
     void setDelta(float delta);
 
-    const m::mat4 world() const;
-    const m::mat4 view() const;
-    const m::mat4 projection() const;
+    // Derived matrices are calculated by the setters of the state they depend
+    // on such that the accessors never write: a pipeline is shared with and
+    // read by jobs on other threads
+    const m::mat4 &world() const;
+    const m::mat4 &view() const;
+    const m::mat4 &projection() const;
+    const m::mat4 &viewProjection() const; // projection * view
+    const m::mat4 &inverseViewProjection() const; // (projection * view)^-1
+    const m::mat4 &worldViewProjection() const; // projection * view * world
 
     // camera accessors.
     const m::vec3 &position() const;
@@ -32,6 +41,11 @@ struct pipeline {
     float delta() const;
 
 private:
+    void updateWorld();
+    void updateView();
+    void updateProjection();
+    void updateViewProjection();
+
     m::perspective m_perspective;
 
     m::vec3 m_scale;
@@ -42,6 +56,13 @@ private:
 
     float m_time;
     float m_delta;
+
+    m::mat4 m_worldMatrix;
+    m::mat4 m_viewMatrix;
+    m::mat4 m_projectionMatrix;
+    m::mat4 m_viewProjectionMatrix;
+    m::mat4 m_inverseViewProjectionMatrix;
+    m::mat4 m_worldViewProjectionMatrix;
 };
 
 }
@@ -0,0 +1,172 @@
+#include <string.h>
+
+#include "r_queue.h"
+#include "r_model.h"
+
+#include "u_algorithm.h"
+
+#include "c_console.h"
+
+VAR(int, r_multidraw, "multi-draw indirect submission of world geometry", 0, 1, 1);
+
+namespace r {
+
+// Space for the indirect draw commands of a single frame
+static constexpr size_t kCommandBufferSize = 64 << 10;
+
+renderQueue::renderQueue()
+    : m_calls(0)
+    , m_triangles(0)
+    , m_stateChanges(0)
+    , m_stateChangesSaved(0)
+{
+}
+
+bool renderQueue::init() {
+    if (!gl::has(gl::ARB_draw_indirect) || !gl::has(gl::ARB_multi_draw_indirect))
+        return true;
+    return m_commandBuffer.init(GL_DRAW_INDIRECT_BUFFER, kCommandBufferSize, sizeof(drawCommand));
+}
+
+uint64_t renderQueue::key(size_t pass, size_t permutation, size_t material, float depth) {
+    // the bit pattern of a positive float increases with its value, the upper
+    // sixteen bits make a logarithmic depth bucket
+    union { float asFloat; uint32_t asUint32; } shape;
+    shape.asFloat = depth > 0.0f ? depth : 0.0f;
+    return (uint64_t(pass & 0xF) << 60)
+         | (uint64_t(permutation & 0xFF) << 52)
+         | (uint64_t(material & 0xFFFFF) << 32)
+         | (uint64_t(shape.asUint32 >> 16) << 16);
+}
+
+void renderQueue::clear() {
+    m_packets.clear();
+    m_keys.clear();
+    m_indices.clear();
+}
+
+void renderQueue::add(uint64_t key, const renderPacket &packet) {
+    m_keys.push_back(key);
+    m_indices.push_back(uint32_t(m_packets.size()));
+    m_packets.push_back(packet);
+}
+
+void renderQueue::sort() {
+    const size_t count = m_keys.size();
+    if (count < 2)
+        return;
+    m_scratchKeys.resize(count);
+    m_scratchIndices.resize(count);
+    u::radixSort(&m_keys[0], &m_indices[0], &m_scratchKeys[0], &m_scratchIndices[0], count);
+}
+
+bool renderQueue::indirect() const {
+    return r_multidraw && supportsIndirect();
+}
+
+bool renderQueue::shareState(const renderPacket &lhs, const renderPacket &rhs) {
+    return lhs.vao == rhs.vao
+        && lhs.mat == rhs.mat
+        && lhs.pl == rhs.pl
+        && !lhs.bones && !rhs.bones
+        && !memcmp(lhs.world.ptr(), rhs.world.ptr(), sizeof lhs.world);
+}
+
+void renderQueue::submit() {
+    m_calls = 0;
+    m_triangles = 0;
+    m_stateChanges = 0;
+    m_stateChangesSaved = 0;
+
+    const bool indirect = this->indirect();
+    const size_t maxCommands = kCommandBufferSize / sizeof(drawCommand);
+    if (indirect)
+        m_commandBuffer.begin();
+
+    GLuint vao = 0;
+    material *mat = nullptr;
+    geomMethod *method = nullptr;
+    const pipeline *pl = nullptr;
+    for (size_t i = 0; i < m_keys.size(); ) {
+        const auto &it = m_packets[m_indices[i]];
+
+        if (i == 0 || it.vao != vao) {
+            gl::BindVertexArray(it.vao);
+            vao = it.vao;
+            m_stateChanges++;
+        } else {
+            m_stateChangesSaved++;
+        }
+
+        geomMethod &next = it.mat->method();
+        const bool changeMethod = &next != method;
+        if (changeMethod) {
+            next.enable();
+            method = &next;
+            m_stateChanges++;
+        } else {
+            m_stateChangesSaved++;
+        }
+
+        if (changeMethod || it.mat != mat || it.pl != pl
+            || memcmp(it.world.ptr(), m_packets[m_indices[i - 1]].world.ptr(), sizeof it.world))
+        {
+            it.mat->bindUniforms(next, *it.pl, it.world);
+            pl = it.pl;
+        }
+
+        if (it.mat != mat) {
+            m_stateChanges += it.mat->bindTextures();
+            mat = it.mat;
+        } else {
+            // previous draw had the exact same textures bound
+            m_stateChangesSaved += it.mat->textures();
+        }
+
+        if (it.bones)
+            next.setBoneMats(it.joints, it.bones);
+
+        // the draws which follow with the exact same state
+        size_t count = 1;
+        while (i + count < m_keys.size() && count < maxCommands
+            && shareState(it, m_packets[m_indices[i + count]]))
+        {
+            count++;
+        }
+        // none of the state had to be set for them
+        m_stateChangesSaved += (count - 1) * (2 + it.mat->textures());
+
+        // a single draw from texture arrays needs its base instance too
+        if (indirect && (count > 1 || it.mat->arrays)) {
+            m_commands.resize(count);
+            for (size_t j = 0; j < count; j++) {
+                const auto &draw = m_packets[m_indices[i + j]];
+                auto &command = m_commands[j];
+                command.count = draw.count;
+                command.instanceCount = 1;
+                command.firstIndex = draw.offset / sizeof(GLuint);
+                command.baseVertex = 0;
+                command.baseInstance = draw.instance;
+                m_triangles += draw.count / 3;
+            }
+            const size_t offset = m_commandBuffer.write(&m_commands[0], sizeof(drawCommand) * count);
+            gl::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer.buffer());
+            gl::MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const GLvoid *)offset, count, 0);
+            m_calls++;
+        } else {
+            for (size_t j = 0; j < count; j++) {
+                const auto &draw = m_packets[m_indices[i + j]];
+                gl::DrawElements(GL_TRIANGLES, draw.count, GL_UNSIGNED_INT, (const GLvoid *)draw.offset);
+                m_triangles += draw.count / 3;
+            }
+            m_calls += count;
+        }
+
+        i += count;
+    }
+
+    if (indirect)
+        m_commandBuffer.end();
+}
+
+}
@@ -0,0 +1,118 @@
+#ifndef R_QUEUE_HDR
+#define R_QUEUE_HDR
+#include <stdint.h>
+
+#include "r_common.h"
+#include "r_buffer.h"
+
+#include "m_mat.h"
+
+#include "u_vector.h"
+
+namespace r {
+
+struct pipeline;
+struct material;
+
+// A single indexed draw of geometry with a material
+struct renderPacket {
+    material *mat;
+    const pipeline *pl;
+    m::mat4 world;
+    const float *bones; // skeletal geometry only
+    size_t joints;
+    GLuint vao;
+    size_t count; // indices
+    size_t offset; // in bytes
+    size_t instance; // selects the per draw attributes of materials drawn from texture arrays
+};
+
+// Draws are submitted in any order with a sort key and are sorted such that
+// draws sharing state are adjacent. The key packs (from most significant)
+//   [63 - 60] pass
+//   [59 - 52] shader permutation
+//   [51 - 32] material
+//   [31 - 16] depth
+// State which is the same for consecutive draws is only set once. Runs of
+// consecutive draws which share all state are submitted with a single
+// glMultiDrawElementsIndirect when ARB_multi_draw_indirect is available. The
+// instance of a draw becomes the base instance of its command, materials drawn
+// from texture arrays are only drawn that way.
+struct renderQueue {
+    enum {
+        kPassGeometry,
+        kPassForward
+    };
+
+    renderQueue();
+
+    bool init();
+
+    static uint64_t key(size_t pass, size_t permutation, size_t material, float depth);
+
+    void clear();
+    void add(uint64_t key, const renderPacket &packet);
+    void sort();
+    void submit();
+
+    bool supportsIndirect() const;
+    bool indirect() const; // draws are submitted with multi-draw indirect
+
+    size_t draws() const;
+    size_t calls() const; // draw calls issued by the last submit
+    size_t triangles() const;
+    size_t stateChanges() const;
+    size_t stateChangesSaved() const;
+
+private:
+    // layout of DrawElementsIndirectCommand
+    struct drawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    static bool shareState(const renderPacket &lhs, const renderPacket &rhs);
+
+    u::vector<renderPacket> m_packets;
+    u::vector<uint64_t> m_keys;
+    u::vector<uint32_t> m_indices; // of the packets, in the order of the keys
+    u::vector<uint64_t> m_scratchKeys;
+    u::vector<uint32_t> m_scratchIndices;
+    u::vector<drawCommand> m_commands;
+    ringBuffer m_commandBuffer;
+    size_t m_calls;
+    size_t m_triangles;
+    size_t m_stateChanges;
+    size_t m_stateChangesSaved;
+};
+
+inline bool renderQueue::supportsIndirect() const {
+    return m_commandBuffer.buffer();
+}
+
+inline size_t renderQueue::draws() const {
+    return m_packets.size();
+}
+
+inline size_t renderQueue::calls() const {
+    return m_calls;
+}
+
+inline size_t renderQueue::triangles() const {
+    return m_triangles;
+}
+
+inline size_t renderQueue::stateChanges() const {
+    return m_stateChanges;
+}
+
+inline size_t renderQueue::stateChangesSaved() const {
+    return m_stateChangesSaved;
+}
+
+}
+
+#endif
@@ -76,6 +76,78 @@ float shadowMap::heightScale(size_t size) const {
     return float(size) / float(m_height);
 }
 
+///! shadowAtlas
+constexpr size_t shadowAtlas::kMinTile;
+
+shadowAtlas::shadowAtlas()
+    : m_size(0)
+{
+}
+
+void shadowAtlas::reset(size_t size) {
+    m_size = size;
+    // a complete quadtree down to the smallest tile
+    size_t nodes = 0;
+    for (size_t level = size; level >= kMinTile; level /= 2)
+        nodes = nodes * 4 + 1;
+    m_nodes.destroy();
+    m_nodes.resize(nodes, kFree);
+}
+
+bool shadowAtlas::allocate(size_t size, tile &result) {
+    if (size > m_size || size < kMinTile)
+        return false;
+    return allocate(0, 0, 0, m_size, size, result);
+}
+
+bool shadowAtlas::allocate(size_t node, size_t x, size_t y, size_t nodeSize, size_t size, tile &result) {
+    auto &state = m_nodes[node];
+    if (state == kUsed)
+        return false;
+    if (nodeSize == size) {
+        if (state != kFree)
+            return false;
+        state = kUsed;
+        result.node = node;
+        result.x = x;
+        result.y = y;
+        result.size = size;
+        return true;
+    }
+    state = kSplit;
+    const size_t half = nodeSize / 2;
+    for (size_t i = 0; i < 4; i++) {
+        if (allocate(node * 4 + 1 + i, x + half * (i & 1), y + half * (i >> 1), half, size, result))
+            return true;
+    }
+    // nothing was allocated below: merge the children back if they are free
+    bool free = true;
+    for (size_t i = 0; i < 4; i++)
+        free = free && m_nodes[node * 4 + 1 + i] == kFree;
+    if (free)
+        state = kFree;
+    return false;
+}
+
+void shadowAtlas::release(tile &t) {
+    if (t.node < 0)
+        return;
+    size_t node = t.node;
+    m_nodes[node] = kFree;
+    // merge free siblings into their parent
+    while (node) {
+        const size_t parent = (node - 1) / 4;
+        bool free = true;
+        for (size_t i = 0; i < 4; i++)
+            free = free && m_nodes[parent * 4 + 1 + i] == kFree;
+        if (!free)
+            break;
+        m_nodes[parent] = kFree;
+        node = parent;
+    }
+    t = tile();
+}
+
 ///! shadowMapMethod
 shadowMapMethod::shadowMapMethod()
     : m_WVP(nullptr)
@@ -3,6 +3,8 @@
 #include "r_method.h"
 #include "m_mat.h"
 
+#include "u_vector.h"
+
 namespace r {
 
 struct shadowMap {
@@ -25,6 +27,56 @@ private:
     GLuint m_shadowMap;
 };
 
+// Allocates square power of two tiles of the shadow map to lights. The tiles
+// form a quadtree over the whole map: a free tile is split into four when a
+// smaller tile is requested and a released tile is merged back with its
+// siblings when they are all free again.
+struct shadowAtlas {
+    static constexpr size_t kMinTile = 64;
+
+    struct tile {
+        tile();
+        int node;
+        size_t x;
+        size_t y;
+        size_t size;
+    };
+
+    shadowAtlas();
+
+    void reset(size_t size);
+
+    // returns false if there is no free tile of that size
+    bool allocate(size_t size, tile &result);
+    void release(tile &t);
+
+    size_t size() const;
+
+private:
+    enum : unsigned char {
+        kFree,
+        kSplit,
+        kUsed
+    };
+
+    bool allocate(size_t node, size_t x, size_t y, size_t nodeSize, size_t size, tile &result);
+
+    u::vector<unsigned char> m_nodes;
+    size_t m_size;
+};
+
+inline shadowAtlas::tile::tile()
+    : node(-1)
+    , x(0)
+    , y(0)
+    , size(0)
+{
+}
+
+inline size_t shadowAtlas::size() const {
+    return m_size;
+}
+
 struct shadowMapMethod : method {
     shadowMapMethod();
     bool init();
@@ -214,7 +214,7 @@ void skybox::render(const pipeline &pl, const fog &f) {
         renderMethod->enable();
     }
 
-    renderMethod->setWVP(p.projection() * p.view() * p.world());
+    renderMethod->setWVP(p.worldViewProjection());
     renderMethod->setWorld(pl.world());
 
     // render skybox cube
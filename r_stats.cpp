@@ -9,8 +9,16 @@
 #include "r_common.h"
 #include "r_stats.h"
 
+#include "u_profiler.h"
+#include "u_log.h"
+
 NVAR(int, r_stats, "rendering statistics", 0, 1, 1);
 NVAR(int, r_stats_gpu_meminfo, "show GPU memory info if supported", 0, 1, 1);
+NVAR(int, r_stats_jobs, "show time spent in jobs", 0, 1, 1);
+NVAR(int, r_stats_profile, "show the hottest profiled scopes", 0, 1, 0);
+NVAR(int, r_stats_passes, "show the GL work issued by every pass", 0, 1, 0);
+NVAR(int, r_stats_passes_log, "write the GL work issued by every pass to the log", 0, 1, 0);
+NVAR(int, r_stats_glstate, "show issued and elided GL state changes", 0, 1, 0);
 NVAR(int, r_stats_histogram, "rendering statistics histogram", 0, 1, 1);
 NVAR(int, r_stats_histogram_duration, "duration in seconds to collect histogram samples", 1, 10, 2);
 NVAR(float, r_stats_histogram_size, "size of histogram in screen width percentage", 0.25f, 1.0f, 0.5f);
@@ -22,8 +30,12 @@ namespace r {
 u::map<const char *, stat> stat::m_stats;
 u::vector<float> stat::m_histogram;
 u::vector<unsigned char> stat::m_texture;
+u::vector<u::JobTiming> stat::m_jobTimings;
+gl::StateCounters stat::m_stateCounters;
+u::vector<stat::PassCounters> stat::m_passCounters;
 
 static constexpr size_t kSpace = 20u;
+static constexpr size_t kProfileScopes = 12u;
 
 void stat::drawHistogram(size_t x, size_t next) {
     // draw histogram
@@ -132,7 +144,93 @@ size_t stat::drawMemoryInfo(size_t x, size_t next) {
     return next;
 }
 
+size_t stat::drawJobInfo(size_t x, size_t next) {
+    if (m_jobTimings.empty())
+        return next;
+    const auto color = gui::RGBA(255,255,255);
+    gui::drawText(x, next, gui::kAlignLeft,
+        u::format("Jobs (%zu workers)", u::gJobs.workers()).c_str(), gui::RGBA(255, 255, 0));
+    next -= kSpace;
+    for (const auto &it : m_jobTimings) {
+        gui::drawText(x + kSpace, next, gui::kAlignLeft,
+            u::format("%s: %.2f ms (%zu %s)", it.name, it.milliseconds, it.count,
+                it.count > 1 ? "jobs" : "job").c_str(), color);
+        next -= kSpace;
+    }
+    return next;
+}
+
+size_t stat::drawProfileInfo(size_t x, size_t next) {
+    const auto &timings = u::gProfiler.timings();
+    if (timings.empty())
+        return next;
+    const auto color = gui::RGBA(255,255,255);
+    const size_t dropped = u::gProfiler.dropped();
+    gui::drawText(x, next, gui::kAlignLeft, dropped
+        ? u::format("Profile (%zu events dropped)", dropped).c_str()
+        : "Profile", gui::RGBA(255, 255, 0));
+    next -= kSpace;
+    const size_t count = u::min(timings.size(), kProfileScopes);
+    for (size_t i = 0; i < count; i++) {
+        const auto &it = timings[i];
+        gui::drawText(x + kSpace, next, gui::kAlignLeft,
+            u::format("%s: %.2f ms self, %.2f ms total (%zu, depth %zu)", it.name,
+                it.self, it.milliseconds, it.count, it.depth).c_str(), color);
+        next -= kSpace;
+    }
+    return next;
+}
+
+size_t stat::drawPassInfo(size_t x, size_t next) {
+    if (m_passCounters.empty())
+        return next;
+    const auto color = gui::RGBA(255,255,255);
+    gui::drawText(x, next, gui::kAlignLeft, "Passes", gui::RGBA(255, 255, 0));
+    next -= kSpace;
+    for (const auto &it : m_passCounters) {
+        const auto &c = it.counters;
+        gui::drawText(x + kSpace, next, gui::kAlignLeft,
+            u::format("%s: %zu draws, %zu triangles, %zu programs, %zu textures, %zu uniforms, %s streamed",
+                it.name, c.draws, c.triangles, c.programs, c.textures, c.uniforms,
+                u::sizeMetric(c.streamed)).c_str(), color);
+        next -= kSpace;
+    }
+    return next;
+}
+
+void stat::logPassInfo() {
+    u::Log::out("%-10s %8s %10s %8s %8s %8s %10s\n", "pass", "draws",
+        "triangles", "programs", "textures", "uniforms", "streamed");
+    for (const auto &it : m_passCounters) {
+        const auto &c = it.counters;
+        u::Log::out("%-10s %8zu %10zu %8zu %8zu %8zu %10zu\n", it.name, c.draws,
+            c.triangles, c.programs, c.textures, c.uniforms, c.streamed);
+    }
+}
+
+size_t stat::drawStateInfo(size_t x, size_t next) {
+    const auto color = gui::RGBA(255,255,255);
+    gui::drawText(x, next, gui::kAlignLeft, "GL State", gui::RGBA(255, 255, 0));
+    next -= kSpace;
+    for (size_t i = 0; i < gl::kStateCount; i++) {
+        gui::drawText(x + kSpace, next, gui::kAlignLeft,
+            u::format("%s: %zu issued (%zu elided)", gl::stateName(i),
+                m_stateCounters.issued[i], m_stateCounters.elided[i]).c_str(), color);
+        next -= kSpace;
+    }
+    return next;
+}
+
 void stat::render(size_t x) {
+    // timings of the jobs which ran this frame
+    u::gJobs.timings(m_jobTimings);
+    // state changes made this frame
+    gl::stateCounters(m_stateCounters);
+    if (r_stats_passes_log) {
+        logPassInfo();
+        r_stats_passes_log.set(0);
+    }
+
     if (r_stats) {
         // calculate total vertical space needed
         size_t space = kSpace;
@@ -154,11 +252,40 @@ void stat::render(size_t x) {
             }
         }
 
+        if (r_stats_jobs && m_jobTimings.size()) {
+            space += kSpace; // 1 for "Jobs" text
+            space += kSpace*m_jobTimings.size(); // for the timings
+        }
+
+        if (r_stats_profile && u::gProfiler.timings().size()) {
+            space += kSpace; // 1 for "Profile" text
+            space += kSpace*u::min(u::gProfiler.timings().size(), kProfileScopes); // for the scopes
+        }
+
+        if (r_stats_passes && m_passCounters.size()) {
+            space += kSpace; // 1 for "Passes" text
+            space += kSpace*m_passCounters.size(); // for the counters
+        }
+
+        if (r_stats_glstate) {
+            space += kSpace; // 1 for "GL State" text
+            space += kSpace*gl::kStateCount; // for the counters
+        }
+
         // shift up by vertical space
         size_t next = space;
         for (const auto &it : m_stats)
             next = it.second.draw(x, next);
 
+        if (r_stats_jobs)
+            next = drawJobInfo(x, next);
+        if (r_stats_profile)
+            next = drawProfileInfo(x, next);
+        if (r_stats_passes)
+            next = drawPassInfo(x, next);
+        if (r_stats_glstate)
+            next = drawStateInfo(x, next);
+
         // memory information before histogram
         if (r_stats_gpu_meminfo)
             next = drawMemoryInfo(x, next);
@@ -181,6 +308,16 @@ void stat::render(size_t x) {
         m_histogram.erase(m_histogram.begin(), m_histogram.begin()+1);
 }
 
+void stat::setPassCounters(const char *pass, const gl::Counters &counters) {
+    for (auto &it : m_passCounters) {
+        if (it.name != pass)
+            continue;
+        it.counters = counters;
+        return;
+    }
+    m_passCounters.push_back({ pass, counters });
+}
+
 stat *stat::get(const char *name) {
     auto find = m_stats.find(name);
     U_ASSERT(find != m_stats.end());
@@ -202,6 +339,14 @@ size_t stat::space() const {
     if (m_instances > 1)    space += kSpace;
     if (m_vboMemory)        space += kSpace;
     if (m_iboMemory)        space += kSpace;
+    if (m_trianglesTotal)   space += kSpace;
+    if (m_stateChanges)     space += kSpace;
+    if (m_worldDraws)       space += kSpace;
+    if (m_modelDraws)       space += kSpace;
+    if (m_shadowMapsRendered || m_shadowMapsCached) space += kSpace;
+    if (m_particles)        space += kSpace;
+    if (m_streamed)         space += kSpace;
+    if (m_renderWidth)      space += kSpace;
     if (m_textureCount)     space += kSpace * (m_textureCount > 1 ? 3 : 1);
     return space;
 }
@@ -226,6 +371,48 @@ size_t stat::draw(size_t x, size_t y) const {
             u::format("Index Memory: %s", u::sizeMetric(m_iboMemory)).c_str(), color);
         y -= kSpace;
     }
+    if (m_trianglesTotal) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Triangles: %zu of %zu (%.1f%%)", m_trianglesSubmitted, m_trianglesTotal,
+                100.0f * m_trianglesSubmitted / m_trianglesTotal).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_stateChanges) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("State Changes: %zu (%zu saved)", m_stateChanges, m_stateChangesSaved).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_worldDraws) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("World Draws: %zu (%zu ranges)", m_worldDraws, m_worldRanges).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_modelDraws) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Model Draws: %zu (%zu without instancing)", m_modelDraws, m_modelDrawsUninstanced).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_shadowMapsRendered || m_shadowMapsCached) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Shadow Maps: %zu (%zu cached)", m_shadowMapsRendered + m_shadowMapsCached, m_shadowMapsCached).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_particles) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Particles: %zu (%.0f updated per ms)", m_particles, m_particlesPerMillisecond).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_streamed) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Streamed: %s per frame", u::sizeMetric(m_streamed)).c_str(), color);
+        y -= kSpace;
+    }
+    if (m_renderWidth) {
+        gui::drawText(x + kSpace, y, gui::kAlignLeft,
+            u::format("Resolution: %zux%zu (%.0f%% scale)", m_renderWidth, m_renderHeight,
+                m_renderScale * 100.0f).c_str(), color);
+        y -= kSpace;
+    }
     if (m_textureCount > 1) {
         // Multiple textures: indicate count and total memory usage
         gui::drawText(x + kSpace, y, gui::kAlignLeft, "Textures:", color);
@@ -1,6 +1,9 @@
 #ifndef R_STATS_HDR
 #define R_STATS_HDR
 #include "u_map.h"
+#include "u_jobs.h"
+
+#include "r_common.h"
 
 namespace r {
 
@@ -18,6 +21,14 @@ struct stat {
     void decTextureCount();
     void incTextureMemory(int amount);
     void decTextureMemory(int amount);
+    void setTriangles(size_t submitted, size_t total);
+    void setStateChanges(size_t issued, size_t saved);
+    void setWorldDraws(size_t issued, size_t ranges);
+    void setModelDraws(size_t issued, size_t uninstanced);
+    void setShadowMaps(size_t rendered, size_t cached);
+    void setParticles(size_t count, float perMillisecond);
+    void setStreamed(size_t bytes);
+    void setResolution(size_t width, size_t height, float scale);
 
     const char *description() const;
     const char *name() const;
@@ -27,9 +38,17 @@ struct stat {
 
     static stat *get(const char *name);
 
+    // the GL work a pass issued during the last frame
+    static void setPassCounters(const char *pass, const gl::Counters &counters);
+
 private:
     static void drawHistogram(size_t x, size_t next);
     static size_t drawMemoryInfo(size_t x, size_t next);
+    static size_t drawJobInfo(size_t x, size_t next);
+    static size_t drawProfileInfo(size_t x, size_t next);
+    static size_t drawPassInfo(size_t x, size_t next);
+    static void logPassInfo();
+    static size_t drawStateInfo(size_t x, size_t next);
     size_t draw(size_t x, size_t y) const;
     size_t space() const;
 
@@ -41,10 +60,34 @@ private:
     size_t m_textureCount;
     size_t m_textureMemory;
     size_t m_instances;
+    size_t m_trianglesSubmitted;
+    size_t m_trianglesTotal;
+    size_t m_stateChanges;
+    size_t m_stateChangesSaved;
+    size_t m_worldDraws;
+    size_t m_worldRanges;
+    size_t m_modelDraws;
+    size_t m_modelDrawsUninstanced;
+    size_t m_shadowMapsRendered;
+    size_t m_shadowMapsCached;
+    size_t m_particles;
+    float m_particlesPerMillisecond;
+    size_t m_streamed;
+    size_t m_renderWidth;
+    size_t m_renderHeight;
+    float m_renderScale;
 
     static u::map<const char *, stat> m_stats;
     static u::vector<float> m_histogram;
     static u::vector<unsigned char> m_texture;
+    static u::vector<u::JobTiming> m_jobTimings;
+    static gl::StateCounters m_stateCounters;
+
+    struct PassCounters {
+        const char *name;
+        gl::Counters counters;
+    };
+    static u::vector<PassCounters> m_passCounters;
 };
 
 inline stat::stat()
@@ -55,6 +98,22 @@ inline stat::stat()
     , m_textureCount(0)
     , m_textureMemory(0)
     , m_instances(0)
+    , m_trianglesSubmitted(0)
+    , m_trianglesTotal(0)
+    , m_stateChanges(0)
+    , m_stateChangesSaved(0)
+    , m_worldDraws(0)
+    , m_worldRanges(0)
+    , m_modelDraws(0)
+    , m_modelDrawsUninstanced(0)
+    , m_shadowMapsRendered(0)
+    , m_shadowMapsCached(0)
+    , m_particles(0)
+    , m_particlesPerMillisecond(0.0f)
+    , m_streamed(0)
+    , m_renderWidth(0)
+    , m_renderHeight(0)
+    , m_renderScale(0.0f)
 {
 }
 
@@ -108,6 +167,46 @@ inline void stat::decTextureMemory(int amount) {
     m_textureMemory -= amount;
 }
 
+inline void stat::setTriangles(size_t submitted, size_t total) {
+    m_trianglesSubmitted = submitted;
+    m_trianglesTotal = total;
+}
+
+inline void stat::setStateChanges(size_t issued, size_t saved) {
+    m_stateChanges = issued;
+    m_stateChangesSaved = saved;
+}
+
+inline void stat::setWorldDraws(size_t issued, size_t ranges) {
+    m_worldDraws = issued;
+    m_worldRanges = ranges;
+}
+
+inline void stat::setModelDraws(size_t issued, size_t uninstanced) {
+    m_modelDraws = issued;
+    m_modelDrawsUninstanced = uninstanced;
+}
+
+inline void stat::setShadowMaps(size_t rendered, size_t cached) {
+    m_shadowMapsRendered = rendered;
+    m_shadowMapsCached = cached;
+}
+
+inline void stat::setParticles(size_t count, float perMillisecond) {
+    m_particles = count;
+    m_particlesPerMillisecond = perMillisecond;
+}
+
+inline void stat::setStreamed(size_t bytes) {
+    m_streamed = bytes;
+}
+
+inline void stat::setResolution(size_t width, size_t height, float scale) {
+    m_renderWidth = width;
+    m_renderHeight = height;
+    m_renderScale = scale;
+}
+
 inline const char *stat::description() const {
     return m_description;
 }
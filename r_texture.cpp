@@ -802,6 +802,8 @@ texture2D::texture2D(bool mipmaps, int filter)
     , m_mipmaps(mipmaps ? 1 : 0)
     , m_memory(0)
     , m_filter(filter)
+    , m_internal(0)
+    , m_levels(0)
 {
     //
 }
@@ -872,18 +874,22 @@ static inline void getTexParams(bool bilinear, bool mipmaps, bool trilinear, GLe
     min = kMinLookup[index];
 }
 
-void texture2D::applyFilter() {
-    const bool aniso = r_aniso && (m_filter & kFilterAniso);
-    const bool bilinear = r_bilinear && (m_filter & kFilterBilinear);
-    const bool trilinear = r_trilinear && (m_filter & kFilterTrilinear);
+static void applyFilter(GLenum target, int filter, bool mipmaps) {
+    const bool aniso = r_aniso && (filter & kFilterAniso);
+    const bool bilinear = r_bilinear && (filter & kFilterBilinear);
+    const bool trilinear = r_trilinear && (filter & kFilterTrilinear);
 
     GLenum min = GL_NEAREST;
     GLenum mag = GL_NEAREST;
-    getTexParams(bilinear, m_mipmaps, trilinear, min, mag);
-    gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, min);
-    gl::TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mag);
+    getTexParams(bilinear, mipmaps, trilinear, min, mag);
+    gl::TexParameteri(target, GL_TEXTURE_MIN_FILTER, min);
+    gl::TexParameteri(target, GL_TEXTURE_MAG_FILTER, mag);
     if (aniso)
-        gl::TexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, float(r_aniso));
+        gl::TexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, float(r_aniso));
+}
+
+void texture2D::applyFilter() {
+    r::applyFilter(GL_TEXTURE_2D, m_filter, m_mipmaps);
 }
 
 bool texture2D::cache(GLuint internal) {
@@ -1090,6 +1096,17 @@ bool texture2D::upload(GLint wrap) {
             cache(format.internal);
     }
 
+    // which format and mip levels were picked depends on the path taken above
+    GLint internal = 0;
+    gl::GetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internal);
+    m_internal = internal;
+    for (m_levels = 0; m_levels < m_mipmaps; m_levels++) {
+        GLint width = 0;
+        gl::GetTexLevelParameteriv(GL_TEXTURE_2D, m_levels, GL_TEXTURE_WIDTH, &width);
+        if (!width)
+            break;
+    }
+
     m_texture.unload();
     return m_uploaded = true;
 }
@@ -1111,4 +1128,75 @@ TextureFormat texture2D::format() const {
   return m_texture.format();
 }
 
+///! texture2DArray
+// immutable storage needs a sized internal format, uncompressed textures may
+// have been uploaded with an unsized one
+static GLenum sizedFormat(GLenum internal) {
+    switch (internal) {
+    case GL_RGBA: return GL_RGBA8;
+    case GL_RGB:  return GL_RGB8;
+    case GL_RG:   return GL_RG8;
+    case GL_RED:  return GL_R8;
+    }
+    return internal;
+}
+
+texture2DArray::texture2DArray()
+    : m_textureHandle(0)
+    , m_memory(0)
+{
+}
+
+texture2DArray::~texture2DArray() {
+    if (m_textureHandle)
+        gl::DeleteTextures(1, &m_textureHandle);
+}
+
+bool texture2DArray::upload(const u::vector<texture2D*> &layers) {
+    if (m_textureHandle || layers.empty())
+        return false;
+
+    const texture2D &first = *layers[0];
+    for (const auto *it : layers) {
+        if (!it->m_uploaded || it->m_internal != first.m_internal || it->m_levels != first.m_levels
+            || it->width() != first.width() || it->height() != first.height())
+        {
+            return false;
+        }
+    }
+
+    gl::GenTextures(1, &m_textureHandle);
+    gl::BindTexture(GL_TEXTURE_2D_ARRAY, m_textureHandle);
+    gl::TexStorage3D(GL_TEXTURE_2D_ARRAY, first.m_levels, sizedFormat(first.m_internal),
+        first.width(), first.height(), layers.size());
+
+    // the textures stay on the GPU, copying them avoids decoding or
+    // compressing them again
+    for (size_t i = 0; i < layers.size(); i++) {
+        size_t mipWidth = first.width();
+        size_t mipHeight = first.height();
+        for (size_t level = 0; level < first.m_levels; level++) {
+            gl::CopyImageSubData(layers[i]->m_textureHandle, GL_TEXTURE_2D, level, 0, 0, 0,
+                                 m_textureHandle, GL_TEXTURE_2D_ARRAY, level, 0, 0, i,
+                                 mipWidth, mipHeight, 1);
+            mipWidth = u::max(mipWidth >> 1, 1_z);
+            mipHeight = u::max(mipHeight >> 1, 1_z);
+        }
+    }
+
+    gl::TexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    gl::TexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    applyFilter(GL_TEXTURE_2D_ARRAY, first.m_filter, first.m_levels > 1);
+
+    m_memory = 0;
+    for (const auto *it : layers)
+        m_memory += it->m_memory;
+    return true;
+}
+
+void texture2DArray::bind(GLenum unit) {
+    gl::ActiveTexture(unit);
+    gl::BindTexture(GL_TEXTURE_2D_ARRAY, m_textureHandle);
+}
+
 }
@@ -30,7 +30,14 @@ struct texture2D {
     size_t memory() const;
     const Texture &get() const;
 
+    // the internal format and number of mip levels the texture was uploaded
+    // with, only valid after upload
+    GLenum internal() const;
+    size_t levels() const;
+
 private:
+    friend struct texture2DArray;
+
     bool useCache();
     void applyFilter();
     bool m_uploaded;
@@ -39,6 +46,8 @@ private:
     size_t m_mipmaps;
     size_t m_memory;
     int m_filter;
+    GLenum m_internal;
+    size_t m_levels;
 };
 
 inline const Texture &texture2D::get() const {
@@ -53,6 +62,34 @@ inline size_t texture2D::height() const {
     return m_texture.height();
 }
 
+inline GLenum texture2D::internal() const {
+    return m_internal;
+}
+
+inline size_t texture2D::levels() const {
+    return m_levels;
+}
+
+// Uploaded textures of the same internal format, size and number of mip levels
+// copied into the layers of a single array texture. Requires ARB_texture_storage
+// and ARB_copy_image
+struct texture2DArray {
+    texture2DArray();
+    ~texture2DArray();
+
+    bool upload(const u::vector<texture2D*> &layers);
+    void bind(GLenum unit);
+    size_t memory() const;
+
+private:
+    GLuint m_textureHandle;
+    size_t m_memory;
+};
+
+inline size_t texture2DArray::memory() const {
+    return m_memory;
+}
+
 }
 
 #endif
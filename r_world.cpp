@@ -1,3 +1,7 @@
+#include <string.h>
+
+#include <SDL_timer.h>
+
 #include "engine.h"
 #include "gui.h"
 
@@ -7,6 +11,7 @@
 #include "r_world.h"
 
 #include "u_log.h"
+#include "u_profiler.h"
 
 // Debug visualizations
 enum {
@@ -21,7 +26,9 @@ VAR(int, r_parallax, "parallax mapping", 0, 1, 1);
 VAR(int, r_ssao, "screen space ambient occlusion", 0, 1, 1);
 VAR(int, r_spec, "specularity mapping", 0, 1, 1);
 VAR(int, r_fog, "fog", 0, 1, 1);
-VAR(int, r_sm_size, "shadow map size", 16, 4096, 256);
+VAR(int, r_sm_size, "maximum shadow map size of a light", 16, 4096, 256);
+VAR(int, r_sm_atlas, "shadow map atlas size", 1024, 8192, 2048);
+VAR(int, r_sm_cache, "cache shadow maps of unchanged lights", 0, 1, 1);
 VAR(int, r_sm_border, "shadow map border", 0, 8, 3);
 VAR(int, r_vignette, "vignette", 0, 1, 1);
 VAR(float, r_vignette_radius, "vignette radius", 0.25f, 1.0f, 0.90f);
@@ -30,8 +37,19 @@ VAR(float, r_vignette_opacity, "vignette opacity", 0.0f, 1.0f, 0.5f);
 VAR(float, r_sm_bias, "shadow map bias", -10.0f, 10.0f, -0.1f);
 VAR(float, r_sm_poly_factor, "shadow map polygon offset factor", -1000.0f, 1000.0f, 1.0f);
 VAR(float, r_sm_poly_offset, "shadow map polygon offset units", -1000.0f, 1000.0f, 0.0f);
+VAR(int, r_world_cull, "hierarchical culling of world geometry", 0, 1, 1);
+VAR(int, r_world_pvs, "potentially visible set culling of world geometry", 0, 1, 1);
+VAR(int, r_occlusion, "software occlusion culling", 0, 1, 1);
+VAR(int, r_occlusion_budget, "maximum occluder triangles to rasterize", 64, 8192, 1024);
+VAR(int, r_instancing, "hardware instancing of map models", 0, 1, 1);
+VAR(int, r_clustered, "clustered shading of lights without shadows", 0, 1, 1);
+VAR(int, r_dynres, "dynamic resolution scaling", 0, 1, 0);
+VAR(float, r_dynres_min, "minimum resolution scale", 0.25f, 1.0f, 0.5f);
+VAR(float, r_dynres_max, "maximum resolution scale", 0.25f, 1.0f, 1.0f);
+VAR(float, r_dynres_target, "frame time in milliseconds to scale the resolution for", 1.0f, 100.0f, 16.6f);
 NVAR(int, r_debug, "debug visualizations", 0, 4, 0);
 NVAR(int, r_reload, "reload shaders", 0, 1, 0);
+NVAR(int, r_cull_bench, "benchmark frustum culling of that many spheres, boxes and model chunks", 0, 1000000, 0);
 
 namespace r {
 
@@ -176,9 +194,18 @@ World::LightChunk::LightChunk()
     , memory(0)
     , collect(false)
     , visible(false)
+    , clustered(false)
     , ebo(0)
     , stats(nullptr)
+    , shadowHash(0)
+    , shadowFrame(0)
+    , shadowCached(false)
+    , job(nullptr)
+    , buildMap(nullptr)
+    , buildHash(0)
+    , buildRadius(0.0f)
 {
+    SDL_AtomicSet(&built, 0);
 }
 
 World::LightChunk::~LightChunk() {
@@ -199,6 +226,10 @@ bool World::LightChunk::init(const char *name, const char *description) {
     return true;
 }
 
+bool World::LightChunk::building() {
+    return job && !SDL_AtomicGet(&built);
+}
+
 ///! spotLightChunk
 World::SpotLightChunk::SpotLightChunk()
     : light(nullptr)
@@ -210,69 +241,133 @@ World::SpotLightChunk::SpotLightChunk(const spotLight *light)
 {
 }
 
-bool World::SpotLightChunk::buildMesh(kdMap *map) {
-    if (hash == 0 && !init("slshadow", "Spot Light Shadows"))
+World::SpotLightChunk::~SpotLightChunk() {
+    // the job references this chunk
+    if (job) {
+        u::gJobs.wait(job);
+        u::gJobs.release(job);
+    }
+}
+
+bool World::SpotLightChunk::buildMesh(const kdMap *map, size_t hash) {
+    if (!ebo && !init("slshadow", "Spot Light Shadows"))
         return false;
-    if (memory)
-        stats->decIBOMemory(memory);
+    U_ASSERT(!job);
+    buildMap = map;
+    buildHash = hash;
+    buildPosition = light->position;
+    buildRadius = light->radius;
+    SDL_AtomicSet(&built, 0);
+    job = u::gJobs.create("build spot light mesh", buildMeshJob, this);
+    u::gJobs.run(job);
+    return true;
+}
+
+void World::SpotLightChunk::buildMeshJob(void *data, size_t, size_t) {
+    SpotLightChunk *const chunk = (SpotLightChunk *)data;
+    const kdMap *const map = chunk->buildMap;
+    const m::vec3 &position = chunk->buildPosition;
+    kdStack stack;
+    stack.resize(map->nodes.size() + 1);
     u::vector<size_t> triangleIndices;
-    u::vector<GLuint> indices;
-    map->inSphere(triangleIndices, light->position, light->radius);
+    u::vector<GLuint> &indices = chunk->m_indices;
+    map->inSphere(stack, triangleIndices, position, chunk->buildRadius);
     indices.reserve(triangleIndices.size() * 3 / 2);
     for (const auto &it : triangleIndices) {
         const auto &triangle = map->triangles[it];
-        const m::vec3 p1 = map->vertices[triangle.v[0]].vertex - light->position;
-        const m::vec3 p2 = map->vertices[triangle.v[1]].vertex - light->position;
-        const m::vec3 p3 = map->vertices[triangle.v[2]].vertex - light->position;
+        const m::vec3 p1 = map->vertices[triangle.v[0]].vertex - position;
+        const m::vec3 p2 = map->vertices[triangle.v[1]].vertex - position;
+        const m::vec3 p3 = map->vertices[triangle.v[2]].vertex - position;
         if (p1 * (p2 - p1).cross(p3 - p1) > 0)
             continue;
         for (const auto &it : triangle.v)
             indices.push_back(it);
     }
+    SDL_AtomicSet(&chunk->built, 1);
+}
+
+void World::SpotLightChunk::uploadMesh() {
+    U_ASSERT(job && !building());
+    u::gJobs.release(job);
+    job = nullptr;
+    if (memory)
+        stats->decIBOMemory(memory);
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof indices[0],
-        &indices[0], GL_STATIC_DRAW);
-    memory = indices.size() * sizeof indices[0];
-    count = indices.size();
+    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof m_indices[0],
+        m_indices.empty() ? nullptr : &m_indices[0], GL_STATIC_DRAW);
+    memory = m_indices.size() * sizeof m_indices[0];
+    count = m_indices.size();
+    hash = buildHash;
+    shadowCached = false;
     stats->incIBOMemory(memory);
-    return true;
+    m_indices.destroy();
 }
 
 ///! pointLightChunk
 World::PointLightChunk::PointLightChunk()
-    : light(nullptr)
+    : meshTile(0)
+    , light(nullptr)
+    , m_bias(0.0f)
 {
     memset(sideCounts, 0, sizeof sideCounts);
 }
 
 World::PointLightChunk::PointLightChunk(const pointLight *light)
-    : light(light)
+    : meshTile(0)
+    , light(light)
+    , m_bias(0.0f)
 {
     memset(sideCounts, 0, sizeof sideCounts);
 }
 
-bool World::PointLightChunk::buildMesh(kdMap *map) {
-    if (hash == 0 && !init("plshadow", "Point Light Shadows"))
+World::PointLightChunk::~PointLightChunk() {
+    // the job references this chunk
+    if (job) {
+        u::gJobs.wait(job);
+        u::gJobs.release(job);
+    }
+}
+
+bool World::PointLightChunk::buildMesh(const kdMap *map, size_t hash) {
+    if (!ebo && !init("plshadow", "Point Light Shadows"))
         return false;
-    // rebuilding mesh: throw away old memory statistics
-    if (memory)
-        stats->decIBOMemory(memory);
+    U_ASSERT(!job);
+    buildMap = map;
+    buildHash = hash;
+    buildPosition = light->position;
+    buildRadius = light->radius;
+    // the faces are a third of the tile of the light, a light without one
+    // is given the smallest
+    meshTile = shadowTile.size ? shadowTile.size : shadowAtlas::kMinTile;
+    const float face = meshTile / 3;
+    m_bias = r_sm_border / (face - r_sm_border);
+    SDL_AtomicSet(&built, 0);
+    job = u::gJobs.create("build point light mesh", buildMeshJob, this);
+    u::gJobs.run(job);
+    return true;
+}
 
+void World::PointLightChunk::buildMeshJob(void *data, size_t, size_t) {
+    PointLightChunk *const chunk = (PointLightChunk *)data;
+    const kdMap *const map = chunk->buildMap;
+    const m::vec3 &position = chunk->buildPosition;
+    kdStack stack;
+    stack.resize(map->nodes.size() + 1);
     u::vector<size_t> triangleIndices;
-    u::vector<GLuint> indices[6];
+    u::vector<GLuint> *const indices = chunk->m_indices;
 
-    map->inSphere(triangleIndices, light->position, light->radius);
+    map->inSphere(stack, triangleIndices, position, chunk->buildRadius);
 
     for (size_t side = 0; side < 6; ++side)
         indices[side].reserve(triangleIndices.size() * 3 / 6);
     for (const auto &it : triangleIndices) {
         const auto &triangle = map->triangles[it];
-        const m::vec3 p1 = map->vertices[triangle.v[0]].vertex - light->position;
-        const m::vec3 p2 = map->vertices[triangle.v[1]].vertex - light->position;
-        const m::vec3 p3 = map->vertices[triangle.v[2]].vertex - light->position;
+        const m::vec3 p1 = map->vertices[triangle.v[0]].vertex - position;
+        const m::vec3 p2 = map->vertices[triangle.v[1]].vertex - position;
+        const m::vec3 p3 = map->vertices[triangle.v[2]].vertex - position;
         if (p1 * (p2 - p1).cross(p3 - p1) > 0)
             continue;
-        const uint8_t mask = calcTriangleSideMask(p1, p2, p3, r_sm_border / float(r_sm_size - r_sm_border));
+        const uint8_t mask = calcTriangleSideMask(p1, p2, p3, chunk->m_bias);
         for (size_t side = 0; side < 6; ++side) {
             if (mask & (1 << side)) {
                 for (const auto &it : triangle.v)
@@ -280,25 +375,37 @@ bool World::PointLightChunk::buildMesh(kdMap *map) {
             }
         }
     }
+    SDL_AtomicSet(&chunk->built, 1);
+}
+
+void World::PointLightChunk::uploadMesh() {
+    U_ASSERT(job && !building());
+    u::gJobs.release(job);
+    job = nullptr;
+    // rebuilt mesh: throw away old memory statistics
+    if (memory)
+        stats->decIBOMemory(memory);
     count = 0;
     memory = 0;
     for (size_t side = 0; side < 6; ++side) {
-        sideCounts[side] = indices[side].size();
+        sideCounts[side] = m_indices[side].size();
         count += sideCounts[side];
     }
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof indices[0][0], nullptr, GL_STATIC_DRAW);
+    gl::BufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof m_indices[0][0], nullptr, GL_STATIC_DRAW);
     size_t offset = 0;
     for (size_t side = 0; side < 6; ++side) {
         if (sideCounts[side] > 0) {
-            gl::BufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset * sizeof indices[0][0],
-                sideCounts[side] * sizeof indices[0][0], &indices[side][0]);
-            memory += sideCounts[side] * sizeof indices[0][0];
+            gl::BufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset * sizeof m_indices[0][0],
+                sideCounts[side] * sizeof m_indices[0][0], &m_indices[side][0]);
+            memory += sideCounts[side] * sizeof m_indices[0][0];
         }
         offset += sideCounts[side];
+        m_indices[side].destroy();
     }
+    hash = buildHash;
+    shadowCached = false;
     stats->incIBOMemory(memory);
-    return true;
 }
 
 ///! modelChunk
@@ -307,11 +414,12 @@ World::ModelChunk::ModelChunk()
     , collect(false)
     , highlight(false)
     , visible(false)
+    , dirty(true)
     , model(nullptr)
 {
 }
 
-World::ModelChunk::ModelChunk(const r::model *model,
+World::ModelChunk::ModelChunk(r::model *model,
                               bool highlight,
                               const m::vec3 &position,
                               const m::vec3 &scale,
@@ -323,10 +431,151 @@ World::ModelChunk::ModelChunk(const r::model *model,
     , collect(false)
     , highlight(highlight)
     , visible(false)
+    , dirty(true)
     , model(model)
 {
 }
 
+// The transforms of four model instances as streams, lanes are instances. The
+// rotation is given by the sines and cosines of the half euler angles, the
+// bounds are those of the model and are transformed in place
+struct transformBatch {
+    alignas(16) float sin[3][4];
+    alignas(16) float cos[3][4];
+    alignas(16) float scale[3][4];
+    alignas(16) float position[3][4];
+    alignas(16) float min[3][4];
+    alignas(16) float max[3][4];
+    alignas(16) float world[3][4][4]; // rows of the world matrices
+};
+
+static void transformBatch4(transformBatch &b) {
+    // the rotation is rz * ry * rx, the matrix is that of the quaternion in
+    // the homogeneous form used by m::quat::getMatrix. The world matrix is
+    // the translation * rotation * scale
+#ifdef __SSE2__
+    const __m128 sx = _mm_load_ps(b.sin[0]), cx = _mm_load_ps(b.cos[0]);
+    const __m128 sy = _mm_load_ps(b.sin[1]), cy = _mm_load_ps(b.cos[1]);
+    const __m128 sz = _mm_load_ps(b.sin[2]), cz = _mm_load_ps(b.cos[2]);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 x1 = _mm_sub_ps(zero, _mm_mul_ps(sz, sy));
+    const __m128 y1 = _mm_mul_ps(cz, sy);
+    const __m128 z1 = _mm_mul_ps(sz, cy);
+    const __m128 w1 = _mm_mul_ps(cz, cy);
+    const __m128 x = _mm_add_ps(_mm_mul_ps(x1, cx), _mm_mul_ps(w1, sx));
+    const __m128 y = _mm_add_ps(_mm_mul_ps(y1, cx), _mm_mul_ps(z1, sx));
+    const __m128 z = _mm_sub_ps(_mm_mul_ps(z1, cx), _mm_mul_ps(y1, sx));
+    const __m128 w = _mm_sub_ps(_mm_mul_ps(w1, cx), _mm_mul_ps(x1, sx));
+    const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y);
+    const __m128 zz = _mm_mul_ps(z, z), ww = _mm_mul_ps(w, w);
+    const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    const __m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 rotate[3][3] = {
+        { _mm_sub_ps(_mm_add_ps(ww, xx), _mm_add_ps(yy, zz)),
+          _mm_mul_ps(two, _mm_sub_ps(xy, zw)),
+          _mm_mul_ps(two, _mm_add_ps(xz, yw)) },
+        { _mm_mul_ps(two, _mm_add_ps(xy, zw)),
+          _mm_sub_ps(_mm_add_ps(ww, yy), _mm_add_ps(xx, zz)),
+          _mm_mul_ps(two, _mm_sub_ps(yz, xw)) },
+        { _mm_mul_ps(two, _mm_sub_ps(xz, yw)),
+          _mm_mul_ps(two, _mm_add_ps(yz, xw)),
+          _mm_sub_ps(_mm_add_ps(ww, zz), _mm_add_ps(xx, yy)) }
+    };
+    __m128 min[3], max[3];
+    for (size_t i = 0; i < 3; i++) {
+        min[i] = _mm_load_ps(b.min[i]);
+        max[i] = _mm_load_ps(b.max[i]);
+    }
+    for (size_t i = 0; i < 3; i++) {
+        const __m128 position = _mm_load_ps(b.position[i]);
+        __m128 lower = position;
+        __m128 upper = position;
+        for (size_t j = 0; j < 3; j++) {
+            const __m128 m = _mm_mul_ps(rotate[i][j], _mm_load_ps(b.scale[j]));
+            _mm_store_ps(b.world[i][j], m);
+            const __m128 a = _mm_mul_ps(m, min[j]);
+            const __m128 c = _mm_mul_ps(m, max[j]);
+            lower = _mm_add_ps(lower, _mm_min_ps(a, c));
+            upper = _mm_add_ps(upper, _mm_max_ps(a, c));
+        }
+        _mm_store_ps(b.world[i][3], position);
+        _mm_store_ps(b.min[i], lower);
+        _mm_store_ps(b.max[i], upper);
+    }
+#else
+    for (size_t k = 0; k < 4; k++) {
+        const float sx = b.sin[0][k], cx = b.cos[0][k];
+        const float sy = b.sin[1][k], cy = b.cos[1][k];
+        const float sz = b.sin[2][k], cz = b.cos[2][k];
+        const float x1 = -sz*sy, y1 = cz*sy, z1 = sz*cy, w1 = cz*cy;
+        const float x = x1*cx + w1*sx;
+        const float y = y1*cx + z1*sx;
+        const float z = z1*cx - y1*sx;
+        const float w = w1*cx - x1*sx;
+        const float rotate[3][3] = {
+            { w*w + x*x - y*y - z*z, 2.0f*(x*y - z*w), 2.0f*(x*z + y*w) },
+            { 2.0f*(x*y + z*w), w*w - x*x + y*y - z*z, 2.0f*(y*z - x*w) },
+            { 2.0f*(x*z - y*w), 2.0f*(y*z + x*w), w*w - x*x - y*y + z*z }
+        };
+        float min[3], max[3];
+        for (size_t i = 0; i < 3; i++) {
+            min[i] = b.min[i][k];
+            max[i] = b.max[i][k];
+        }
+        for (size_t i = 0; i < 3; i++) {
+            float lower = b.position[i][k];
+            float upper = b.position[i][k];
+            for (size_t j = 0; j < 3; j++) {
+                const float m = rotate[i][j] * b.scale[j][k];
+                b.world[i][j][k] = m;
+                lower += u::min(m*min[j], m*max[j]);
+                upper += u::max(m*min[j], m*max[j]);
+            }
+            b.world[i][3][k] = b.position[i][k];
+            b.min[i][k] = lower;
+            b.max[i][k] = upper;
+        }
+    }
+#endif
+}
+
+void World::transformModels(const u::vector<ModelChunk*> &models) {
+    transformBatch b;
+    for (size_t i = 0; i < models.size(); i += 4) {
+        // unused lanes of the last batch transform an empty box
+        const size_t count = u::min(models.size() - i, size_t(4));
+        memset(&b, 0, sizeof b);
+        for (size_t k = 0; k < count; k++) {
+            const auto &it = *models[i + k];
+            const auto &mdl = *it.model;
+            const m::vec3 rotate = it.rotate + mdl.rotate;
+            const m::vec3 scale = it.scale + mdl.scale;
+            const m::bbox bounds = mdl.bounds();
+            for (size_t j = 0; j < 3; j++) {
+                const m::vec2 sc = m::sincos(m::toRadian(rotate[j]) * 0.5f);
+                b.sin[j][k] = sc.x;
+                b.cos[j][k] = sc.y;
+                b.scale[j][k] = scale[j];
+                b.position[j][k] = it.position[j];
+                b.min[j][k] = bounds.min()[j];
+                b.max[j][k] = bounds.max()[j];
+            }
+        }
+        transformBatch4(b);
+        for (size_t k = 0; k < count; k++) {
+            auto &it = *models[i + k];
+            m::vec4 rows[3];
+            for (size_t j = 0; j < 3; j++)
+                rows[j] = { b.world[j][0][k], b.world[j][1][k], b.world[j][2][k], b.world[j][3][k] };
+            it.world = m::mat4(rows[0], rows[1], rows[2], { 0.0f, 0.0f, 0.0f, 1.0f });
+            it.bounds = m::bbox({ b.min[0][k], b.min[1][k], b.min[2][k] },
+                                { b.max[0][k], b.max[1][k], b.max[2][k] });
+            it.dirty = false;
+        }
+    }
+}
+
 /// NOTE: Testing only
 struct dustSystem final : particleSystem {
     dustSystem(const m::vec3 &ownerPosition);
@@ -366,28 +615,136 @@ void dustSystem::initParticle(particle &p, const m::vec3 &ownerPosition) {
     p.visible = true;
 }
 
+///! dynamicResolution
+constexpr size_t dynamicResolution::kHistory;
+constexpr float dynamicResolution::kStep;
+constexpr float dynamicResolution::kMaxStep;
+constexpr float dynamicResolution::kHeadroom;
+
+dynamicResolution::dynamicResolution()
+    : m_last(0.0f)
+    , m_scale(1.0f)
+{
+}
+
+void dynamicResolution::reset() {
+    m_history.clear();
+    m_last = 0.0f;
+    m_scale = 1.0f;
+}
+
+void dynamicResolution::update(float mspf, float target, float minScale, float maxScale) {
+    maxScale = u::max(minScale, maxScale);
+    m_scale = m::clamp(m_scale, minScale, maxScale);
+    if (mspf > 0.0f && mspf != m_last) {
+        m_last = mspf;
+        m_history.push_back(mspf);
+    }
+    if (m_history.size() < kHistory)
+        return;
+
+    float average = 0.0f;
+    for (const auto it : m_history)
+        average += it;
+    average /= m_history.size();
+
+    // the cost of the passes at the render size is about proportional to the
+    // pixels in it. The scale only steps back up once the frame time is well
+    // below the target such that it doesn't oscillate around it
+    const float fit = m_scale * m::sqrt(target / average);
+    const auto quantize = [](float scale) { return m::floor(scale / kStep + 0.001f) * kStep; };
+    float scale = m_scale;
+    if (average > target)
+        scale = u::min(quantize(fit), m_scale - kStep);
+    else if (average < target * kHeadroom)
+        scale = u::max(quantize(u::min(fit, m_scale + kMaxStep)), m_scale + kStep);
+    scale = m::clamp(scale, minScale, maxScale);
+
+    if (scale != m_scale) {
+        // the readings were taken at the previous scale
+        m_scale = scale;
+        m_history.clear();
+    } else {
+        m_history.erase(m_history.begin(), m_history.begin() + 1);
+    }
+}
+
+m::perspective dynamicResolution::apply(const m::perspective &p) const {
+    m::perspective scaled = p;
+    scaled.width = u::max(1.0f, m::floor(p.width * m_scale + 0.5f));
+    scaled.height = u::max(1.0f, m::floor(p.height * m_scale + 0.5f));
+    return scaled;
+}
+
 ///! world
 static constexpr float kLightRadiusTweak = 1.11f;
+// lights and models culled by a single job
+static constexpr size_t kCullGrain = 16;
+
+// Space for the uniform blocks of the light passes in a single frame
+static constexpr size_t kUniformBufferSize = 256 << 10;
+// Space for the world matrices of instanced map models in a single frame
+static constexpr size_t kInstanceBufferSize = 256 << 10;
+
+static bool instancing() {
+    return r_instancing && gl::has(gl::ARB_draw_instanced) && gl::has(gl::ARB_instanced_arrays);
+}
+
+// integer textures and texelFetch need GLSL 1.30
+static bool clustered() {
+    return r_clustered && gl::glslVersion() >= 130;
+}
+
+constexpr int32_t World::kNoCluster;
 
 // light entities
-void World::addPointLight(r::pointLight *light) {
-    // ignore adding it again
-    auto find = m_culledPointLights.find(light);
+scene::scene()
+    : colorGraded(false)
+{
+}
+
+void scene::clear() {
+    colorGraded = false;
+    pointLights.clear();
+    spotLights.clear();
+    models.clear();
+    // keep the memory of the positions around
+    for (auto &it : billboards)
+        it.positions.clear();
+}
+
+void World::reset() {
+    // walk all the entities and mark them for collection
+    for (auto &it : m_models)
+        it.second->collect = true;
+    for (auto &it : m_culledSpotLights)
+        it.second->collect = true;
+    for (auto &it : m_culledPointLights)
+        it.second->collect = true;
+    for (auto &it : m_billboards)
+        it.second.first = true;
+}
+
+void World::addPointLight(const void *instance, const r::pointLight *light) {
+    // ignore adding it again, the light lives in the scene of this frame
+    auto find = m_culledPointLights.find(instance);
     if (find != m_culledPointLights.end()) {
         find->second->collect = false;
+        find->second->light = light;
         return;
     }
-    m_culledPointLights.insert( { light, new PointLightChunk(light) } );
+    m_culledPointLights.insert( { instance, new PointLightChunk(light) } );
 }
 
-void World::addSpotLight(r::spotLight *light) {
-    // ignore adding it again
-    auto find = m_culledSpotLights.find(light);
+void World::addSpotLight(const void *instance, const r::spotLight *light) {
+    // ignore adding it again, the light lives in the scene of this frame
+    auto find = m_culledSpotLights.find(instance);
     if (find != m_culledSpotLights.end()) {
         find->second->collect = false;
+        find->second->light = light;
         return;
     }
-    m_culledSpotLights.insert( { light, new SpotLightChunk(light) } );
+    m_culledSpotLights.insert( { instance, new SpotLightChunk(light) } );
 }
 
 void World::addBillboard(r::billboard *billboard) {
@@ -401,45 +758,82 @@ void World::addBillboard(r::billboard *billboard) {
     m_billboards.insert({ billboard, { false, billboard } });
 }
 
-void World::addModel(r::model *model,
+void World::addModel(const void *instance,
+                     r::model *model,
                      bool highlight,
                      const m::vec3 &position,
                      const m::vec3 &scale,
                      const m::vec3 &rotate)
 {
-    auto find = m_models.find(model);
+    auto find = m_models.find(instance);
     if (find != m_models.end()) {
-        find->second->collect = false;
-        // update properties of existing
-        find->second->highlight = highlight;
-        find->second->position = position;
-        find->second->rotate = rotate;
+        auto &chunk = *find->second;
+        chunk.collect = false;
+        // update properties of existing, the transform is only recalculated
+        // when the instance moved
+        chunk.highlight = highlight;
+        if (chunk.position != position || chunk.scale != scale || chunk.rotate != rotate) {
+            chunk.position = position;
+            chunk.scale = scale;
+            chunk.rotate = rotate;
+            chunk.dirty = true;
+        }
+        if (chunk.model != model) {
+            if (!model->vao)
+                model->upload();
+            chunk.model = model;
+            chunk.dirty = true;
+        }
         return;
     }
-    // upload and insert the model
-    model->upload();
-    m_models.insert({ model, new ModelChunk(model, highlight, position, scale, rotate) });
+    // upload the model the first time it's placed and insert the instance
+    if (!model->vao)
+        model->upload();
+    m_models.insert({ instance, new ModelChunk(model, highlight, position, scale, rotate) });
 }
 
-// global entities
-fog &World::getFog() {
-    return m_fog;
-}
+///! world
+static const char *kPassNames[] = {
+    "cull",
+    "geometry",
+    "ssao",
+    "lighting",
+    "shadow",
+    "forward",
+    "composite"
+};
+
+// Counts the GL work issued in a scope into counters
+struct CountScope {
+    CountScope(gl::Counters &counters);
+    ~CountScope();
+private:
+    gl::Counters *m_previous;
+};
 
-directionalLight *World::getDirectionalLight() {
-    return &m_directionalLight;
+inline CountScope::CountScope(gl::Counters &counters)
+    : m_previous(gl::countInto(&counters))
+{
 }
 
-ColorGrader *World::getColorGrader() {
-    return &m_grader;
+inline CountScope::~CountScope() {
+    gl::countInto(m_previous);
 }
 
-///! world
 World::World()
     : m_geomMethods(&geomMethods::instance())
     , m_gun(nullptr)
     , m_kdWorld(nullptr)
+    , m_orphanCluster(kNoCluster)
+    , m_triangles(0)
+    , m_cameraLeaf(-1)
+    , m_materialBuffer(0)
+    , m_shadowSettings(0)
+    , m_shadowFrame(0)
+    , m_shadowMapsRendered(0)
+    , m_shadowMapsCached(0)
     , m_uploaded(false)
+    , m_passCounters()
     , m_stats(nullptr)
 {
 }
@@ -448,24 +842,472 @@ World::~World() {
     unload(false);
 }
 
+void World::buildClusters(kdMap *map) {
+    const auto &nodes = map->nodes;
+    const auto &leafs = map->leafs;
+
+    // a triangle which straddles a splitting plane is referenced by more than
+    // one leaf; only the first leaf to reference it owns it for rendering
+    u::vector<int32_t> triangleOwners(map->triangles.size(), -1);
+    u::vector<size_t> leafCounts(leafs.size(), 0);
+    for (size_t i = 0; i < leafs.size(); i++) {
+        for (const auto &it : leafs[i].triangles) {
+            if (triangleOwners[it] != -1)
+                continue;
+            triangleOwners[it] = i;
+            leafCounts[i]++;
+        }
+    }
+
+    // nodes are stored in pre-order so children always come after their
+    // parents; walking backwards accumulates triangle counts of every subtree
+    u::vector<size_t> nodeCounts(nodes.size(), 0);
+    for (size_t i = nodes.size(); i-- > 0; ) {
+        for (const auto &it : nodes[i].children)
+            nodeCounts[i] += it < 0 ? leafCounts[-it-1] : nodeCounts[it];
+    }
+
+    // the largest subtree with fewer than kClusterTriangles triangles becomes
+    // a cluster, this keeps the amount of draw calls down for partially visible
+    // geometry while still allowing big chunks of the world to be culled
+    static constexpr size_t kClusterTriangles = 256;
+    m_nodeClusters.resize(nodes.size(), kNoCluster);
+    m_leafClusters.resize(leafs.size(), kNoCluster);
+
+    u::vector<u::vector<uint32_t>> clusterTriangles;
+    u::vector<int32_t> stack;
+    u::vector<int32_t> gather;
+    if (nodes.size())
+        stack.push_back(0);
+    while (!stack.empty()) {
+        const int32_t node = stack.back();
+        stack.pop_back();
+        if (node >= 0 && nodeCounts[node] > kClusterTriangles) {
+            stack.push_back(nodes[node].children[1]);
+            stack.push_back(nodes[node].children[0]);
+            continue;
+        }
+        if (node < 0 && m_leafClusters[-node-1] != kNoCluster)
+            continue;
+        const int32_t cluster = clusterTriangles.size();
+        if (node >= 0)
+            m_nodeClusters[node] = cluster;
+        clusterTriangles.push_back({});
+        auto &triangles = clusterTriangles.back();
+        // gather all triangles owned by leafs of this subtree
+        gather.push_back(node);
+        while (!gather.empty()) {
+            const int32_t next = gather.back();
+            gather.pop_back();
+            if (next >= 0) {
+                gather.push_back(nodes[next].children[1]);
+                gather.push_back(nodes[next].children[0]);
+                continue;
+            }
+            const size_t leaf = -next-1;
+            if (m_leafClusters[leaf] != kNoCluster)
+                continue;
+            m_leafClusters[leaf] = cluster;
+            for (const auto &it : leafs[leaf].triangles)
+                if (triangleOwners[it] == int32_t(leaf))
+                    triangles.push_back(it);
+        }
+    }
+
+    // triangles which never made it into a leaf are kept in a cluster of their
+    // own which is only tested against the frustum
+    m_orphanCluster = kNoCluster;
+    for (size_t i = 0; i < triangleOwners.size(); i++) {
+        if (triangleOwners[i] != -1)
+            continue;
+        if (m_orphanCluster == kNoCluster) {
+            m_orphanCluster = clusterTriangles.size();
+            clusterTriangles.push_back({});
+        }
+        clusterTriangles[m_orphanCluster].push_back(i);
+    }
+
+    m_clusters.resize(clusterTriangles.size());
+    for (size_t i = 0; i < clusterTriangles.size(); i++) {
+        auto &cluster = m_clusters[i];
+        cluster.triangles = clusterTriangles[i].size();
+        cluster.visible = cluster.triangles;
+        if (!cluster.triangles)
+            continue;
+        const auto &triangles = clusterTriangles[i];
+        cluster.bounds = { map->vertices[map->triangles[triangles[0]].v[0]].vertex };
+        for (const auto &it : triangles)
+            for (const auto &jt : map->triangles[it].v)
+                cluster.bounds.expand(map->vertices[jt].vertex);
+
+        // the largest triangles of every cluster are used as occluders
+        static constexpr size_t kOccludersPerCluster = 16;
+        u::vector<u::pair<float, uint32_t>> areas;
+        areas.reserve(triangles.size());
+        for (const auto &it : triangles) {
+            const m::vec3 &p1 = map->vertices[map->triangles[it].v[0]].vertex;
+            const m::vec3 &p2 = map->vertices[map->triangles[it].v[1]].vertex;
+            const m::vec3 &p3 = map->vertices[map->triangles[it].v[2]].vertex;
+            areas.push_back({ (p2 - p1).cross(p3 - p1).abs(), it });
+        }
+        u::sort(areas.begin(), areas.end(),
+            [](const u::pair<float, uint32_t> &lhs, const u::pair<float, uint32_t> &rhs) {
+                return lhs.first > rhs.first;
+            }
+        );
+        for (size_t j = 0; j < areas.size() && j < kOccludersPerCluster; j++)
+            cluster.occluders.push_back(areas[j].second);
+    }
+
+    // distribute the triangles of every cluster into texture batches, clusters
+    // are visited in traversal order which keeps spatially adjacent clusters
+    // adjacent in the index buffer such that their ranges can be merged
+    u::vector<u::vector<uint32_t>> batchTriangles(map->textures.size());
+    m_textureBatches.resize(map->textures.size());
+    for (size_t i = 0; i < clusterTriangles.size(); i++) {
+        for (const auto &it : clusterTriangles[i]) {
+            const size_t texture = map->triangles[it].texture;
+            auto &ranges = m_textureBatches[texture].ranges;
+            if (ranges.empty() || ranges.back().cluster != i)
+                ranges.push_back({ i, batchTriangles[texture].size() * 3, 0 });
+            ranges.back().count += 3;
+            batchTriangles[texture].push_back(it);
+        }
+    }
+
+    m_triangles = 0;
+    for (size_t i = 0; i < m_textureBatches.size(); i++) {
+        auto &batch = m_textureBatches[i];
+        batch.start = m_indices.size();
+        batch.index = i;
+        batch.group = nullptr;
+        for (const auto &it : batchTriangles[i])
+            for (const auto &jt : map->triangles[it].v)
+                m_indices.push_back(jt);
+        batch.count = m_indices.size() - batch.start;
+        for (auto &it : batch.ranges)
+            it.start += batch.start;
+        m_triangles += batch.count / 3;
+    }
+
+    m_cullStack.resize(nodes.size() + 1);
+}
+
+void World::buildTextureArrays() {
+    // the layers and constants of a material are picked by the base instance
+    // of its draw command
+    if (!m_renderQueue.supportsIndirect()
+        || !gl::has(gl::ARB_base_instance)
+        || !gl::has(gl::ARB_texture_storage)
+        || !gl::has(gl::ARB_copy_image))
+    {
+        return;
+    }
+
+    // textures can be layers of the same array when they agree in format, size
+    // and mip levels
+    struct textureClass {
+        GLenum internal;
+        size_t width;
+        size_t height;
+        size_t levels;
+        u::vector<texture2D*> layers;
+    };
+    u::vector<textureClass> classes;
+    auto classify = [&classes](const texture2D *texture) -> int {
+        if (!texture)
+            return -1;
+        for (size_t i = 0; i < classes.size(); i++) {
+            const auto &it = classes[i];
+            if (it.internal == texture->internal() && it.levels == texture->levels()
+                && it.width == texture->width() && it.height == texture->height())
+            {
+                return i;
+            }
+        }
+        classes.push_back({ texture->internal(), texture->width(), texture->height(), texture->levels(), {} });
+        return classes.size() - 1;
+    };
+
+    // materials with the same permutation whose textures fall into the same
+    // classes can be drawn together
+    struct groupKey {
+        int classes[4]; // { diffuse, normal, spec, displacement }
+        bool specParams;
+        size_t members;
+    };
+    u::vector<groupKey> keys;
+    u::vector<int> batchKeys(m_textureBatches.size(), -1);
+    for (size_t i = 0; i < m_textureBatches.size(); i++) {
+        const auto &mat = m_textureBatches[i].mat;
+        if (!mat.diffuse || mat.animated())
+            continue;
+        const groupKey key = {
+            { classify(mat.diffuse), classify(mat.normal), classify(mat.spec), classify(mat.displacement) },
+            mat.specParams,
+            1
+        };
+        for (size_t j = 0; j < keys.size() && batchKeys[i] == -1; j++) {
+            auto &it = keys[j];
+            if (!memcmp(it.classes, key.classes, sizeof key.classes) && it.specParams == key.specParams) {
+                it.members++;
+                batchKeys[i] = j;
+            }
+        }
+        if (batchKeys[i] == -1) {
+            batchKeys[i] = keys.size();
+            keys.push_back(key);
+        }
+    }
+
+    // only materials which share a group are moved into arrays
+    auto layer = [&classes](int index, texture2D *texture) -> size_t {
+        if (index == -1)
+            return 0;
+        auto &layers = classes[index].layers;
+        for (size_t i = 0; i < layers.size(); i++)
+            if (layers[i] == texture)
+                return i;
+        layers.push_back(texture);
+        return layers.size() - 1;
+    };
+    u::vector<materialInstance> instances(m_textureBatches.size());
+    size_t groups = 0;
+    for (size_t i = 0; i < m_textureBatches.size(); i++) {
+        const auto &mat = m_textureBatches[i].mat;
+        auto &instance = instances[i];
+        mat.instance(instance);
+        instance.layers[0] = instance.layers[1] = instance.layers[2] = instance.layers[3] = 0.0f;
+        if (batchKeys[i] == -1 || keys[batchKeys[i]].members < 2)
+            continue;
+        const auto &key = keys[batchKeys[i]];
+        instance.layers[0] = layer(key.classes[0], mat.diffuse);
+        instance.layers[1] = layer(key.classes[1], mat.normal);
+        instance.layers[2] = layer(key.classes[2], mat.spec);
+        instance.layers[3] = layer(key.classes[3], mat.displacement);
+    }
+    for (const auto &it : keys)
+        if (it.members > 1)
+            groups++;
+    if (!groups)
+        return;
+
+    m_textureArrays.resize(classes.size(), nullptr);
+    for (size_t i = 0; i < classes.size(); i++) {
+        if (classes[i].layers.empty())
+            continue;
+        m_textureArrays[i] = new texture2DArray;
+        if (m_textureArrays[i]->upload(classes[i].layers))
+            continue;
+        // the materials are drawn by themselves
+        u::Log::err("[world] => failed to upload texture array\n");
+        for (auto *it : m_textureArrays)
+            delete it;
+        m_textureArrays.destroy();
+        return;
+    }
+    for (const auto *it : m_textureArrays) {
+        if (!it)
+            continue;
+        m_stats->incTextureCount();
+        m_stats->incTextureMemory(it->memory());
+    }
+
+    // the group vector is not resized below, batches point into it
+    m_materialGroups.resize(groups);
+    u::vector<int> keyGroups(keys.size(), -1);
+    size_t grouped = 0;
+    for (size_t i = 0, next = 0; i < m_textureBatches.size(); i++) {
+        auto &batch = m_textureBatches[i];
+        if (batchKeys[i] == -1 || keys[batchKeys[i]].members < 2)
+            continue;
+        int &index = keyGroups[batchKeys[i]];
+        if (index == -1) {
+            const auto &key = keys[batchKeys[i]];
+            auto &group = m_materialGroups[next];
+            auto array = [this](int which) {
+                return which == -1 ? nullptr : m_textureArrays[which];
+            };
+            group.arrays = { array(key.classes[0]), array(key.classes[1]),
+                             array(key.classes[2]), array(key.classes[3]) };
+            group.mat = batch.mat;
+            group.mat.arrays = &group.arrays;
+            index = next++;
+        }
+        batch.group = &m_materialGroups[index];
+        grouped++;
+    }
+
+    gl::GenBuffers(1, &m_materialBuffer);
+    gl::BindVertexArray(vao);
+    gl::BindBuffer(GL_ARRAY_BUFFER, m_materialBuffer);
+    gl::BufferData(GL_ARRAY_BUFFER, instances.size() * sizeof instances[0], &instances[0], GL_STATIC_DRAW);
+    gl::VertexAttribPointer(geomMethod::kMaterialLayers, 4, GL_FLOAT, GL_FALSE, sizeof(materialInstance),
+        u::offset_of(&materialInstance::layers));
+    gl::VertexAttribPointer(geomMethod::kMaterialParams, 4, GL_FLOAT, GL_FALSE, sizeof(materialInstance),
+        u::offset_of(&materialInstance::params));
+    gl::VertexAttribDivisor(geomMethod::kMaterialLayers, 1);
+    gl::VertexAttribDivisor(geomMethod::kMaterialParams, 1);
+    gl::EnableVertexAttribArray(geomMethod::kMaterialLayers);
+    gl::EnableVertexAttribArray(geomMethod::kMaterialParams);
+
+    u::Log::out("[world] => %zu materials drawn in %zu groups from texture arrays\n",
+        grouped, groups);
+}
+
+void World::rasterizeOccluders(const pipeline &pl) {
+    m_occlusion.clear(pl.worldViewProjection());
+    if (!r_occlusion) {
+        m_occlusion.finalize();
+        return;
+    }
+
+    // occluders of clusters inside the frustum are rasterized front to back
+    // until the budget runs out
+    m_occluderClusters.clear();
+    for (size_t i = 0; i < m_clusters.size(); i++) {
+        auto &it = m_clusters[i];
+        if (it.occluders.empty() || !m_frustum.testBox(it.bounds))
+            continue;
+        const m::vec3 distance = it.bounds.center() - pl.position();
+        m_occluderClusters.push_back({ distance * distance, i });
+    }
+    u::sort(m_occluderClusters.begin(), m_occluderClusters.end(),
+        [](const u::pair<float, size_t> &lhs, const u::pair<float, size_t> &rhs) {
+            return lhs.first < rhs.first;
+        }
+    );
+
+    const auto &triangles = m_kdWorld->triangles;
+    const auto &vertices = m_kdWorld->vertices;
+    size_t budget = r_occlusion_budget;
+    for (const auto &it : m_occluderClusters) {
+        for (const auto &jt : m_clusters[it.second].occluders) {
+            const auto &triangle = triangles[jt];
+            m_occlusion.rasterize(vertices[triangle.v[0]].vertex,
+                                  vertices[triangle.v[1]].vertex,
+                                  vertices[triangle.v[2]].vertex);
+            if (--budget == 0)
+                break;
+        }
+        if (budget == 0)
+            break;
+    }
+    m_occlusion.finalize();
+}
+
+void World::updateVisibility(const m::vec3 &position) {
+    if (m_kdWorld->nodes.empty())
+        return;
+
+    // without potentially visible sets everything is visible which is exactly
+    // what happens for a leaf without visibility information
+    const int32_t leaf = r_world_pvs ? m_kdWorld->findLeaf(position) : -1;
+    if (leaf == m_cameraLeaf && !m_leafVisibility.empty())
+        return;
+
+    m_cameraLeaf = leaf;
+    m_kdWorld->leafVisibility(leaf, m_leafVisibility);
+
+    // nodes are stored in pre-order so children always come after their
+    // parents; walking backwards propagates visibility up the tree
+    const auto &nodes = m_kdWorld->nodes;
+    m_nodeVisibility.resize(nodes.size());
+    for (size_t i = nodes.size(); i-- > 0; ) {
+        m_nodeVisibility[i] = 0;
+        for (const auto &it : nodes[i].children)
+            m_nodeVisibility[i] |= it < 0 ? leafVisible(-it-1) : m_nodeVisibility[it];
+    }
+}
+
+bool World::leafVisible(size_t leaf) const {
+    return m_leafVisibility[leaf / 8] & (1 << (leaf % 8));
+}
+
+bool World::potentiallyVisible(kdStack &stack, const m::vec3 &position, float radius) const {
+    if (m_kdWorld->nodes.empty())
+        return true;
+    // visible when any leaf the sphere touches is in the potentially visible set
+    const auto &nodes = m_kdWorld->nodes;
+    const auto &planes = m_kdWorld->planes;
+    stack.reset();
+    stack.push(0);
+    while (stack) {
+        const int32_t node = stack.pop();
+        if (node < 0) {
+            if (leafVisible(-node-1))
+                return true;
+            continue;
+        }
+        if (!m_nodeVisibility[node])
+            continue;
+        const auto &it = nodes[node];
+        const float distance = planes[it.plane].distance(position);
+        if (distance > -radius)
+            stack.push(it.children[0]);
+        if (distance < radius)
+            stack.push(it.children[1]);
+    }
+    return false;
+}
+
+void World::cullClusters() {
+    if (!r_world_cull || m_kdWorld->nodes.empty()) {
+        for (auto &it : m_clusters)
+            it.visible = it.triangles;
+        return;
+    }
+
+    for (auto &it : m_clusters)
+        it.visible = false;
+
+    // hierarchical culling: a node whose bounding sphere is outside the frustum
+    // rejects everything beneath it
+    const auto &nodes = m_kdWorld->nodes;
+    m_cullStack.reset();
+    m_cullStack.push(0);
+    while (m_cullStack) {
+        const int32_t node = m_cullStack.pop();
+        int32_t cluster = kNoCluster;
+        if (node < 0) {
+            if (!leafVisible(-node-1))
+                continue;
+            cluster = m_leafClusters[-node-1];
+        } else {
+            const auto &it = nodes[node];
+            if (!m_nodeVisibility[node])
+                continue;
+            if (!m_frustum.testSphere(it.sphereOrigin, it.sphereRadius))
+                continue;
+            if (!m_occlusion.testSphere(it.sphereOrigin, it.sphereRadius))
+                continue;
+            cluster = m_nodeClusters[node];
+            if (cluster == kNoCluster) {
+                m_cullStack.push(it.children[1]);
+                m_cullStack.push(it.children[0]);
+                continue;
+            }
+        }
+        if (cluster == kNoCluster)
+            continue;
+        auto &it = m_clusters[cluster];
+        it.visible = it.triangles && m_frustum.testBox(it.bounds)
+                                  && m_occlusion.testBox(it.bounds);
+    }
+
+    if (m_orphanCluster != kNoCluster) {
+        auto &it = m_clusters[m_orphanCluster];
+        it.visible = m_frustum.testBox(it.bounds);
+    }
+}
+
 bool World::load(kdMap *map) {
     // load skybox
     if (!m_skybox.load("textures/sky01"))
         return false;
 
     // make rendering batches for triangles which share the same texture
-    for (size_t i = 0; i < map->textures.size(); i++) {
-        renderTextureBatch batch;
-        batch.start = m_indices.size();
-        batch.index = i;
-        for (size_t j = 0; j < map->triangles.size(); j++) {
-            if (map->triangles[j].texture == i)
-                for (size_t k = 0; k < 3; k++)
-                    m_indices.push_back(map->triangles[j].v[k]);
-        }
-        batch.count = m_indices.size() - batch.start;
-        m_textureBatches.push_back(batch);
-    }
+    buildClusters(map);
 
     m_kdWorld = map;
 
@@ -551,6 +1393,9 @@ bool World::upload(const m::perspective &p) {
 
     m_stats->incIBOMemory(m_indices.size() * sizeof m_indices[0]);
 
+    // needs the vertex array and the uploaded materials
+    buildTextureArrays();
+
     // composite shader
     if (!m_compositeMethod.init())
         neoFatal("failed to initialize composite rendering method");
@@ -616,6 +1461,19 @@ bool World::upload(const m::perspective &p) {
     m_spotLightMethods[1].setDepthTextureUnit(lightMethod::kDepth);
     m_spotLightMethods[1].setShadowMapTextureUnit(lightMethod::kShadowMap);
 
+    // clustered light method
+    if (gl::glslVersion() >= 130) {
+        if (!m_clusteredLightMethod.init())
+            neoFatal("failed to initialize clustered light rendering method");
+        m_clusteredLightMethod.enable();
+        m_clusteredLightMethod.setColorTextureUnit(lightMethod::kColor);
+        m_clusteredLightMethod.setNormalTextureUnit(lightMethod::kNormal);
+        m_clusteredLightMethod.setDepthTextureUnit(lightMethod::kDepth);
+        m_clusteredLightMethod.setClusterMapTextureUnit(lightMethod::kClusterMap);
+        m_clusteredLightMethod.setLightIndexMapTextureUnit(lightMethod::kLightIndexMap);
+        m_clusteredLightMethod.setLightMapTextureUnit(lightMethod::kLightMap);
+    }
+
     // bbox method
     if (!m_bboxMethod.init())
         neoFatal("failed to initialize bounding box rendering method");
@@ -665,13 +1523,31 @@ bool World::upload(const m::perspective &p) {
     if (!m_vignette.init(p))
         neoFatal("failed to initialize vignette render buffer");
 
-    if (!m_shadowMap.init(r_sm_size*3, r_sm_size*2))
+    if (!m_shadowMap.init(r_sm_atlas, r_sm_atlas))
         neoFatal("failed to initialize shadow map");
     if (!m_shadowMapMethod.init())
         neoFatal("failed to initialize shadow map method");
     m_shadowMapMethod.enable();
     m_shadowMapMethod.setWVP(m::mat4::kIdentity);
 
+    if (lightMethod::uniformBlocks()) {
+        GLint alignment = 0;
+        gl::GetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (!m_uniformBuffer.init(GL_UNIFORM_BUFFER, kUniformBufferSize, alignment))
+            neoFatal("failed to initialize uniform buffer");
+    }
+
+    if (!m_renderQueue.init())
+        neoFatal("failed to initialize render queue");
+
+    if (gl::glslVersion() >= 130 && !m_lightClusters.init())
+        neoFatal("failed to initialize light clusters");
+
+    if (gl::has(gl::ARB_draw_instanced) && gl::has(gl::ARB_instanced_arrays)) {
+        if (!m_instanceBuffer.init(GL_ARRAY_BUFFER, kInstanceBufferSize, sizeof(m::mat4)))
+            neoFatal("failed to initialize instance buffer");
+    }
+
     u::Log::out("[world] => uploaded\n");
     return m_uploaded = true;
 }
@@ -683,6 +1559,9 @@ void World::unload(bool destroy) {
     for (auto &it : m_culledPointLights) delete it.second;
     for (auto &it : m_culledSpotLights)  delete it.second;
     for (auto &it : m_models)            delete it.second;
+    m_visibleModels.clear();
+    // reset the shadow atlas the next frame
+    m_shadowSettings = 0;
 
     for (auto &it : m_textures2D) {
         m_stats->decTextureCount();
@@ -690,6 +1569,21 @@ void World::unload(bool destroy) {
         delete it.second;
     }
 
+    for (auto &it : m_textureBatches)
+        it.group = nullptr;
+    m_materialGroups.destroy();
+    for (auto *it : m_textureArrays) {
+        if (!it)
+            continue;
+        m_stats->decTextureCount();
+        m_stats->decTextureMemory(it->memory());
+        delete it;
+    }
+    m_textureArrays.destroy();
+    if (m_materialBuffer)
+        gl::DeleteBuffers(1, &m_materialBuffer);
+    m_materialBuffer = 0;
+
     for (auto *it : m_particleSystems)
         delete it;
 
@@ -700,6 +1594,11 @@ void World::unload(bool destroy) {
         m_billboards.clear();
         m_indices.destroy();
         m_textureBatches.destroy();
+        m_clusters.destroy();
+        m_nodeClusters.destroy();
+        m_leafClusters.destroy();
+        m_leafVisibility.destroy();
+        m_nodeVisibility.destroy();
         m_textures2D.clear();
     }
 
@@ -710,46 +1609,68 @@ void World::unload(bool destroy) {
     u::Log::out("[world] => unloaded\n");
 }
 
-void World::render(const pipeline &pl) {
-    m_frustum.update(pl.projection() * pl.view() * pl.world());
+void World::render(const pipeline &pl, const scene &scene_) {
+    // this also calculates the cached matrices of the pipeline before the
+    // culling jobs copy it
+    m_frustum.update(pl.worldViewProjection());
+
+    m_directionalLight = scene_.directionalLight_;
+    m_fog = scene_.fog_;
+    // the composite pass grades it again
+    if (scene_.colorGraded)
+        m_grader = scene_.colorGrader_;
 
-    // the job of the game code is to call reset before the start
-    // of every world frame and add all entities to the world
-    // before calling render.
-    //
     // the world in a sense manages internal entities and doesn't actually
     // remove entities during reset but rather marks them to be collected
     // here.
     //
-    // the idea is the game code will add the entities back which will
-    // unmark the collect flag preventing them from being removed
-    u::vector<SpotLightChunk*> removeSpotLights;
-    u::vector<PointLightChunk*> removePointLights;
-    u::vector<r::model*> removeModels;
+    // the entities of the scene are added back which will unmark the collect
+    // flag preventing them from being removed
+    reset();
+    for (const auto &it : scene_.pointLights)
+        addPointLight(it.first, &it.second);
+    for (const auto &it : scene_.spotLights)
+        addSpotLight(it.first, &it.second);
+    for (const auto &it : scene_.billboards) {
+        for (const auto &position : it.positions)
+            it.billboard_->add(position);
+        addBillboard(it.billboard_);
+    }
+    for (const auto &it : scene_.models)
+        addModel(it.instance, it.model_, it.highlight, it.position, it.scale, it.rotate);
+
+    u::vector<const void*> removeSpotLights;
+    u::vector<const void*> removePointLights;
+    u::vector<const void*> removeModels;
     u::vector<r::billboard*> removeBillboards;
     for (auto it = m_models.begin(); it != m_models.end(); ++it)
         if (it->second->collect)
             removeModels.push_back(it->first);
     for (auto it = m_culledSpotLights.begin(); it != m_culledSpotLights.end(); ++it)
         if (it->second->collect)
-            removeSpotLights.push_back(it->second);
+            removeSpotLights.push_back(it->first);
     for (auto it = m_culledPointLights.begin(); it != m_culledPointLights.end(); ++it)
         if (it->second->collect)
-            removePointLights.push_back(it->second);
+            removePointLights.push_back(it->first);
     for (auto it = m_billboards.begin(); it != m_billboards.end(); ++it)
         if (it->second.first)
             removeBillboards.push_back(it->first);
-    for (auto *it : removeSpotLights) {
-        m_culledSpotLights.erase(m_culledSpotLights.find((r::spotLight*)it->light));
-        delete it;
+    for (const auto &it : removeSpotLights) {
+        auto find = m_culledSpotLights.find(it);
+        m_shadowAtlas.release(find->second->shadowTile);
+        delete find->second;
+        m_culledSpotLights.erase(find);
     }
-    for (auto *it : removePointLights) {
-        m_culledPointLights.erase(m_culledPointLights.find((r::pointLight*)it->light));
-        delete it;
+    for (const auto &it : removePointLights) {
+        auto find = m_culledPointLights.find(it);
+        m_shadowAtlas.release(find->second->shadowTile);
+        delete find->second;
+        m_culledPointLights.erase(find);
     }
     for (const auto &it : removeModels) {
-        m_models.erase(m_models.find(it));
-        delete it;
+        auto find = m_models.find(it);
+        delete find->second;
+        m_models.erase(find);
     }
     for (const auto &it : removeBillboards) {
         // note: not deleted like others since this references the game's
@@ -767,6 +1688,8 @@ void World::render(const pipeline &pl) {
             it.reload();
         for (auto &it : m_spotLightMethods)
             it.reload();
+        if (gl::glslVersion() >= 130)
+            m_clusteredLightMethod.reload();
         m_ssaoMethod.reload();
         m_bboxMethod.reload();
         m_aaMethod.reload();
@@ -774,79 +1697,286 @@ void World::render(const pipeline &pl) {
         r_reload.set(0);
     }
 
-    cullPass(pl);
-    geometryPass(pl);
-    lightingPass(pl);
-    forwardPass(pl);
-    compositePass(pl);
+    // pick the size the world is rendered at. The frame timer is updated by
+    // the main thread, it's read here the same way the stats histogram does
+    if (r_dynres)
+        m_resolution.update(neoFrameTimer().mspf(), r_dynres_target, r_dynres_min, r_dynres_max);
+    else
+        m_resolution.reset();
+    m_renderPerspective = m_resolution.apply(pl.perspective());
+    pipeline scaled = pl;
+    scaled.setPerspective(m_renderPerspective);
+    m_stats->setResolution(size_t(m_renderPerspective.width),
+        size_t(m_renderPerspective.height), m_resolution.scale());
+
+    m_passTimings.clear();
+    for (auto &it : m_passCounters)
+        it = gl::Counters();
+    const auto pass = [this](size_t index, void (World::*function)(const pipeline &), const pipeline &p) {
+        const char *const name = kPassNames[index];
+        U_PROFILE(name);
+        CountScope count(m_passCounters[index]);
+        const size_t draws = gl::drawCalls();
+        const uint64_t start = SDL_GetPerformanceCounter();
+        (this->*function)(p);
+        const float milliseconds = 1000.0f * (SDL_GetPerformanceCounter() - start)
+                                 / SDL_GetPerformanceFrequency();
+        m_passTimings.push_back({ name, milliseconds, gl::drawCalls() - draws });
+    };
+    pass(kPassCull, &World::cullPass, pl);
+    pass(kPassGeometry, &World::geometryPass, scaled);
+    pass(kPassLighting, &World::lightingPass, scaled);
+    pass(kPassForward, &World::forwardPass, scaled);
+    pass(kPassComposite, &World::compositePass, pl);
+
+    for (size_t i = 0; i < kPassCount; i++)
+        stat::setPassCounters(kPassNames[i], m_passCounters[i]);
 }
 
-void World::cullPass(const pipeline &pl) {
-    const float widthOffset = 0.5f * m_shadowMap.widthScale(r_sm_size);
-    const float heightOffset = 0.5f * m_shadowMap.heightScale(r_sm_size);
-    const float widthScale = 0.5f * m_shadowMap.widthScale(r_sm_size - r_sm_border);
-    const float heightScale = 0.5f * m_shadowMap.heightScale(r_sm_size - r_sm_border);
-
-    // cull spot lights (and calculate theit transform)
-    for (auto &pair : m_culledSpotLights) {
-        auto &it = *pair.second;
-        const auto &light = pair.first;
-        const float scale = light->radius * kLightRadiusTweak;
-        it.visible = m_frustum.testSphere(light->position, scale);
-        const auto hash = light->hash();
-        if (it.visible && light->castShadows && it.hash != hash) {
-            it.buildMesh(m_kdWorld);
-            it.hash = hash;
-            it.transform = m::mat4::translate({widthOffset, heightOffset, 0.5f}) *
-                           m::mat4::scale({widthScale, heightScale, 0.5f}) *
-                           m::mat4::project(light->cutOff, 1.0f / light->radius, m::sqrt(3.0f), r_sm_bias / light->radius) *
-                           m::mat4::lookat(light->direction, m::vec3::yAxis) *
-                           m::mat4::scale(1.0f / light->radius) *
-                           m::mat4::translate(-light->position);
-        }
+// Tests count random spheres and boxes around position one at a time and in
+// batches and logs how many of them are tested per second either way
+static void benchmarkCulling(m::frustum frustum, const m::vec3 &position, size_t count) {
+    static constexpr float kRange = 2048.0f;
+    static constexpr float kMaxSize = 64.0f;
+    u::vector<m::vec3> centers(count);
+    u::vector<float> radii(count);
+    u::vector<m::bbox> boxes(count);
+    m::sphereBounds sphereBounds;
+    m::boxBounds boxBounds;
+    for (size_t i = 0; i < count; i++) {
+        centers[i] = position + m::vec3(u::randf() - 0.5f, u::randf() - 0.5f, u::randf() - 0.5f) * kRange;
+        radii[i] = 1.0f + u::randf() * kMaxSize;
+        boxes[i] = { centers[i] - radii[i], centers[i] + radii[i] };
+        sphereBounds.add(centers[i], radii[i]);
+        boxBounds.add(boxes[i]);
     }
+    u::vector<bool> visible(count);
+    size_t inside[4] = { 0, 0, 0, 0 };
+    double seconds[4];
+    Uint64 start = 0;
+    const auto finish = [&](size_t index) {
+        seconds[index] = double(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        for (size_t i = 0; i < count; i++)
+            inside[index] += visible[i];
+    };
 
-    // cull point lights (and calculate their transform)
-    for (auto &pair : m_culledPointLights) {
-        auto &it = *pair.second;
-        const auto &light = pair.first;
-        const float scale = light->radius * kLightRadiusTweak;
-        it.visible = m_frustum.testSphere(light->position, scale);
-        const auto hash = light->hash();
-        if (it.visible && light->castShadows && it.hash != hash) {
-            it.buildMesh(m_kdWorld);
-            it.hash = hash;
-            it.transform = m::mat4::translate({widthOffset, heightOffset, 0.5f}) *
-                           m::mat4::scale({widthScale, heightScale, 0.5f}) *
-                           m::mat4::project(90.0f, 1.0f / light->radius, m::sqrt(3.0f), r_sm_bias / light->radius) *
-                           m::mat4::scale(1.0f / light->radius);
-        }
+    start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < count; i++)
+        visible[i] = frustum.testSphere(centers[i], radii[i]);
+    finish(0);
+
+    start = SDL_GetPerformanceCounter();
+    frustum.testSpheres(sphereBounds, 0, count, &visible[0]);
+    finish(1);
+
+    start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < count; i++)
+        visible[i] = frustum.testBox(boxes[i]);
+    finish(2);
+
+    start = SDL_GetPerformanceCounter();
+    frustum.testBoxes(boxBounds, 0, count, &visible[0]);
+    finish(3);
+
+    static const char *const kNames[] = { "spheres", "spheres batched", "boxes", "boxes batched" };
+    for (size_t i = 0; i < 4; i++) {
+        u::Log::out("[world] => culled %zu %s in %.3f ms (%.1f million/s, %zu inside)\n",
+            count, kNames[i], seconds[i] * 1000.0, count / seconds[i] / 1000000.0, inside[i]);
     }
+}
+
+void World::cullModels(const pipeline &pl, const u::vector<ModelChunk*> &models, const m::boxBounds &modelBounds) {
+    // every job traverses the tree with its own stack
+    const size_t stackSize = m_kdWorld->nodes.size() + 1;
 
     // cull models (and calculate their pipeline)
-    for (auto &pair : m_models) {
-        auto &it = *pair.second;
-        auto &mdl = *pair.first;
+    u::gJobs.parallelFor("cull models", models.size(), kCullGrain,
+        [&](size_t begin, size_t end) {
+            kdStack stack;
+            stack.resize(stackSize);
+            bool inFrustum[kCullGrain];
+            m_frustum.testBoxes(modelBounds, begin, end, inFrustum);
+            for (size_t i = begin; i < end; i++) {
+                auto &it = *models[i];
+                it.pipeline = pl;
+                it.pipeline.setWorldMatrix(it.world);
+
+                const m::bbox &bounds = it.bounds;
+                it.visible = inFrustum[i - begin]
+                          && potentiallyVisible(stack, bounds.center(), bounds.size().abs() * 0.5f)
+                          && m_occlusion.testBox(bounds);
+            }
+        }
+    );
+}
 
-        it.pipeline = pl;
-        it.pipeline.setWorld(it.position);
-        it.pipeline.setScale(it.scale + mdl.scale);
+// Culls count model chunks placed randomly around the camera like the models
+// of the scene are culled and logs how many of them are culled per second
+void World::benchmarkModelCulling(const pipeline &pl, size_t count) {
+    static constexpr float kRange = 2048.0f;
+    static constexpr float kMaxSize = 64.0f;
+    u::vector<ModelChunk> chunks(count);
+    u::vector<ModelChunk*> models(count);
+    m::boxBounds bounds;
+    for (size_t i = 0; i < count; i++) {
+        auto &it = chunks[i];
+        const float size = 1.0f + u::randf() * kMaxSize;
+        it.position = pl.position() + m::vec3(u::randf() - 0.5f, u::randf() - 0.5f, u::randf() - 0.5f) * kRange;
+        it.world = m::mat4::translate(it.position) * m::mat4::scale(m::vec3(size));
+        it.bounds = { it.position - size, it.position + size };
+        bounds.add(it.bounds);
+        models[i] = &it;
+    }
 
-        const m::vec3 rot = it.rotate + mdl.rotate;
-        const m::quat rx(m::toRadian(rot.x), m::vec3::xAxis);
-        const m::quat ry(m::toRadian(rot.y), m::vec3::yAxis);
-        const m::quat rz(m::toRadian(rot.z), m::vec3::zAxis);
-        m::mat4 rotate = (rz * ry * rx).getMatrix();
-        it.pipeline.setRotate(rotate);
+    const Uint64 start = SDL_GetPerformanceCounter();
+    cullModels(pl, models, bounds);
+    const double seconds = double(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    size_t visible = 0;
+    for (const auto &it : chunks)
+        visible += it.visible;
+    u::Log::out("[world] => culled %zu model chunks in %.3f ms (%.1f million/s, %zu visible)\n",
+        count, seconds * 1000.0, count / seconds / 1000000.0, visible);
+}
 
-        it.visible = m_frustum.testBox(mdl.bounds().transform(it.pipeline.world()));
+void World::cullPass(const pipeline &pl) {
+    // cull world geometry, occluders must be rasterized first as everything
+    // after this is tested against them
+    updateVisibility(pl.position());
+    rasterizeOccluders(pl);
+    cullClusters();
+
+    // everything below is culled in parallel, gather it first
+    u::vector<SpotLightChunk*> spotLights;
+    u::vector<PointLightChunk*> pointLights;
+    u::vector<ModelChunk*> models;
+    spotLights.reserve(m_culledSpotLights.size());
+    pointLights.reserve(m_culledPointLights.size());
+    models.reserve(m_models.size());
+    for (auto &it : m_culledSpotLights)
+        spotLights.push_back(it.second);
+    for (auto &it : m_culledPointLights)
+        pointLights.push_back(it.second);
+    u::vector<ModelChunk*> moved;
+    for (auto &it : m_models) {
+        models.push_back(it.second);
+        if (it.second->dirty)
+            moved.push_back(it.second);
+    }
+
+    // only models which moved get their world matrix and bounds recalculated
+    transformModels(moved);
+
+    if (r_cull_bench) {
+        benchmarkCulling(m_frustum, pl.position(), r_cull_bench);
+        benchmarkModelCulling(pl, r_cull_bench);
+        r_cull_bench.set(0);
+    }
+
+    // the bounds are packed into streams such that the frustum tests them
+    // four at a time
+    m_spotLightBounds.clear();
+    m_pointLightBounds.clear();
+    m_modelBounds.clear();
+    for (const auto *it : spotLights)
+        m_spotLightBounds.add(it->light->position, it->light->radius * kLightRadiusTweak);
+    for (const auto *it : pointLights)
+        m_pointLightBounds.add(it->light->position, it->light->radius * kLightRadiusTweak);
+    for (const auto *it : models)
+        m_modelBounds.add(it->bounds);
+
+    // every job traverses the tree with its own stack
+    const size_t stackSize = m_kdWorld->nodes.size() + 1;
+
+    // cull spot lights
+    u::gJobs.parallelFor("cull spot lights", spotLights.size(), kCullGrain,
+        [&](size_t begin, size_t end) {
+            kdStack stack;
+            stack.resize(stackSize);
+            bool inFrustum[kCullGrain];
+            m_frustum.testSpheres(m_spotLightBounds, begin, end, inFrustum);
+            for (size_t i = begin; i < end; i++) {
+                auto &it = *spotLights[i];
+                const auto &light = it.light;
+                const float scale = light->radius * kLightRadiusTweak;
+                it.visible = inFrustum[i - begin]
+                          && potentiallyVisible(stack, light->position, scale)
+                          && m_occlusion.testSphere(light->position, scale);
+            }
+        }
+    );
+
+    // cull point lights
+    u::gJobs.parallelFor("cull point lights", pointLights.size(), kCullGrain,
+        [&](size_t begin, size_t end) {
+            kdStack stack;
+            stack.resize(stackSize);
+            bool inFrustum[kCullGrain];
+            m_frustum.testSpheres(m_pointLightBounds, begin, end, inFrustum);
+            for (size_t i = begin; i < end; i++) {
+                auto &it = *pointLights[i];
+                const auto &light = it.light;
+                const float scale = light->radius * kLightRadiusTweak;
+                it.visible = inFrustum[i - begin]
+                          && potentiallyVisible(stack, light->position, scale)
+                          && m_occlusion.testSphere(light->position, scale);
+            }
+        }
+    );
+
+    // the meshes of point lights depend on the size of their tile
+    allocateShadowMaps(pl, spotLights, pointLights);
+
+    // shadow meshes are built asynchronously: upload the ones which finished
+    // and start building for lights which changed. Lights keep rendering with
+    // their previous mesh in the meantime
+    for (auto *it : spotLights) {
+        if (it->job && !it->building())
+            it->uploadMesh();
+        const auto hash = it->light->hash();
+        if (it->visible && it->light->castShadows && it->hash != hash && !it->job)
+            it->buildMesh(m_kdWorld, hash);
     }
+    for (auto *it : pointLights) {
+        if (it->job && !it->building())
+            it->uploadMesh();
+        const auto hash = it->light->hash();
+        const bool resized = it->shadowTile.size && it->shadowTile.size != it->meshTile;
+        if (it->visible && it->light->castShadows && (it->hash != hash || resized) && !it->job)
+            it->buildMesh(m_kdWorld, hash);
+    }
+
+    cullModels(pl, models, m_modelBounds);
+
+    // group the visible models by the model they're an instance of such that
+    // they can be drawn together
+    m_visibleModels.clear();
+    for (auto *it : models)
+        if (it->visible)
+            m_visibleModels.push_back(it);
+    u::sort(m_visibleModels.begin(), m_visibleModels.end(),
+        [](const ModelChunk *lhs, const ModelChunk *rhs) { return lhs->model < rhs->model; });
+
+    // instances share the pose of their model: animate every model once
+    u::vector<ModelChunk*> animated;
+    for (size_t i = 0; i < m_visibleModels.size(); i++) {
+        auto *it = m_visibleModels[i];
+        if ((i == 0 || it->model != m_visibleModels[i - 1]->model) && it->model->animated())
+            animated.push_back(it);
+    }
+    u::gJobs.parallelFor("animate models", animated.size(), 1,
+        [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                animated[i]->model->animate(animated[i]->frame);
+        }
+    );
 }
 
 void World::geometryPass(const pipeline &pl) {
     // The scene pass will be writing into the gbuffer
     m_gBuffer.update(pl.perspective());
     m_gBuffer.bindWriting();
+    gl::Viewport(0, 0, pl.perspective().width, pl.perspective().height);
 
     // Clear the depth and color buffers. This is a new scene pass.
     // We need depth testing as the scene pass will write into the depth
@@ -855,42 +1985,113 @@ void World::geometryPass(const pipeline &pl) {
     gl::Enable(GL_DEPTH_TEST);
     gl::Disable(GL_BLEND);
 
-    // Render the map
-    gl::BindVertexArray(vao);
-    for (auto &it : m_textureBatches) {
-        it.mat.bind(pl, pl.world());
-        gl::DrawElements(GL_TRIANGLES, it.count, GL_UNSIGNED_INT,
-            (const GLvoid*)(it.start * sizeof m_indices[0]));
+    // Render the map: visible ranges of adjacent clusters are merged into a
+    // single draw which is sorted by material and then front to back
+    m_renderQueue.clear();
+    const m::mat4 world = pl.world();
+    const bool indirect = m_renderQueue.indirect();
+    for (size_t i = 0; i < m_textureBatches.size(); i++) {
+        auto &it = m_textureBatches[i];
+        it.mat.calculatePermutation();
+        // materials of a group share the material of the group instead, its
+        // index follows the ones of the batches
+        material *mat = &it.mat;
+        size_t index = i;
+        if (indirect && it.group) {
+            mat = &it.group->mat;
+            mat->calculatePermutation();
+            index = m_textureBatches.size() + (it.group - &m_materialGroups[0]);
+        }
+        float depth = 0.0f;
+        auto submit = [&](size_t start, size_t count) {
+            renderPacket packet;
+            packet.mat = mat;
+            packet.pl = &pl;
+            packet.world = world;
+            packet.bones = nullptr;
+            packet.joints = 0;
+            packet.vao = vao;
+            packet.count = count;
+            packet.offset = start * sizeof m_indices[0];
+            packet.instance = i;
+            m_renderQueue.add(renderQueue::key(renderQueue::kPassGeometry, mat->permute, index, depth), packet);
+        };
+        // distance to the nearest point on the bounding sphere of the cluster
+        auto distance = [&](const m::bbox &bounds) {
+            return (bounds.center() - pl.position()).abs() - bounds.size().abs() * 0.5f;
+        };
+        size_t start = 0;
+        size_t count = 0;
+        for (const auto &jt : it.ranges) {
+            const auto &cluster = m_clusters[jt.cluster];
+            if (!cluster.visible)
+                continue;
+            if (count && start + count == jt.start) {
+                count += jt.count;
+                depth = u::min(depth, distance(cluster.bounds));
+                continue;
+            }
+            if (count)
+                submit(start, count);
+            start = jt.start;
+            count = jt.count;
+            depth = distance(cluster.bounds);
+        }
+        if (count)
+            submit(start, count);
     }
-
-#if 0
-    // Render map models
-    for (const auto &pair : m_models) {
-        auto &it = *pair.second;
-        auto &mdl = *pair.first;
-
-        it.pipeline = pl;
-        it.pipeline.setWorld(it.position);
-        it.pipeline.setScale(it.scale + mdl.scale);
-
-        const m::vec3 rot = it.rotate + mdl.rotate;
-        const m::quat rx(m::toRadian(rot.x), m::vec3::xAxis);
-        const m::quat ry(m::toRadian(rot.y), m::vec3::yAxis);
-        const m::quat rz(m::toRadian(rot.z), m::vec3::zAxis);
-        m::mat4 rotate = (rz * ry * rx).getMatrix();
-        it.pipeline.setRotate(rotate);
-
-        //it.visible = m_frustum.testBox(mdl.bounds().transform(it.pipeline.world()));
-
-        mdl.render(it.pipeline, pl.world());
+    m_renderQueue.sort();
+    m_renderQueue.submit();
+    m_stats->setTriangles(m_renderQueue.triangles(), m_triangles);
+    m_stats->setStateChanges(m_renderQueue.stateChanges(), m_renderQueue.stateChangesSaved());
+    m_stats->setWorldDraws(m_renderQueue.calls(), m_renderQueue.draws());
+
+    // Render map models: all visible instances of a model are drawn with one
+    // instanced draw per batch, their world matrices are streamed into the
+    // instance buffer
+    static constexpr size_t kMaxInstances = kInstanceBufferSize / sizeof(m::mat4);
+    const bool instanced = instancing() && m_instanceBuffer.buffer();
+    size_t modelDraws = 0;
+    size_t modelDrawsUninstanced = 0;
+    if (instanced)
+        m_instanceBuffer.begin();
+    for (size_t i = 0; i < m_visibleModels.size(); ) {
+        auto &mdl = *m_visibleModels[i]->model;
+        size_t count = 1;
+        while (i + count < m_visibleModels.size() && m_visibleModels[i + count]->model == &mdl)
+            count++;
+        modelDrawsUninstanced += mdl.batches() * count;
+        if (instanced && count > 1 && !mdl.animated()) {
+            for (size_t j = 0; j < count; j += kMaxInstances) {
+                const size_t instances = u::min(count - j, kMaxInstances);
+                m_instanceMatrices.resize(instances);
+                for (size_t k = 0; k < instances; k++)
+                    m_instanceMatrices[k] = m_visibleModels[i + j + k]->pipeline.world();
+                const size_t offset = m_instanceBuffer.write(&m_instanceMatrices[0],
+                    sizeof(m::mat4) * instances);
+                mdl.render(pl, m_instanceBuffer.buffer(), offset, instances);
+                modelDraws += mdl.batches();
+            }
+        } else {
+            for (size_t j = 0; j < count; j++) {
+                const auto &it = *m_visibleModels[i + j];
+                mdl.render(it.pipeline, it.pipeline.world());
+            }
+            modelDraws += mdl.batches() * count;
+        }
+        i += count;
     }
-#endif
+    if (instanced)
+        m_instanceBuffer.end();
+    m_stats->setModelDraws(modelDraws, modelDrawsUninstanced);
 
     // Only the scene pass needs to write to the depth buffer
     gl::Disable(GL_DEPTH_TEST);
 
     // Screen space ambient occlusion pass
     if (r_ssao) {
+        U_PROFILE("ssao");
+        CountScope count(m_passCounters[kPassSSAO]);
         // Read from the gbuffer, write to the ssao pass
         m_ssao.update(pl.perspective());
         m_ssao.bindWriting();
@@ -909,7 +2110,7 @@ void World::geometryPass(const pipeline &pl) {
 
         m_ssaoMethod.enable();
         m_ssaoMethod.setPerspective(pl.perspective());
-        m_ssaoMethod.setInverse((pl.projection() * pl.view()).inverse());
+        m_ssaoMethod.setInverse(pl.inverseViewProjection());
 
         m_quad.render();
 
@@ -974,13 +2175,60 @@ void World::lightingPass(const pipeline &pl) {
     gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kDepth);
     gl::BindTexture(format, m_gBuffer.texture(gBuffer::kDepth));
 
+    // Constants shared by all the light passes
+    const bool blocks = lightMethod::uniformBlocks();
+    if (blocks) {
+        m_uniformBuffer.begin();
+        const frameBlock frame(pl.perspective(), pl.position(),
+            pl.inverseViewProjection(), m_fog);
+        m_uniformBuffer.bind(lightMethod::kFrameBlock, &frame, sizeof frame);
+    }
+
     if (!r_debug) {
+        // Lights without shadows are assigned to clusters and shaded in one
+        // pass, the others are shaded by rendering their volumes
+        const bool cluster = clustered();
+        if (cluster) {
+            m_lightClusters.clear();
+            for (auto &it : m_culledPointLights) {
+                auto &plc = *it.second;
+                const bool shadowed = plc.light->castShadows && plc.shadowTile.size;
+                plc.clustered = plc.visible && !shadowed && m_lightClusters.add(*plc.light);
+            }
+            for (auto &it : m_culledSpotLights) {
+                auto &slc = *it.second;
+                const bool shadowed = slc.light->castShadows && slc.shadowTile.size;
+                slc.clustered = slc.visible && !shadowed && m_lightClusters.add(*slc.light);
+            }
+            m_lightClusters.update(pl.view(), pl.perspective());
+            // lights which did not fit into the clusters render their volumes,
+            // they're visited in the order they were added
+            size_t index = 0;
+            for (auto &it : m_culledPointLights)
+                if (it.second->clustered && !m_lightClusters.assigned(index++))
+                    it.second->clustered = false;
+            for (auto &it : m_culledSpotLights)
+                if (it.second->clustered && !m_lightClusters.assigned(index++))
+                    it.second->clustered = false;
+        } else {
+            for (auto &it : m_culledPointLights)
+                it.second->clustered = false;
+            for (auto &it : m_culledSpotLights)
+                it.second->clustered = false;
+        }
+
         gl::Enable(GL_DEPTH_TEST);
 
+        m_shadowMapsRendered = 0;
+        m_shadowMapsCached = 0;
         pointLightPass(pl);
         spotLightPass(pl);
+        m_stats->setShadowMaps(m_shadowMapsRendered, m_shadowMapsCached);
 
         gl::Disable(GL_DEPTH_TEST);
+
+        if (cluster && m_lightClusters.lights())
+            clusteredLightPass(pl);
     }
 
     // Change the blending function such that point and spot lights get fogged
@@ -996,6 +2244,9 @@ void World::lightingPass(const pipeline &pl) {
     directionalLightPass(pl, false);
 
     gl::Disable(GL_STENCIL_TEST);
+
+    if (blocks)
+        m_uniformBuffer.end();
 }
 
 void World::forwardPass(const pipeline &pl) {
@@ -1044,7 +2295,7 @@ void World::forwardPass(const pipeline &pl) {
             bp.setScale(mdl->bounds().size());
             m_bboxMethod.enable();
             m_bboxMethod.setColor(it->highlight ? kHighlighted : kOutline);
-            m_bboxMethod.setWVP((p.projection() * p.view() * p.world()) * bp.world());
+            m_bboxMethod.setWVP(p.worldViewProjection() * bp.world());
             m_bbox.render();
         }
 #endif
@@ -1057,20 +2308,20 @@ void World::forwardPass(const pipeline &pl) {
         m_bboxMethod.setColor(kHighlighted);
         for (const auto &pair : m_culledPointLights) {
             const auto &chunk = *pair.second;
-            const auto &it = pair.first;
+            const auto &it = chunk.light;
             if (!chunk.visible || !it->highlight)
                 continue;
             const float scale = it->radius * kLightRadiusTweak;
             pipeline p = pl;
             p.setWorld(it->position);
             p.setScale({scale, scale, scale});
-            m_bboxMethod.setWVP(p.projection() * p.view() * p.world());
+            m_bboxMethod.setWVP(p.worldViewProjection());
             m_sphere.render();
         }
 
         for (const auto &pair : m_culledSpotLights) {
             const auto &chunk = *pair.second;
-            const auto &it = pair.first;
+            const auto &it = chunk.light;
             if (!chunk.visible || it->highlight)
                 continue;
             const float scale = it->radius * kLightRadiusTweak;
@@ -1085,7 +2336,7 @@ void World::forwardPass(const pipeline &pl) {
             m::mat4 rotate = (rz * ry * rx).getMatrix();
             p.setRotate(rotate);
 
-            m_bboxMethod.setWVP(p.projection() * p.view() * p.world());
+            m_bboxMethod.setWVP(p.worldViewProjection());
             m_cone.render(false);
         }
 
@@ -1139,8 +2390,10 @@ void World::compositePass(const pipeline &pl) {
         m_colorGrader.update(pl.perspective(), nullptr);
     }
 
-    // Writing to color grader
+    // Writing to color grader, the final composite is upscaled to the window
+    // here when it was rendered at a lower resolution
     m_colorGrader.bindWriting();
+    gl::Viewport(0, 0, neoWidth(), neoHeight());
 
     const GLenum format = gl::has(gl::ARB_texture_rectangle) ? GL_TEXTURE_RECTANGLE : GL_TEXTURE_2D;
 
@@ -1154,7 +2407,7 @@ void World::compositePass(const pipeline &pl) {
 
     // render to color grading buffer
     m_compositeMethod.enable();
-    m_compositeMethod.setPerspective(pl.perspective());
+    m_compositeMethod.setPerspective(m_renderPerspective);
     m_quad.render();
 
     // apply vignette now
@@ -1224,12 +2477,144 @@ void World::compositePass(const pipeline &pl) {
     }
 }
 
+void World::allocateShadowMaps(const pipeline &pl,
+                               const u::vector<SpotLightChunk*> &spotLights,
+                               const u::vector<PointLightChunk*> &pointLights)
+{
+    size_t atlasSize = shadowAtlas::kMinTile;
+    while (atlasSize * 2 <= size_t(r_sm_atlas))
+        atlasSize *= 2;
+
+    // changing any of the settings invalidates every cached shadow map
+    const float settings[] = {
+        float(atlasSize), float(r_sm_size), float(r_sm_border),
+        r_sm_bias, r_sm_poly_factor, r_sm_poly_offset
+    };
+    const size_t hash = u::hash((const unsigned char *)settings, sizeof settings);
+    if (hash != m_shadowSettings) {
+        m_shadowSettings = hash;
+        m_shadowMap.update(atlasSize, atlasSize);
+        m_shadowAtlas.reset(atlasSize);
+        for (auto *it : spotLights) {
+            it->shadowTile = shadowAtlas::tile();
+            it->shadowCached = false;
+        }
+        for (auto *it : pointLights) {
+            it->shadowTile = shadowAtlas::tile();
+            it->shadowCached = false;
+        }
+    }
+
+    m_shadowFrame++;
+
+    // the tile of a light is sized by its coverage of the screen, point lights
+    // need room for three faces across
+    const float halfFov = m::tan(m::toRadian(pl.perspective().fov) * 0.5f);
+    const auto tileSize = [&](const pointLight *light, size_t faces) {
+        const float distance = (light->position - pl.position()).abs();
+        const float coverage = distance > light->radius
+            ? light->radius / (distance * halfFov) : 1.0f;
+        const float size = faces * r_sm_size * u::min(coverage, 1.0f);
+        size_t tile = shadowAtlas::kMinTile;
+        while (tile < size && tile < atlasSize)
+            tile *= 2;
+        return tile;
+    };
+
+    // lights which need a new tile, largest first to reduce fragmentation. A
+    // light with a smaller tile than it wants (e.g. it settled for one when
+    // the atlas was full) keeps it until a larger one is free instead of
+    // giving it up, failing and rendering into a new small tile every frame
+    u::vector<u::pair<size_t, LightChunk*>> requests;
+    u::vector<u::pair<size_t, LightChunk*>> upgrades;
+    const auto request = [&](LightChunk *chunk, size_t size) {
+        chunk->shadowFrame = m_shadowFrame;
+        if (chunk->shadowTile.size == size)
+            return;
+        if (chunk->shadowTile.size && chunk->shadowTile.size < size) {
+            upgrades.push_back({ size, chunk });
+            return;
+        }
+        m_shadowAtlas.release(chunk->shadowTile);
+        chunk->shadowCached = false;
+        requests.push_back({ size, chunk });
+    };
+    for (auto *it : spotLights)
+        if (it->visible && it->light->castShadows)
+            request(it, tileSize(it->light, 1));
+    for (auto *it : pointLights)
+        if (it->visible && it->light->castShadows)
+            request(it, tileSize(it->light, 3));
+    if (requests.empty() && upgrades.empty())
+        return;
+    u::sort(requests.begin(), requests.end(),
+        [](const u::pair<size_t, LightChunk*> &lhs, const u::pair<size_t, LightChunk*> &rhs) {
+            return lhs.first > rhs.first;
+        }
+    );
+
+    // tiles of lights which were not visible this frame are evicted least
+    // recently used first when the atlas is full
+    u::vector<LightChunk*> evictable;
+    bool gathered = false;
+    const auto evict = [&]() {
+        if (!gathered) {
+            gathered = true;
+            for (auto *it : spotLights)
+                if (it->shadowTile.size && it->shadowFrame != m_shadowFrame)
+                    evictable.push_back(it);
+            for (auto *it : pointLights)
+                if (it->shadowTile.size && it->shadowFrame != m_shadowFrame)
+                    evictable.push_back(it);
+            u::sort(evictable.begin(), evictable.end(),
+                [](const LightChunk *lhs, const LightChunk *rhs) {
+                    return lhs->shadowFrame > rhs->shadowFrame;
+                }
+            );
+        }
+        if (evictable.empty())
+            return false;
+        m_shadowAtlas.release(evictable.back()->shadowTile);
+        evictable.pop_back();
+        return true;
+    };
+
+    // when nothing is left to evict the light settles for a smaller tile and
+    // renders without shadows if none is left at all
+    for (auto &it : requests) {
+        size_t size = it.first;
+        while (!m_shadowAtlas.allocate(size, it.second->shadowTile)) {
+            if (evict())
+                continue;
+            if (size == shadowAtlas::kMinTile)
+                break;
+            size /= 2;
+        }
+    }
+
+    // then the lights which kept a smaller tile trade it in for the largest
+    // one which is free, if any is larger
+    for (auto &it : upgrades) {
+        auto &current = it.second->shadowTile;
+        shadowAtlas::tile larger;
+        for (size_t size = it.first; size > current.size && !larger.size; size /= 2) {
+            while (!m_shadowAtlas.allocate(size, larger) && evict())
+                continue;
+        }
+        if (!larger.size)
+            continue;
+        m_shadowAtlas.release(current);
+        current = larger;
+        it.second->shadowCached = false;
+    }
+}
+
 void World::pointLightPass(const pipeline &pl) {
     gl::DepthMask(GL_FALSE);
 
     for (const auto &pair : m_culledPointLights) {
-        const auto &plc = *pair.second;
-        if (!plc.visible)
+        auto &plc = *pair.second;
+        if (!plc.visible || plc.clustered)
             continue;
         const auto &it = plc.light;
         float scale = it->radius * kLightRadiusTweak;
@@ -1237,8 +2622,16 @@ void World::pointLightPass(const pipeline &pl) {
         pointLightMethod *method = &m_pointLightMethods[0];
 
         // Only bother if these are casting shadows
-        if (it->castShadows) {
-            pointLightShadowPass(&plc);
+        const bool shadowed = it->castShadows && plc.shadowTile.size;
+        const size_t face = plc.shadowTile.size / 3;
+        const float faceScale = m_shadowMap.widthScale(face);
+        if (shadowed) {
+            if (!r_sm_cache || !plc.shadowCached || plc.shadowHash != it->hash()) {
+                pointLightShadowPass(&plc);
+                m_shadowMapsRendered++;
+            } else {
+                m_shadowMapsCached++;
+            }
 
             gl::DepthMask(GL_FALSE);
 
@@ -1246,24 +2639,29 @@ void World::pointLightPass(const pipeline &pl) {
 
             gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kShadowMap);
             gl::BindTexture(GL_TEXTURE_2D, m_shadowMap.texture());
-
-            method->enable();
-            method->setLightWVP(plc.transform);
-        } else {
-            method->enable();
         }
 
-        method->setPerspective(pl.perspective());
-        method->setEyeWorldPos(pl.position());
-        method->setInverse((pl.projection() * pl.view()).inverse());
+        method->enable();
 
         pipeline p = pl;
         p.setWorld(it->position);
         p.setScale({scale, scale, scale});
 
-        const m::mat4 wvp = p.projection() * p.view() * p.world();
-        method->setLight(*it);
-        method->setWVP(wvp);
+        const m::mat4 &wvp = p.worldViewProjection();
+        if (lightMethod::uniformBlocks()) {
+            const lightBlock block(wvp, plc.transform, *it, { faceScale, faceScale });
+            m_uniformBuffer.bind(lightMethod::kLightBlock, &block, sizeof block);
+        } else {
+            if (shadowed) {
+                method->setLightWVP(plc.transform);
+                method->setShadowFace({ faceScale, faceScale });
+            }
+            method->setPerspective(pl.perspective());
+            method->setEyeWorldPos(pl.position());
+            method->setInverse(pl.inverseViewProjection());
+            method->setLight(*it);
+            method->setWVP(wvp);
+        }
 
         const m::vec3 dist = it->position - p.position();
         scale += pl.perspective().nearp + 1.0f;
@@ -1282,12 +2680,19 @@ void World::pointLightPass(const pipeline &pl) {
     gl::CullFace(GL_BACK);
 }
 
-void World::pointLightShadowPass(const PointLightChunk *const plc) {
+void World::pointLightShadowPass(PointLightChunk *const plc) {
+    U_PROFILE("shadow");
+    CountScope count(m_passCounters[kPassShadow]);
     const pointLight *const pl = plc->light;
+    const auto &tile = plc->shadowTile;
+    const size_t face = tile.size / 3;
     gl::DepthMask(GL_TRUE);
     gl::DepthFunc(GL_LEQUAL);
 
-    m_shadowMap.update(r_sm_size*3, r_sm_size*2);
+    // the rest of the atlas holds the shadow maps of other lights
+    gl::Enable(GL_SCISSOR_TEST);
+    gl::Scissor(tile.x, tile.y, face*3, face*2);
+
     m_shadowMap.bindWriting();
     gl::Clear(GL_DEPTH_BUFFER_BIT);
 
@@ -1296,8 +2701,6 @@ void World::pointLightShadowPass(const PointLightChunk *const plc) {
         gl::Enable(GL_POLYGON_OFFSET_FILL);
     }
 
-    gl::Enable(GL_SCISSOR_TEST);
-
     m_shadowMapMethod.enable();
 
     // v = identity
@@ -1326,7 +2729,7 @@ void World::pointLightShadowPass(const PointLightChunk *const plc) {
 
     gl::BindVertexArray(vao);
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, plc->ebo);
-    const float borderScale = float(r_sm_size - r_sm_border) / r_sm_size;
+    const float borderScale = float(face - r_sm_border) / face;
     size_t offset = 0;
     for (size_t side = 0; side < 6; ++side) {
         if (plc->sideCounts[side] <= 0)
@@ -1339,10 +2742,10 @@ void World::pointLightShadowPass(const PointLightChunk *const plc) {
                                  m::mat4::scale(1.0f /  pl->radius) *
                                  m::mat4::translate(-pl->position));
 
-        const size_t x = r_sm_size * (side / 2);
-        const size_t y = r_sm_size * (side % 2);
-        gl::Viewport(x, y, r_sm_size, r_sm_size);
-        gl::Scissor(x, y, r_sm_size, r_sm_size);
+        const size_t x = tile.x + face * (side / 2);
+        const size_t y = tile.y + face * (side % 2);
+        gl::Viewport(x, y, face, face);
+        gl::Scissor(x, y, face, face);
         gl::CullFace(view.cullFace);
         gl::DrawElements(GL_TRIANGLES, plc->sideCounts[side], GL_UNSIGNED_INT,
             (const GLvoid *)(sizeof(GLuint)*offset));
@@ -1351,7 +2754,7 @@ void World::pointLightShadowPass(const PointLightChunk *const plc) {
     }
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
-    gl::Viewport(0, 0, neoWidth(), neoHeight());
+    gl::Viewport(0, 0, m_renderPerspective.width, m_renderPerspective.height);
 
     gl::Disable(GL_SCISSOR_TEST);
 
@@ -1359,14 +2762,27 @@ void World::pointLightShadowPass(const PointLightChunk *const plc) {
         gl::Disable(GL_POLYGON_OFFSET_FILL);
 
     m_final.bindWriting();
+
+    // the faces are offset by the shader
+    const float center = m_shadowMap.widthScale(face) * 0.5f;
+    const float scale = m_shadowMap.widthScale(face - r_sm_border) * 0.5f;
+    plc->transform = m::mat4::translate({m_shadowMap.widthScale(tile.x) + center,
+                                         m_shadowMap.heightScale(tile.y) + center, 0.5f}) *
+                     m::mat4::scale({scale, scale, 0.5f}) *
+                     m::mat4::project(90.0f, 1.0f / pl->radius, m::sqrt(3.0f), r_sm_bias / pl->radius) *
+                     m::mat4::scale(1.0f / pl->radius);
+
+    // only cache the shadow map once it was rendered with the current mesh
+    plc->shadowHash = pl->hash();
+    plc->shadowCached = plc->hash == plc->shadowHash;
 }
 
 void World::spotLightPass(const pipeline &pl) {
     gl::DepthMask(GL_FALSE);
 
     for (const auto &pair : m_culledSpotLights) {
-        const auto &slc = *pair.second;
-        if (!slc.visible)
+        auto &slc = *pair.second;
+        if (!slc.visible || slc.clustered)
             continue;
         const auto &sl = slc.light;
         float scale = sl->radius * kLightRadiusTweak;
@@ -1374,8 +2790,14 @@ void World::spotLightPass(const pipeline &pl) {
         spotLightMethod *method = &m_spotLightMethods[0];
 
         // Only bother if these are casting shadows
-        if (sl->castShadows) {
-            spotLightShadowPass(&slc);
+        const bool shadowed = sl->castShadows && slc.shadowTile.size;
+        if (shadowed) {
+            if (!r_sm_cache || !slc.shadowCached || slc.shadowHash != sl->hash()) {
+                spotLightShadowPass(&slc);
+                m_shadowMapsRendered++;
+            } else {
+                m_shadowMapsCached++;
+            }
 
             gl::DepthMask(GL_FALSE);
 
@@ -1383,24 +2805,27 @@ void World::spotLightPass(const pipeline &pl) {
 
             gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kShadowMap);
             gl::BindTexture(GL_TEXTURE_2D, m_shadowMap.texture());
-
-            method->enable();
-            method->setLightWVP(slc.transform);
-        } else {
-            method->enable();
         }
 
-        method->setPerspective(pl.perspective());
-        method->setEyeWorldPos(pl.position());
-        method->setInverse((pl.projection() * pl.view()).inverse());
+        method->enable();
 
         pipeline p = pl;
         p.setWorld(sl->position);
         p.setScale({scale, scale, scale});
 
-        const m::mat4 wvp = p.projection() * p.view() * p.world();
-        method->setLight(*sl);
-        method->setWVP(wvp);
+        const m::mat4 &wvp = p.worldViewProjection();
+        if (lightMethod::uniformBlocks()) {
+            const lightBlock block(wvp, slc.transform, *sl);
+            m_uniformBuffer.bind(lightMethod::kLightBlock, &block, sizeof block);
+        } else {
+            if (shadowed)
+                method->setLightWVP(slc.transform);
+            method->setPerspective(pl.perspective());
+            method->setEyeWorldPos(pl.position());
+            method->setInverse(pl.inverseViewProjection());
+            method->setLight(*sl);
+            method->setWVP(wvp);
+        }
 
         const m::vec3 dist = sl->position - p.position();
         scale += pl.perspective().nearp + 1.0f;
@@ -1419,8 +2844,11 @@ void World::spotLightPass(const pipeline &pl) {
     gl::CullFace(GL_BACK);
 }
 
-void World::spotLightShadowPass(const SpotLightChunk *const slc) {
+void World::spotLightShadowPass(SpotLightChunk *const slc) {
+    U_PROFILE("shadow");
+    CountScope count(m_passCounters[kPassShadow]);
     const spotLight *const sl = slc->light;
+    const auto &tile = slc->shadowTile;
     gl::DepthMask(GL_TRUE);
     gl::DepthFunc(GL_LEQUAL);
     gl::CullFace(GL_BACK);
@@ -1430,14 +2858,14 @@ void World::spotLightShadowPass(const SpotLightChunk *const slc) {
         gl::Enable(GL_POLYGON_OFFSET_FILL);
     }
 
+    // the rest of the atlas holds the shadow maps of other lights
     gl::Enable(GL_SCISSOR_TEST);
-    gl::Scissor(0, 0, r_sm_size, r_sm_size);
+    gl::Scissor(tile.x, tile.y, tile.size, tile.size);
 
-    m_shadowMap.update(r_sm_size*3, r_sm_size*2);
     m_shadowMap.bindWriting();
     gl::Clear(GL_DEPTH_BUFFER_BIT);
 
-    const float borderScale = float(r_sm_size - r_sm_border) / r_sm_size;
+    const float borderScale = float(tile.size - r_sm_border) / tile.size;
     m_shadowMapMethod.enable();
     m_shadowMapMethod.setWVP(m::mat4::scale({borderScale, borderScale, 1.0f}) *
                              m::mat4::project(sl->cutOff, 1.0f / sl->radius, m::sqrt(3.0f)) *
@@ -1446,11 +2874,11 @@ void World::spotLightShadowPass(const SpotLightChunk *const slc) {
                              m::mat4::translate(-sl->position));
 
     // Draw the scene from the lights perspective into the shadow map
-    gl::Viewport(0, 0, r_sm_size, r_sm_size);
+    gl::Viewport(tile.x, tile.y, tile.size, tile.size);
     gl::BindVertexArray(vao);
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, slc->ebo);
     gl::DrawElements(GL_TRIANGLES, slc->count, GL_UNSIGNED_INT, 0);
-    gl::Viewport(0, 0, neoWidth(), neoHeight());
+    gl::Viewport(0, 0, m_renderPerspective.width, m_renderPerspective.height);
     gl::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 
     gl::Disable(GL_SCISSOR_TEST);
@@ -1459,6 +2887,38 @@ void World::spotLightShadowPass(const SpotLightChunk *const slc) {
         gl::Disable(GL_POLYGON_OFFSET_FILL);
 
     m_final.bindWriting();
+
+    const float center = m_shadowMap.widthScale(tile.size) * 0.5f;
+    const float scale = m_shadowMap.widthScale(tile.size - r_sm_border) * 0.5f;
+    slc->transform = m::mat4::translate({m_shadowMap.widthScale(tile.x) + center,
+                                         m_shadowMap.heightScale(tile.y) + center, 0.5f}) *
+                     m::mat4::scale({scale, scale, 0.5f}) *
+                     m::mat4::project(sl->cutOff, 1.0f / sl->radius, m::sqrt(3.0f), r_sm_bias / sl->radius) *
+                     m::mat4::lookat(sl->direction, m::vec3::yAxis) *
+                     m::mat4::scale(1.0f / sl->radius) *
+                     m::mat4::translate(-sl->position);
+
+    // only cache the shadow map once it was rendered with the current mesh
+    slc->shadowHash = sl->hash();
+    slc->shadowCached = slc->hash == slc->shadowHash;
+}
+
+void World::clusteredLightPass(const pipeline &pl) {
+    gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kClusterMap);
+    gl::BindTexture(GL_TEXTURE_2D, m_lightClusters.clusterTexture());
+    gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kLightIndexMap);
+    gl::BindTexture(GL_TEXTURE_2D, m_lightClusters.indexTexture());
+    gl::ActiveTexture(GL_TEXTURE0 + lightMethod::kLightMap);
+    gl::BindTexture(GL_TEXTURE_2D, m_lightClusters.lightTexture());
+
+    m_clusteredLightMethod.enable();
+    m_clusteredLightMethod.setClusterGrid(m_lightClusters.grid());
+    if (!lightMethod::uniformBlocks()) {
+        m_clusteredLightMethod.setPerspective(pl.perspective());
+        m_clusteredLightMethod.setEyeWorldPos(pl.position());
+        m_clusteredLightMethod.setInverse(pl.inverseViewProjection());
+    }
+    m_quad.render();
 }
 
 void World::directionalLightPass(const pipeline &pl, bool stencil) {
@@ -1474,12 +2934,17 @@ void World::directionalLightPass(const pipeline &pl, bool stencil) {
 
     auto &method = m_directionalLightMethods[lightCalculatePermutation(stencil)];
     method.enable();
-    method.setLight(m_directionalLight);
-    method.setPerspective(pl.perspective());
-    method.setEyeWorldPos(pl.position());
-    method.setInverse((pl.projection() * pl.view()).inverse());
-    if (r_fog)
-        method.setFog(m_fog);
+    if (lightMethod::uniformBlocks()) {
+        const lightBlock block(m::mat4::kIdentity, m_directionalLight);
+        m_uniformBuffer.bind(lightMethod::kLightBlock, &block, sizeof block);
+    } else {
+        method.setLight(m_directionalLight);
+        method.setPerspective(pl.perspective());
+        method.setEyeWorldPos(pl.position());
+        method.setInverse(pl.inverseViewProjection());
+        if (r_fog)
+            method.setFog(m_fog);
+    }
     m_quad.render();
 }
 
@@ -16,17 +16,112 @@
 #include "r_composite.h"
 #include "r_vignette.h"
 #include "r_pipeline.h"
+#include "r_occlusion.h"
+#include "r_queue.h"
+#include "r_buffer.h"
+#include "r_cluster.h"
 
 #include "u_map.h"
+#include "u_pair.h"
+#include "u_jobs.h"
+
+#include "m_bbox.h"
 
 namespace r {
 
+// A cluster of kd-tree leafs. World geometry is culled a cluster at a time
+struct renderCluster {
+    m::bbox bounds;
+    size_t triangles;
+    bool visible;
+    u::vector<uint32_t> occluders; // Largest triangles of the cluster
+};
+
+// The range of indices a cluster owns inside of a texture batch
+struct renderClusterRange {
+    size_t cluster;
+    size_t start;
+    size_t count;
+};
+
+// Materials of the same permutation whose textures are layers of the same
+// texture arrays are drawn with the material of their group, their draws are
+// merged into a single multi-draw indirect call
+struct renderMaterialGroup {
+    materialArrays arrays;
+    material mat;
+};
+
 struct renderTextureBatch {
     int permute;
     size_t start;
     size_t count;
     size_t index;
     material mat; // Rendering material (world and models share this)
+    renderMaterialGroup *group; // Only with multi-draw indirect (or nullptr)
+    u::vector<renderClusterRange> ranges; // Ordered by cluster
+};
+
+// Picks the scale of the size the world is rendered at before it's upscaled to
+// the window from the history of the frame time. The frame timer refreshes its
+// average once every second so only new readings are kept and a step is taken
+// once kHistory of them are known
+struct dynamicResolution {
+    static constexpr size_t kHistory = 3;
+    static constexpr float kStep = 0.05f; // scales are multiples of this
+    static constexpr float kMaxStep = 0.1f; // largest step up at once
+    static constexpr float kHeadroom = 0.8f; // of the target before stepping up
+
+    dynamicResolution();
+
+    void update(float mspf, float target, float minScale, float maxScale);
+    void reset();
+
+    float scale() const;
+    // the render size of p at the current scale
+    m::perspective apply(const m::perspective &p) const;
+
+private:
+    u::vector<float> m_history;
+    float m_last;
+    float m_scale;
+};
+
+inline float dynamicResolution::scale() const {
+    return m_scale;
+}
+
+// The entities of the world for a frame. The game fills a scene while the
+// render thread is still drawing the previous one, so it holds copies of
+// everything the renderer reads. The instance of an entity identifies it
+// across frames (e.g. the map entity it was placed by.)
+struct scene {
+    struct modelInstance {
+        const void *instance;
+        model *model_;
+        bool highlight;
+        m::vec3 position;
+        m::vec3 scale;
+        m::vec3 rotate;
+    };
+
+    struct billboardInstance {
+        billboard *billboard_;
+        u::vector<m::vec3> positions;
+    };
+
+    scene();
+    void clear();
+
+    directionalLight directionalLight_;
+    fog fog_;
+    // only read when the color grading changed since the last scene
+    ColorGrader colorGrader_;
+    bool colorGraded;
+    u::vector<u::pair<const void *, pointLight>> pointLights;
+    u::vector<u::pair<const void *, spotLight>> spotLights;
+    u::vector<modelInstance> models;
+    u::vector<billboardInstance> billboards;
 };
 
 struct World : geom {
@@ -37,44 +132,46 @@ struct World : geom {
     bool upload(const m::perspective &p);
 
     void unload(bool destroy = true);
-    void render(const pipeline &pl);
-
-    // called before start of rendering to clear billboards
-    // and other things that get sent to the world every frame
-    void reset() {
-        // walk all the lights and mark them for collection
-        for (auto &it : m_models)
-            it.second->collect = true;
-        for (auto &it : m_culledSpotLights)
-            it.second->collect = true;
-        for (auto &it : m_culledPointLights)
-            it.second->collect = true;
-        for (auto &it : m_billboards)
-            it.second.first = true;
-    }
-
-    // to add raw primitives into the world
+    // the scene must stay alive until the next scene is rendered
+    void render(const pipeline &pl, const scene &scene_);
+
+    // CPU time spent in and draw calls issued by every pass of the last frame
+    struct PassTiming {
+        const char *name;
+        float milliseconds;
+        size_t draws;
+    };
+    const u::vector<PassTiming> &passTimings() const;
+
+private:
+    // entities not added back by the scene are collected
+    void reset();
     void addBillboard(r::billboard *billboard_);
-    void addPointLight(r::pointLight *light);
-    void addSpotLight(r::spotLight *light);
-    void addModel(r::model *model_,
+    void addPointLight(const void *instance, const r::pointLight *light);
+    void addSpotLight(const void *instance, const r::spotLight *light);
+    void addModel(const void *instance,
+                  r::model *model_,
                   bool highlight,
                   const m::vec3 &position,
                   const m::vec3 &scale,
                   const m::vec3 &rotate);
 
-    // global entities
-    fog &getFog();
-    directionalLight *getDirectionalLight();
-    ColorGrader *getColorGrader();
+    void buildClusters(kdMap *map);
+    void buildTextureArrays();
+    void rasterizeOccluders(const pipeline &pl);
+    void updateVisibility(const m::vec3 &position);
+    bool potentiallyVisible(kdStack &stack, const m::vec3 &position, float radius) const;
+    bool leafVisible(size_t leaf) const;
+    void cullClusters();
 
-private:
     void cullPass(const pipeline &pl);
     void geometryPass(const pipeline &pl);
     void lightingPass(const pipeline &pl);
     void forwardPass(const pipeline &pl);
     void compositePass(const pipeline &pl);
 
+    // Shadow meshes are built by a job: the previous mesh is rendered until the
+    // job has finished after which the new one is uploaded by uploadMesh
     struct LightChunk {
         LightChunk();
         ~LightChunk();
@@ -83,30 +180,57 @@ private:
         size_t memory;
         bool collect;
         bool visible;
+        bool clustered; // shaded by the clustered light pass
         m::mat4 transform;
         GLuint ebo;
         r::stat *stats;
+        // tile of the shadow atlas and the state of the light rendered into it
+        shadowAtlas::tile shadowTile;
+        size_t shadowHash;
+        size_t shadowFrame; // last frame the light needed the tile
+        bool shadowCached;
         bool init(const char *name, const char *description);
+        bool building();
+        // state of the light the job is building a mesh for. The job sets
+        // built itself once done such that only the owner waits on the handle
+        u::Job *job;
+        SDL_atomic_t built;
+        const kdMap *buildMap;
+        size_t buildHash;
+        m::vec3 buildPosition;
+        float buildRadius;
     };
 
     struct SpotLightChunk : LightChunk {
         SpotLightChunk();
         SpotLightChunk(const r::spotLight *light);
-        bool buildMesh(kdMap *map);
+        ~SpotLightChunk();
+        bool buildMesh(const kdMap *map, size_t hash);
+        void uploadMesh();
         const r::spotLight *light;
+    private:
+        static void buildMeshJob(void *data, size_t, size_t);
+        u::vector<GLuint> m_indices;
     };
 
     struct PointLightChunk : LightChunk {
         PointLightChunk();
         PointLightChunk(const r::pointLight *light);
-        bool buildMesh(kdMap *map);
+        ~PointLightChunk();
+        bool buildMesh(const kdMap *map, size_t hash);
+        void uploadMesh();
         size_t sideCounts[6];
+        size_t meshTile; // size of the tile the mesh was built for
         const r::pointLight *light;
+    private:
+        static void buildMeshJob(void *data, size_t, size_t);
+        u::vector<GLuint> m_indices[6];
+        float m_bias;
     };
 
     struct ModelChunk {
         ModelChunk();
-        ModelChunk(const r::model *model,
+        ModelChunk(r::model *model,
                    bool highlight,
                    const m::vec3 &position,
                    const m::vec3 &scale,
@@ -119,19 +243,37 @@ private:
         bool collect;
         bool highlight;
         bool visible;
-        const r::model *model;
+        bool dirty; // moved since the world matrix and bounds were calculated
+        r::model *model;
+        m::mat4 world;
+        m::bbox bounds; // in world space
         r::pipeline pipeline;
     };
 
+    // calculate the world matrices and bounds of dirty models
+    static void transformModels(const u::vector<ModelChunk*> &models);
+    // calculate the pipeline of and cull models, bounds has theirs in order
+    void cullModels(const pipeline &pl, const u::vector<ModelChunk*> &models, const m::boxBounds &bounds);
+    void benchmarkModelCulling(const pipeline &pl, size_t count);
+
+    void allocateShadowMaps(const pipeline &pl,
+                            const u::vector<SpotLightChunk*> &spotLights,
+                            const u::vector<PointLightChunk*> &pointLights);
     void pointLightPass(const pipeline &pl);
-    void pointLightShadowPass(const PointLightChunk *const pl);
+    void pointLightShadowPass(PointLightChunk *const pl);
     void spotLightPass(const pipeline &pl);
-    void spotLightShadowPass(const SpotLightChunk *const sl);
+    void spotLightShadowPass(SpotLightChunk *const sl);
+    void clusteredLightPass(const pipeline &pl);
     void directionalLightPass(const pipeline &pl, bool stencil);
 
     // represents all six frustum planes used for frustum culling
     // spheres, points and bounding boxes
     m::frustum m_frustum;
+    // bounds of the lights and models culled this frame, in the order they
+    // are culled
+    m::sphereBounds m_spotLightBounds;
+    m::sphereBounds m_pointLightBounds;
+    m::boxBounds m_modelBounds;
 
     // world shading methods and permutations
     geomMethods *m_geomMethods;
@@ -139,6 +281,7 @@ private:
     compositeMethod m_compositeMethod;
     pointLightMethod m_pointLightMethods[2]; // no shadow, shadow
     spotLightMethod m_spotLightMethods[2]; // no shadow, shadow
+    clusteredLightMethod m_clusteredLightMethod;
     ssaoMethod m_ssaoMethod;
     bboxMethod m_bboxMethod;
     aaMethod m_aaMethod;
@@ -166,10 +309,51 @@ private:
     kdMap *m_kdWorld;
     u::vector<uint32_t> m_indices;
 
+    // World geometry clusters: the index buffer is ordered by texture batch
+    // then by cluster such that every cluster owns a contiguous range of
+    // indices within each texture batch. Nodes and leafs of the kd-tree which
+    // root a cluster map to it, otherwise they're kNoCluster.
+    static constexpr int32_t kNoCluster = -1;
+    u::vector<renderCluster> m_clusters;
+    u::vector<int32_t> m_nodeClusters;
+    u::vector<int32_t> m_leafClusters;
+    int32_t m_orphanCluster;
+    size_t m_triangles;
+    kdStack m_cullStack;
+
+    // potentially visible set of the leaf the camera is in and the nodes
+    // which contain any of those leafs
+    int32_t m_cameraLeaf;
+    u::vector<unsigned char> m_leafVisibility;
+    u::vector<unsigned char> m_nodeVisibility;
+
+    // software occlusion culling
+    occlusionBuffer m_occlusion;
+    u::vector<u::pair<float, size_t>> m_occluderClusters;
+
+    // draws of the world geometry sorted by state
+    renderQueue m_renderQueue;
+    ringBuffer m_uniformBuffer; // per frame and per light uniform blocks
+
+    // lights without shadows assigned to froxels for the clustered light pass
+    lightClusters m_lightClusters;
+
+    // visible map models ordered by model and the world matrices of the
+    // instances streamed for instanced rendering
+    u::vector<ModelChunk*> m_visibleModels;
+    u::vector<m::mat4> m_instanceMatrices;
+    ringBuffer m_instanceBuffer;
+
     // TODO: cleanup
     u::vector<renderTextureBatch> m_textureBatches;
     u::map<u::string, texture2D*> m_textures2D;
 
+    // the textures of materials drawn together, one array for every format
+    // and size, and the per draw attributes of every texture batch
+    u::vector<texture2DArray*> m_textureArrays;
+    u::vector<renderMaterialGroup> m_materialGroups;
+    GLuint m_materialBuffer;
+
     // render buffers
     aa m_aa;
     gBuffer m_gBuffer;
@@ -179,16 +363,48 @@ private:
     grader m_colorGrader;
     shadowMap m_shadowMap;
 
-    u::map<r::model*, ModelChunk*> m_models;
-    u::map<r::spotLight*, SpotLightChunk*> m_culledSpotLights;
-    u::map<r::pointLight*, PointLightChunk*> m_culledPointLights;
+    // tiles of the shadow map handed out to lights
+    shadowAtlas m_shadowAtlas;
+    size_t m_shadowSettings; // hash of the settings the atlas was built for
+    size_t m_shadowFrame;
+    size_t m_shadowMapsRendered;
+    size_t m_shadowMapsCached;
+
+    // the gbuffer, ssao and final composite are rendered at the size of the
+    // render perspective, the composite pass upscales them to the window
+    dynamicResolution m_resolution;
+    m::perspective m_renderPerspective;
+
+    u::map<const void*, ModelChunk*> m_models;
+    u::map<const void*, SpotLightChunk*> m_culledSpotLights;
+    u::map<const void*, PointLightChunk*> m_culledPointLights;
     u::map<r::billboard*, u::pair<bool, r::billboard*>> m_billboards;
 
     bool m_uploaded;
 
+    // GL work issued by every pass of the last frame, the ssao and shadow
+    // passes are not counted into the passes they are nested in
+    enum : size_t {
+        kPassCull,
+        kPassGeometry,
+        kPassSSAO,
+        kPassLighting,
+        kPassShadow,
+        kPassForward,
+        kPassComposite,
+        kPassCount
+    };
+
+    u::vector<PassTiming> m_passTimings;
+    gl::Counters m_passCounters[kPassCount];
+
     r::stat *m_stats;
 };
 
+inline const u::vector<World::PassTiming> &World::passTimings() const {
+    return m_passTimings;
+}
+
 }
 
 #endif
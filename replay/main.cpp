@@ -0,0 +1,57 @@
+#include <string.h>
+
+#include <SDL_timer.h>
+
+#include "engine.h"
+
+#include "r_common.h"
+
+#include "u_file.h"
+#include "u_log.h"
+
+namespace r {
+    struct World;
+}
+
+// Plays back a capture recorded with -capture <name> as fast as it can be
+// submitted and reports the throughput. Only the calls are replayed, there is
+// no game running alongside such that the cost of submitting them is measured
+// alone.
+//
+// -replay <name> replays captures/<name>.capture
+int neoMain(FrameTimer &, a::Audio &, r::World &, int argc, char **argv, bool &shutdown) {
+    u::string name;
+    for (int i = 1; i < argc - 1; i++)
+        if (!strcmp(argv[i], "-replay"))
+            name = argv[i + 1];
+    if (name.empty()) {
+        u::Log::err("usage: %s -replay <name>\n", argv[0]);
+        return 1;
+    }
+
+    const u::string file = u::fixPath(u::format("%scaptures/%s.capture", neoUserPath(), name));
+    if (!gl::replayOpen(file.c_str()))
+        neoFatal("failed to open capture `%s'", file);
+
+    u::Log::out("[replay] => replaying %s\n", file);
+
+    const uint64_t start = SDL_GetPerformanceCounter();
+    while (!shutdown && gl::replayFrame())
+        neoSwap();
+    const double seconds = double(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    // the calls changed the state behind the back of the cache
+    gl::invalidateState();
+
+    const auto &stats = gl::replayStats();
+    const double megabytes = stats.bytes / (1024.0 * 1024.0);
+    u::Log::out("[replay] => %zu frames, %zu calls, %.2f MB in %.2f ms\n",
+        stats.frames, stats.calls, megabytes, seconds * 1000.0);
+    if (seconds > 0.0) {
+        u::Log::out("[replay] => %.2f frames/s, %.0f calls/s, %.2f MB/s\n",
+            stats.frames / seconds, stats.calls / seconds, megabytes / seconds);
+    }
+
+    gl::replayClose();
+    return 0;
+}
@@ -9,6 +9,7 @@
 #include "u_file.h"
 #include "u_misc.h"
 #include "u_log.h"
+#include "u_profiler.h"
 
 #include "c_variable.h"
 
@@ -783,6 +784,7 @@ void VM::step(State *state) {
 }
 
 void VM::run(State *state) {
+    U_PROFILE("script");
     U_ASSERT(state->m_runState == kTerminated || state->m_runState == kErrored);
     if (!state->m_frame) {
         return;
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "r_occlusion.h"
+
+#include "m_bbox.h"
+#include "m_mat.h"
+#include "m_trig.h"
+
+// Headless test of the software occlusion buffer. Random scenes of a single
+// quad occluder and boxes are rasterized and every box is tested against an
+// independent reference which casts rays from the eye to points sampled on the
+// surface of the box. A box the reference sees through any ray must never be
+// culled. Boxes whose corners are all hidden behind the (convex) quad are
+// hidden entirely and are counted to verify that the buffer culls at all.
+//
+// Exits with a non-zero status when a visible box was culled or when less than
+// half of the hidden boxes were
+
+// the engine isn't linked into the test
+[[noreturn]] void neoFatalError(const char *error) {
+    fprintf(stderr, "%s\n", error);
+    abort();
+}
+
+static constexpr size_t kScenes = 2000;
+static constexpr size_t kBoxesPerScene = 64;
+static constexpr size_t kSamples = 8; // per edge of every face of a box
+static constexpr float kNear = 1.0f;
+static constexpr float kFar = 4096.0f;
+
+// the random number generator of the engine isn't seeded deterministically
+static uint32_t gSeed = 0x9E3779B9u;
+static float random(float min, float max) {
+    gSeed ^= gSeed << 13;
+    gSeed ^= gSeed >> 17;
+    gSeed ^= gSeed << 5;
+    return min + (max - min) * float(gSeed & 0xFFFFFF) / float(0xFFFFFF);
+}
+
+static m::vec3 randomVector(float extent) {
+    return { random(-extent, extent), random(-extent, extent), random(-extent, extent) };
+}
+
+struct quad {
+    m::vec3 v[4]; // planar and convex
+};
+
+// ray from origin to target hits the triangle strictly before the target,
+// edges are widened by epsilon such that grazing rays count as hits
+static bool hitTriangle(const m::vec3 &origin, const m::vec3 &target,
+                        const m::vec3 &a, const m::vec3 &b, const m::vec3 &c,
+                        float epsilon)
+{
+    const m::vec3 direction = target - origin;
+    const m::vec3 e1 = b - a;
+    const m::vec3 e2 = c - a;
+    const m::vec3 p = direction.cross(e2);
+    const float determinant = e1 * p;
+    if (m::abs(determinant) < 1e-9f)
+        return false;
+    const float inverse = 1.0f / determinant;
+    const m::vec3 s = origin - a;
+    const float u = (s * p) * inverse;
+    if (u < -epsilon || u > 1.0f + epsilon)
+        return false;
+    const m::vec3 q = s.cross(e1);
+    const float v = (direction * q) * inverse;
+    if (v < -epsilon || u + v > 1.0f + epsilon)
+        return false;
+    const float t = (e2 * q) * inverse;
+    return t > 0.0f && t < 1.0f;
+}
+
+static bool hitQuad(const m::vec3 &origin, const m::vec3 &target, const quad &occluder, float epsilon) {
+    return hitTriangle(origin, target, occluder.v[0], occluder.v[1], occluder.v[2], epsilon)
+        || hitTriangle(origin, target, occluder.v[0], occluder.v[2], occluder.v[3], epsilon);
+}
+
+static bool insideFrustum(const m::mat4 &wvp, const m::vec3 &point) {
+    const m::vec4 p(point, 1.0f);
+    const float x = m::vec4::dot(wvp.a, p);
+    const float y = m::vec4::dot(wvp.b, p);
+    const float z = m::vec4::dot(wvp.c, p);
+    const float w = m::vec4::dot(wvp.d, p);
+    return w > 0.0f && m::abs(x) <= w && m::abs(y) <= w && z >= -w && z <= w;
+}
+
+// some point on the surface of the box can be seen from the eye
+static bool referenceVisible(const m::mat4 &wvp, const m::vec3 &eye, const quad &occluder, const m::bbox &box) {
+    const m::vec3 &min = box.min();
+    const m::vec3 &max = box.max();
+    for (size_t axis = 0; axis < 3; axis++) {
+        for (size_t side = 0; side < 2; side++) {
+            for (size_t i = 0; i <= kSamples; i++) {
+                for (size_t j = 0; j <= kSamples; j++) {
+                    const float s = float(i) / kSamples;
+                    const float t = float(j) / kSamples;
+                    m::vec3 point;
+                    const size_t u = (axis + 1) % 3;
+                    const size_t v = (axis + 2) % 3;
+                    point[axis] = side ? max[axis] : min[axis];
+                    point[u] = min[u] + (max[u] - min[u]) * s;
+                    point[v] = min[v] + (max[v] - min[v]) * t;
+                    if (insideFrustum(wvp, point) && !hitQuad(eye, point, occluder, 1e-3f))
+                        return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// every corner is hidden behind the quad which hides the entire box as both
+// the quad and the box are convex
+static bool referenceHidden(const m::vec3 &eye, const quad &occluder, const m::bbox &box) {
+    const m::vec3 &min = box.min();
+    const m::vec3 &max = box.max();
+    for (size_t i = 0; i < 8; i++) {
+        const m::vec3 corner(i & 1 ? max.x : min.x,
+                             i & 2 ? max.y : min.y,
+                             i & 4 ? max.z : min.z);
+        if (!hitQuad(eye, corner, occluder, -1e-3f))
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    m::perspective perspective;
+    perspective.fov = 90.0f;
+    perspective.width = r::occlusionBuffer::kWidth;
+    perspective.height = r::occlusionBuffer::kHeight;
+    perspective.nearp = kNear;
+    perspective.farp = kFar;
+    const m::mat4 projection = m::mat4::project(perspective);
+
+    r::occlusionBuffer buffer;
+    size_t tested = 0;
+    size_t visible = 0;
+    size_t hidden = 0;
+    size_t culled = 0;
+    size_t failures = 0;
+    for (size_t scene = 0; scene < kScenes; scene++) {
+        const m::vec3 eye = randomVector(256.0f);
+        const m::vec3 forward = randomVector(1.0f).normalized();
+        const m::vec3 up = m::abs(forward.y) > 0.9f ? m::vec3::xAxis : m::vec3::yAxis;
+        const m::mat4 wvp = projection * m::mat4::lookat(forward, up) * m::mat4::translate(-eye);
+
+        // a rectangle facing the eye somewhere in front of it
+        const m::vec3 center = eye + forward * random(16.0f, 256.0f) + randomVector(64.0f);
+        const m::vec3 normal = (eye - center).normalized();
+        const m::vec3 tangent = normal.cross(m::abs(normal.y) > 0.9f ? m::vec3::xAxis : m::vec3::yAxis).normalized();
+        const m::vec3 bitangent = normal.cross(tangent);
+        const float width = random(8.0f, 128.0f);
+        const float height = random(8.0f, 128.0f);
+        quad occluder;
+        occluder.v[0] = center - tangent * width - bitangent * height;
+        occluder.v[1] = center + tangent * width - bitangent * height;
+        occluder.v[2] = center + tangent * width + bitangent * height;
+        occluder.v[3] = center - tangent * width + bitangent * height;
+
+        buffer.clear(wvp);
+        buffer.rasterize(occluder.v[0], occluder.v[1], occluder.v[2]);
+        buffer.rasterize(occluder.v[0], occluder.v[2], occluder.v[3]);
+        buffer.finalize();
+
+        for (size_t i = 0; i < kBoxesPerScene; i++) {
+            // boxes around and behind the occluder
+            const m::vec3 position = center + (center - eye).normalized() * random(-32.0f, 256.0f)
+                                   + randomVector(96.0f);
+            const m::vec3 extent(random(0.5f, 24.0f), random(0.5f, 24.0f), random(0.5f, 24.0f));
+            const m::bbox box(position - extent, position + extent);
+            const bool result = buffer.testBox(box);
+            tested++;
+            if (referenceVisible(wvp, eye, occluder, box)) {
+                visible++;
+                if (!result) {
+                    failures++;
+                    printf("scene %zu: box at (%.2f, %.2f, %.2f) is visible but was culled\n",
+                        scene, position.x, position.y, position.z);
+                }
+            } else if (referenceHidden(eye, occluder, box)) {
+                hidden++;
+                culled += !result;
+            }
+        }
+    }
+
+    printf("%zu boxes: %zu visible, %zu hidden of which %zu were culled (%.1f%%)\n",
+        tested, visible, hidden, culled, hidden ? 100.0 * culled / hidden : 0.0);
+    if (failures) {
+        printf("FAILED: %zu visible boxes were culled\n", failures);
+        return 1;
+    }
+    // a buffer which culls nothing is conservative as well
+    if (hidden && culled * 2 < hidden) {
+        printf("FAILED: less than half of the hidden boxes were culled\n");
+        return 1;
+    }
+    printf("PASSED\n");
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include "u_misc.h"
 #include "u_traits.h"
 #include "u_log.h"
+#include "u_profiler.h"
 
 #include "m_const.h"
 #include "m_trig.h"
@@ -2636,6 +2637,7 @@ u::optional<u::string> Texture::find(const u::string &infile) {
 }
 
 bool Texture::load(const u::string &file, float quality) {
+    U_PROFILE("texture load");
     // Construct a texture from a file
     auto name = find(neoGamePath() + file);
     if (!name)
@@ -1,6 +1,6 @@
 #!/usr/bin/env python
 
-import textwrap, sys, getopt
+import textwrap, sys, getopt, io
 from proto import *
 
 # Data types:
@@ -25,7 +25,9 @@ types = [
     {'name': 'GLclampf',   'format': '%f',   'promote': 'double',       'spec': 'd' },
     {'name': 'GLintptr',   'format': '%p',   'promote': 'intptr_t',     'spec': 'e' },
     {'name': 'GLsizeiptr', 'format': '%p',   'promote': 'intptr_t',     'spec': 'f' },
-    {'name': 'GLclampd',   'format': '%.2f', 'promote': 'double',       'spec': 'g' }
+    {'name': 'GLclampd',   'format': '%.2f', 'promote': 'double',       'spec': 'g' },
+    {'name': 'GLsync',     'format': '%p',   'promote': 'GLsync',       'spec': 'h' },
+    {'name': 'GLuint64',   'format': '%llu', 'promote': 'GLuint64',     'spec': 'i' }
 ]
 
 # Read a list of extensions from an extension file and return a list of strings
@@ -56,9 +58,306 @@ def printCheck(stream, function):
     else:
         stream.write('    GL_CHECK("",0);\n')
 
+# Entry points filtered through the state cache. The function state<Name>
+# of the cache is called with the same arguments and returns true when the
+# call is redundant
+cachedFunctions = [
+    'UseProgram',
+    'ActiveTexture',
+    'BindTexture',
+    'BindBuffer',
+    'BindBufferBase',
+    'BindBufferRange',
+    'Enable',
+    'Disable',
+    'BlendFunc'
+]
+
+# Entry points which invalidate some of the cached state. The function
+# state<Name> of the cache is called with the same arguments after the call
+invalidatingFunctions = [
+    'BindVertexArray',
+    'DeleteProgram',
+    'DeleteTextures',
+    'DeleteBuffers',
+    'DeleteVertexArrays'
+]
+
+# Entry points which count the work they issue into the current counters,
+# the lines are emitted right after the call
+countingFunctions = {
+    'UseProgram':                ['gCounters->programs++;'],
+    'BindTexture':               ['gCounters->textures++;'],
+    'UniformMatrix4fv':          ['gCounters->uniforms++;'],
+    'Uniform1i':                 ['gCounters->uniforms++;'],
+    'Uniform2i':                 ['gCounters->uniforms++;'],
+    'Uniform1f':                 ['gCounters->uniforms++;'],
+    'Uniform2f':                 ['gCounters->uniforms++;'],
+    'Uniform2fv':                ['gCounters->uniforms++;'],
+    'Uniform3fv':                ['gCounters->uniforms++;'],
+    'Uniform4fv':                ['gCounters->uniforms++;'],
+    'UniformMatrix3x4fv':        ['gCounters->uniforms++;'],
+    'BufferData':                ['if (data)', '    gCounters->streamed += size;'],
+    'BufferSubData':             ['gCounters->streamed += size;'],
+    'DrawElements':              ['countDraw(mode, count);'],
+    'DrawArrays':                ['countDraw(mode, count);'],
+    'DrawElementsInstanced':     ['countDraw(mode, count, primcount);'],
+    'MultiDrawElementsIndirect': ['// the commands live in a buffer, their triangles can\'t be counted',
+                                  'gDrawCalls++;',
+                                  'gCounters->draws++;']
+}
+
+# How the pointer arguments of the entry points are captured:
+#   ('data', size)         - size bytes are read through the pointer
+#   ('names', count, kind) - an array of object names of a kind
+#   'string'               - a null terminated string
+#   'strings'              - the sources of ShaderSource
+#   'offset'               - an offset into a bound buffer
+#   'pack'                 - an offset into the bound pixel pack buffer
+#   ('out', size)          - written to by the call, not captured
+#   'null'                 - not captured, replayed as a null pointer
+captureArguments = {
+    'ShaderSource':           { 'string': 'strings', 'length': 'null' },
+    'GetUniformLocation':     { 'name': 'string' },
+    'UniformMatrix4fv':       { 'value': ('data', 'count * 16 * sizeof(GLfloat)') },
+    'GenBuffers':             { 'buffers': ('names', 'n', 'Buffer') },
+    'VertexAttribPointer':    { 'pointer': 'offset' },
+    'BufferData':             { 'data': ('data', 'size') },
+    'GenVertexArrays':        { 'arrays': ('names', 'n', 'VertexArray') },
+    'DeleteBuffers':          { 'buffers': ('names', 'n', 'Buffer') },
+    'DeleteVertexArrays':     { 'arrays': ('names', 'n', 'VertexArray') },
+    'Uniform2fv':             { 'value': ('data', 'count * 2 * sizeof(GLfloat)') },
+    'Uniform3fv':             { 'value': ('data', 'count * 3 * sizeof(GLfloat)') },
+    'Uniform4fv':             { 'value': ('data', 'count * 4 * sizeof(GLfloat)') },
+    'UniformMatrix3x4fv':     { 'value': ('data', 'count * 12 * sizeof(GLfloat)') },
+    'GetShaderiv':            { 'params': ('out', '16 * sizeof(GLint)') },
+    'GetProgramiv':           { 'params': ('out', '16 * sizeof(GLint)') },
+    'GetShaderInfoLog':       { 'length': ('out', 'sizeof(GLsizei)'), 'infoLog': ('out', 'maxLength') },
+    'GenFramebuffers':        { 'ids': ('names', 'n', 'Framebuffer') },
+    'DrawBuffers':            { 'bufs': ('data', 'n * sizeof(GLenum)') },
+    'DeleteFramebuffers':     { 'framebuffers': ('names', 'n', 'Framebuffer') },
+    'DrawElements':           { 'indices': 'offset' },
+    'TexImage2D':             { 'data': ('data', 'captureImageSize(format, type, width, height, 1)') },
+    'DeleteTextures':         { 'textures': ('names', 'n', 'Texture') },
+    'GenTextures':            { 'textures': ('names', 'n', 'Texture') },
+    'ReadPixels':             { 'data': 'pack' },
+    'GetIntegerv':            { 'data': ('out', '16 * sizeof(GLint)') },
+    'GetFloatv':              { 'params': ('out', '16 * sizeof(GLfloat)') },
+    'GetTexLevelParameteriv': { 'params': ('out', '16 * sizeof(GLint)') },
+    'GetCompressedTexImage':  { 'img': 'pack' },
+    'CompressedTexImage2D':   { 'data': ('data', 'imageSize') },
+    'GenQueries':             { 'ids': ('names', 'n', 'Query') },
+    'DeleteQueries':          { 'ids': ('names', 'n', 'Query') },
+    'GetQueryObjectuiv':      { 'params': ('out', '16 * sizeof(GLuint)') },
+    'TexImage3D':             { 'data': ('data', 'captureImageSize(format, type, width, height, depth)') },
+    'TexSubImage3D':          { 'data': ('data', 'captureImageSize(format, type, width, height, depth)') },
+    'GetProgramInfoLog':      { 'length': ('out', 'sizeof(GLsizei)'), 'infoLog': ('out', 'maxLength') },
+    'BindAttribLocation':     { 'name': 'string' },
+    'BindFragDataLocation':   { 'name': 'string' },
+    'TexSubImage2D':          { 'data': ('data', 'captureImageSize(format, type, width, height, 1)') },
+    'BufferSubData':          { 'data': ('data', 'size') },
+    'GetProgramBinary':       { 'length': ('out', 'sizeof(GLsizei)'),
+                                'binaryFormat': ('out', 'sizeof(GLenum)'),
+                                'binary': ('out', 'bufSize') },
+    'ProgramBinary':          { 'binary': ('data', 'length') },
+    'GetUniformBlockIndex':   { 'uniformBlockName': 'string' },
+    'BufferStorage':          { 'data': ('data', 'size') },
+    'DrawElementsInstanced':  { 'indices': 'offset' },
+    'MultiDrawElementsIndirect': { 'indirect': 'offset' }
+}
+
+# Scalar arguments which name objects, they are translated to the names the
+# replay created
+nameArguments = {
+    'program':     'Program',
+    'shader':      'Shader',
+    'buffer':      'Buffer',
+    'array':       'VertexArray',
+    'texture':     'Texture',
+    'srcName':     'Texture',
+    'dstName':     'Texture',
+    'framebuffer': 'Framebuffer',
+    'id':          'Query'
+}
+
+nameKinds = [
+    'Buffer',
+    'VertexArray',
+    'Texture',
+    'Framebuffer',
+    'Query',
+    'Shader',
+    'Program'
+]
+
+# Results which the replay has to associate with the recorded ones
+replayResults = {
+    'CreateShader':         'gReplay.names[kNameShader][recorded] = result;',
+    'CreateProgram':        'gReplay.names[kNameProgram][recorded] = result;',
+    'GetUniformLocation':   'gReplay.locations[replayKey(program, recorded)] = result;',
+    'GetUniformBlockIndex': 'gReplay.blocks[replayKey(program, recorded)] = result;',
+    'FenceSync':            'gReplay.syncs[recorded] = result;'
+}
+
+# Arguments the replay changes
+replayOverrides = {
+    # buffers written to through a mapping are updated with glBufferSubData
+    'BufferStorage': { 'flags': 'flags | GL_DYNAMIC_STORAGE_BIT' }
+}
+
+# Lines the replay emits after the call
+replayEpilogues = {
+    'UseProgram': ['gReplay.program = program;'],
+    'BindBuffer': ['if (target == GL_PIXEL_PACK_BUFFER)', '    gReplay.packBuffer = buffer;']
+}
+
+def baseType(formalType):
+    return ''.join([i for i in formalType.split() if i not in ['const']]).strip('*')
+
+def isPointer(formalType):
+    return '*' in formalType
+
+def capturedResult(function):
+    return function.type != 'void' and not isPointer(function.type)
+
+# Emit the lines counting the work of an entry point
+def printCounting(stream, function):
+    for line in countingFunctions.get(function.name, []):
+        stream.write('    %s\n' % (line))
+
+# Emit the call recording an entry point when capturing
+def printCaptureCall(stream, function):
+    arguments = [name for _, name in function.formals]
+    if capturedResult(function):
+        arguments.append('result')
+    stream.write('    if (gCapturing)\n        capture%s(%s);\n' % (function.name, ', '.join(arguments)))
+
 def infoTag(function):
     return ' GL_INFOP' if len(function.formals) else 'GL_INFO'
 
+# Emit the function which records a call to an entry point
+def printCapture(stream, function):
+    stream.write('static void capture%s' % (function.name))
+    formals = list(function.formals)
+    if capturedResult(function):
+        formals.append((function.type, 'result'))
+    kinds = captureArguments.get(function.name, {})
+    def formal(formalType, name):
+        # what the call writes into is not captured
+        kind = kinds.get(name)
+        if isPointer(formalType) and kind and kind[0] == 'out':
+            return formalType
+        return '%s %s' % (formalType, name)
+    stream.write('(%s) {\n' % (', '.join(formal(t, n) for t, n in formals)))
+    stream.write('    captureValue(uint16_t(kCall%s));\n' % (function.name))
+    for formalType, name in formals:
+        base = baseType(formalType)
+        if isPointer(formalType):
+            kind = kinds[name]
+            if kind in ['offset', 'pack']:
+                stream.write('    captureValue(uint64_t(uintptr_t(%s)));\n' % (name))
+            elif kind == 'string':
+                stream.write('    captureString(%s);\n' % (name))
+            elif kind == 'strings':
+                stream.write('    captureStrings(count, %s, length);\n' % (name))
+            elif kind[0] == 'data':
+                stream.write('    captureData(%s, %s);\n' % (name, kind[1]))
+            elif kind[0] == 'names':
+                stream.write('    captureData(%s, %s * sizeof(GLuint));\n' % (name, kind[1]))
+        elif base in ['GLintptr', 'GLsizeiptr']:
+            stream.write('    captureValue(int64_t(%s));\n' % (name))
+        elif base == 'GLsync':
+            stream.write('    captureValue(uint64_t(uintptr_t(%s)));\n' % (name))
+        else:
+            stream.write('    captureValue(%s);\n' % (name))
+    stream.write('}\n\n')
+
+# Emit the case which replays a call to an entry point
+def printReplay(stream, function):
+    stream.write('    case kCall%s: {\n' % (function.name))
+    kinds = captureArguments.get(function.name, {})
+    overrides = replayOverrides.get(function.name, {})
+    arguments = []
+    outputs = 0
+    pack = None
+    generated = None
+    for formalType, name in function.formals:
+        base = baseType(formalType)
+        if isPointer(formalType):
+            kind = kinds[name]
+            if kind in ['offset', 'pack']:
+                stream.write('        const GLvoid *%s = (const GLvoid *)uintptr_t(replayValue<uint64_t>());\n' % (name))
+                arguments.append('(%s)%s' % (formalType, name))
+                if kind == 'pack':
+                    pack = name
+            elif kind == 'string':
+                stream.write('        const GLchar *%s = (const GLchar *)replayData();\n' % (name))
+                arguments.append(name)
+            elif kind == 'strings':
+                stream.write('        const GLchar **%s = replayStrings(count);\n' % (name))
+                arguments.append(name)
+            elif kind == 'null':
+                arguments.append('nullptr')
+            elif kind[0] == 'data':
+                stream.write('        const %s *%s = (const %s *)replayData();\n' % (base, name, base))
+                arguments.append(name)
+            elif kind[0] == 'names':
+                stream.write('        const GLuint *%s = (const GLuint *)replayData();\n' % (name))
+                if function.name.startswith('Gen'):
+                    generated = (name, kind)
+                    arguments.append('generated')
+                else:
+                    arguments.append('replayNames(kName%s, %s, %s)' % (kind[2], name, kind[1]))
+            elif kind[0] == 'out':
+                arguments.append('(%s)replayScratch(%d, %s)' % (formalType, outputs, kind[1]))
+                outputs += 1
+        else:
+            if base in ['GLintptr', 'GLsizeiptr']:
+                stream.write('        const %s %s = %s(replayValue<int64_t>());\n' % (base, name, base))
+            elif base == 'GLsync':
+                stream.write('        const uint64_t %s = replayValue<uint64_t>();\n' % (name))
+            else:
+                stream.write('        const %s %s = replayValue<%s>();\n' % (base, name, base))
+            if name in overrides:
+                arguments.append(overrides[name])
+            elif base == 'GLuint' and name in nameArguments:
+                arguments.append('replayName(kName%s, %s)' % (nameArguments[name], name))
+            elif base == 'GLint' and name == 'location':
+                arguments.append('replayLocation(%s)' % (name))
+            elif base == 'GLuint' and name == 'uniformBlockIndex':
+                arguments.append('replayBlock(program, %s)' % (name))
+            elif base == 'GLsync':
+                arguments.append('replaySync(%s)' % (name))
+            else:
+                arguments.append(name)
+    if capturedResult(function):
+        recorded = 'uint64_t' if function.type == 'GLsync' else function.type
+        if function.name in replayResults:
+            stream.write('        const %s recorded = replayValue<%s>();\n' % (recorded, recorded))
+        else:
+            stream.write('        replayValue<%s>();\n' % (recorded))
+    if generated:
+        stream.write('        GLuint *const generated = (GLuint *)replayScratch(0, %s * sizeof(GLuint));\n'
+            % (generated[1][1]))
+    call = 'gl%s_(%s)' % (function.name, ', '.join(arguments))
+    indent = '        '
+    if pack:
+        # readbacks into client memory are not replayed
+        stream.write('        if (gReplay.packBuffer)\n')
+        indent += '    '
+    if function.name in replayResults:
+        stream.write('%sconst %s result = %s;\n' % (indent, function.type, call))
+        stream.write('%s%s\n' % (indent, replayResults[function.name]))
+    else:
+        stream.write('%s%s;\n' % (indent, call))
+    if generated:
+        stream.write('        replayGenerated(kName%s, %s, generated, %s);\n'
+            % (generated[1][2], generated[0], generated[1][1]))
+    for line in replayEpilogues.get(function.name, []):
+        stream.write('        %s\n' % (line))
+    stream.write('        break;\n')
+    stream.write('    }\n')
+
 def genHeader(functionList, extensionList, headerFile):
     with open(headerFile, 'w') as header:
         # Begin the header
@@ -143,6 +442,78 @@ def genHeader(functionList, extensionList, headerFile):
         const u::set<size_t> &extensions();
         bool has(size_t ext);
 
+        // The most frequently changed state is shadowed, redundant changes
+        // through these entry points never reach the driver
+        enum : size_t {
+            kStateUseProgram,
+            kStateActiveTexture,
+            kStateBindTexture,
+            kStateBindBuffer,
+            kStateBindBufferRange,
+            kStateEnable,
+            kStateDisable,
+            kStateBlendFunc,
+            kStateCount
+        };
+
+        struct StateCounters {
+            size_t issued[kStateCount];
+            size_t elided[kStateCount];
+        };
+
+        // collect the state change counters since the last call
+        void stateCounters(StateCounters &counters);
+        const char *stateName(size_t what);
+        // forget all shadowed state; must be called when the state is changed
+        // without going through the entry points
+        void invalidateState();
+
+        // the number of draw calls issued since startup
+        size_t drawCalls();
+
+        // The work issued through the entry points. It's counted into the target
+        // given to countInto such that the cost of a frame can be attributed to the
+        // passes which issued it
+        struct Counters {
+            size_t draws;
+            size_t triangles;
+            size_t programs; // program switches which reached the driver
+            size_t textures; // texture binds which reached the driver
+            size_t uniforms;
+            size_t streamed; // bytes uploaded into buffers
+        };
+
+        // count into counters from now on (nullptr to stop counting), returns the
+        // previous target
+        Counters *countInto(Counters *counters);
+        // count bytes uploaded without going through an entry point, e.g. through a
+        // persistent mapping
+        void countStreamed(size_t bytes);
+
+        // Every call which reaches the driver through the entry points can be
+        // captured into a file along with the data it reads. The capture must be
+        // started before any object is created, it can then be replayed without
+        // the engine to measure the cost of submitting the calls alone
+        bool startCapture(const char *file);
+        void stopCapture();
+        bool capturing();
+        // mark the end of a frame
+        void captureFrame();
+        // capture data written into a buffer through a mapping
+        void captureBufferWrite(GLuint buffer, size_t offset, const void *data, size_t size);
+
+        struct ReplayStats {
+            size_t frames;
+            size_t calls;
+            size_t bytes; // data handed to the driver
+        };
+
+        bool replayOpen(const char *file);
+        // issue the calls of the next frame, returns false at the end of the capture
+        bool replayFrame();
+        void replayClose();
+        const ReplayStats &replayStats();
+
         """))
         # Generate the function prototypes
         for function in functionList:
@@ -178,7 +549,11 @@ def genSource(functionList, extensionList, sourceFile):
 
         #include "u_string.h"
         #include "u_set.h"
+        #include "u_map.h"
         #include "u_misc.h"
+        #include "u_file.h"
+        #include "u_log.h"
+        #include "u_vector.h"
         #include "u_traits.h"
 
         #include "engine.h"
@@ -408,7 +783,421 @@ def genSource(functionList, extensionList, sourceFile):
             return gExtensions.find(ext) != gExtensions.end();
         }
 
+        """))
+        # Emit the state cache
+        source.write(textwrap.dedent("""\
+        static constexpr GLuint kStateUnknown = ~0u;
+        static constexpr size_t kStateTextureUnits = 32;
+        static constexpr size_t kStateUniformBlocks = 16;
+
+        static constexpr GLenum kStateTextureTargets[] = {
+            GL_TEXTURE_2D,
+            GL_TEXTURE_RECTANGLE,
+            GL_TEXTURE_3D,
+            GL_TEXTURE_CUBE_MAP,
+            GL_TEXTURE_2D_ARRAY
+        };
+
+        static constexpr GLenum kStateBufferTargets[] = {
+            GL_ARRAY_BUFFER,
+            GL_ELEMENT_ARRAY_BUFFER,
+            GL_PIXEL_PACK_BUFFER,
+            GL_PIXEL_UNPACK_BUFFER,
+            GL_UNIFORM_BUFFER
+        };
+
+        static constexpr GLenum kStateCapabilities[] = {
+            GL_DEPTH_TEST,
+            GL_BLEND,
+            GL_CULL_FACE,
+            GL_STENCIL_TEST,
+            GL_SCISSOR_TEST,
+            GL_POLYGON_OFFSET_FILL
+        };
+
+        static constexpr size_t kStateTextureTargetCount = sizeof kStateTextureTargets / sizeof *kStateTextureTargets;
+        static constexpr size_t kStateBufferTargetCount = sizeof kStateBufferTargets / sizeof *kStateBufferTargets;
+        static constexpr size_t kStateCapabilityCount = sizeof kStateCapabilities / sizeof *kStateCapabilities;
+
+        static const char *kStateNames[] = {
+            "UseProgram",
+            "ActiveTexture",
+            "BindTexture",
+            "BindBuffer",
+            "BindBufferRange",
+            "Enable",
+            "Disable",
+            "BlendFunc"
+        };
+
+        // Shadow copy of the state, kStateUnknown is used for state which was
+        // never set or can no longer be trusted
+        struct State {
+            GLuint program;
+            GLuint textureUnit;
+            GLuint textures[kStateTextureUnits][kStateTextureTargetCount];
+            GLuint buffers[kStateBufferTargetCount];
+            struct {
+                GLuint buffer;
+                GLintptr offset;
+                GLsizeiptr size;
+            } uniformBlocks[kStateUniformBlocks];
+            GLuint capabilities[kStateCapabilityCount];
+            GLenum blendSource;
+            GLenum blendDestination;
+            StateCounters counters;
+        };
+
+        static State gState;
+
+        template <size_t N>
+        static inline size_t stateIndex(const GLenum (&list)[N], GLenum value) {
+            for (size_t i = 0; i < N; i++)
+                if (list[i] == value)
+                    return i;
+            return N;
+        }
+
+        static inline bool stateElide(size_t what, bool redundant) {
+            if (redundant)
+                gState.counters.elided[what]++;
+            else
+                gState.counters.issued[what]++;
+            return redundant;
+        }
+
+        static inline void stateForget(GLuint *names, size_t count, GLsizei n, const GLuint *deleted) {
+            // deleting a bound object reverts the binding to zero
+            for (GLsizei i = 0; i < n; i++)
+                for (size_t j = 0; j < count; j++)
+                    if (names[j] == deleted[i])
+                        names[j] = 0;
+        }
+
+        static bool stateUseProgram(GLuint program) {
+            if (stateElide(kStateUseProgram, gState.program == program))
+                return true;
+            gState.program = program;
+            return false;
+        }
+
+        static bool stateActiveTexture(GLenum texture) {
+            const GLuint unit = texture - GL_TEXTURE0;
+            if (stateElide(kStateActiveTexture, gState.textureUnit == unit))
+                return true;
+            gState.textureUnit = unit;
+            return false;
+        }
+
+        static bool stateBindTexture(GLenum target, GLuint texture) {
+            const size_t index = stateIndex(kStateTextureTargets, target);
+            const GLuint unit = gState.textureUnit;
+            if (index == kStateTextureTargetCount || unit >= kStateTextureUnits)
+                return stateElide(kStateBindTexture, false);
+            GLuint &bound = gState.textures[unit][index];
+            if (stateElide(kStateBindTexture, bound == texture))
+                return true;
+            bound = texture;
+            return false;
+        }
+
+        static bool stateBindBuffer(GLenum target, GLuint buffer) {
+            const size_t index = stateIndex(kStateBufferTargets, target);
+            if (index == kStateBufferTargetCount)
+                return stateElide(kStateBindBuffer, false);
+            GLuint &bound = gState.buffers[index];
+            if (stateElide(kStateBindBuffer, bound == buffer))
+                return true;
+            bound = buffer;
+            return false;
+        }
+
+        static bool stateBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+            // Both the indexed and the generic binding point change, but only
+            // when the call is issued: an elided call leaves the generic
+            // binding alone and shadowing it anyway would elide a later bind
+            // of the generic binding point which is still needed
+            const size_t generic = stateIndex(kStateBufferTargets, target);
+            if (target == GL_UNIFORM_BUFFER && index < kStateUniformBlocks) {
+                auto &bound = gState.uniformBlocks[index];
+                if (stateElide(kStateBindBufferRange, bound.buffer == buffer
+                                                   && bound.offset == offset
+                                                   && bound.size == size))
+                {
+                    return true;
+                }
+                bound.buffer = buffer;
+                bound.offset = offset;
+                bound.size = size;
+            } else {
+                stateElide(kStateBindBufferRange, false);
+            }
+            if (generic != kStateBufferTargetCount)
+                gState.buffers[generic] = buffer;
+            return false;
+        }
+
+        static bool stateBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+            // an offset of -1 can never match a range
+            return stateBindBufferRange(target, index, buffer, -1, 0);
+        }
+
+        static bool stateCapability(size_t what, GLenum cap, GLuint enable) {
+            const size_t index = stateIndex(kStateCapabilities, cap);
+            if (index == kStateCapabilityCount)
+                return stateElide(what, false);
+            if (stateElide(what, gState.capabilities[index] == enable))
+                return true;
+            gState.capabilities[index] = enable;
+            return false;
+        }
+
+        static bool stateEnable(GLenum cap) {
+            return stateCapability(kStateEnable, cap, 1);
+        }
+
+        static bool stateDisable(GLenum cap) {
+            return stateCapability(kStateDisable, cap, 0);
+        }
+
+        static bool stateBlendFunc(GLenum sfactor, GLenum dfactor) {
+            if (stateElide(kStateBlendFunc, gState.blendSource == sfactor
+                                         && gState.blendDestination == dfactor))
+            {
+                return true;
+            }
+            gState.blendSource = sfactor;
+            gState.blendDestination = dfactor;
+            return false;
+        }
+
+        static void stateBindVertexArray(GLuint) {
+            // the element array binding is part of the vertex array object
+            gState.buffers[stateIndex(kStateBufferTargets, GL_ELEMENT_ARRAY_BUFFER)] = kStateUnknown;
+        }
+
+        static void stateDeleteProgram(GLuint program) {
+            if (gState.program == program)
+                gState.program = kStateUnknown;
+        }
+
+        static void stateDeleteTextures(GLsizei n, const GLuint *textures) {
+            stateForget(&gState.textures[0][0], kStateTextureUnits * kStateTextureTargetCount, n, textures);
+        }
+
+        static void stateDeleteBuffers(GLsizei n, const GLuint *buffers) {
+            stateForget(gState.buffers, kStateBufferTargetCount, n, buffers);
+            for (auto &it : gState.uniformBlocks)
+                stateForget(&it.buffer, 1, n, buffers);
+        }
+
+        static void stateDeleteVertexArrays(GLsizei, const GLuint *) {
+            stateBindVertexArray(0);
+        }
+
+        void invalidateState() {
+            gState.program = kStateUnknown;
+            gState.textureUnit = kStateUnknown;
+            for (auto &unit : gState.textures)
+                for (auto &it : unit)
+                    it = kStateUnknown;
+            for (auto &it : gState.buffers)
+                it = kStateUnknown;
+            for (auto &it : gState.uniformBlocks)
+                it.buffer = kStateUnknown;
+            for (auto &it : gState.capabilities)
+                it = kStateUnknown;
+            gState.blendSource = kStateUnknown;
+            gState.blendDestination = kStateUnknown;
+        }
+
+        void stateCounters(StateCounters &counters) {
+            counters = gState.counters;
+            memset(&gState.counters, 0, sizeof gState.counters);
+        }
+
+        const char *stateName(size_t what) {
+            return kStateNames[what];
+        }
+
+        static size_t gDrawCalls = 0;
+        static Counters gUncounted;
+        static Counters *gCounters = &gUncounted;
+
+        size_t drawCalls() {
+            return gDrawCalls;
+        }
+
+        Counters *countInto(Counters *counters) {
+            Counters *const previous = gCounters;
+            gCounters = counters ? counters : &gUncounted;
+            return previous == &gUncounted ? nullptr : previous;
+        }
+
+        void countStreamed(size_t bytes) {
+            gCounters->streamed += bytes;
+        }
+
+        static inline void countDraw(GLenum mode, GLsizei count, GLsizei instances = 1) {
+            gDrawCalls++;
+            gCounters->draws++;
+            if (mode == GL_TRIANGLES)
+                gCounters->triangles += size_t(count / 3) * instances;
+            else if ((mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN) && count > 2)
+                gCounters->triangles += size_t(count - 2) * instances;
+        }
+
+        """))
+        # Emit the call identifiers of the capture
+        source.write('enum : uint16_t {\n')
+        for f in functionList:
+            source.write('    kCall%s,\n' % (f.name))
+        source.write(textwrap.dedent("""\
+            kCallFrame,
+            kCallBufferWrite
+        };
+
+        // A capture is the magic followed by the calls, every call is its identifier
+        // followed by its arguments and its result. Data is stored as its size followed
+        // by the bytes which are aligned such that the replay can use them in place
+        static const char kCaptureMagic[8] = { 'N', 'E', 'O', 'C', 'A', 'P', '0', '1' };
+
+        struct Capture {
+            u::file file;
+            size_t position;
+        };
+
+        static Capture gCapture;
+        static bool gCapturing = false;
+
+        static void captureBytes(const void *data, size_t size) {
+            fwrite(data, size, 1, gCapture.file);
+            gCapture.position += size;
+        }
+
+        template <typename T>
+        static inline void captureValue(const T &value) {
+            captureBytes(&value, sizeof value);
+        }
+
+        static void captureAlign() {
+            static const unsigned char kPadding[8] = { 0 };
+            const size_t padding = -gCapture.position & (sizeof kPadding - 1);
+            if (padding)
+                captureBytes(kPadding, padding);
+        }
+
+        static void captureData(const void *data, size_t size) {
+            captureValue(uint32_t(data ? size : 0));
+            captureAlign();
+            if (data && size)
+                captureBytes(data, size);
+        }
+
+        static void captureString(const GLchar *string) {
+            captureData(string, strlen(string) + 1);
+        }
+
+        static void captureStrings(GLsizei count, const GLchar **strings, const GLint *lengths) {
+            // the sources are stored null terminated
+            for (GLsizei i = 0; i < count; i++) {
+                const size_t length = lengths && lengths[i] >= 0 ? lengths[i] : strlen(strings[i]);
+                captureValue(uint32_t(length + 1));
+                captureAlign();
+                captureBytes(strings[i], length);
+                captureBytes("", 1);
+            }
+        }
+
+        // the size of the pixels read by a texture upload
+        static size_t captureImageSize(GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth) {
+            size_t components = 4;
+            switch (format) {
+            case GL_RED: case GL_RED_INTEGER: case GL_ALPHA: case GL_LUMINANCE:
+            case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+                components = 1;
+                break;
+            case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA: case GL_DEPTH_STENCIL:
+                components = 2;
+                break;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER:
+                components = 3;
+                break;
+            }
+            size_t bytes = components * 4;
+            switch (type) {
+            case GL_UNSIGNED_BYTE: case GL_BYTE:
+                bytes = components;
+                break;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+                bytes = components * 2;
+                break;
+            case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1:
+                bytes = 2;
+                break;
+            case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+            case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_5_9_9_9_REV:
+                bytes = 4;
+                break;
+            case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+                bytes = 8;
+                break;
+            }
+            if (width <= 0 || height <= 0 || depth <= 0)
+                return 0;
+            GLint alignment = 4;
+            GLint length = 0;
+            glGetIntegerv_(GL_UNPACK_ALIGNMENT, &alignment);
+            glGetIntegerv_(GL_UNPACK_ROW_LENGTH, &length);
+            const size_t row = (bytes * (length ? length : width) + alignment - 1) / alignment * alignment;
+            // the last row is not padded
+            return row * (size_t(height) * depth - 1) + bytes * width;
+        }
+
+        bool startCapture(const char *file) {
+            stopCapture();
+            gCapture.file = u::fopen(file, "wb");
+            if (!gCapture.file)
+                return false;
+            setvbuf(gCapture.file, nullptr, _IOFBF, 1 << 20);
+            gCapture.position = 0;
+            captureBytes(kCaptureMagic, sizeof kCaptureMagic);
+            return gCapturing = true;
+        }
+
+        void stopCapture() {
+            if (!gCapturing)
+                return;
+            gCapture.file.close();
+            gCapturing = false;
+        }
+
+        bool capturing() {
+            return gCapturing;
+        }
+
+        void captureFrame() {
+            if (gCapturing)
+                captureValue(uint16_t(kCallFrame));
+        }
+
+        void captureBufferWrite(GLuint buffer, size_t offset, const void *data, size_t size) {
+            if (!gCapturing)
+                return;
+            captureValue(uint16_t(kCallBufferWrite));
+            captureValue(buffer);
+            captureValue(uint64_t(offset));
+            captureData(data, size);
+        }
+
+        """))
+        # Emit the capture functions of the entry points
+        for f in functionList:
+            printCapture(source, f)
+        source.write(textwrap.dedent("""\
         void init() {
+            invalidateState();
+
         """))
         for f in functionList:
             fill = largest - len(f.name)
@@ -475,17 +1264,200 @@ def genSource(functionList, extensionList, sourceFile):
                 source.write('%s result = gl%s_' % (f.type, f.name))
                 printFormals(source, f, True, False)
                 source.write(';\n')
+                printCounting(source, f)
                 printCheck(source, f)
+                printCaptureCall(source, f)
                 source.write('    return result;\n}\n')
             else:
+                if f.name in cachedFunctions:
+                    # Skip redundant state changes
+                    source.write('if (state%s' % (f.name))
+                    printFormals(source, f, True, False)
+                    source.write(')\n        return;\n    ')
                 # Just call
                 source.write('gl%s_' % (f.name))
                 printFormals(source, f, True, False)
                 source.write(';\n')
+                if f.name in invalidatingFunctions:
+                    source.write('    state%s' % (f.name))
+                    printFormals(source, f, True, False)
+                    source.write(';\n')
+                printCounting(source, f)
                 printCheck(source, f)
+                printCaptureCall(source, f)
                 source.write('}\n')
-        # End the namespace
-        source.write('\n}\n')
+        # Emit the replay
+        source.write('\nenum {\n')
+        for kind in nameKinds:
+            source.write('    kName%s,\n' % (kind))
+        source.write(textwrap.dedent("""\
+            kNameCount
+        };
+
+        struct Replay {
+            u::vector<unsigned char> data;
+            size_t position;
+            // the names the replay created for the recorded ones
+            u::map<GLuint, GLuint> names[kNameCount];
+            u::map<uint64_t, GLint> locations;
+            u::map<uint64_t, GLuint> blocks;
+            u::map<uint64_t, GLsync> syncs;
+            u::vector<unsigned char> scratch[4];
+            u::vector<const GLchar *> strings;
+            GLuint program;
+            GLuint packBuffer;
+            ReplayStats stats;
+        };
+
+        static Replay gReplay;
+
+        template <typename T>
+        static T replayValue() {
+            T value = T();
+            if (gReplay.position + sizeof value > gReplay.data.size()) {
+                gReplay.position = gReplay.data.size();
+                return value;
+            }
+            memcpy(&value, &gReplay.data[gReplay.position], sizeof value);
+            gReplay.position += sizeof value;
+            return value;
+        }
+
+        static const void *replayData(size_t *size = nullptr) {
+            const size_t length = replayValue<uint32_t>();
+            gReplay.position += -gReplay.position & 7;
+            if (size)
+                *size = 0;
+            if (!length || gReplay.position + length > gReplay.data.size())
+                return nullptr;
+            const void *const data = &gReplay.data[gReplay.position];
+            gReplay.position += length;
+            gReplay.stats.bytes += length;
+            if (size)
+                *size = length;
+            return data;
+        }
+
+        static const GLchar **replayStrings(GLsizei count) {
+            gReplay.strings.resize(count);
+            for (GLsizei i = 0; i < count; i++)
+                gReplay.strings[i] = (const GLchar *)replayData();
+            return gReplay.strings.data();
+        }
+
+        // memory the calls which return data can write into
+        static void *replayScratch(size_t index, size_t size) {
+            auto &scratch = gReplay.scratch[index];
+            if (scratch.size() < size)
+                scratch.resize(size);
+            return scratch.data();
+        }
+
+        static GLuint replayName(size_t kind, GLuint name) {
+            if (!name)
+                return 0;
+            const auto find = gReplay.names[kind].find(name);
+            return find != gReplay.names[kind].end() ? find->second : name;
+        }
+
+        static const GLuint *replayNames(size_t kind, const GLuint *names, GLsizei count) {
+            GLuint *const replay = (GLuint *)replayScratch(0, count * sizeof(GLuint));
+            for (GLsizei i = 0; i < count; i++)
+                replay[i] = replayName(kind, names ? names[i] : 0);
+            return replay;
+        }
+
+        static void replayGenerated(size_t kind, const GLuint *names, const GLuint *generated, GLsizei count) {
+            if (!names)
+                return;
+            for (GLsizei i = 0; i < count; i++)
+                gReplay.names[kind][names[i]] = generated[i];
+        }
+
+        static inline uint64_t replayKey(GLuint program, uint32_t value) {
+            return (uint64_t(program) << 32) | value;
+        }
+
+        static GLint replayLocation(GLint location) {
+            const auto find = gReplay.locations.find(replayKey(gReplay.program, location));
+            return find != gReplay.locations.end() ? find->second : location;
+        }
+
+        static GLuint replayBlock(GLuint program, GLuint index) {
+            const auto find = gReplay.blocks.find(replayKey(program, index));
+            return find != gReplay.blocks.end() ? find->second : index;
+        }
+
+        static GLsync replaySync(uint64_t sync) {
+            const auto find = gReplay.syncs.find(sync);
+            return find != gReplay.syncs.end() ? find->second : nullptr;
+        }
+
+        bool replayOpen(const char *file) {
+            replayClose();
+            auto read = u::read(file, "rb");
+            if (!read || read->size() < sizeof kCaptureMagic)
+                return false;
+            if (memcmp(read->data(), kCaptureMagic, sizeof kCaptureMagic))
+                return false;
+            gReplay.data = u::move(*read);
+            gReplay.position = sizeof kCaptureMagic;
+            return true;
+        }
+
+        void replayClose() {
+            gReplay.data.destroy();
+            gReplay.position = 0;
+            for (auto &it : gReplay.names)
+                it.clear();
+            gReplay.locations.clear();
+            gReplay.blocks.clear();
+            gReplay.syncs.clear();
+            gReplay.program = 0;
+            gReplay.packBuffer = 0;
+            gReplay.stats = ReplayStats();
+        }
+
+        const ReplayStats &replayStats() {
+            return gReplay.stats;
+        }
+
+        bool replayFrame() {
+            while (gReplay.position < gReplay.data.size()) {
+                const uint16_t call = replayValue<uint16_t>();
+                if (call == kCallFrame) {
+                    gReplay.stats.frames++;
+                    return true;
+                }
+                gReplay.stats.calls++;
+                switch (call) {
+                case kCallBufferWrite: {
+                    const GLuint buffer = replayName(kNameBuffer, replayValue<GLuint>());
+                    const GLintptr offset = GLintptr(replayValue<uint64_t>());
+                    size_t size = 0;
+                    const void *const data = replayData(&size);
+                    glBindBuffer_(GL_COPY_WRITE_BUFFER, buffer);
+                    glBufferSubData_(GL_COPY_WRITE_BUFFER, offset, size, data);
+                    break;
+                }
+        """))
+        for f in functionList:
+            cases = io.StringIO()
+            printReplay(cases, f)
+            for line in cases.getvalue().splitlines():
+                source.write('    %s\n' % (line))
+        source.write(textwrap.dedent("""\
+                default:
+                    u::Log::err("[gl] => corrupt capture at %zu\\n", gReplay.position);
+                    gReplay.position = gReplay.data.size();
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        }
+        """))
 
 def main(argv):
     protos = 'tools/glprotos'
@@ -84,6 +84,45 @@ partitioned:
     insertion_sort(start, end, fun);
 }
 
+// stable least significant digit radix sort of unsigned integer keys and the
+// values which go along with them, one byte of the keys at a time. Passes over
+// a byte which is the same for every key are skipped. The scratch arrays must
+// have room for count elements, the result ends up in keys and values
+template <typename K, typename V>
+inline void radixSort(K *keys, V *values, K *scratchKeys, V *scratchValues, size_t count) {
+    if (count < 2)
+        return;
+    K *sourceKeys = keys;
+    K *targetKeys = scratchKeys;
+    V *sourceValues = values;
+    V *targetValues = scratchValues;
+    for (size_t shift = 0; shift < sizeof(K) * 8; shift += 8) {
+        size_t offsets[256] = { 0 };
+        for (size_t i = 0; i < count; i++)
+            offsets[(sourceKeys[i] >> shift) & 0xFF]++;
+        if (offsets[(sourceKeys[0] >> shift) & 0xFF] == count)
+            continue;
+        for (size_t i = 0, sum = 0; i < 256; i++) {
+            const size_t digits = offsets[i];
+            offsets[i] = sum;
+            sum += digits;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const size_t index = offsets[(sourceKeys[i] >> shift) & 0xFF]++;
+            targetKeys[index] = sourceKeys[i];
+            targetValues[index] = u::move(sourceValues[i]);
+        }
+        u::swap(sourceKeys, targetKeys);
+        u::swap(sourceValues, targetValues);
+    }
+    if (sourceKeys == keys)
+        return;
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = sourceKeys[i];
+        values[i] = u::move(sourceValues[i]);
+    }
+}
+
 template <typename I, typename T>
 inline I find(I first, I last, const T &value) {
     while (first != last) {
@@ -0,0 +1,298 @@
+#include <string.h>
+
+#include <SDL_thread.h>
+#include <SDL_mutex.h>
+#include <SDL_timer.h>
+#include <SDL_cpuinfo.h>
+
+#include "u_jobs.h"
+#include "u_assert.h"
+#include "u_log.h"
+#include "u_profiler.h"
+
+namespace u {
+
+JobSystem gJobs;
+
+JobSystem::Queue::Queue()
+    : owner(nullptr)
+    , index(0)
+    , mutex((void *)SDL_CreateMutex())
+    , head(0)
+    , tail(0)
+    , timingsMutex((void *)SDL_CreateMutex())
+{
+}
+
+JobSystem::JobSystem()
+    : m_jobs(nullptr)
+    , m_semaphore(nullptr)
+    , m_index(0)
+{
+    SDL_AtomicSet(&m_allocate, 0);
+    SDL_AtomicSet(&m_running, 0);
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+bool JobSystem::init() {
+    if (m_jobs)
+        return true;
+
+    m_jobs = new Job[kMaxJobs];
+    memset(m_jobs, 0, sizeof *m_jobs * kMaxJobs);
+
+    m_index = SDL_TLSCreate();
+    if (!m_index)
+        return false;
+    m_semaphore = (void *)SDL_CreateSemaphore(0);
+    if (!m_semaphore)
+        return false;
+
+    // one queue for the calling thread and one for every worker
+    const int cpus = SDL_GetCPUCount();
+    const size_t workers = cpus > 1 ? size_t(cpus - 1) : 0;
+    for (size_t i = 0; i <= workers; i++) {
+        Queue *queue = new Queue;
+        queue->owner = this;
+        queue->index = i;
+        m_queues.push_back(queue);
+    }
+    SDL_TLSSet(m_index, (const void *)1, nullptr);
+
+    SDL_AtomicSet(&m_running, 1);
+    for (size_t i = 1; i <= workers; i++) {
+        SDL_Thread *thread = SDL_CreateThread(workerThread, "worker", m_queues[i]);
+        if (!thread)
+            return false;
+        m_threads.push_back((void *)thread);
+    }
+
+    u::Log::out("[jobs] => started %zu %s\n", workers, workers == 1 ? "worker" : "workers");
+    return true;
+}
+
+void JobSystem::shutdown() {
+    if (!m_jobs)
+        return;
+
+    SDL_AtomicSet(&m_running, 0);
+    for (size_t i = 0; i < m_threads.size(); i++)
+        SDL_SemPost((SDL_sem *)m_semaphore);
+    for (auto *it : m_threads)
+        SDL_WaitThread((SDL_Thread *)it, nullptr);
+    m_threads.destroy();
+
+    for (auto *it : m_queues) {
+        SDL_DestroyMutex((SDL_mutex *)it->mutex);
+        SDL_DestroyMutex((SDL_mutex *)it->timingsMutex);
+        delete it;
+    }
+    m_queues.destroy();
+
+    if (m_semaphore)
+        SDL_DestroySemaphore((SDL_sem *)m_semaphore);
+    m_semaphore = nullptr;
+
+    delete[] m_jobs;
+    m_jobs = nullptr;
+}
+
+int JobSystem::workerThread(void *data) {
+    Queue *const queue = (Queue *)data;
+    JobSystem *const system = queue->owner;
+    SDL_TLSSet(system->m_index, (const void *)(queue->index + 1), nullptr);
+    while (SDL_AtomicGet(&system->m_running)) {
+        Job *job = system->next();
+        if (job)
+            system->execute(job);
+        else
+            SDL_SemWait((SDL_sem *)system->m_semaphore);
+    }
+    return 0;
+}
+
+Job *JobSystem::allocate(int references) {
+    U_ASSERT(m_jobs);
+    // claim the next free job in the pool: when every job is in flight help
+    // finish some of them instead of spinning
+    for (size_t attempts = 0; ; attempts++) {
+        const size_t index = size_t(unsigned(SDL_AtomicAdd(&m_allocate, 1))) % kMaxJobs;
+        Job *job = &m_jobs[index];
+        if (SDL_AtomicCAS(&job->references, 0, references))
+            return job;
+        if (attempts >= kMaxJobs) {
+            if (Job *help = next())
+                execute(help);
+            attempts = 0;
+        }
+    }
+}
+
+JobSystem::Queue *JobSystem::queue() {
+    if (m_queues.empty())
+        return nullptr;
+    // threads not owned by the job system share the queue of the main thread
+    const size_t index = size_t(SDL_TLSGet(m_index));
+    return m_queues[index ? index - 1 : 0];
+}
+
+// one reference is held until the job finishes and one by its creator
+Job *JobSystem::create(const char *name, JobFunction function, void *data, size_t begin, size_t end) {
+    return setup(allocate(2), name, function, data, begin, end);
+}
+
+Job *JobSystem::setup(Job *job, const char *name, JobFunction function, void *data, size_t begin, size_t end) {
+    job->function = function;
+    job->data = data;
+    job->begin = begin;
+    job->end = end;
+    job->name = name;
+    job->parent = nullptr;
+    job->continuationCount = 0;
+    SDL_AtomicSet(&job->unfinished, 1);
+    SDL_AtomicSet(&job->pending, 1);
+    return job;
+}
+
+Job *JobSystem::createChild(Job *parent, const char *name, JobFunction function, void *data, size_t begin, size_t end) {
+    SDL_AtomicAdd(&parent->unfinished, 1);
+    // only referenced until it finishes, the parent keeps track of it
+    Job *job = setup(allocate(1), name, function, data, begin, end);
+    job->parent = parent;
+    return job;
+}
+
+void JobSystem::release(Job *job) {
+    SDL_AtomicAdd(&job->references, -1);
+}
+
+void JobSystem::depend(Job *job, Job *dependency) {
+    U_ASSERT(dependency->continuationCount < Job::kMaxContinuations);
+    dependency->continuations[dependency->continuationCount++] = job;
+    SDL_AtomicAdd(&job->pending, 1);
+}
+
+void JobSystem::run(Job *job) {
+    // only once every dependency has finished
+    if (SDL_AtomicAdd(&job->pending, -1) == 1)
+        push(job);
+}
+
+void JobSystem::wait(Job *job) {
+    while (!finished(job)) {
+        if (Job *next = this->next())
+            execute(next);
+        else
+            SDL_Delay(0);
+    }
+}
+
+void JobSystem::push(Job *job) {
+    Queue *const queue = this->queue();
+    if (!queue) {
+        // not initialized: execute immediately
+        execute(job);
+        return;
+    }
+    SDL_LockMutex((SDL_mutex *)queue->mutex);
+    queue->jobs[queue->tail++ % kMaxJobs] = job;
+    SDL_UnlockMutex((SDL_mutex *)queue->mutex);
+    SDL_SemPost((SDL_sem *)m_semaphore);
+}
+
+Job *JobSystem::next() {
+    Queue *const own = queue();
+    if (!own)
+        return nullptr;
+
+    // newest job from our own queue first, it's most likely still in cache
+    Job *job = nullptr;
+    SDL_LockMutex((SDL_mutex *)own->mutex);
+    if (own->tail != own->head)
+        job = own->jobs[--own->tail % kMaxJobs];
+    SDL_UnlockMutex((SDL_mutex *)own->mutex);
+    if (job)
+        return job;
+
+    // otherwise steal the oldest job from another queue
+    const size_t count = m_queues.size();
+    for (size_t i = 1; i < count && !job; i++) {
+        Queue *const steal = m_queues[(own->index + i) % count];
+        SDL_LockMutex((SDL_mutex *)steal->mutex);
+        if (steal->tail != steal->head)
+            job = steal->jobs[steal->head++ % kMaxJobs];
+        SDL_UnlockMutex((SDL_mutex *)steal->mutex);
+    }
+    return job;
+}
+
+void JobSystem::execute(Job *job) {
+    const char *const name = job->name;
+    const Uint64 start = name ? SDL_GetPerformanceCounter() : 0;
+
+    if (job->function) {
+        U_PROFILE(name ? name : "job");
+        job->function(job->data, job->begin, job->end);
+    }
+    const Uint64 stop = name ? SDL_GetPerformanceCounter() : 0;
+    finish(job);
+
+    Queue *const queue = this->queue();
+    if (!name || !queue)
+        return;
+    const float milliseconds = float(stop - start) * 1000.0f
+                             / float(SDL_GetPerformanceFrequency());
+    SDL_LockMutex((SDL_mutex *)queue->timingsMutex);
+    bool found = false;
+    for (auto &it : queue->timings) {
+        if (strcmp(it.name, name))
+            continue;
+        it.milliseconds += milliseconds;
+        it.count++;
+        found = true;
+        break;
+    }
+    if (!found)
+        queue->timings.push_back({ name, milliseconds, 1 });
+    SDL_UnlockMutex((SDL_mutex *)queue->timingsMutex);
+}
+
+void JobSystem::finish(Job *job) {
+    // children may still be running
+    if (SDL_AtomicAdd(&job->unfinished, -1) != 1)
+        return;
+    Job *const parent = job->parent;
+    for (size_t i = 0; i < job->continuationCount; i++)
+        run(job->continuations[i]);
+    // the job can be reused once its creator released it as well
+    release(job);
+    if (parent)
+        finish(parent);
+}
+
+void JobSystem::timings(u::vector<JobTiming> &out) {
+    out.clear();
+    for (auto *queue : m_queues) {
+        SDL_LockMutex((SDL_mutex *)queue->timingsMutex);
+        for (const auto &it : queue->timings) {
+            bool found = false;
+            for (auto &jt : out) {
+                if (strcmp(it.name, jt.name))
+                    continue;
+                jt.milliseconds += it.milliseconds;
+                jt.count += it.count;
+                found = true;
+                break;
+            }
+            if (!found)
+                out.push_back(it);
+        }
+        queue->timings.clear();
+        SDL_UnlockMutex((SDL_mutex *)queue->timingsMutex);
+    }
+}
+
+}
@@ -0,0 +1,148 @@
+#ifndef U_JOBS_HDR
+#define U_JOBS_HDR
+#include <SDL_atomic.h>
+
+#include "u_vector.h"
+
+namespace u {
+
+typedef void (*JobFunction)(void *data, size_t begin, size_t end);
+
+// A unit of work. Jobs are allocated from a fixed pool owned by the job system.
+// A job returned by create() stays valid until it has finished and its creator
+// released it, such that waiting on it never looks at a job which reused its
+// slot. A child is only referenced until it finishes and must not be touched
+// after it's handed to run.
+struct Job {
+    static constexpr size_t kMaxContinuations = 8;
+
+    JobFunction function;
+    void *data;
+    size_t begin;
+    size_t end;
+    const char *name;
+    Job *parent;
+    Job *continuations[kMaxContinuations];
+    size_t continuationCount;
+    SDL_atomic_t unfinished; // this job and all its children
+    SDL_atomic_t pending; // dependencies (and the call to run) not yet satisfied
+    SDL_atomic_t references; // the slot is free once this drops to zero
+};
+
+// Time spent executing jobs of a given name during the last frame
+struct JobTiming {
+    const char *name;
+    float milliseconds;
+    size_t count;
+};
+
+// A work-stealing job system. A fixed pool of worker threads (one less than
+// the number of processors) each owns a queue of jobs, idle workers steal
+// from the queues of others. The thread which calls init() participates in
+// the execution of jobs whenever it waits on one.
+struct JobSystem {
+    JobSystem();
+    ~JobSystem();
+
+    bool init();
+    void shutdown();
+
+    // create a job, the function is invoked with the [begin, end) range given;
+    // the job must be released once it is no longer waited on
+    Job *create(const char *name, JobFunction function, void *data, size_t begin = 0, size_t end = 0);
+    // create a job which must finish before parent is considered finished
+    Job *createChild(Job *parent, const char *name, JobFunction function, void *data, size_t begin = 0, size_t end = 0);
+    // give up the handle returned by create(), the job may still be running
+    void release(Job *job);
+
+    // job will not start before dependency finished; must be called before
+    // either of the two jobs are handed to run
+    void depend(Job *job, Job *dependency);
+
+    // schedule a job for execution
+    void run(Job *job);
+    // execute other jobs until this job has finished
+    void wait(Job *job);
+    bool finished(Job *job) const;
+
+    // split [0, count) into ranges of grain elements and invoke function
+    // with every range in parallel, returns when all ranges were processed
+    template <typename F>
+    void parallelFor(const char *name, size_t count, size_t grain, const F &function);
+
+    size_t workers() const;
+
+    // collect the timings of the jobs executed since the last call
+    void timings(u::vector<JobTiming> &out);
+
+private:
+    static constexpr size_t kMaxJobs = 4096;
+
+    struct Queue {
+        Queue();
+        JobSystem *owner;
+        size_t index;
+        void *mutex;
+        Job *jobs[kMaxJobs];
+        size_t head;
+        size_t tail;
+        u::vector<JobTiming> timings;
+        void *timingsMutex;
+    };
+
+    template <typename F>
+    static void parallelForThunk(void *data, size_t begin, size_t end);
+
+    static int workerThread(void *data);
+
+    Job *allocate(int references);
+    static Job *setup(Job *job, const char *name, JobFunction function, void *data, size_t begin, size_t end);
+    Queue *queue();
+    void push(Job *job);
+    Job *next();
+    void execute(Job *job);
+    void finish(Job *job);
+
+    Job *m_jobs;
+    SDL_atomic_t m_allocate;
+    SDL_atomic_t m_running;
+    u::vector<Queue*> m_queues;
+    u::vector<void *> m_threads;
+    void *m_semaphore;
+    unsigned int m_index; // thread local storage for the queue index
+};
+
+extern JobSystem gJobs;
+
+template <typename F>
+inline void JobSystem::parallelForThunk(void *data, size_t begin, size_t end) {
+    (*(const F *)data)(begin, end);
+}
+
+template <typename F>
+inline void JobSystem::parallelFor(const char *name, size_t count, size_t grain, const F &function) {
+    if (count == 0)
+        return;
+    if (grain == 0)
+        grain = 1;
+    Job *root = create(nullptr, nullptr, nullptr);
+    for (size_t begin = 0; begin < count; begin += grain) {
+        const size_t end = begin + grain < count ? begin + grain : count;
+        run(createChild(root, name, &parallelForThunk<F>, (void *)&function, begin, end));
+    }
+    run(root);
+    wait(root);
+    release(root);
+}
+
+inline size_t JobSystem::workers() const {
+    return m_threads.size();
+}
+
+inline bool JobSystem::finished(Job *job) const {
+    return SDL_AtomicGet(&job->unfinished) == 0;
+}
+
+}
+
+#endif
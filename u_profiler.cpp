@@ -0,0 +1,177 @@
+#include <string.h>
+
+#include <SDL_thread.h>
+#include <SDL_timer.h>
+
+#include "u_profiler.h"
+#include "u_algorithm.h"
+#include "u_file.h"
+#include "u_log.h"
+
+namespace u {
+
+Profiler gProfiler;
+
+constexpr size_t Profiler::kMaxThreads;
+constexpr size_t Profiler::kMaxEvents;
+constexpr size_t Profiler::kMaxDepth;
+
+Profiler::Thread::Thread(size_t index)
+    : index(index)
+    , depth(0)
+    , children()
+{
+    SDL_AtomicSet(&dropped, 0);
+    SDL_AtomicSet(&head, 0);
+    SDL_AtomicSet(&tail, 0);
+}
+
+Profiler::Profiler()
+    : m_index(0)
+    , m_threads()
+    , m_dropped(0)
+    , m_traceFrames(0)
+    , m_traceStart(0)
+{
+    SDL_AtomicSet(&m_threadCount, 0);
+}
+
+Profiler::~Profiler() {
+    for (auto *it : m_threads)
+        delete it;
+}
+
+bool Profiler::init() {
+    if (m_index)
+        return true;
+    m_index = SDL_TLSCreate();
+    return m_index;
+}
+
+Profiler::Thread *Profiler::thread() {
+    if (!m_index)
+        return nullptr;
+    Thread *thread = (Thread *)SDL_TLSGet(m_index);
+    if (thread)
+        return thread;
+    // reserve a slot, threads beyond kMaxThreads are not profiled
+    int index;
+    do {
+        index = SDL_AtomicGet(&m_threadCount);
+        if (size_t(index) >= kMaxThreads)
+            return nullptr;
+    } while (!SDL_AtomicCAS(&m_threadCount, index, index + 1));
+    thread = new Thread(index);
+    SDL_TLSSet(m_index, thread, nullptr);
+    SDL_AtomicSetPtr((void **)&m_threads[index], thread);
+    return thread;
+}
+
+void Profiler::begin(const char *name) {
+    Thread *const thread = this->thread();
+    if (!thread)
+        return;
+    // scopes nested too deeply are only counted such that end() stays balanced
+    if (thread->depth < kMaxDepth)
+        thread->stack[thread->depth] = { name, SDL_GetPerformanceCounter(), 0, thread->depth };
+    thread->depth++;
+}
+
+void Profiler::end() {
+    Thread *const thread = this->thread();
+    if (!thread || !thread->depth)
+        return;
+    if (--thread->depth >= kMaxDepth)
+        return;
+    const unsigned int head = SDL_AtomicGet(&thread->head);
+    if (head - (unsigned int)SDL_AtomicGet(&thread->tail) >= kMaxEvents) {
+        SDL_AtomicAdd(&thread->dropped, 1);
+        return;
+    }
+    Event &event = thread->events[head & (kMaxEvents - 1)];
+    event = thread->stack[thread->depth];
+    event.end = SDL_GetPerformanceCounter();
+    // the event must be visible before it is published
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&thread->head, int(head + 1));
+}
+
+void Profiler::collect(Thread *thread) {
+    const unsigned int head = SDL_AtomicGet(&thread->head);
+    SDL_MemoryBarrierAcquire();
+    const double scale = 1000.0 / SDL_GetPerformanceFrequency();
+    for (unsigned int i = SDL_AtomicGet(&thread->tail); i != head; i++) {
+        const Event &event = thread->events[i & (kMaxEvents - 1)];
+        const uint64_t duration = event.end - event.start;
+        // nested scopes are recorded before their parent
+        const uint64_t self = duration - u::min(duration, thread->children[event.depth + 1]);
+        thread->children[event.depth + 1] = 0;
+        thread->children[event.depth] += duration;
+
+        if (m_traceFrames && event.start >= m_traceStart)
+            m_traceEvents.push_back({ event, thread->index });
+
+        bool found = false;
+        for (auto &it : m_collect) {
+            if (strcmp(it.name, event.name))
+                continue;
+            it.depth = u::min(it.depth, event.depth);
+            it.milliseconds += float(duration * scale);
+            it.self += float(self * scale);
+            it.count++;
+            found = true;
+            break;
+        }
+        if (!found)
+            m_collect.push_back({ event.name, event.depth, float(duration * scale), float(self * scale), 1 });
+    }
+    SDL_AtomicSet(&thread->tail, int(head));
+    m_dropped += SDL_AtomicSet(&thread->dropped, 0);
+}
+
+void Profiler::frame() {
+    m_collect.clear();
+    m_dropped = 0;
+    const size_t count = u::min(size_t(SDL_AtomicGet(&m_threadCount)), kMaxThreads);
+    for (size_t i = 0; i < count; i++)
+        if (Thread *const thread = (Thread *)SDL_AtomicGetPtr((void **)&m_threads[i]))
+            collect(thread);
+    u::sort(m_collect.begin(), m_collect.end(),
+        [](const ProfileTiming &lhs, const ProfileTiming &rhs) { return lhs.self > rhs.self; });
+    m_timings.swap(m_collect);
+
+    if (m_traceFrames && --m_traceFrames == 0)
+        writeTrace();
+}
+
+void Profiler::trace(const u::string &file, size_t frames) {
+    if (tracing() || !frames)
+        return;
+    m_traceFile = file;
+    m_traceFrames = frames;
+    m_traceStart = SDL_GetPerformanceCounter();
+    m_traceEvents.clear();
+}
+
+void Profiler::writeTrace() {
+    u::file file = u::fopen(m_traceFile, "w");
+    if (!file) {
+        u::Log::err("[profiler] => failed to write %s\n", m_traceFile);
+        m_traceEvents.destroy();
+        return;
+    }
+    // timestamps of the trace format are in microseconds
+    const double scale = 1000000.0 / SDL_GetPerformanceFrequency();
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < m_traceEvents.size(); i++) {
+        const auto &it = m_traceEvents[i];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+            it.event.name, it.thread, (it.event.start - m_traceStart) * scale,
+            (it.event.end - it.event.start) * scale, i + 1 < m_traceEvents.size() ? "," : "");
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    u::Log::out("[profiler] => wrote %zu events to %s\n", m_traceEvents.size(), m_traceFile);
+    m_traceEvents.destroy();
+}
+
+}
@@ -0,0 +1,132 @@
+#ifndef U_PROFILER_HDR
+#define U_PROFILER_HDR
+#include <stdint.h>
+
+#include <SDL_atomic.h>
+
+#include "u_string.h"
+#include "u_vector.h"
+
+namespace u {
+
+// Time spent in a profiled scope during the last frame
+struct ProfileTiming {
+    const char *name;
+    size_t depth; // nesting of the scope the first time it was entered
+    float milliseconds; // including nested scopes
+    float self; // excluding nested scopes
+    size_t count;
+};
+
+// A hierarchical CPU profiler. Every thread which enters a profiled scope owns
+// a ring of events which only that thread writes into and only the thread
+// calling frame() reads from, scopes are recorded when they are left such that
+// nested scopes always precede their parent. Recording never takes a lock;
+// events are dropped when a thread records more than kMaxEvents in a frame.
+struct Profiler {
+    static constexpr size_t kMaxThreads = 64;
+    static constexpr size_t kMaxEvents = 16384; // must be a power of two
+    static constexpr size_t kMaxDepth = 32;
+
+    Profiler();
+    ~Profiler();
+
+    bool init();
+
+    void begin(const char *name);
+    void end();
+
+    // collect the events of all threads, must be called once every frame
+    // from the thread which called init()
+    void frame();
+
+    // the scopes of the last frame sorted by the time spent in them alone
+    const u::vector<ProfileTiming> &timings() const;
+    // events dropped during the last frame
+    size_t dropped() const;
+
+    // record the events of the next frames and write them to file as a
+    // Chrome trace (chrome://tracing) once done
+    void trace(const u::string &file, size_t frames);
+    bool tracing() const;
+
+private:
+    struct Event {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+        size_t depth;
+    };
+
+    struct TraceEvent {
+        Event event;
+        size_t thread;
+    };
+
+    struct Thread {
+        Thread(size_t index);
+        size_t index;
+        // written by the owning thread only
+        Event events[kMaxEvents];
+        Event stack[kMaxDepth];
+        size_t depth;
+        SDL_atomic_t dropped;
+        SDL_atomic_t head; // events published by the owning thread
+        SDL_atomic_t tail; // events consumed by frame()
+        // used by frame() only
+        uint64_t children[kMaxDepth + 1]; // time spent in nested scopes
+    };
+
+    Thread *thread();
+    void collect(Thread *thread);
+    void writeTrace();
+
+    unsigned int m_index; // thread local storage
+    Thread *m_threads[kMaxThreads];
+    SDL_atomic_t m_threadCount;
+    u::vector<ProfileTiming> m_collect;
+    u::vector<ProfileTiming> m_timings;
+    size_t m_dropped;
+    u::string m_traceFile;
+    size_t m_traceFrames;
+    uint64_t m_traceStart;
+    u::vector<TraceEvent> m_traceEvents;
+};
+
+inline const u::vector<ProfileTiming> &Profiler::timings() const {
+    return m_timings;
+}
+
+inline size_t Profiler::dropped() const {
+    return m_dropped;
+}
+
+inline bool Profiler::tracing() const {
+    return m_traceFrames;
+}
+
+extern Profiler gProfiler;
+
+struct ProfileScope {
+    ProfileScope(const char *name);
+    ~ProfileScope();
+};
+
+inline ProfileScope::ProfileScope(const char *name) {
+    gProfiler.begin(name);
+}
+
+inline ProfileScope::~ProfileScope() {
+    gProfiler.end();
+}
+
+}
+
+#define U_PROFILE_CONCAT_(X, Y) X##Y
+#define U_PROFILE_CONCAT(X, Y) U_PROFILE_CONCAT_(X, Y)
+
+// profile the enclosing scope, NAME must outlive the program
+#define U_PROFILE(NAME) \
+    u::ProfileScope U_PROFILE_CONCAT(profileScope, __LINE__)(NAME)
+
+#endif